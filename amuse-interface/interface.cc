@@ -1,9 +1,98 @@
 #include "petar.hpp"
+#include "probe_tree.hpp"
 #include "interface.h"
 
 // AMUSE STOPPING CONDITIONS SUPPORT
 #include <stopcond.h>
 
+//! get data of a list of particles to rank 0 with one collective communication
+/*! All ranks have the same ID list (arguments are broadcasted by the AMUSE worker). 
+    Each rank finds its local particles from the list, packs the list index and the data, and sends them to rank 0 by MPI_Gatherv.
+  @param[in] _petar: PeTar instance
+  @param[out] _data: [_n_field] output arrays with size of _n, only rank 0 is filled
+  @param[in] _index: particle ID list
+  @param[in] _n: number of particles
+  @param[in] _n_field: number of data fields
+  @param[in] _pack: function (const FPSoft&, double*) to pack _n_field data of one particle
+  \return 0: success; -1: some particles are not found
+ */
+template <class Tpack>
+static int getParticleDataMany(PeTar& _petar, double* const* _data, const int* _index, const int _n, const int _n_field, Tpack _pack) {
+    const int n_unit = _n_field+1; // list index + data
+    static PS::ReallocatableArray<double> data_send;
+    data_send.resizeNoInitialize(_n*n_unit);
+    int n_found = 0;
+    for (int i=0; i<_n; i++) {
+        int adr = _petar.getParticleAdrFromID(_index[i]);
+        if (adr>=0) {
+            double* pack = &data_send[n_found*n_unit];
+            pack[0] = i;
+            _pack(_petar.system_soft[adr], &pack[1]);
+            n_found++;
+        }
+    }
+#ifdef PARTICLE_SIMULATOR_MPI_PARALLEL
+    const int n_proc = _petar.n_proc;
+    const int my_rank = _petar.my_rank;
+    static PS::ReallocatableArray<int> n_recv;
+    static PS::ReallocatableArray<int> n_recv_disp;
+    static PS::ReallocatableArray<double> data_recv;
+    n_recv.resizeNoInitialize(n_proc);
+    n_recv_disp.resizeNoInitialize(n_proc+1);
+    int n_send = n_found*n_unit;
+    MPI_Gather(&n_send, 1, MPI_INT, n_recv.getPointer(), 1, MPI_INT, 0, MPI_COMM_WORLD);
+    if (my_rank==0) {
+        n_recv_disp[0] = 0;
+        for (int i=0; i<n_proc; i++) n_recv_disp[i+1] = n_recv_disp[i] + n_recv[i];
+        data_recv.resizeNoInitialize(n_recv_disp[n_proc]);
+    }
+    MPI_Gatherv(data_send.getPointer(), n_send, MPI_DOUBLE, data_recv.getPointer(), n_recv.getPointer(), n_recv_disp.getPointer(), MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    if (my_rank==0) {
+        n_found = n_recv_disp[n_proc]/n_unit;
+        for (int k=0; k<n_found; k++) {
+            const double* pack = &data_recv[k*n_unit];
+            const int i = pack[0];
+            for (int j=0; j<_n_field; j++) _data[j][i] = pack[j+1];
+        }
+        if (n_found<_n) return -1;
+    }
+#else
+    for (int k=0; k<n_found; k++) {
+        const double* pack = &data_send[k*n_unit];
+        const int i = pack[0];
+        for (int j=0; j<_n_field; j++) _data[j][i] = pack[j+1];
+    }
+    if (n_found<_n) return -1;
+#endif
+    return 0;
+}
+
+//! set data of a list of particles
+/*! All ranks have the same ID list and data (arguments are broadcasted by the AMUSE worker), 
+    thus each rank updates its local particles directly and only one reduction is needed for the error check.
+  @param[in] _petar: PeTar instance
+  @param[in] _index: particle ID list
+  @param[in] _n: number of particles
+  @param[in] _unpack: function (FPSoft&, const int i) to set data of the particle with list index i
+  \return 0: success; -1: some particles are not found
+ */
+template <class Tunpack>
+static int setParticleDataMany(PeTar& _petar, const int* _index, const int _n, Tunpack _unpack) {
+    int n_found = 0;
+    for (int i=0; i<_n; i++) {
+        int adr = _petar.getParticleAdrFromID(_index[i]);
+        if (adr>=0) {
+            _unpack(_petar.system_soft[adr], i);
+            n_found++;
+        }
+    }
+#ifdef PARTICLE_SIMULATOR_MPI_PARALLEL
+    n_found = PS::Comm::getSum(n_found);
+#endif
+    if (n_found<_n) return -1;
+    return 0;
+}
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -20,6 +109,8 @@ extern "C" {
     static CalcForcePPNoSimd<ParticleBase,FPSoft> fcalc;
 #endif
     static int n_particle_in_interrupt_connected_cluster_glb; // 
+    static ProbeTree probe_tree; // tree for get_gravity_at_point and get_potential_at_point
+    static int gravity_at_point_mode = 0; // 0: direct sum; 1: tree
 
     // flags
     static bool particle_list_change_flag=true;
@@ -546,6 +637,131 @@ extern "C" {
         return 0;
     }
 
+    // array versions of getters and setters
+
+    int get_state_many(int * index_of_the_particle,
+                       double * mass, 
+                       double * x, double * y, double * z,
+                       double * vx, double * vy, double * vz, double * radius, int n) {
+        reconstruct_particle_list();
+        double* data[8] = {mass, x, y, z, vx, vy, vz, radius};
+        return getParticleDataMany(*ptr, data, index_of_the_particle, n, 8, 
+                                   [](const FPSoft& p, double* d) {
+                                       d[0] = p.mass;
+                                       d[1] = p.pos.x;
+                                       d[2] = p.pos.y;
+                                       d[3] = p.pos.z;
+                                       d[4] = p.vel.x;
+                                       d[5] = p.vel.y;
+                                       d[6] = p.vel.z;
+                                       d[7] = p.radius;
+                                   });
+    }
+
+    int set_state_many(int * index_of_the_particle,
+                       double * mass, 
+                       double * x, double * y, double * z,
+                       double * vx, double * vy, double * vz, double * radius, int n) {
+        reconstruct_particle_list();
+        return setParticleDataMany(*ptr, index_of_the_particle, n, 
+                                   [&](FPSoft& p, const int i) {
+                                       p.mass  = mass[i];
+                                       p.pos.x = x[i];
+                                       p.pos.y = y[i];
+                                       p.pos.z = z[i];
+                                       p.vel.x = vx[i];
+                                       p.vel.y = vy[i];
+                                       p.vel.z = vz[i];
+                                       p.radius= radius[i];
+                                   });
+    }
+
+    int get_mass_many(int * index_of_the_particle, double * mass, int n) {
+        reconstruct_particle_list();
+        double* data[1] = {mass};
+        return getParticleDataMany(*ptr, data, index_of_the_particle, n, 1, 
+                                   [](const FPSoft& p, double* d) { d[0] = p.mass; });
+    }
+
+    int set_mass_many(int * index_of_the_particle, double * mass, int n) {
+        reconstruct_particle_list();
+        return setParticleDataMany(*ptr, index_of_the_particle, n, 
+                                   [&](FPSoft& p, const int i) { p.mass = mass[i]; });
+    }
+
+    int get_radius_many(int * index_of_the_particle, double * radius, int n) {
+        reconstruct_particle_list();
+        double* data[1] = {radius};
+        return getParticleDataMany(*ptr, data, index_of_the_particle, n, 1, 
+                                   [](const FPSoft& p, double* d) { d[0] = p.radius; });
+    }
+
+    int set_radius_many(int * index_of_the_particle, double * radius, int n) {
+        reconstruct_particle_list();
+        return setParticleDataMany(*ptr, index_of_the_particle, n, 
+                                   [&](FPSoft& p, const int i) { p.radius = radius[i]; });
+    }
+
+    int get_position_many(int * index_of_the_particle, double * x, double * y, double * z, int n) {
+        reconstruct_particle_list();
+        double* data[3] = {x, y, z};
+        return getParticleDataMany(*ptr, data, index_of_the_particle, n, 3, 
+                                   [](const FPSoft& p, double* d) {
+                                       d[0] = p.pos.x;
+                                       d[1] = p.pos.y;
+                                       d[2] = p.pos.z;
+                                   });
+    }
+
+    int set_position_many(int * index_of_the_particle, double * x, double * y, double * z, int n) {
+        reconstruct_particle_list();
+        return setParticleDataMany(*ptr, index_of_the_particle, n, 
+                                   [&](FPSoft& p, const int i) {
+                                       p.pos.x = x[i];
+                                       p.pos.y = y[i];
+                                       p.pos.z = z[i];
+                                   });
+    }
+
+    int get_velocity_many(int * index_of_the_particle, double * vx, double * vy, double * vz, int n) {
+        reconstruct_particle_list();
+        double* data[3] = {vx, vy, vz};
+        return getParticleDataMany(*ptr, data, index_of_the_particle, n, 3, 
+                                   [](const FPSoft& p, double* d) {
+                                       d[0] = p.vel.x;
+                                       d[1] = p.vel.y;
+                                       d[2] = p.vel.z;
+                                   });
+    }
+
+    int set_velocity_many(int * index_of_the_particle, double * vx, double * vy, double * vz, int n) {
+        reconstruct_particle_list();
+        return setParticleDataMany(*ptr, index_of_the_particle, n, 
+                                   [&](FPSoft& p, const int i) {
+                                       p.vel.x = vx[i];
+                                       p.vel.y = vy[i];
+                                       p.vel.z = vz[i];
+                                   });
+    }
+
+    int get_acceleration_many(int * index_of_the_particle, double * ax, double * ay, double * az, int n) {
+        reconstruct_particle_list();
+        double* data[3] = {ax, ay, az};
+        return getParticleDataMany(*ptr, data, index_of_the_particle, n, 3, 
+                                   [](const FPSoft& p, double* d) {
+                                       d[0] = p.acc.x;
+                                       d[1] = p.acc.y;
+                                       d[2] = p.acc.z;
+                                   });
+    }
+
+    int get_potential_many(int * index_of_the_particle, double * potential, int n) {
+        reconstruct_particle_list();
+        double* data[1] = {potential};
+        return getParticleDataMany(*ptr, data, index_of_the_particle, n, 1, 
+                                   [](const FPSoft& p, double* d) { d[0] = p.pot_tot; });
+    }
+
     int evolve_model(double time_next) {
 #ifdef INTERFACE_DEBUG_PRINT
         if(ptr->my_rank==0) std::cout<<"PETAR: evolve models start\n";
@@ -968,39 +1184,47 @@ extern "C" {
         // update particle array first if necessary
         reconstruct_particle_list();
 
-        // transform data
-        ParticleBase ptmp[n];
-        ForceSoft force[n];
-        for (int i=0; i<n; i++) {
-            ptmp[i].pos.x = x[i];
-            ptmp[i].pos.y = y[i];
-            ptmp[i].pos.z = z[i];
-            force[i].acc.x = 0;
-            force[i].acc.y = 0;
-            force[i].acc.z = 0;
-        };
+        // acc x, y, z of each point are stored continuously for one reduction
+        static PS::ReallocatableArray<double> acc;
+        acc.resizeNoInitialize(3*n);
+        for (int i=0; i<3*n; i++) acc[i] = 0.0;
 
-        
-        fcalc(ptmp, n, &(ptr->system_soft[0]), ptr->system_soft.getNumberOfParticleLocal(), force);
-
-        for (int i=0; i<n; i++) {
-            forcex[i] = force[i].acc.x;
-            forcey[i] = force[i].acc.y;
-            forcez[i] = force[i].acc.z;
-        }
-
-#ifdef PARTICLE_SIMULATOR_MPI_PARALLEL
-        if (ptr->my_rank==0) {
-            MPI_Reduce(MPI_IN_PLACE, forcex, n, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
-            MPI_Reduce(MPI_IN_PLACE, forcey, n, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
-            MPI_Reduce(MPI_IN_PLACE, forcez, n, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+        const int n_loc = ptr->system_soft.getNumberOfParticleLocal();
+        if (gravity_at_point_mode==1) {
+            probe_tree.build(&(ptr->system_soft[0]), n_loc, ptr->input_parameters.theta.value, ptr->input_parameters.n_leaf_limit.value);
+            probe_tree.calcAccPot(acc.getPointer(), NULL, x, y, z, n, ForceSoft::grav_const);
         }
         else {
-            MPI_Reduce(forcex, NULL, n, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
-            MPI_Reduce(forcey, NULL, n, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
-            MPI_Reduce(forcez, NULL, n, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+            // transform data
+            static PS::ReallocatableArray<ParticleBase> ptmp;
+            static PS::ReallocatableArray<ForceSoft> force;
+            ptmp.resizeNoInitialize(n);
+            force.resizeNoInitialize(n);
+            for (int i=0; i<n; i++) {
+                ptmp[i].pos.x = x[i];
+                ptmp[i].pos.y = y[i];
+                ptmp[i].pos.z = z[i];
+                force[i].clear();
+            };
+
+            fcalc(ptmp.getPointer(), n, &(ptr->system_soft[0]), n_loc, force.getPointer());
+
+            for (int i=0; i<n; i++) {
+                acc[3*i  ] = force[i].acc.x;
+                acc[3*i+1] = force[i].acc.y;
+                acc[3*i+2] = force[i].acc.z;
+            }
         }
+
+#ifdef PARTICLE_SIMULATOR_MPI_PARALLEL
+        if (ptr->my_rank==0) MPI_Reduce(MPI_IN_PLACE,      acc.getPointer(), 3*n, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+        else                 MPI_Reduce(acc.getPointer(), NULL,              3*n, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
 #endif
+        for (int i=0; i<n; i++) {
+            forcex[i] = acc[3*i  ];
+            forcey[i] = acc[3*i+1];
+            forcez[i] = acc[3*i+2];
+        }
         return 0;
     }
 
@@ -1011,19 +1235,30 @@ extern "C" {
         // update particle array first if necessary
         reconstruct_particle_list();
 
-        // transform data
-        ParticleBase ptmp[n];
-        ForceSoft force[n];
-        for (int i=0; i<n; i++) {
-            ptmp[i].pos.x = x[i];
-            ptmp[i].pos.y = y[i];
-            ptmp[i].pos.z = z[i];
-            force[i].pot = 0;
-        };
-
-        fcalc(ptmp, n, &(ptr->system_soft[0]), ptr->system_soft.getNumberOfParticleLocal(), force);
+        for (int i=0; i<n; i++) phi[i] = 0.0;
 
-        for (int i=0; i<n; i++) phi[i] = force[i].pot;
+        const int n_loc = ptr->system_soft.getNumberOfParticleLocal();
+        if (gravity_at_point_mode==1) {
+            probe_tree.build(&(ptr->system_soft[0]), n_loc, ptr->input_parameters.theta.value, ptr->input_parameters.n_leaf_limit.value);
+            probe_tree.calcAccPot(NULL, phi, x, y, z, n, ForceSoft::grav_const);
+        }
+        else {
+            // transform data
+            static PS::ReallocatableArray<ParticleBase> ptmp;
+            static PS::ReallocatableArray<ForceSoft> force;
+            ptmp.resizeNoInitialize(n);
+            force.resizeNoInitialize(n);
+            for (int i=0; i<n; i++) {
+                ptmp[i].pos.x = x[i];
+                ptmp[i].pos.y = y[i];
+                ptmp[i].pos.z = z[i];
+                force[i].clear();
+            };
+
+            fcalc(ptmp.getPointer(), n, &(ptr->system_soft[0]), n_loc, force.getPointer());
+
+            for (int i=0; i<n; i++) phi[i] = force[i].pot;
+        }
 
 #ifdef PARTICLE_SIMULATOR_MPI_PARALLEL
         if (ptr->my_rank==0) MPI_Reduce(MPI_IN_PLACE, phi,  n, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
@@ -1032,6 +1267,17 @@ extern "C" {
         return 0;
     }    
 
+    int set_gravity_at_point_mode(int mode) {
+        if (mode<0||mode>1) return -1;
+        gravity_at_point_mode = mode;
+        return 0;
+    }
+
+    int get_gravity_at_point_mode(int * mode) {
+        *mode = gravity_at_point_mode;
+        return 0;
+    }
+
 #ifdef __cplusplus
 }
 #endif
@@ -45,6 +45,32 @@ int set_acceleration(int index_of_the_particle, double ax, double ay, double az)
 
 int get_potential(int index_of_the_particle, double * potential);
 
+// array versions of getters and setters, n is the array size
+
+int get_state_many(int * index_of_the_particle, double * mass, double * x, double * y, double * z, double * vx, double * vy, double * vz, double * radius, int n);
+
+int set_state_many(int * index_of_the_particle, double * mass, double * x, double * y, double * z, double * vx, double * vy, double * vz, double * radius, int n);
+
+int get_mass_many(int * index_of_the_particle, double * mass, int n);
+
+int set_mass_many(int * index_of_the_particle, double * mass, int n);
+
+int get_radius_many(int * index_of_the_particle, double * radius, int n);
+
+int set_radius_many(int * index_of_the_particle, double * radius, int n);
+
+int get_position_many(int * index_of_the_particle, double * x, double * y, double * z, int n);
+
+int set_position_many(int * index_of_the_particle, double * x, double * y, double * z, int n);
+
+int get_velocity_many(int * index_of_the_particle, double * vx, double * vy, double * vz, int n);
+
+int set_velocity_many(int * index_of_the_particle, double * vx, double * vy, double * vz, int n);
+
+int get_acceleration_many(int * index_of_the_particle, double * ax, double * ay, double * az, int n);
+
+int get_potential_many(int * index_of_the_particle, double * potential, int n);
+
 int evolve_model(double time);
 
 int commit_particles();
@@ -119,6 +145,11 @@ int get_gravity_at_point(double * eps, double * x, double * y, double * z, doubl
 
 int get_potential_at_point(double * eps, double * x, double * y, double * z, double * phi, int npoints);
 
+// 0: direct sum; 1: Barnes-Hut tree with the opening angle theta
+int set_gravity_at_point_mode(int mode);
+
+int get_gravity_at_point_mode(int * mode);
+
 //int get_eta(double * eta);
 
 //int set_eta(double eta);
@@ -356,6 +356,98 @@ class petarInterface(
         """
         return function
 
+    @legacy_function
+    def get_gravity_at_point_mode():
+        """
+        Get the mode of get_gravity_at_point and get_potential_at_point
+        """
+        function = LegacyFunctionSpecification()
+        function.addParameter(
+            'mode', dtype='int32', direction=function.OUT,
+            description=(
+                "0: direct sum; 1: Barnes-Hut tree with the opening angle"
+                " theta"
+            )
+        )
+        function.result_type = 'int32'
+        function.result_doc = """
+        0 - OK
+            the parameter was retrieved
+        -1 - ERROR
+            could not retrieve parameter
+        """
+        return function
+
+    @legacy_function
+    def set_gravity_at_point_mode():
+        """
+        Set the mode of get_gravity_at_point and get_potential_at_point
+        """
+        function = LegacyFunctionSpecification()
+        function.addParameter(
+            'mode', dtype='int32', direction=function.IN,
+            description=(
+                "0: direct sum; 1: Barnes-Hut tree with the opening angle"
+                " theta"
+            )
+        )
+        function.result_type = 'int32'
+        function.result_doc = """
+        0 - OK
+            the parameter was set
+        -1 - ERROR
+            could not set parameter
+        """
+        return function
+
+    @legacy_function
+    def get_state_many():
+        """
+        Get the state of a list of particles with one collective
+        communication
+        """
+        function = LegacyFunctionSpecification()
+        function.must_handle_array = True
+        function.addParameter(
+            'index_of_the_particle', dtype='int32', direction=function.IN,
+            description="Index of the particles to get the state from"
+        )
+        for x in ['mass', 'x', 'y', 'z', 'vx', 'vy', 'vz', 'radius']:
+            function.addParameter(x, dtype='float64', direction=function.OUT)
+        function.addParameter('npoints', dtype='int32', direction=function.LENGTH)
+        function.result_type = 'int32'
+        function.result_doc = """
+        0 - OK
+            the states were retrieved
+        -1 - ERROR
+            some particles were not found
+        """
+        return function
+
+    @legacy_function
+    def set_state_many():
+        """
+        Set the state of a list of particles with one collective
+        communication
+        """
+        function = LegacyFunctionSpecification()
+        function.must_handle_array = True
+        function.addParameter(
+            'index_of_the_particle', dtype='int32', direction=function.IN,
+            description="Index of the particles to set the state"
+        )
+        for x in ['mass', 'x', 'y', 'z', 'vx', 'vy', 'vz', 'radius']:
+            function.addParameter(x, dtype='float64', direction=function.IN)
+        function.addParameter('npoints', dtype='int32', direction=function.LENGTH)
+        function.result_type = 'int32'
+        function.result_doc = """
+        0 - OK
+            the states were set
+        -1 - ERROR
+            some particles were not found
+        """
+        return function
+
 
 class petar(GravitationalDynamics, GravityFieldCode):
 
@@ -443,6 +535,15 @@ class petar(GravitationalDynamics, GravityFieldCode):
             default_value=0.0 | nbody_system.time
         )
 
+        handler.add_method_parameter(
+            "get_gravity_at_point_mode",
+            "set_gravity_at_point_mode",
+            "gravity_at_point_mode",
+            ("Method of get_gravity_at_point and get_potential_at_point"
+             " (0: direct sum; 1: Barnes-Hut tree with theta)"),
+            default_value=0
+        )
+
     def define_methods(self, handler):
         GravitationalDynamics.define_methods(self, handler)
         self.stopping_conditions.define_methods(handler)
@@ -542,6 +643,42 @@ class petar(GravitationalDynamics, GravityFieldCode):
             )
         )
 
+        handler.add_method(
+            "get_state_many",
+            (
+                handler.NO_UNIT,
+            ),
+            (
+                nbody_system.mass,
+                nbody_system.length,
+                nbody_system.length,
+                nbody_system.length,
+                nbody_system.speed,
+                nbody_system.speed,
+                nbody_system.speed,
+                nbody_system.length,
+                handler.ERROR_CODE,
+            )
+        )
+
+        handler.add_method(
+            "set_state_many",
+            (
+                handler.NO_UNIT,
+                nbody_system.mass,
+                nbody_system.length,
+                nbody_system.length,
+                nbody_system.length,
+                nbody_system.speed,
+                nbody_system.speed,
+                nbody_system.speed,
+                nbody_system.length,
+            ),
+            (
+                handler.ERROR_CODE,
+            )
+        )
+
     def define_particle_sets(self, handler):
         GravitationalDynamics.define_particle_sets(self, handler)
         self.stopping_conditions.define_particle_set(handler)
@@ -1,11 +1,17 @@
 #include "interface.h"
 #include <cstdio>
 #include <cassert>
+#include <cstdlib>
+#include <vector>
 #include "mpi.h"
 
 int main(int argc, char **argv) {
     
     MPI_Init(&argc, &argv);
+    // number of particles for the benchmark of array getters and setters
+    int n_bench = 10000;
+    if (argc>1) n_bench = atoi(argv[1]);
+
     initialize_code();
     int my_rank;
     MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
@@ -130,6 +136,69 @@ int main(int argc, char **argv) {
         assert(vy==56);
         assert(vz==57);
     }
+
+    // benchmark: single-particle getters and setters vs. array versions
+    std::vector<int> index_bench(n_bench);
+    for (int i=0; i<n_bench; i++) {
+        double s = 1.0/n_bench;
+        new_particle(&index_bench[i], s, i*s, -i*s, 0.5*i*s, 0.1*i*s, -0.1*i*s, 0.2*i*s, 0.0);
+    }
+    MPI_Bcast(index_bench.data(), n_bench, MPI_INT, 0, MPI_COMM_WORLD);
+    recommit_particles();
+
+    std::vector<double> bm(n_bench), bx(n_bench), by(n_bench), bz(n_bench), bvx(n_bench), bvy(n_bench), bvz(n_bench), br(n_bench);
+    std::vector<double> cm(n_bench), cx(n_bench), cy(n_bench), cz(n_bench), cvx(n_bench), cvy(n_bench), cvz(n_bench), cr(n_bench);
+
+    // the first call reconstructs the particle list, exclude it from the timing
+    get_mass(index_bench[0], &bm[0]);
+
+    double t0 = MPI_Wtime();
+    for (int i=0; i<n_bench; i++) 
+        get_state(index_bench[i], &bm[i], &bx[i], &by[i], &bz[i], &bvx[i], &bvy[i], &bvz[i], &br[i]);
+    double t_get_single = MPI_Wtime() - t0;
+
+    t0 = MPI_Wtime();
+    error = get_state_many(index_bench.data(), cm.data(), cx.data(), cy.data(), cz.data(), cvx.data(), cvy.data(), cvz.data(), cr.data(), n_bench);
+    double t_get_many = MPI_Wtime() - t0;
+    if (my_rank==0) {
+        if (error<0) printf("get state many error\n");
+        for (int i=0; i<n_bench; i++) {
+            assert(bm[i]==cm[i]);
+            assert(bx[i]==cx[i]);
+            assert(by[i]==cy[i]);
+            assert(bz[i]==cz[i]);
+            assert(bvx[i]==cvx[i]);
+            assert(bvy[i]==cvy[i]);
+            assert(bvz[i]==cvz[i]);
+        }
+    }
+
+    t0 = MPI_Wtime();
+    for (int i=0; i<n_bench; i++) 
+        set_state(index_bench[i], bm[i], bx[i], by[i], bz[i], bvx[i], bvy[i], bvz[i], br[i]);
+    double t_set_single = MPI_Wtime() - t0;
+
+    // set scaled masses, then check with get_mass_many
+    for (int i=0; i<n_bench; i++) cm[i] = 2.0*bm[i];
+    t0 = MPI_Wtime();
+    error = set_state_many(index_bench.data(), cm.data(), bx.data(), by.data(), bz.data(), bvx.data(), bvy.data(), bvz.data(), br.data(), n_bench);
+    double t_set_many = MPI_Wtime() - t0;
+    if (my_rank==0 && error<0) printf("set state many error\n");
+    error = get_mass_many(index_bench.data(), bm.data(), n_bench);
+    if (my_rank==0) {
+        if (error<0) printf("get mass many error\n");
+        for (int i=0; i<n_bench; i++) assert(bm[i]==cm[i]);
+        printf("N=%d get_state: %e s, get_state_many: %e s; set_state: %e s, set_state_many: %e s\n",
+               n_bench, t_get_single, t_get_many, t_set_single, t_set_many);
+    }
+
+    // unknown ID should report error
+    int index_bad[2] = {index_bench[0], -1};
+    error = get_mass_many(index_bad, bm.data(), 2);
+    if (my_rank==0) assert(error<0);
+
+    for (int i=0; i<n_bench; i++) delete_particle(index_bench[i]);
+
     recommit_particles();
 
     for (int k=0; k<10; k++) {
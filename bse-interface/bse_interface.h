@@ -4,6 +4,8 @@
 #include <cassert>
 #include <cstdio>
 #include <string>
+#include <vector>
+#include <cmath>
 #include <getopt.h>
 #include "../src/io.hpp"
 
@@ -616,6 +618,8 @@ public:
     IOParams<double> mscale;
     IOParams<double> vscale;
     IOParams<double> z;
+    IOParams<long long int> track_n_mass;
+    IOParams<std::string> track_file;
 
     bool print_flag;
 
@@ -652,6 +656,8 @@ public:
                    mscale(input_par_store, 1.0,   "bse-mscale", "Mass scale factor from input data unit (IN) to Msun (m[Msun]=m[IN]*mscale)"),
                    vscale(input_par_store, 1.0,   "bse-vscale", "Velocity scale factor from input data unit(IN) to km/s (v[km/s]=v[IN]*vscale)"),
                    z     (input_par_store, 0.001, "bse-metallicity", "Metallicity Z, ranging from 0.0001 to 0.03"),
+                   track_n_mass(input_par_store, 0, "bse-track-nmass", "Number of ZAMS masses (log grid in [0.08, 150] Msun) of the interpolated main-sequence track table used for single stars; 0: always call SSE"),
+                   track_file(input_par_store, "__NONE__", "bse-track-file", "File to cache the track table: read if it exists with the same mass grid and metallicity, otherwise build and write; __NONE__: always build"),
                    print_flag(false) {}
 #elif MOBSE
     IOParamsBSE(): input_par_store(),
@@ -688,6 +694,8 @@ public:
                    mscale(input_par_store, 1.0,     "mobse-msclae", "Mass scale factor from input data unit (IN) to Msun (m[Msun]=m[IN]*mscale)"),
                    vscale(input_par_store, 1.0,     "mobse-vsclae",  "Velocity scale factor from input data unit(IN) to km/s (v[km/s]=v[IN]*vscale)"),
                    z     (input_par_store, 0.001,   "mobse-metallicity",    "Metallicity"),
+                   track_n_mass(input_par_store, 0, "mobse-track-nmass", "Number of ZAMS masses (log grid in [0.08, 150] Msun) of the interpolated main-sequence track table used for single stars; 0: always call SSE"),
+                   track_file(input_par_store, "__NONE__", "mobse-track-file", "File to cache the track table: read if it exists with the same mass grid and metallicity, otherwise build and write; __NONE__: always build"),
                    print_flag(false) {}
 #endif
 
@@ -740,6 +748,8 @@ public:
             {rscale.key, required_argument, &sse_flag, 19},
             {mscale.key, required_argument, &sse_flag, 20},
             {vscale.key, required_argument, &sse_flag, 21},
+            {track_n_mass.key, required_argument, &sse_flag, 30},
+            {track_file.key,   required_argument, &sse_flag, 31},
             {z.key,      required_argument, 0, 'z'},
             {"help",     no_argument,       0, 'h'},
             {0,0,0,0}
@@ -919,6 +929,16 @@ public:
                     if(print_flag) gamma.print(std::cout);
                     opt_used+=2;
                     break;
+                case 30:
+                    track_n_mass.value = atoi(optarg);
+                    if(print_flag) track_n_mass.print(std::cout);
+                    opt_used+=2;
+                    break;
+                case 31:
+                    track_file.value = optarg;
+                    if(print_flag) track_file.print(std::cout);
+                    opt_used+=2;
+                    break;
                 default:
                     break;
                 }
@@ -983,6 +1003,276 @@ public:
     }    
 };
 
+//! Interpolated SSE tracks of main-sequence single stars
+/*! On the main sequence (MS, type 0 and 1), SSE evolv1 resets the initial mass to the current mass after the wind mass loss
+    and keeps the fractional age tau = age/t_MS, thus the state of a MS star is determined by its mass and tau.
+    The table records tracks evolved by evolv1 from ZAMS for a mass grid uniform in log mass, at a uniform tau grid in [0, tau_max].
+    A star is located by its mass and tau as a fractional track index between two neighboring tracks, 
+    which is kept during one evolution step. 
+    The new tau is found by the evolved time along the fractional track, and the stellar parameters are linearly interpolated.
+    The stars which are not on the MS, are out of the mass range or evolve beyond tau_max are not handled (evolve returns false), 
+    and should be evolved by evolv1 directly, so that all type changes and supernova kicks are from SSE.
+    Only the metallicity of BSEManager is tabulated, since all stars in one PeTar run share the same metallicity.
+ */
+class SSETrackTable{
+public:
+    //! one record of a track
+    struct Record{
+        long long int kw; ///> stellar type, -1: invalid
+        double mt;    ///> current mass [Msun]
+        double r;     ///> stellar radius [Rsun]
+        double lum;   ///> luminosity [Lsun]
+        double mc;    ///> core mass [Msun]
+        double rc;    ///> core radius [Rsun]
+        double menv;  ///> mass of convective envelope [Msun]
+        double renv;  ///> radius of convective envelope [Rsun]
+        double ospin; ///> spin of star
+        double age;   ///> evolved time since ZAMS [Myr]
+        double tm;    ///> MS lifetime [Myr]
+    };
+
+    int n_mass;      ///> number of ZAMS mass grid points, 0: table is not used
+    int n_tau;       ///> number of tau grid points
+    double m_min;    ///> minimum ZAMS mass [Msun]
+    double m_max;    ///> maximum ZAMS mass [Msun]
+    double tau_max;  ///> maximum tau
+    double z;        ///> metallicity
+    std::vector<Record> track; ///> records of tracks, index: i_mass*n_tau + k_tau
+
+    SSETrackTable(): n_mass(0), n_tau(0), m_min(0.0), m_max(0.0), tau_max(0.0), z(0.0), track() {}
+
+    //! check whether the table is available
+    bool isAvailable() const {
+        return n_mass>1 && (int)track.size()==n_mass*n_tau;
+    }
+
+    //! build the table by evolving tracks from ZAMS
+    /*!
+      @param[in] _evolve: function (StarParameter&, StarParameterOut&, const double dt) evolving one star by dt [Myr] with evolv1, return event flag
+      @param[in] _n_mass: number of ZAMS mass grid points
+      @param[in] _n_tau: number of tau grid points
+      @param[in] _m_min: minimum ZAMS mass [Msun]
+      @param[in] _m_max: maximum ZAMS mass [Msun]
+      @param[in] _tau_max: maximum tau
+      @param[in] _z: metallicity
+     */
+    template <class Tevolve>
+    void build(Tevolve _evolve, const int _n_mass, const int _n_tau, const double _m_min, const double _m_max, const double _tau_max, const double _z) {
+        assert(_n_mass>1&&_n_tau>1);
+        assert(_m_min>0.0&&_m_max>_m_min);
+        assert(_tau_max>0.0&&_tau_max<1.0);
+        n_mass = _n_mass;
+        n_tau = _n_tau;
+        m_min = _m_min;
+        m_max = _m_max;
+        tau_max = _tau_max;
+        z = _z;
+        track.resize(n_mass*n_tau);
+        const double dlogm = std::log(m_max/m_min)/(n_mass-1);
+        const double dtau = tau_max/(n_tau-1);
+
+#pragma omp parallel for schedule(dynamic)
+        for (int i=0; i<n_mass; i++) {
+            StarParameter star;
+            StarParameterOut out;
+            star.initial(m_min*std::exp(i*dlogm));
+            // initialize radius, luminosity and spin
+            int event_flag = _evolve(star, out, 1e-10);
+            bool valid_flag = (event_flag==0);
+            Record* track_i = &track[i*n_tau];
+            for (int k=0; k<n_tau; k++) {
+                // evolve to the tau grid, the step is corrected by the new MS lifetime after mass loss
+                const double tau_k = k*dtau;
+                for (int iter=0; iter<8&&valid_flag; iter++) {
+                    const double tau = (star.tphys-star.epoch)/out.tm;
+                    if (tau_k-tau<=1e-10) break;
+                    event_flag = _evolve(star, out, (tau_k-tau)*out.tm);
+                    if (event_flag!=0||(star.kw!=0&&star.kw!=1)) valid_flag = false;
+                }
+                Record& rec = track_i[k];
+                rec.kw = valid_flag? star.kw: -1;
+                rec.mt = star.mt;
+                rec.r  = star.r;
+                rec.lum= star.lum;
+                rec.mc = star.mc;
+                rec.rc = star.rc;
+                rec.menv = out.menv;
+                rec.renv = out.renv;
+                rec.ospin= star.ospin;
+                rec.age  = star.tphys;
+                rec.tm   = out.tm;
+            }
+        }
+    }
+
+    //! write table with binary format
+    void writeBinary(FILE* _fp) const {
+        fwrite(&n_mass, sizeof(int), 1, _fp);
+        fwrite(&n_tau, sizeof(int), 1, _fp);
+        fwrite(&m_min, sizeof(double), 1, _fp);
+        fwrite(&m_max, sizeof(double), 1, _fp);
+        fwrite(&tau_max, sizeof(double), 1, _fp);
+        fwrite(&z, sizeof(double), 1, _fp);
+        fwrite(track.data(), sizeof(Record), track.size(), _fp);
+    }
+
+    //! read table with binary format
+    /*! \return true: success
+     */
+    bool readBinary(FILE* _fin) {
+        size_t rcount = fread(&n_mass, sizeof(int), 1, _fin);
+        rcount += fread(&n_tau, sizeof(int), 1, _fin);
+        rcount += fread(&m_min, sizeof(double), 1, _fin);
+        rcount += fread(&m_max, sizeof(double), 1, _fin);
+        rcount += fread(&tau_max, sizeof(double), 1, _fin);
+        rcount += fread(&z, sizeof(double), 1, _fin);
+        if (rcount<6||n_mass<=1||n_tau<=1) {
+            n_mass = 0;
+            return false;
+        }
+        track.resize(n_mass*n_tau);
+        rcount = fread(track.data(), sizeof(Record), track.size(), _fin);
+        if (rcount<track.size()) {
+            n_mass = 0;
+            return false;
+        }
+        return true;
+    }
+
+    //! get MS lifetime of a mass from the ZAMS records [Myr]
+    /*! SSE MS lifetime only depends on the mass for a given metallicity
+      \return MS lifetime; negative if mass is out of range
+     */
+    double getMSLifetime(const double _mass) const {
+        const double dlogm = std::log(m_max/m_min)/(n_mass-1);
+        const double x = std::log(_mass/m_min)/dlogm;
+        const int i = (int)x;
+        if (x<0.0||i>=n_mass-1) return -1.0;
+        const double w = x - i;
+        return std::exp((1.0-w)*std::log(track[i*n_tau].tm) + w*std::log(track[(i+1)*n_tau].tm));
+    }
+
+    //! evolve a MS star by interpolation
+    /*! 
+      @param[in,out] _star: star parameter
+      @param[out] _out: output parameter as from evolv1
+      @param[in] _dt: time step [Myr]
+      \return true: success; false: the star is not handled by the table and _star is unchanged
+     */
+    bool evolve(StarParameter& _star, StarParameterOut& _out, const double _dt) const {
+        if (_star.kw!=0&&_star.kw!=1) return false;
+        // the star should be initialized by SSE and have the initial mass reset
+        if (_star.r<=0.0||_star.ospin<=0.0||_star.m0!=_star.mt) return false;
+
+        const double tm = getMSLifetime(_star.mt);
+        if (tm<=0.0) return false;
+        const double tau = (_star.tphys-_star.epoch)/tm;
+        const double dtau = tau_max/(n_tau-1);
+        const double xk = tau/dtau;
+        const int k = (int)xk;
+        if (xk<0.0||k>=n_tau-1) return false;
+
+        // fractional track index at the two neighboring tau grid points
+        double s[2];
+        for (int j=0; j<2; j++) {
+            s[j] = getTrackIndex(_star.mt, k+j);
+            if (s[j]<0.0) return false;
+        }
+        const double wk = xk - k;
+        const double si = (1.0-wk)*s[0] + wk*s[1];
+        const int i = (int)si;
+        if (i>=n_mass-1) return false;
+        const double wi = si - i;
+
+        // find new tau by the evolved time along the fractional track
+        const double age_now = (1.0-wk)*getAge(i, wi, k) + wk*getAge(i, wi, k+1);
+        const double age_new = age_now + _dt;
+        int kn = k;
+        while (kn<n_tau-1 && getAge(i, wi, kn+1)<=age_new) kn++;
+        if (kn>=n_tau-1) return false;
+        for (int kk=k; kk<=kn+1; kk++) {
+            if (track[i*n_tau+kk].kw!=_star.kw || track[(i+1)*n_tau+kk].kw!=_star.kw) return false;
+        }
+        const double age_kn = getAge(i, wi, kn);
+        const double wkn = (age_new - age_kn)/(getAge(i, wi, kn+1) - age_kn);
+
+        Record rec_now, rec_new;
+        interpolate(rec_now, i, wi, k, wk);
+        interpolate(rec_new, i, wi, kn, wkn);
+        const double tau_new = (kn+wkn)*dtau;
+
+        // apply the differences of mass and spin to keep the own values of the star
+        const double mt_new = _star.mt + rec_new.mt - rec_now.mt;
+        const double tm_new = getMSLifetime(mt_new);
+        if (tm_new<=0.0) return false;
+
+        _out.kw0 = _star.kw;
+        _out.dm = mt_new - _star.mt;
+        _out.dtmiss = 0.0;
+        _out.menv = rec_new.menv;
+        _out.renv = rec_new.renv;
+        _out.tm = tm_new;
+        for (int j=0; j<4; j++) _out.vkick[j] = 0.0;
+
+        _star.m0 = mt_new;
+        _star.mt = mt_new;
+        _star.r  = rec_new.r;
+        _star.lum= rec_new.lum;
+        _star.mc = rec_new.mc;
+        _star.rc = rec_new.rc;
+        _star.ospin *= rec_new.ospin/rec_now.ospin;
+        _star.tphys += _dt;
+        _star.epoch = _star.tphys - tau_new*tm_new;
+
+        return true;
+    }
+
+private:
+    //! find the fractional track index where the mass at tau grid k is _mass
+    /*! \return fractional index; negative if out of range
+     */
+    double getTrackIndex(const double _mass, const int _k) const {
+        // masses at the same tau increase with the ZAMS mass
+        if (_mass<track[_k].mt||_mass>=track[(n_mass-1)*n_tau+_k].mt) return -1.0;
+        int i_low = 0, i_high = n_mass-1;
+        while (i_high-i_low>1) {
+            const int i_mid = (i_low+i_high)/2;
+            if (track[i_mid*n_tau+_k].mt<=_mass) i_low = i_mid;
+            else i_high = i_mid;
+        }
+        const double m_low = track[i_low*n_tau+_k].mt;
+        const double m_high = track[i_high*n_tau+_k].mt;
+        return i_low + std::log(_mass/m_low)/std::log(m_high/m_low);
+    }
+
+    //! get evolved time on fractional track at tau grid k
+    double getAge(const int _i, const double _wi, const int _k) const {
+        return (1.0-_wi)*track[_i*n_tau+_k].age + _wi*track[(_i+1)*n_tau+_k].age;
+    }
+
+    //! bilinear interpolation of records
+    void interpolate(Record& _rec, const int _i, const double _wi, const int _k, const double _wk) const {
+        const Record* r00 = &track[_i*n_tau+_k];
+        const Record* r01 = &track[_i*n_tau+_k+1];
+        const Record* r10 = &track[(_i+1)*n_tau+_k];
+        const Record* r11 = &track[(_i+1)*n_tau+_k+1];
+        const double w00 = (1.0-_wi)*(1.0-_wk), w01 = (1.0-_wi)*_wk, w10 = _wi*(1.0-_wk), w11 = _wi*_wk;
+        _rec.kw = r00->kw;
+#define SSE_TRACK_INTERP(x) _rec.x = w00*r00->x + w01*r01->x + w10*r10->x + w11*r11->x
+        SSE_TRACK_INTERP(mt);
+        SSE_TRACK_INTERP(r);
+        SSE_TRACK_INTERP(lum);
+        SSE_TRACK_INTERP(mc);
+        SSE_TRACK_INTERP(rc);
+        SSE_TRACK_INTERP(menv);
+        SSE_TRACK_INTERP(renv);
+        SSE_TRACK_INTERP(ospin);
+        SSE_TRACK_INTERP(age);
+        SSE_TRACK_INTERP(tm);
+#undef SSE_TRACK_INTERP
+    }
+};
+
 //! SSE/BSE interface manager
 /*! The class provides the interface to call single and binary stellar evolution (evolveStar and evolveBinary);
   and also the time step estimators (getTimeStepStar, getTimeStepBinary).
@@ -997,6 +1287,7 @@ public:
     const double year_to_day; ///> year to day 
     const char* single_type[16]; ///> name of single type from SSE
     const char* binary_type[14]; ///> name of binary type return from BSE evolv2, notice if it is -1, it indicate the end of record
+    SSETrackTable sse_track; ///> interpolated main-sequence tracks used in evolveStar if available
 
     BSEManager(): z(0.0), zpars{0}, tscale(0.0), rscale(0.0), mscale(0.0), vscale(0.0), year_to_day(3.6525e8),
                   single_type{"LMS", "MS", "HG", "GB", "CHeB", "FAGB", "SAGB", "HeMS", "HeHG", "HeGB", "HeWD", "COWD", "ONWD", "NS", "BH", "SN"},
@@ -1014,7 +1305,7 @@ public:
                               "Blue_straggler",      //11
                               "No_remain",           //12
                               "Disrupt"              //13
-                              } {}
+                              }, sse_track() {}
     
 
     bool checkParams() {
@@ -1039,6 +1330,22 @@ public:
         fclose(fin);
     }
 
+    //! copy BSE rand constant to an array of 35 integers (idum, idum2, iy, ir[32])
+    void getRandConstant(int* _rand) const {
+        _rand[0] = value3_.idum;
+        _rand[1] = rand3_.idum2;
+        _rand[2] = rand3_.iy;
+        for (int i=0; i<32; i++) _rand[i+3] = rand3_.ir[i];
+    }
+
+    //! set BSE rand constant from an array of 35 integers (idum, idum2, iy, ir[32])
+    void setRandConstant(const int* _rand) {
+        value3_.idum = _rand[0];
+        rand3_.idum2 = _rand[1];
+        rand3_.iy = _rand[2];
+        for (int i=0; i<32; i++) rand3_.ir[i] = _rand[i+3];
+    }
+
     //! read BSE rand constant from file
     void readRandConstant(const char* _fname) {
         FILE* fin;
@@ -1229,6 +1536,54 @@ public:
             std::cout<<std::endl;
         }
 
+        if (_input.track_n_mass.value>0) initialTrackTable(_input.track_n_mass.value, _input.track_file.value, _print_flag);
+    }
+
+    //! build or read the interpolated main-sequence track table
+    /*!
+      @param[in] _n_mass: number of ZAMS mass grid points
+      @param[in] _fname: file to cache the table, "__NONE__": no cache
+      @param[in] _print_flag: print information
+     */
+    void initialTrackTable(const int _n_mass, const std::string& _fname, const bool _print_flag=false) {
+        const int n_tau = 100;
+        const double m_min = 0.08, m_max = 150.0, tau_max = 0.95;
+        bool read_flag = false;
+        if (_fname!="__NONE__") {
+            FILE* fin = fopen(_fname.c_str(), "rb");
+            if (fin!=NULL) {
+                read_flag = sse_track.readBinary(fin);
+                fclose(fin);
+                read_flag = read_flag && sse_track.n_mass==_n_mass && sse_track.n_tau==n_tau && sse_track.m_min==m_min && sse_track.m_max==m_max && sse_track.tau_max==tau_max && sse_track.z==z;
+                if (!read_flag&&_print_flag) std::cerr<<"SSE track table in "<<_fname<<" does not match, rebuild it\n";
+            }
+        }
+        if (!read_flag) {
+            sse_track.n_mass = 0;
+            sse_track.build([&](StarParameter& _star, StarParameterOut& _out, const double _dt) {
+                    return evolveStarSSE(_star, _out, _dt/tscale); }, _n_mass, n_tau, m_min, m_max, tau_max, z);
+            bool write_flag = (_fname!="__NONE__");
+#ifdef PARTICLE_SIMULATOR_MPI_PARALLEL
+            if (PS::Comm::getRank()!=0) write_flag = false;
+#endif
+            if (write_flag) {
+                // write to a temporary file first so that others never read an incomplete table
+                std::string fname_tmp = _fname + ".tmp";
+                FILE* fout = fopen(fname_tmp.c_str(), "wb");
+                if (fout==NULL) {
+                    fprintf(stderr,"Error: Cannot open file %s.\n", fname_tmp.c_str());
+                    abort();
+                }
+                sse_track.writeBinary(fout);
+                fclose(fout);
+                rename(fname_tmp.c_str(), _fname.c_str());
+            }
+        }
+        if (_print_flag) {
+            std::cout<<"SSE track table: ZAMS mass grid "<<sse_track.n_mass<<" in ["<<sse_track.m_min<<", "<<sse_track.m_max<<"] Msun"
+                     <<", tau grid "<<sse_track.n_tau<<" in [0, "<<sse_track.tau_max<<"]"
+                     <<", Z= "<<sse_track.z<<std::endl;
+        }
     }
 
     //! get current mass in NB unit
@@ -1323,6 +1678,18 @@ public:
         return _out.vkick[3]/vscale;
     }
 
+    //! evolve single star by the track table if possible, otherwise call SSE evolv1
+    /*! The main-sequence stars in the range of the track table are interpolated, all events are from evolv1
+      @param[in,out] _star: star parameter
+      @param[out] _out: output parameter from evolv1
+      @param[in] _dt_nb: physical time step to evolve [In unit]
+      \return event flag: -1: error, 0: normal, 1: type change, 2: velocity kick
+     */
+    int evolveStar(StarParameter& _star, StarParameterOut& _out, const double _dt_nb) {
+        if (sse_track.isAvailable() && sse_track.evolve(_star, _out, _dt_nb*tscale)) return 0;
+        return evolveStarSSE(_star, _out, _dt_nb);
+    }
+
     //! call SSE evolv1 for single star
     /*!
       @param[in,out] _star: star parameter
@@ -1330,7 +1697,7 @@ public:
       @param[in] _dt_nb: physical time step to evolve [In unit]
       \return event flag: -1: error, 0: normal, 1: type change, 2: velocity kick
      */
-    int evolveStar(StarParameter& _star, StarParameterOut& _out, const double _dt_nb) {
+    int evolveStarSSE(StarParameter& _star, StarParameterOut& _out, const double _dt_nb) {
         double tphysf = _dt_nb*tscale + _star.tphys;
         double dtp=tphysf*100.0+1000.0;
         _out.dm = _star.mt;
@@ -1382,9 +1749,9 @@ public:
         // backup initial state
         _bse_event.recordInitial(_star1, _star2, semi_rsun, _ecc, _binary_init_type);
 
-        if (_star1.tphys<tphys) event_flag = evolveStar(_star1, _out1, tphys);
+        if (_star1.tphys<tphys) event_flag = evolveStarSSE(_star1, _out1, tphys);
         if (event_flag<0) return event_flag;
-        if (_star2.tphys<tphys) event_flag = evolveStar(_star2, _out2, tphys);
+        if (_star2.tphys<tphys) event_flag = evolveStarSSE(_star2, _out2, tphys);
         if (event_flag<0) return event_flag;
         
         int kw[2];
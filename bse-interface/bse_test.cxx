@@ -4,6 +4,7 @@
 #include <cmath>
 #include <vector>
 #include <string>
+#include <chrono>
 #include "bse_interface.h"
 #include "../src/io.hpp"
 
@@ -47,6 +48,7 @@ int main(int argc, char** argv){
     std::string fhyb_name;
     bool read_mass_flag = false;
     bool always_output_flag = false;
+    bool track_check_flag = false;
 
     auto printHelp= [&]() {
         std::cout<<"The tool to evolve single stars or binaries using "<<BSEManager::getBSEName()<<std::endl;
@@ -71,6 +73,8 @@ int main(int argc, char** argv){
                  <<"    -w [I]: print column width ("<<width<<")\n"
                  <<"    -o    : print evolution data every time when bse function is called (maximum time step by -d); if this option is not used, only output data when binary type changes\n"
                  <<"    -f [S]: the prefix of data file that save the stellar evolution data every step, if not given, this file is not generated\n"
+                 <<"        --track-check: compare single stars evolved with the interpolated main-sequence track table to direct SSE evolution\n"
+                 <<"                       the table size is set by the option *-track-nmass, 200 if not given\n"
                  <<"    -h    : help\n";
     };
 
@@ -82,6 +86,7 @@ int main(int argc, char** argv){
     static struct option long_options[] = {
         {"mmin", required_argument, &long_flag, 0},
         {"mmax", required_argument, &long_flag, 1},
+        {"track-check", no_argument, &long_flag, 2},
         {0,0,0,0}
     };
 
@@ -103,6 +108,11 @@ int main(int argc, char** argv){
                 std::cout<<"max mass: "<<m_max<<std::endl;
                 opt_used+=2;
                 break;
+            case 2:
+                track_check_flag = true;
+                std::cout<<"Check the SSE track table"<<std::endl;
+                opt_used++;
+                break;
             default:
                 break;
             }
@@ -490,6 +500,86 @@ int main(int argc, char** argv){
         for (int i=0; i<nbin; i++) printBinary(std::cout, bin[i]);
     }
 
+    if (track_check_flag&&star.size()>0) {
+        if (!bse_manager.sse_track.isAvailable()) bse_manager.initialTrackTable(200, "__NONE__", true);
+
+        // evolve the same stars with direct SSE (ref) and with the track table (trk) using the same time steps
+        int nstar = star.size();
+        std::vector<StarParameter> star_ref(star), star_trk(star);
+        std::vector<double> dt_list;
+        std::vector<int> n_step_offset(nstar+1, 0);
+        StarParameterOut out_ref, out_trk;
+        double tend = time*bse_manager.tscale;
+        auto t0 = std::chrono::steady_clock::now();
+        for (int i=0; i<nstar; i++) {
+            while (bse_manager.getTime(star_ref[i])<tend) {
+                double dt = std::max(bse_manager.getTimeStepStar(star_ref[i]),dtmin);
+                dt = std::min(tend-bse_manager.getTime(star_ref[i]), dt);
+                dt_list.push_back(dt);
+                int event_flag = bse_manager.evolveStarSSE(star_ref[i], out_ref, dt);
+                assert(event_flag>=0);
+                double dt_miss = bse_manager.getDTMiss(out_ref);
+                if (dt_miss!=0.0&&star_ref[i].kw>=15) break;
+            }
+            n_step_offset[i+1] = dt_list.size();
+        }
+        double time_ref = std::chrono::duration<double>(std::chrono::steady_clock::now()-t0).count();
+
+        // the table is used until the first phase change, afterwards results differ by the random kicks
+        star_ref = star;
+        long long int n_step_ms = 0, n_step_table = 0;
+        double err_max[3] = {0.0, 0.0, 0.0}, err_sum[3] = {0.0, 0.0, 0.0};
+        double time_trk = 0.0;
+        std::cout<<std::setw(width)<<"mass0[M*]"
+                 <<std::setw(width)<<"n_step_MS"
+                 <<std::setw(width)<<"n_table"
+                 <<std::setw(width)<<"dm_max"
+                 <<std::setw(width)<<"dr_max"
+                 <<std::setw(width)<<"dlum_max"
+                 <<std::endl;
+        for (int i=0; i<nstar; i++) {
+            int n_table_i = 0, n_step_i = 0;
+            double err_max_i[3] = {0.0, 0.0, 0.0};
+            for (int k=n_step_offset[i]; k<n_step_offset[i+1]; k++) {
+                if (star_ref[i].kw>1) break;
+                bse_manager.evolveStarSSE(star_ref[i], out_ref, dt_list[k]);
+                t0 = std::chrono::steady_clock::now();
+                bool table_flag = bse_manager.sse_track.isAvailable() && bse_manager.sse_track.evolve(star_trk[i], out_trk, dt_list[k]*bse_manager.tscale);
+                if (!table_flag) bse_manager.evolveStarSSE(star_trk[i], out_trk, dt_list[k]);
+                time_trk += std::chrono::duration<double>(std::chrono::steady_clock::now()-t0).count();
+                if (star_ref[i].kw!=star_trk[i].kw) {
+                    if (star_ref[i].kw>1||star_trk[i].kw>1) break;
+                    // type 0 and 1 switch at a mass boundary, restart from the reference
+                    star_trk[i] = star_ref[i];
+                    continue;
+                }
+                n_step_i++;
+                if (table_flag) n_table_i++;
+                double err[3] = {std::abs(star_trk[i].mt/star_ref[i].mt-1.0), std::abs(star_trk[i].r/star_ref[i].r-1.0), std::abs(star_trk[i].lum/star_ref[i].lum-1.0)};
+                for (int j=0; j<3; j++) {
+                    err_max_i[j] = std::max(err_max_i[j], err[j]);
+                    err_sum[j] += err[j]*err[j];
+                }
+            }
+            n_step_ms += n_step_i;
+            n_step_table += n_table_i;
+            for (int j=0; j<3; j++) err_max[j] = std::max(err_max[j], err_max_i[j]);
+            std::cout<<std::setw(width)<<mass0[i]*bse_manager.mscale
+                     <<std::setw(width)<<n_step_i
+                     <<std::setw(width)<<n_table_i
+                     <<std::setw(width)<<err_max_i[0]
+                     <<std::setw(width)<<err_max_i[1]
+                     <<std::setw(width)<<err_max_i[2]
+                     <<std::endl;
+        }
+        std::cout<<"MS steps: "<<n_step_ms<<" from table: "<<n_step_table
+                 <<"\nRelative error of mass, radius, luminosity: max: "<<err_max[0]<<" "<<err_max[1]<<" "<<err_max[2]
+                 <<" RMS: "<<std::sqrt(err_sum[0]/std::max(n_step_ms,1LL))<<" "<<std::sqrt(err_sum[1]/std::max(n_step_ms,1LL))<<" "<<std::sqrt(err_sum[2]/std::max(n_step_ms,1LL))
+                 <<"\nWallclock time [s]: direct SSE (all steps): "<<time_ref<<" MS steps with table: "<<time_trk
+                 <<std::endl;
+        return 0;
+    }
+
     if (star.size()>0) {
         StarParameterOut output[star.size()];
 
@@ -6,10 +6,16 @@
 #include <vector>
 #include <getopt.h>
 #include <cmath>
+#include <algorithm>
+#include <limits>
 #include "../src/io.hpp"
 
 #include <integrateFullOrbit.h>
 
+#ifndef GALPY_BATCH_SIZE
+#define GALPY_BATCH_SIZE 64 ///> maximum particle number of one batch in calcAccPotBatch
+#endif
+
 //! IO parameters for Galpy manager
 class IOParamsGalpy{
 public:
@@ -22,6 +28,11 @@ public:
     IOParams<double> vscale; 
     IOParams<double> fscale; 
     IOParams<double> pscale; 
+    IOParams<long long int> cache_n;
+    IOParams<double> cache_rmin;
+    IOParams<double> cache_rmax;
+    IOParams<double> cache_zmax;
+    IOParams<double> evolve_dt;
     
     bool print_flag;
 
@@ -34,6 +45,11 @@ public:
                      vscale(input_par_store, 1.0, "galpy-vscale", "Velocity scale factor from unit of the input particle data (IN) to Galpy velocity unit (v[220 km/s]=v[IN]*vscale)"),
                      fscale(input_par_store, 1.0, "galpy-fscale", "Acceleration scale factor (vscale^2/rscale) from unit of the input particle data (IN) to Galpy acceleration unit (acc[Galpy]=acc[IN]*fscale)"),
                      pscale(input_par_store, 1.0, "galpy-pscale", "Potential scale factor (vscale^2) from unit of the input particle data (IN) to Galpy potential unit (pot[Galpy]=pot[IN]*pscale)"),
+                     cache_n(input_par_store, 0, "galpy-cache-n", "Number of grid nodes per dimension of the (R,z) interpolation cache of axisymmetric potentials; 0: no cache"),
+                     cache_rmin(input_par_store, 1e-4, "galpy-cache-rmin", "Inner cylindrical radius [Galpy unit] of the interpolation cache, also the scale of the sinh mapping in z"),
+                     cache_rmax(input_par_store, 10.0, "galpy-cache-rmax", "Outer cylindrical radius [Galpy unit] of the interpolation cache"),
+                     cache_zmax(input_par_store, 10.0, "galpy-cache-zmax", "Maximum |z| [Galpy unit] of the interpolation cache"),
+                     evolve_dt(input_par_store, 0.0, "galpy-evolve-dt", "Minimum time interval [IN] to update the parameters of MWPotentialEvolve; 0: update at every tree step"),
                      print_flag(false) {}
 
     //! reading parameters from GNU option API
@@ -54,6 +70,11 @@ public:
             {vscale.key,     required_argument, &galpy_flag, 5}, 
             {fscale.key,     required_argument, &galpy_flag, 6}, 
             {pscale.key,     required_argument, &galpy_flag, 7}, 
+            {cache_n.key,    required_argument, &galpy_flag, 8}, 
+            {cache_rmin.key, required_argument, &galpy_flag, 9}, 
+            {cache_rmax.key, required_argument, &galpy_flag, 10}, 
+            {cache_zmax.key, required_argument, &galpy_flag, 11}, 
+            {evolve_dt.key,  required_argument, &galpy_flag, 12}, 
             {"help", no_argument, 0, 'h'},
             {0,0,0,0}
         };
@@ -107,6 +128,35 @@ public:
                     if(print_flag) pscale.print(std::cout);
                     opt_used+=2;
                     break;
+                case 8:
+                    cache_n.value = atoi(optarg);
+                    if(print_flag) cache_n.print(std::cout);
+                    assert(cache_n.value==0||cache_n.value>=2);
+                    opt_used+=2;
+                    break;
+                case 9:
+                    cache_rmin.value = atof(optarg);
+                    if(print_flag) cache_rmin.print(std::cout);
+                    assert(cache_rmin.value>0.0);
+                    opt_used+=2;
+                    break;
+                case 10:
+                    cache_rmax.value = atof(optarg);
+                    if(print_flag) cache_rmax.print(std::cout);
+                    opt_used+=2;
+                    break;
+                case 11:
+                    cache_zmax.value = atof(optarg);
+                    if(print_flag) cache_zmax.print(std::cout);
+                    assert(cache_zmax.value>0.0);
+                    opt_used+=2;
+                    break;
+                case 12:
+                    evolve_dt.value = atof(optarg);
+                    if(print_flag) evolve_dt.print(std::cout);
+                    assert(evolve_dt.value>=0.0);
+                    opt_used+=2;
+                    break;
                 default:
                     break;
                 }
@@ -198,7 +248,13 @@ public:
                              <<"             Here the G*M and distance scaling factors are 2.4692087520131e-09 [galpy GM unit] / [pc^3/Myr^2] and 0.000125 [8 kpc] / [pc], respectively;\n"
                              <<"             The plummer sphere has a total mass of 1000 Msun and a scale radius of 1 pc at time zero.\n"
                              <<"             Notice that the comments after the symbol # is for the reference here, they cannot appear in the configure file.\n"
-                             <<"       Users can either use --galpy-type-arg and --galpy-set or --galpy-conf-file. But if both are used, the error will appear."
+                             <<"       Users can either use --galpy-type-arg and --galpy-set or --galpy-conf-file. But if both are used, the error will appear.\n"
+                             <<"       for --galpy-cache-n: the force and potential of each potential set are tabulated on a (R,z) grid, where R is log-spaced in [rmin, rmax]\n"
+                             <<"             and z is spaced by asinh(z/rmin) in [-zmax, zmax]. Particles inside the grid use the bilinear interpolation and others use Galpy directly.\n"
+                             <<"             The grid is rebuilt when the potential arguments are updated and the maximum relative errors are printed.\n"
+                             <<"             Only static axisymmetric potential sets are supported, non-axisymmetric sets are detected and evaluated by Galpy directly.\n"
+                             <<"             Explicitly time-dependent potentials (e.g. wrappers with time argument) should not use the cache.\n"
+                             <<"             For MWPotentialEvolve, use --galpy-evolve-dt (e.g. the output interval) to avoid rebuilding the grid at every tree step."
                              <<std::endl;
                 }
                 return -1;
@@ -296,6 +352,237 @@ struct PotentialSet{
     }
 };
 
+//! interpolation grid of force and potential in (R,z) for one axisymmetric potential set
+/*! R is log-spaced in [rmin, rmax]; z is mapped by v=asinh(z/rmin) and uniformly spaced in [-zmax, zmax].
+    All values are in Galpy unit. The bilinear interpolation is used.
+ */
+struct PotentialGridRZ{
+    int nr, nz; // number of nodes
+    double rmin, rmax, zmax; // grid boundary
+    double rmin_inv, du_inv, dv_inv, vmax; // mapping factors
+    std::vector<double> acc_r; // R force
+    std::vector<double> acc_z; // z force
+    std::vector<double> pot;   // potential
+    bool valid; // false: the set is not axisymmetric, time-dependent or the grid is not built
+    double err_acc; // maximum relative error of force from the check
+    double err_pot; // maximum relative error of potential from the check
+
+    PotentialGridRZ(): nr(0), nz(0), rmin(0.0), rmax(0.0), zmax(0.0), rmin_inv(0.0), du_inv(0.0), dv_inv(0.0), vmax(0.0), acc_r(), acc_z(), pot(), valid(false), err_acc(0.0), err_pot(0.0) {}
+
+    //! get R of node index (can be non-integer)
+    double getR(const double _iu) const {
+        return rmin*std::exp(_iu/du_inv);
+    }
+
+    //! get z of node index (can be non-integer)
+    double getZ(const double _iv) const {
+        return rmin*std::sinh(_iv/dv_inv - vmax);
+    }
+
+    //! potential at (R, z, phi, t), evaluatePotentials of Galpy uses phi=t=0
+    static double evaluatePotentialsPhiT(const double _r, const double _z, const double _phi, const double _t, const int _npot, struct potentialArg* _args) {
+        double pot = 0.0;
+        for (int i=0; i<_npot; i++) pot += _args[i].potentialEval(_r, _z, _phi, _t, &_args[i]);
+        return pot;
+    }
+
+    //! check whether a potential set is axisymmetric and static
+    /*! On a subset of nodes (about 16 per dimension), forces and potentials at several azimuthal angles
+        (including an irrational fraction of pi) and at later times are compared with those at phi=0 and _t,
+        and the phi force is compared with the total force.
+      @param[in] _pset: potential set
+      @param[in] _t: time [Galpy unit]
+      \return maximum relative difference
+     */
+    double checkAxisymmetryAndStatic(PotentialSet& _pset, const double _t) {
+        int my_rank = 0, n_proc = 1;
+#ifdef PARTICLE_SIMULATOR_MPI_PARALLEL
+        my_rank = PS::Comm::getRank();
+        n_proc = PS::Comm::getNumberOfProc();
+#endif
+        const int npot = _pset.npot;
+        auto* args = _pset.arguments;
+        const double pi = 3.141592653589793;
+        const int n_phi = 4;
+        const double phi_check[n_phi] = {0.0, 0.25*pi, 0.5*pi, 1.0};
+        const int n_dt = 3;
+        const double dt_check[n_dt] = {1e-3, 1.0, 1e3};
+        const int stride_r = std::max(1, (nr-1)/16);
+        const int stride_z = std::max(1, (nz-1)/16);
+        double diff_max = 0.0;
+#pragma omp parallel for schedule(dynamic) reduction(max:diff_max)
+        for (int ir=my_rank*stride_r; ir<nr; ir+=stride_r*n_proc) {
+            const double r = getR(ir);
+            for (int iz=0; iz<nz; iz+=stride_z) {
+                const double z = getZ(iz);
+                const double acc_r0 = calcRforce(r, z, 0.0, _t, npot, args);
+                const double acc_z0 = calczforce(r, z, 0.0, _t, npot, args);
+                const double pot0   = evaluatePotentialsPhiT(r, z, 0.0, _t, npot, args);
+                const double acc_abs = std::sqrt(acc_r0*acc_r0+acc_z0*acc_z0);
+                const double pot_abs = std::abs(pot0);
+                auto compare = [&](const double _phi, const double _tc) {
+                    const double acc_r = calcRforce(r, z, _phi, _tc, npot, args);
+                    const double acc_z = calczforce(r, z, _phi, _tc, npot, args);
+                    const double acc_phi = calcPhiforce(r, z, _phi, _tc, npot, args);
+                    const double pot = evaluatePotentialsPhiT(r, z, _phi, _tc, npot, args);
+                    if (acc_abs>0.0) {
+                        diff_max = std::max(diff_max, std::abs(acc_phi)/(r*acc_abs));
+                        diff_max = std::max(diff_max, std::sqrt((acc_r-acc_r0)*(acc_r-acc_r0)+(acc_z-acc_z0)*(acc_z-acc_z0))/acc_abs);
+                    }
+                    else if (acc_r!=0.0||acc_z!=0.0||acc_phi!=0.0) diff_max = std::numeric_limits<double>::max();
+                    if (pot_abs>0.0) diff_max = std::max(diff_max, std::abs(pot-pot0)/pot_abs);
+                    else if (pot!=0.0) diff_max = std::numeric_limits<double>::max();
+                };
+                for (int i=0; i<n_phi; i++) compare(phi_check[i], _t);
+                for (int i=0; i<n_dt; i++) compare(0.0, _t+dt_check[i]);
+            }
+        }
+#ifdef PARTICLE_SIMULATOR_MPI_PARALLEL
+        diff_max = PS::Comm::getMaxValue(diff_max);
+#endif
+        return diff_max;
+    }
+
+    //! build the grid
+    /*! The potential set is first checked by checkAxisymmetryAndStatic, the grid is built only if it is axisymmetric and static.
+        The nodes are distributed to MPI ranks and OpenMP threads, the results are summed by MPI_Allreduce.
+      @param[in] _pset: potential set
+      @param[in] _t: time [Galpy unit]
+      @param[in] _n: number of nodes per dimension
+      @param[in] _rmin: inner radius
+      @param[in] _rmax: outer radius
+      @param[in] _zmax: maximum |z|
+     */
+    void build(PotentialSet& _pset, const double _t, const int _n, const double _rmin, const double _rmax, const double _zmax) {
+        assert(_n>=2);
+        assert(_rmin>0.0&&_rmax>_rmin&&_zmax>0.0);
+        nr = nz = _n;
+        rmin = _rmin;
+        rmax = _rmax;
+        zmax = _zmax;
+        rmin_inv = 1.0/rmin;
+        du_inv = (nr-1)/std::log(rmax/rmin);
+        vmax = std::asinh(zmax/rmin);
+        dv_inv = (nz-1)/(2.0*vmax);
+
+        valid = (checkAxisymmetryAndStatic(_pset, _t)<1e-10);
+        if (!valid) {
+            acc_r.clear();
+            acc_z.clear();
+            pot.clear();
+            return;
+        }
+
+        const int n_node = nr*nz;
+        acc_r.assign(n_node, 0.0);
+        acc_z.assign(n_node, 0.0);
+        pot.assign(n_node, 0.0);
+
+        int my_rank = 0, n_proc = 1;
+#ifdef PARTICLE_SIMULATOR_MPI_PARALLEL
+        my_rank = PS::Comm::getRank();
+        n_proc = PS::Comm::getNumberOfProc();
+#endif
+        const int npot = _pset.npot;
+        auto* args = _pset.arguments;
+#pragma omp parallel for schedule(dynamic)
+        for (int ir=my_rank; ir<nr; ir+=n_proc) {
+            const double r = getR(ir);
+            for (int iz=0; iz<nz; iz++) {
+                const double z = getZ(iz);
+                const int k = ir*nz+iz;
+                acc_r[k] = calcRforce(r, z, 0.0, _t, npot, args);
+                acc_z[k] = calczforce(r, z, 0.0, _t, npot, args);
+                pot[k]   = evaluatePotentials(r, z, npot, args);
+            }
+        }
+#ifdef PARTICLE_SIMULATOR_MPI_PARALLEL
+        MPI_Allreduce(MPI_IN_PLACE, acc_r.data(), n_node, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+        MPI_Allreduce(MPI_IN_PLACE, acc_z.data(), n_node, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+        MPI_Allreduce(MPI_IN_PLACE, pot.data(),   n_node, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+#endif
+        checkError(_pset, _t);
+    }
+
+    //! check the maximum relative errors at cell centers, where the bilinear interpolation error is largest
+    /*! A subset of cells (about 64 per dimension) is checked
+      @param[in] _pset: potential set
+      @param[in] _t: time [Galpy unit]
+     */
+    void checkError(PotentialSet& _pset, const double _t) {
+        int my_rank = 0, n_proc = 1;
+#ifdef PARTICLE_SIMULATOR_MPI_PARALLEL
+        my_rank = PS::Comm::getRank();
+        n_proc = PS::Comm::getNumberOfProc();
+#endif
+        const int npot = _pset.npot;
+        auto* args = _pset.arguments;
+        const int stride_r = std::max(1, (nr-1)/64);
+        const int stride_z = std::max(1, (nz-1)/64);
+        double err_acc_max = 0.0, err_pot_max = 0.0;
+#pragma omp parallel for schedule(dynamic) reduction(max:err_acc_max,err_pot_max)
+        for (int ir=my_rank*stride_r; ir<nr-1; ir+=stride_r*n_proc) {
+            const double r = getR(ir+0.5);
+            for (int iz=0; iz<nz-1; iz+=stride_z) {
+                const double z = getZ(iz+0.5);
+                double acc_r_i, acc_z_i, pot_i;
+                if (!interpolate(acc_r_i, acc_z_i, pot_i, r, z)) continue;
+                const double acc_r_d = calcRforce(r, z, 0.0, _t, npot, args);
+                const double acc_z_d = calczforce(r, z, 0.0, _t, npot, args);
+                const double pot_d   = evaluatePotentials(r, z, npot, args);
+                const double dacc_r = acc_r_i - acc_r_d;
+                const double dacc_z = acc_z_i - acc_z_d;
+                const double acc2_d = acc_r_d*acc_r_d + acc_z_d*acc_z_d;
+                if (acc2_d>0.0) err_acc_max = std::max(err_acc_max, std::sqrt((dacc_r*dacc_r+dacc_z*dacc_z)/acc2_d));
+                if (pot_d!=0.0) err_pot_max = std::max(err_pot_max, std::abs((pot_i-pot_d)/pot_d));
+            }
+        }
+#ifdef PARTICLE_SIMULATOR_MPI_PARALLEL
+        err_acc_max = PS::Comm::getMaxValue(err_acc_max);
+        err_pot_max = PS::Comm::getMaxValue(err_pot_max);
+#endif
+        err_acc = err_acc_max;
+        err_pot = err_pot_max;
+    }
+
+    //! bilinear interpolation 
+    /*! 
+      @param[out] _acc_r: R force
+      @param[out] _acc_z: z force
+      @param[out] _pot: potential
+      @param[in] _r: cylindrical radius
+      @param[in] _z: z
+      \return false if the position is outside the grid
+     */
+    inline bool interpolate(double& _acc_r, double& _acc_z, double& _pot, const double _r, const double _z) const {
+        if (_r<rmin || _r>=rmax || std::abs(_z)>=zmax) return false;
+        const double u = std::log(_r*rmin_inv)*du_inv;
+        const double v = (std::asinh(_z*rmin_inv)+vmax)*dv_inv;
+        const int iu = std::min(std::max(int(u), 0), nr-2);
+        const int iv = std::min(std::max(int(v), 0), nz-2);
+        const double fu = u - iu;
+        const double fv = v - iv;
+        const double w00 = (1.0-fu)*(1.0-fv);
+        const double w01 = (1.0-fu)*fv;
+        const double w10 = fu*(1.0-fv);
+        const double w11 = fu*fv;
+        const int k = iu*nz+iv;
+        _acc_r = w00*acc_r[k] + w01*acc_r[k+1] + w10*acc_r[k+nz] + w11*acc_r[k+nz+1];
+        _acc_z = w00*acc_z[k] + w01*acc_z[k+1] + w10*acc_z[k+nz] + w11*acc_z[k+nz+1];
+        _pot   = w00*pot[k]   + w01*pot[k+1]   + w10*pot[k+nz]   + w11*pot[k+nz+1];
+        return true;
+    }
+
+    void clear() {
+        nr = nz = 0;
+        acc_r.clear();
+        acc_z.clear();
+        pot.clear();
+        valid = false;
+        err_acc = err_pot = 0.0;
+    }
+};
+
 //! FRW cosmological model for calculating scale factor (redshift)
 class FRWModel{
 public:
@@ -569,8 +856,16 @@ public:
     std::string set_name;
     std::string set_parfile;
     MWPotentialEvolve mw_evolve;
+    double evolve_dt; // minimum time interval to update MWPotentialEvolve
+    double evolve_time; // last update time of MWPotentialEvolve
+    long long int potential_update_count; // increase when potential sets are regenerated
+    long long int cache_update_count; // potential_update_count when the grid cache is built
+    int cache_n; // number of grid nodes per dimension, 0: no cache
+    double cache_rmin, cache_rmax, cache_zmax; // grid range [Galpy unit]
+    std::vector<PotentialGridRZ> grid_cache; // grid for each potential set
 
-    GalpyManager(): potential_sets(), update_time(0.0), rscale(1.0), tscale(1.0), vscale(1.0), fscale(1.0), pscale(1.0), gmscale(1.0), fconf(), set_name(), set_parfile(), mw_evolve() {}
+    GalpyManager(): potential_sets(), update_time(0.0), rscale(1.0), tscale(1.0), vscale(1.0), fscale(1.0), pscale(1.0), gmscale(1.0), fconf(), set_name(), set_parfile(), mw_evolve(), 
+                    evolve_dt(0.0), evolve_time(0.0), potential_update_count(0), cache_update_count(-1), cache_n(0), cache_rmin(0.0), cache_rmax(0.0), cache_zmax(0.0), grid_cache() {}
 
     //! initialization function
     /*!
@@ -587,6 +882,13 @@ public:
         pscale = _input.pscale.value;
         gmscale = pscale*rscale;
 
+        // interpolation cache
+        cache_n = _input.cache_n.value;
+        cache_rmin = _input.cache_rmin.value;
+        cache_rmax = _input.cache_rmax.value;
+        cache_zmax = _input.cache_zmax.value;
+        evolve_dt = _input.evolve_dt.value;
+
         // add pre-defined type-argu groups
         std::string type_args = _input.type_args.value;
         // Update types and arguments from type-args string
@@ -647,10 +949,18 @@ public:
             mw_evolve.initialFromFile(set_parfile, _time);
 
             updateMWPotentialEvolve(0, _print_flag);
+            // ensure the first updatePotential call applies the parameters at the current time
+            evolve_time = -std::numeric_limits<double>::max();
 
             initial_flag = true;
         }        
 
+        // MWPotentialEvolve is updated at every tree step without evolve_dt, do not rebuild the cache every step
+        if (cache_n>0 && set_name=="MWPotentialEvolve" && evolve_dt==0.0) {
+            if (_print_flag) std::cout<<"Galpy grid cache is switched off since MWPotentialEvolve is updated every step, set --galpy-evolve-dt to use the cache"<<std::endl;
+            cache_n = 0;
+        }
+
         if (initial_flag && _input.config_filename.value!="__NONE__")  {
             std::cerr<<"Galpy Error: both --galpy-type-arg|--galpy-set and --galpy-conf-file are used, please choose one of them."<<std::endl;
             abort();
@@ -772,13 +1082,59 @@ public:
      */
     void updatePotential(const double& _system_time, const bool _print_flag) {
         
-        if (set_name=="MWPotentialEvolve") updateMWPotentialEvolve(_system_time, _print_flag);
+        if (set_name=="MWPotentialEvolve" && (evolve_dt==0.0 || _system_time-evolve_time>=evolve_dt)) {
+            updateMWPotentialEvolve(_system_time, _print_flag);
+            evolve_time = _system_time;
+        }
 
         updateTypesAndArgsFromFile(_system_time, _print_flag);
+
+        if (cache_n>0 && cache_update_count!=potential_update_count) buildGridCache(_system_time, _print_flag);
+    }
+
+    //! build interpolation grids for all potential sets
+    /*!
+      @param[in] _system_time: the time of particle system in PeTar
+      @param[in] _print_flag: if true, print grid information and error bounds
+     */
+    void buildGridCache(const double& _system_time, const bool _print_flag) {
+        const double t = _system_time*tscale;
+        grid_cache.resize(potential_sets.size());
+        for (size_t k=0; k<potential_sets.size(); k++) {
+            auto& grid = grid_cache[k];
+            grid.build(potential_sets[k], t, cache_n, cache_rmin, cache_rmax, cache_zmax);
+            if (_print_flag) {
+                std::cout<<std::setprecision(6)<<"Galpy grid cache: set "<<k+1;
+                if (grid.valid)
+                    std::cout<<" nodes "<<grid.nr<<" x "<<grid.nz
+                             <<" R range [Galpy]: ["<<grid.rmin<<", "<<grid.rmax<<"] |z| < "<<grid.zmax
+                             <<" max relative error: force "<<grid.err_acc<<" potential "<<grid.err_pot<<std::endl;
+                else
+                    std::cout<<" is not axisymmetric or time-dependent, use Galpy directly"<<std::endl;
+            }
+        }
+        cache_update_count = potential_update_count;
+    }
+
+    //! check whether the grid cache of one potential set can be used
+    bool isGridCacheValid(const size_t _k) const {
+        return (cache_n>0 && cache_update_count==potential_update_count && grid_cache[_k].valid);
+    }
+
+    //! update MWPotentialEvolve parameters to the current time if the update is delayed by evolve_dt
+    /*! Must be called by all MPI ranks before writePotentialPars, so that all ranks keep the same potential
+      @param[in] _system_time: the time of particle system in PeTar
+      @param[in] _print_flag: if true, print the updated parameters
+     */
+    void updatePotentialEvolveToTime(const double& _system_time, const bool _print_flag) {
+        if (set_name=="MWPotentialEvolve" && mw_evolve.frw.time!=_system_time) {
+            updateMWPotentialEvolve(_system_time, _print_flag);
+            evolve_time = _system_time;
+        }
     }
 
     //! write potential parameters for restart
-    /*! Precision is set to 14
+    /*! Precision is set to 14. If evolve_dt is used, updatePotentialEvolveToTime should be called first.
       @param[in] _fout std:ofstream to write data
       @param[in] _time current time
      */
@@ -1052,7 +1408,117 @@ public:
         }
     }
 
+    //! calculate acceleration and potential for a batch of particles
+    /*! The positions and the results are structure-of-arrays. 
+        The cylindrical coordinates are calculated once for each frame used by potential sets, 
+        then each potential component is evaluated for all particles in one pass.
+        Particles are processed in chunks of GALPY_BATCH_SIZE with scratch arrays on stack, thus the function can be called by multiple threads.
+      @param[out] _acc: [3] arrays of acceleration x, y, z (size of _n)
+      @param[out] _pot: array of potential (size of _n)
+      @param[in] _time: time in input unit
+      @param[in] _n: number of particles
+      @param[in] _pos_g: [3] arrays of position x, y, z in the galactic frame [input unit]
+      @param[in] _pos_l: [3] arrays of position x, y, z in the particle system frame [input unit]
+     */
+    void calcAccPotBatch(double* const _acc[3], double* _pot, const double _time, const int _n, const double* const _pos_g[3], const double* const _pos_l[3]) {
+        if (potential_sets.size()==0) {
+            for (int j=0; j<_n; j++) _acc[0][j] = _acc[1][j] = _acc[2][j] = _pot[j] = 0.0;
+            return;
+        }
+
+        const double t = _time*tscale;
+        bool frame_used[2] = {false, false};
+        for (size_t k=0; k<potential_sets.size(); k++) {
+            assert(potential_sets[k].mode==0||potential_sets[k].mode==1);
+            frame_used[potential_sets[k].mode] = true;
+        }
+        const double* const* pos_frame[2] = {_pos_g, _pos_l};
+        const double fscale_inv = 1.0/fscale;
+        const double pscale_inv = 1.0/pscale;
+
+        double rxy[2][GALPY_BATCH_SIZE], z[2][GALPY_BATCH_SIZE], phi[2][GALPY_BATCH_SIZE], sinphi[2][GALPY_BATCH_SIZE], cosphi[2][GALPY_BATCH_SIZE];
+        double acc_rxy[GALPY_BATCH_SIZE], acc_z[GALPY_BATCH_SIZE], acc_phi[GALPY_BATCH_SIZE], pot_set[GALPY_BATCH_SIZE];
+        int index_direct[GALPY_BATCH_SIZE];
+
+        for (int i0=0; i0<_n; i0+=GALPY_BATCH_SIZE) {
+            const int nb = std::min(GALPY_BATCH_SIZE, _n-i0);
+            double* acc_x = &_acc[0][i0];
+            double* acc_y = &_acc[1][i0];
+            double* acc_zb= &_acc[2][i0];
+            double* pot = &_pot[i0];
+
+            // cylindrical coordinates
+            for (int f=0; f<2; f++) {
+                if (!frame_used[f]) continue;
+                const double* x = &pos_frame[f][0][i0];
+                const double* y = &pos_frame[f][1][i0];
+                const double* zf= &pos_frame[f][2][i0];
+                for (int j=0; j<nb; j++) {
+                    const double xs = x[j]*rscale;
+                    const double ys = y[j]*rscale;
+                    z[f][j] = zf[j]*rscale;
+                    rxy[f][j] = std::sqrt(xs*xs+ys*ys);
+                    cosphi[f][j] = xs/rxy[f][j];
+                    sinphi[f][j] = ys/rxy[f][j];
+                }
+                for (int j=0; j<nb; j++) phi[f][j] = std::acos(cosphi[f][j]);
+            }
+
+            for (int j=0; j<nb; j++) acc_x[j] = acc_y[j] = acc_zb[j] = pot[j] = 0.0;
+
+            for (size_t k=0; k<potential_sets.size(); k++) {
+                const int f = potential_sets[k].mode;
+                const int npot = potential_sets[k].npot;
+                for (int j=0; j<nb; j++) acc_rxy[j] = acc_z[j] = acc_phi[j] = pot_set[j] = 0.0;
+
+                // use interpolation grid if possible, the others use Galpy directly
+                int n_direct = 0;
+                if (isGridCacheValid(k)) {
+                    auto& grid = grid_cache[k];
+                    for (int j=0; j<nb; j++) {
+                        if (!grid.interpolate(acc_rxy[j], acc_z[j], pot_set[j], rxy[f][j], z[f][j])) 
+                            index_direct[n_direct++] = j;
+                    }
+                }
+                else {
+                    for (int j=0; j<nb; j++) index_direct[j] = j;
+                    n_direct = nb;
+                }
+
+                // one pass for each potential component
+                for (int c=0; c<npot; c++) {
+                    struct potentialArg* arg_c = potential_sets[k].arguments + c;
+                    for (int jj=0; jj<n_direct; jj++) {
+                        const int j = index_direct[jj];
+                        acc_rxy[j] += calcRforce(rxy[f][j], z[f][j], phi[f][j], t, 1, arg_c);
+                        acc_z[j]   += calczforce(rxy[f][j], z[f][j], phi[f][j], t, 1, arg_c);
+                        acc_phi[j] += calcPhiforce(rxy[f][j], z[f][j], phi[f][j], t, 1, arg_c);
+                        pot_set[j] += evaluatePotentials(rxy[f][j], z[f][j], 1, arg_c);
+                    }
+                }
+
+                for (int j=0; j<nb; j++) {
+                    pot[j] += pot_set[j];
+                    if (rxy[f][j]>0.0) {
+                        const double rinv = 1.0/rxy[f][j];
+                        acc_x[j] += (cosphi[f][j]*acc_rxy[j] - sinphi[f][j]*acc_phi[j]*rinv);
+                        acc_y[j] += (sinphi[f][j]*acc_rxy[j] + cosphi[f][j]*acc_phi[j]*rinv);
+                        acc_zb[j]+= acc_z[j];
+                    }
+                }
+            }
+
+            for (int j=0; j<nb; j++) {
+                pot[j]   *= pscale_inv;
+                acc_x[j] *= fscale_inv;
+                acc_y[j] *= fscale_inv;
+                acc_zb[j]*= fscale_inv;
+            }
+        }
+    }
+
     void freePotentialArgs() {
+        potential_update_count++;
         if (!potential_sets.empty()) {
             for (size_t i=0; i<potential_sets.size(); i++) potential_sets[i].clear();
             potential_sets.resize(0);
@@ -1061,6 +1527,8 @@ public:
 
     void clear() {
         freePotentialArgs();
+        for (size_t k=0; k<grid_cache.size(); k++) grid_cache[k].clear();
+        grid_cache.resize(0);
         update_time = 0;
         if (fconf.is_open()) fconf.close();
     }
@@ -1,5 +1,7 @@
 #include <iostream>
 #include <fstream>
+#include <cmath>
+#include <algorithm>
 #include <getopt.h>
 #include "galpy_interface.h"
 #include "../src/io.hpp"
@@ -220,16 +222,44 @@ int main(int argc, char** argv){
         Particle::printColumnTitle(std::cout);
         std::cout<<std::endl;
 
+        // evaluate all particles with the batch API (structure of arrays)
+        std::vector<double> pos_g[3], pos_l[3], acc[3], pot(n);
+        for (int k=0; k<3; k++) {
+            pos_g[k].resize(n);
+            pos_l[k].resize(n);
+            acc[k].resize(n);
+        }
         for (int i=0; i<n; i++) {
             particles[i].readAscii(fp);
-            double pos[3] = {particles[i].pos[0] + pos_offset[0],
-                             particles[i].pos[1] + pos_offset[1],
-                             particles[i].pos[2] + pos_offset[2]};
+            for (int k=0; k<3; k++) {
+                pos_g[k][i] = particles[i].pos[k] + pos_offset[k];
+                pos_l[k][i] = particles[i].pos[k];
+            }
+        }
+        double* acc_ptr[3] = {acc[0].data(), acc[1].data(), acc[2].data()};
+        const double* pos_g_ptr[3] = {pos_g[0].data(), pos_g[1].data(), pos_g[2].data()};
+        const double* pos_l_ptr[3] = {pos_l[0].data(), pos_l[1].data(), pos_l[2].data()};
+        galpy_manager.calcAccPotBatch(acc_ptr, pot.data(), time, n, pos_g_ptr, pos_l_ptr);
+
+        // the batch API should agree with the scalar one (within the grid error if the interpolation cache is used)
+        const double tolerance = galpy_manager.cache_n>0 ? 1e-3 : 1e-10;
+        double diff_max = 0.0;
+        for (int i=0; i<n; i++) {
+            double pos[3] = {pos_g[0][i], pos_g[1][i], pos_g[2][i]};
             galpy_manager.calcAccPot(particles[i].acc, particles[i].pot, time, pos, &particles[i].pos[0]);
 
+            double acc_abs = std::sqrt(particles[i].acc[0]*particles[i].acc[0] + particles[i].acc[1]*particles[i].acc[1] + particles[i].acc[2]*particles[i].acc[2]);
+            for (int k=0; k<3; k++)
+                diff_max = std::max(diff_max, std::abs(acc[k][i]-particles[i].acc[k])/std::max(acc_abs, 1e-300));
+            diff_max = std::max(diff_max, std::abs(pot[i]-particles[i].pot)/std::max(std::abs(particles[i].pot), 1e-300));
+
             particles[i].printColumn(std::cout);
             std::cout<<std::endl;
         }
+        if (diff_max>tolerance) {
+            std::cerr<<"Error: maximum relative difference between calcAccPotBatch and calcAccPot is "<<diff_max<<" > "<<tolerance<<std::endl;
+            abort();
+        }
     }    
     return 0;
 }
@@ -237,49 +237,16 @@ public:
 
         // perturber force
         const int n_pert = _perturber.neighbor_address.getSize();
-        const int n_pert_single = _perturber.n_neighbor_single;
-        const int n_pert_group = _perturber.n_neighbor_group;
 
         if (n_pert>0) {
 
             Float time = _time;
 
-            auto* pert_adr = _perturber.neighbor_address.getDataAddress();
-
-            Float xp[n_pert][3], xcm[3], m[n_pert];
-            ChangeOver* changeover[n_pert_single];
-            H4::NBAdr<PtclHard>::Group* ptclgroup[n_pert_group];
-
-            int n_single_count=0;
-            int n_group_count=0;
-            for (int j=0; j<n_pert; j++) {
-                H4::NBAdr<PtclHard>::Single* pertj;
-                int k; // index of predicted data
-                if (pert_adr[j].type==H4::NBType::group) {
-                    pertj = &(((H4::NBAdr<PtclHard>::Group*)pert_adr[j].adr)->cm);
-                    k = n_group_count + n_pert_single;
-                    ptclgroup[n_group_count] = (H4::NBAdr<PtclHard>::Group*)pert_adr[j].adr;
-                    n_group_count++;
-                }
-                else {
-                    pertj = (H4::NBAdr<PtclHard>::Single*)pert_adr[j].adr;
-                    k = n_single_count;
-                    changeover[n_single_count] = &pertj->changeover;
-                    n_single_count++;
-                }
-
-                Float dt = time - pertj->time;
-                //ASSERT(dt>=-1e-7);
-                xp[k][0] = pertj->pos[0] + dt*(pertj->vel[0] + 0.5*dt*(pertj->acc0[0] + inv3*dt*pertj->acc1[0]));
-                xp[k][1] = pertj->pos[1] + dt*(pertj->vel[1] + 0.5*dt*(pertj->acc0[1] + inv3*dt*pertj->acc1[1]));
-                xp[k][2] = pertj->pos[2] + dt*(pertj->vel[2] + 0.5*dt*(pertj->acc0[2] + inv3*dt*pertj->acc1[2]));
-
-
-                m[k] = pertj->mass;
-            }
-            ASSERT(n_single_count == n_pert_single);
-            ASSERT(n_group_count == n_pert_group);
+            // predicted perturbers in structure-of-arrays, one heap scratch per thread
+            static thread_local ARPerturberSoA pert_soa;
+            pert_soa.load(_perturber, time);
 
+            Float xcm[3];
             Float dt = time - _particle_cm.time;
             //ASSERT(dt>=0.0);
             xcm[0] = _particle_cm.pos[0] + dt*(_particle_cm.vel[0] + 0.5*dt*(_particle_cm.acc0[0] + inv3*dt*_particle_cm.acc1[0]));
@@ -304,44 +271,8 @@ public:
                 xi[1] = pi.pos[1] + xcm[1];
                 xi[2] = pi.pos[2] + xcm[2];
 
-                // single perturber
-                for (int j=0; j<n_pert_single; j++) {
-                    Float dr[3] = {xp[j][0] - xi[0],
-                                   xp[j][1] - xi[1],
-                                   xp[j][2] - xi[2]};
-                    Float r2 = dr[0]*dr[0] + dr[1]*dr[1] + dr[2]*dr[2] + eps_sq;
-                    Float r  = sqrt(r2);
-                    Float k  = ChangeOver::calcAcc0WTwo(chi, *changeover[j], r);
-                    Float r3 = r*r2;
-                    Float gm = gravitational_constant*m[j];
-                    Float gmor3 = gm/r3 * k;
-
-                    acc_pert[0] += gmor3 * dr[0];
-                    acc_pert[1] += gmor3 * dr[1];
-                    acc_pert[2] += gmor3 * dr[2];
-
-                }
-                // group perturber
-                for (int j=n_pert_single; j<n_pert; j++) {
-                    Float dr[3] = {xp[j][0] - xi[0],
-                                   xp[j][1] - xi[1],
-                                   xp[j][2] - xi[2]};
-                    Float r2 = dr[0]*dr[0] + dr[1]*dr[1] + dr[2]*dr[2] + eps_sq;
-                    Float r  = sqrt(r2);
-                    const int jk = j-n_pert_single;
-                    auto* ptcl_mem = ptclgroup[jk]->getDataAddress();
-                    Float mk = 0.0;
-                    for (int k=0; k<ptclgroup[jk]->getSize(); k++) {
-                        mk += ptcl_mem[k].mass * ChangeOver::calcAcc0WTwo(chi, ptcl_mem[k].changeover, r);
-                    }
-                    Float r3 = r*r2;
-                    Float gmor3 = gravitational_constant*mk/r3;
-
-                    acc_pert[0] += gmor3 * dr[0];
-                    acc_pert[1] += gmor3 * dr[1];
-                    acc_pert[2] += gmor3 * dr[2];
-
-                }
+                // single and group member perturbers
+                pert_soa.calcAcc(acc_pert, xi, chi, eps_sq, gravitational_constant);
 
                 acc_pert_cm[0] += pi.mass *acc_pert[0];
                 acc_pert_cm[1] += pi.mass *acc_pert[1];
@@ -626,7 +557,24 @@ public:
      */
     template <class Tparticle>
     int modifyOneParticle(Tparticle& _p, const Float& _time_now, const Float& _time_end) {
+#if (defined STELLAR_EVOLUTION) && (defined BSE_BASE)
+        return evolveOneStar(_p, _time_end, fout_sse, true);
+#else
+        return 0;
+#endif
+    }
+
 #ifdef STELLAR_EVOLUTION
+    //! evolve one star by SSE to _time_end
+    /*! Used by modifyOneParticle and by StellarEvolutionBatch for single stars, where the events are written to per-thread buffers
+      @param[in] _p: particle
+      @param[in] _time_end: required evolved time (not physical time, NB unit)
+      @param[in,out] _fout: output of SSE events
+      @param[in] _lock_output: if true, write events in an OpenMP critical section (_fout is shared by threads)
+      \return 0: no modification; 1: modify mass; 2: modify mass and velocity; 3: mass become zero
+     */
+    template <class Tparticle>
+    int evolveOneStar(Tparticle& _p, const Float& _time_end, std::ostream& _fout, const bool _lock_output) {
         // sample of mass loss
         //if (_p.time_interrupt<_time_end) {
         //    _p.dm = -_p.mass*1e-4;
@@ -681,16 +629,11 @@ public:
 
             // type change
             if (stellar_evolution_write_flag&&event_flag==1) {
+                if (_lock_output) {
 #pragma omp critical
-                {
-                    fout_sse<<"Type_change ";
-                    //bse_manager.printTypeChange(fout_sse, _p.star, output);
-                    fout_sse<<std::setw(WRITE_WIDTH)<<_p.id;
-                    star_bk.printColumn(fout_sse, WRITE_WIDTH);
-                    _p.star.printColumn(fout_sse, WRITE_WIDTH);
-                    //output.printColumn(fout_sse, WRITE_WIDTH);
-                    fout_sse<<std::endl;
+                    printSSETypeChange(_fout, _p, star_bk);
                 }
+                else printSSETypeChange(_fout, _p, star_bk);
             }
 
             // add velocity change if exist
@@ -701,14 +644,11 @@ public:
                 for (int k=0; k<3; k++) _p.vel[k] += dv[k];
                 modify_flag = 2;
                 if (stellar_evolution_write_flag) {
+                    if (_lock_output) {
 #pragma omp critical
-                    {
-                        fout_sse<<"SN_kick "
-                                <<std::setw(WRITE_WIDTH)<<_p.id
-                                <<std::setw(WRITE_WIDTH)<<dvabs*bse_manager.vscale;
-                        _p.star.printColumn(fout_sse, WRITE_WIDTH);
-                        fout_sse<<std::endl;
+                        printSSEKick(_fout, _p, dvabs);
                     }
+                    else printSSEKick(_fout, _p, dvabs);
                 }
             }
             // if mass become zero, set to unused for removing
@@ -721,10 +661,34 @@ public:
         }
 
 #endif // BSE_BASE
-#endif // STELLAR_EVOLUTION
         return 0;
     }
 
+#ifdef BSE_BASE
+    //! print SSE type change event
+    template <class Tparticle>
+    void printSSETypeChange(std::ostream& _fout, const Tparticle& _p, const StarParameter& _star_bk) {
+        _fout<<"Type_change ";
+        //bse_manager.printTypeChange(_fout, _p.star, output);
+        _fout<<std::setw(WRITE_WIDTH)<<_p.id;
+        _star_bk.printColumn(_fout, WRITE_WIDTH);
+        _p.star.printColumn(_fout, WRITE_WIDTH);
+        //output.printColumn(_fout, WRITE_WIDTH);
+        _fout<<std::endl;
+    }
+
+    //! print SSE supernova kick event
+    template <class Tparticle>
+    void printSSEKick(std::ostream& _fout, const Tparticle& _p, const double _dvabs) {
+        _fout<<"SN_kick "
+             <<std::setw(WRITE_WIDTH)<<_p.id
+             <<std::setw(WRITE_WIDTH)<<_dvabs*bse_manager.vscale;
+        _p.star.printColumn(_fout, WRITE_WIDTH);
+        _fout<<std::endl;
+    }
+#endif // BSE_BASE
+#endif // STELLAR_EVOLUTION
+
     //! (Necessary) modify the orbits and interrupt check 
     /*! check the inner left binary whether their separation is smaller than particle radius sum and become close, if true, set one component stauts to merger with cm mass and the other unused with zero mass. Return the binary tree address 
       @param[in] _bin_interrupt: interrupt binary information: adr: binary tree address; time_now: current physical time; time_end: integration finishing time; status: interrupt status: change, merge,none
@@ -5,7 +5,194 @@
 #include "hard_ptcl.hpp"
 #include "Common/binary_tree.h"
 #include "tidal_tensor.hpp"
+#include "hermite_simd.hpp"
 
+//! Structure-of-arrays copy of predicted AR perturbers for the vectorized perturbation force
+/*! Single perturbers are stored first, followed by the members of group perturbers.
+    A group member entry uses the predicted c.m. position of its group together with its own mass and changeover,
+    so that the sum over members is the same as the original group loop.
+    The list is padded to a multiple of 8 with massless particles far away.
+    Perturbers are predicted again at each load, since the hard particle storage is reused at the same addresses by later clusters and tree steps.
+    The kernel uses the SIMD wrappers of HermiteSIMD (without INTEGRATED_CUTOFF_FUNCTION), otherwise a scalar loop over the arrays.
+ */
+class ARPerturberSoA{
+private:
+    enum {X=0, Y, Z, MASS, R_IN, R_OUT, NORM, COFF, N_FIELD};
+    enum {PAD_WIDTH = 8};
+
+    PS::ReallocatableArray<Float> buf_; // field f of entry j is buf_[f*n_pad_ + j]
+    PS::ReallocatableArray<const ChangeOver*> changeover_; // changeover of each entry
+    int n_;     // number of entries
+    int n_pad_; // padded size
+
+    Float* field(const int _f) { return buf_.getPointer(_f*n_pad_); }
+    const Float* field(const int _f) const { return buf_.getPointer(_f*n_pad_); }
+
+    //! set one entry
+    void setEntry(const int _j, const Float* _pos, const Float _mass, const ChangeOver& _ch) {
+        Float* b = buf_.getPointer();
+        b[X*n_pad_+_j] = _pos[0];
+        b[Y*n_pad_+_j] = _pos[1];
+        b[Z*n_pad_+_j] = _pos[2];
+        b[MASS*n_pad_+_j] = _mass;
+        b[R_IN*n_pad_+_j] = _ch.getRin();
+        b[R_OUT*n_pad_+_j] = _ch.getRout();
+        b[NORM*n_pad_+_j] = _ch.getNorm();
+        b[COFF*n_pad_+_j] = _ch.getCoff();
+        changeover_[_j] = &_ch;
+    }
+
+    //! predict the position of one perturber to _time
+    template <class Tpert>
+    static void predict(Float* _pos, const Tpert& _pert, const Float _time) {
+        static const Float inv3 = 1.0 / 3.0;
+        Float dt = _time - _pert.time;
+        //ASSERT(dt>=-1e-7);
+        for (int k=0; k<3; k++)
+            _pos[k] = _pert.pos[k] + dt*(_pert.vel[k] + 0.5*dt*(_pert.acc0[k] + inv3*dt*_pert.acc1[k]));
+    }
+
+public:
+    ARPerturberSoA(): buf_(), changeover_(), n_(0), n_pad_(0) {}
+
+    //! predict perturbers to _time and copy them
+    /*!
+      @param[in] _perturber: perturber container (neighbor_address, n_neighbor_single, n_neighbor_group)
+      @param[in] _time: prediction time
+     */
+    template <class Tptcl>
+    void load(const H4::Neighbor<Tptcl>& _perturber, const Float _time) {
+        typedef typename H4::NBAdr<Tptcl>::Single NBSingle;
+        typedef typename H4::NBAdr<Tptcl>::Group NBGroup;
+        const int n_pert = _perturber.neighbor_address.getSize();
+        const int n_pert_single = _perturber.n_neighbor_single;
+        auto* pert_adr = _perturber.neighbor_address.getDataAddress();
+
+        // number of entries
+        int n = n_pert_single;
+        for (int j=0; j<n_pert; j++)
+            if (pert_adr[j].type==H4::NBType::group) n += ((const NBGroup*)pert_adr[j].adr)->getSize();
+
+        n_ = n;
+        n_pad_ = ((n+PAD_WIDTH-1)/PAD_WIDTH)*PAD_WIDTH;
+        buf_.resizeNoInitialize(N_FIELD*n_pad_);
+        changeover_.resizeNoInitialize(n_pad_);
+
+        int n_single_count=0;
+        int n_member_count=n_pert_single;
+        for (int j=0; j<n_pert; j++) {
+            if (pert_adr[j].type==H4::NBType::group) {
+                const NBGroup* group = (const NBGroup*)pert_adr[j].adr;
+                Float xp[3];
+                predict(xp, group->cm, _time);
+                auto* ptcl_mem = group->getDataAddress();
+                for (int k=0; k<group->getSize(); k++)
+                    setEntry(n_member_count++, xp, ptcl_mem[k].mass, ptcl_mem[k].changeover);
+            }
+            else {
+                const NBSingle* pertj = (const NBSingle*)pert_adr[j].adr;
+                Float xp[3];
+                predict(xp, *pertj, _time);
+                setEntry(n_single_count++, xp, pertj->mass, pertj->changeover);
+            }
+        }
+        ASSERT(n_single_count == n_pert_single);
+        ASSERT(n_member_count == n);
+
+        // padding
+        Float* b = buf_.getPointer();
+        for (int j=n; j<n_pad_; j++) {
+            b[X*n_pad_+j] = b[Y*n_pad_+j] = b[Z*n_pad_+j] = 1e100;
+            b[MASS*n_pad_+j] = 0.0;
+            b[R_IN*n_pad_+j] = 0.5;
+            b[R_OUT*n_pad_+j] = 1.0;
+            b[NORM*n_pad_+j] = 2.0;
+            b[COFF*n_pad_+j] = 1.0/3.0;
+            changeover_[j] = NULL;
+        }
+    }
+
+    //! get number of entries
+    int size() const {
+        return n_;
+    }
+
+    //! accumulate perturbation acceleration of one particle from all entries
+    /*!
+      @param[in,out] _acc: acceleration (accumulated)
+      @param[in] _xi: position of the particle
+      @param[in] _chi: changeover of the particle
+      @param[in] _eps_sq: softening parameter
+      @param[in] _G: gravitational constant
+     */
+    void calcAcc(Float* _acc, const Float* _xi, const ChangeOver& _chi, const Float _eps_sq, const Float _G) const {
+        const Float* px = field(X);
+        const Float* py = field(Y);
+        const Float* pz = field(Z);
+        const Float* mass = field(MASS);
+#if (defined(HERMITE_SIMD_AVX512) || defined(HERMITE_SIMD_AVX2)) && !defined(INTEGRATED_CUTOFF_FUNCTION)
+        static_assert(sizeof(Float)==sizeof(double), "SIMD AR perturber kernel requires double precision Float");
+        using namespace HermiteSIMD;
+        const Float* r_in = field(R_IN);
+        const Float* r_out = field(R_OUT);
+        const Float* norm = field(NORM);
+        const Float* coff = field(COFF);
+        const VecD xi = set1(_xi[0]), yi = set1(_xi[1]), zi = set1(_xi[2]);
+        const VecD r_in_i = set1(_chi.getRin()), r_out_i = set1(_chi.getRout()), norm_i = set1(_chi.getNorm()), coff_i = set1(_chi.getCoff());
+        const VecD eps_sq = set1(_eps_sq), gc = set1(_G);
+        const VecD zero = set1(0.0), one = set1(1.0);
+        const VecD c4 = set1(4.0), c10 = set1(10.0), c20 = set1(20.0), c35 = set1(35.0);
+
+        VecD ax = zero, ay = zero, az = zero;
+        for (int j=0; j<n_pad_; j+=VEC_WIDTH) {
+            const VecD dx = sub(loadVec(px+j), xi);
+            const VecD dy = sub(loadVec(py+j), yi);
+            const VecD dz = sub(loadVec(pz+j), zi);
+            const VecD r2 = add(add(add(mul(dx,dx), mul(dy,dy)), mul(dz,dz)), eps_sq);
+            const VecD r = sqrt(r2);
+
+            // changeover with larger r_out
+            const VecD r_out_j = loadVec(r_out+j);
+            const VecD rin = selectGT(r_out_i, r_out_j, r_in_i, loadVec(r_in+j));
+            const VecD nm = selectGT(r_out_i, r_out_j, norm_i, loadVec(norm+j));
+            const VecD cf = selectGT(r_out_i, r_out_j, coff_i, loadVec(coff+j));
+
+            // (x-1)^4 (1 + 4x + 10x^2 + 20x^3 + 35 coff x^4)
+            const VecD x = max(min(mul(sub(r, rin), nm), one), zero);
+            const VecD x2 = mul(x,x);
+            const VecD x3 = mul(x2,x);
+            const VecD x4 = mul(x2,x2);
+            const VecD x_1 = sub(x, one);
+            const VecD x_2 = mul(x_1,x_1);
+            const VecD x_4 = mul(x_2,x_2);
+            const VecD k = mul(x_4, add(add(add(add(one, mul(c4,x)), mul(c10,x2)), mul(c20,x3)), mul(mul(c35,cf),x4)));
+
+            const VecD gmor3 = div(mul(mul(gc, loadVec(mass+j)), k), mul(r, r2));
+            ax = add(ax, mul(gmor3, dx));
+            ay = add(ay, mul(gmor3, dy));
+            az = add(az, mul(gmor3, dz));
+        }
+        _acc[0] += reduceAdd(ax);
+        _acc[1] += reduceAdd(ay);
+        _acc[2] += reduceAdd(az);
+#else
+        for (int j=0; j<n_; j++) {
+            Float dr[3] = {px[j] - _xi[0],
+                           py[j] - _xi[1],
+                           pz[j] - _xi[2]};
+            Float r2 = dr[0]*dr[0] + dr[1]*dr[1] + dr[2]*dr[2] + _eps_sq;
+            Float r  = sqrt(r2);
+            Float k  = ChangeOver::calcAcc0WTwo(_chi, *changeover_[j], r);
+            Float r3 = r*r2;
+            Float gmor3 = _G*mass[j]/r3 * k;
+
+            _acc[0] += gmor3 * dr[0];
+            _acc[1] += gmor3 * dr[1];
+            _acc[2] += gmor3 * dr[2];
+        }
+#endif
+    }
+};
 
 //! Perturber class for AR integration
 class ARPerturber: public H4::Neighbor<PtclHard>{
@@ -71,7 +258,32 @@ public:
             soft_pert->shiftCM(pos);
             return r_min_index;
         }
-        else 
+        else
+            return -1;
+    }
+
+    //! find close tidal tensor by using a k-d tree index and if (-) tensor group id is the same as input, initial tidal tensor c.m.
+    /*! Same as the linear scan version, the index should be built once for the tensor array of the cluster.
+        The shifted c.m. position is updated in the index, thus the following queries see the same positions as the linear scan.
+      @param[in,out] _tt: tensor array
+      @param[in,out] _tt_index: k-d tree index of _tt
+      @param[in] _cm: c.m. particle
+      @param[in] _gid: group id (not necessary integer)
+      \return the tidal tensor index, if no match, return -1
+     */
+    PS::S32 findCloseSoftPert(TidalTensor* _tt, TidalTensorIndex& _tt_index, const H4::ParticleH4<PtclHard>& _cm, const PS::F64 _gid) {
+        ASSERT(_gid>0.0);
+        const PS::F64vec& pos = _cm.pos;
+        PS::S32 r_min_index = _tt_index.findClosest(pos);
+        if (r_min_index>=0 && -_tt[r_min_index].group_id==_gid) {
+            soft_pert = &_tt[r_min_index];
+            soft_pert->group_id = _gid;
+            // update c.m.
+            soft_pert->shiftCM(pos);
+            _tt_index.updatePosition(r_min_index, soft_pert->pos);
+            return r_min_index;
+        }
+        else
             return -1;
     }
 
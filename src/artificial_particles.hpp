@@ -242,7 +242,11 @@ public:
 
     //! check paramters
     bool checkParams() {
-        ASSERT(TidalTensor::getParticleN()%2==0);
+        ASSERT(getTidalTensorParticleN()%2==0);
+#ifdef TIDAL_TENSOR_TREE
+        // orbital particles store the member number and the additional data instead of tidal tensor particles
+        ASSERT(getOrbitalParticleN()>=1);
+#endif
         ASSERT(r_tidal_tensor>=0.0);
         ASSERT(id_offset>0);
         ASSERT(gravitational_constant>0);
@@ -251,7 +255,7 @@ public:
     }
 
     //! create artificial particles 
-    /*! First TidalTensor::getParticleN() are tidal tensor particles; others-1 are orbitial sample particles; last is c.m.  
+    /*! First TidalTensor::getParticleN() are tidal tensor particles (none with TIDAL_TENSOR_TREE); others-1 are orbitial sample particles; last is c.m.  
       id: 
       tt/orb: id_offset + abs(member->id)*(n_artificial-1)/2 + index/2;
       cm: - abs(_bin.id)
@@ -296,13 +300,15 @@ public:
 #ifdef ARTIFICIAL_PARTICLE_DEBUG
         assert(r_tidal_tensor<=_bin.changeover.getRin());
 #endif
+#ifndef TIDAL_TENSOR_TREE
         TidalTensor::createTidalTensorMeasureParticles(_ptcl_artificial, *((Tptcl*)&_bin), r_tidal_tensor);
+#endif
 
         // remaining is for orbital sample particles
         orbit_manager.createSampleParticles(&(_ptcl_artificial[getIndexOffsetOrb()]), _bin);
         
         // store the component member number 
-        for (int j=0; j<2; j++) {
+        for (int j=0; j<getIndexOffsetData(); j++) {
             PS::S32 n_members = _bin.isMemberTree(j) ? ((COMM::BinaryTree<Tptcl,COMM::Binary>*)(_bin.getMember(j)))->getMemberN() : 1;
             _ptcl_artificial[j].group_data.artificial.storeData(n_members); 
 #ifdef ARTIFICIAL_PARTICLE_DEBUG
@@ -312,9 +318,9 @@ public:
 
         // store the additional data (should be positive) 
         // ensure the data size is not overflow
-        assert(_n_data+2<n_artificial-1);
+        assert(_n_data+getIndexOffsetData()<=n_artificial-1);
         for (int j=0; j<_n_data; j++) {
-            _ptcl_artificial[j+2].group_data.artificial.storeData(_data_to_store[j]);
+            _ptcl_artificial[j+getIndexOffsetData()].group_data.artificial.storeData(_data_to_store[j]);
 #ifdef ARTIFICIAL_PARTICLE_DEBUG
             assert(_data_to_store[j]>0);
 #endif
@@ -371,10 +377,12 @@ public:
     */
     template <class Tptcl>
     void correctArtficialParticleForce(Tptcl* _ptcl_artificial) {
+#ifndef TIDAL_TENSOR_TREE
         auto* pcm = getCMParticles(_ptcl_artificial);
         // substract c.m. force (acc) from tidal tensor force (acc)
         auto* ptt = getTidalTensorParticles(_ptcl_artificial);
         TidalTensor::subtractCMForce(ptt, *pcm);
+#endif
 
         // not consistent
         // After c.m. force used, it can be replaced by the averaged force on orbital particles
@@ -415,22 +423,39 @@ public:
 
     //! orbital/pseudo particle index offset
     PS::S32 getIndexOffsetOrb() const {
-        return TidalTensor::getParticleN();
+        return getTidalTensorParticleN();
+    }
+
+    //! stored data index offset
+    /*! The left and right member numbers are stored first.
+        Without tidal tensor particles (TIDAL_TENSOR_TREE), only the left one is stored so that the data fit in three pseudo particles,
+        the right one is obtained from the c.m. member number.
+     */
+    PS::S32 getIndexOffsetData() const {
+#ifdef TIDAL_TENSOR_TREE
+        return 1;
+#else
+        return 2;
+#endif
     }
 
     //! CM particle index offset
     PS::S32 getIndexOffsetCM() const {
-        return TidalTensor::getParticleN() + orbit_manager.getParticleN();
+        return getTidalTensorParticleN() + orbit_manager.getParticleN();
     }
 
     //! get artificial particle total number
     PS::S32 getArtificialParticleN() const {
-        return TidalTensor::getParticleN() + orbit_manager.getParticleN() + 1;
+        return getTidalTensorParticleN() + orbit_manager.getParticleN() + 1;
     }
 
-    //! get artificial particle total number
+    //! get tidal tensor particle number, zero if tidal tensors are calculated at c.m. particles by the tree (TIDAL_TENSOR_TREE)
     PS::S32 getTidalTensorParticleN() const {
+#ifdef TIDAL_TENSOR_TREE
+        return 0;
+#else
         return TidalTensor::getParticleN();
+#endif
     }
 
     //! get orbitial particle number 
@@ -459,10 +484,14 @@ public:
     //! get right member number
     template <class Tptcl>
     PS::S32 getRightMemberN(const Tptcl* _ptcl_list) const {
+#ifdef TIDAL_TENSOR_TREE
+        return getMemberN(_ptcl_list) - getLeftMemberN(_ptcl_list);
+#else
 #ifdef ARTIFICIAL_PARTICLE_DEBUG
         assert(_ptcl_list[1].group_data.artificial.isArtificial());
 #endif
         return PS::S32(_ptcl_list[1].group_data.artificial.getData(true));
+#endif
     }
 
     //! get center of mass id
@@ -478,9 +507,9 @@ public:
     template <class Tptcl>
     PS::F64 getStoredData(const Tptcl* _ptcl_list, const PS::S32 _index, const bool _is_positive) const {
 #ifdef ARTIFICIAL_PARTICLE_DEBUG
-        assert(_ptcl_list[_index+2].group_data.artificial.isArtificial());
+        assert(_ptcl_list[_index+getIndexOffsetData()].group_data.artificial.isArtificial());
 #endif
-        return _ptcl_list[_index+2].group_data.artificial.getData(_is_positive);
+        return _ptcl_list[_index+getIndexOffsetData()].group_data.artificial.getData(_is_positive);
     }
 
     //! write class data to file with binary format
@@ -0,0 +1,183 @@
+#pragma once
+#include <iostream>
+#include <cassert>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+//! Background thread to write packed snapshot data
+/*! The main thread packs data into a buffer obtained from getBuffer and pushes a job with the file offset.
+    The background thread writes the data by pwrite, so the integration continues during the writing.
+    The number of pending jobs is bounded. If the disk falls behind, getBuffer waits until one job is finished (back-pressure).
+    The file should be created (and truncated) by the main thread before the job is pushed.
+    The writer thread does not call MPI functions.
+ */
+class AsyncSnapshotWriter{
+private:
+    //! one writing job
+    struct Job{
+        std::string fname;       // filename
+        std::vector<char> header; // header data written at the beginning of the file, empty if no header
+        std::vector<char> data;   // packed particle data
+        off_t offset;            // file offset of data
+    };
+
+    std::deque<Job> queue_;                  // pending jobs
+    std::vector<std::vector<char>> buffer_pool_; // buffers returned from finished jobs for reuse
+    std::mutex mtx_;
+    std::condition_variable cv_job_;   // notify the writer thread of new jobs
+    std::condition_variable cv_done_;  // notify the main thread of finished jobs
+    std::thread thread_;
+    size_t n_pending_;     // number of jobs not yet finished (including the one being written)
+    size_t n_pending_max_; // maximum pending jobs
+    bool finish_flag_;     // stop the writer thread
+    double wait_time_;     // accumulated waiting time of the main thread for back-pressure
+
+    //! write all data with pwrite
+    static void writeAll(const int _fd, const char* _data, size_t _size, off_t _offset, const std::string& _fname) {
+        while (_size>0) {
+            ssize_t n = pwrite(_fd, _data, _size, _offset);
+            if (n<0) {
+                if (errno==EINTR) continue;
+                std::cerr<<"Error: asynchronous writing of "<<_fname<<" fails: "<<std::strerror(errno)<<std::endl;
+                abort();
+            }
+            _data += n;
+            _size -= n;
+            _offset += n;
+        }
+    }
+
+    //! writer thread loop
+    void run() {
+        while (true) {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(mtx_);
+                cv_job_.wait(lock, [this]{ return finish_flag_ || !queue_.empty(); });
+                if (queue_.empty()) break; // finish_flag_ is set and all jobs are done
+                job = std::move(queue_.front());
+                queue_.pop_front();
+            }
+
+            int fd = open(job.fname.c_str(), O_WRONLY);
+            if (fd<0) {
+                std::cerr<<"Error: Cannot open file "<<job.fname<<" for asynchronous writing: "<<std::strerror(errno)<<std::endl;
+                abort();
+            }
+            if (job.header.size()>0) writeAll(fd, job.header.data(), job.header.size(), 0, job.fname);
+            writeAll(fd, job.data.data(), job.data.size(), job.offset, job.fname);
+            close(fd);
+
+            {
+                std::lock_guard<std::mutex> lock(mtx_);
+                buffer_pool_.push_back(std::move(job.data));
+                n_pending_--;
+            }
+            cv_done_.notify_all();
+        }
+    }
+
+public:
+
+    AsyncSnapshotWriter(): queue_(), buffer_pool_(), mtx_(), cv_job_(), cv_done_(), thread_(), n_pending_(0), n_pending_max_(2), finish_flag_(false), wait_time_(0.0) {}
+
+    //! set maximum number of pending jobs, and start the writer thread if not yet
+    /*! @param[in] _n_pending_max: maximum number of pending jobs (2 for double buffering)
+     */
+    void initialize(const size_t _n_pending_max) {
+        assert(_n_pending_max>0);
+        n_pending_max_ = _n_pending_max;
+        if (!thread_.joinable()) {
+            finish_flag_ = false;
+            thread_ = std::thread(&AsyncSnapshotWriter::run, this);
+        }
+    }
+
+    //! get a buffer for packing data
+    /*! Wait if the number of pending jobs reaches the limit, then reuse a buffer of finished jobs if exists
+      @param[in] _size: buffer size in bytes
+     */
+    std::vector<char> getBuffer(const size_t _size) {
+        std::unique_lock<std::mutex> lock(mtx_);
+        if (n_pending_>=n_pending_max_) {
+            auto t0 = std::chrono::steady_clock::now();
+            cv_done_.wait(lock, [this]{ return n_pending_<n_pending_max_; });
+            wait_time_ += std::chrono::duration<double>(std::chrono::steady_clock::now()-t0).count();
+        }
+        std::vector<char> buf;
+        if (!buffer_pool_.empty()) {
+            buf = std::move(buffer_pool_.back());
+            buffer_pool_.pop_back();
+        }
+        buf.resize(_size);
+        return buf;
+    }
+
+    //! push a job
+    /*!
+      @param[in] _fname: filename, the file should exist
+      @param[in] _header: pointer of header data written at the file beginning, NULL if no header
+      @param[in] _header_size: header size in bytes
+      @param[in] _data: packed data buffer from getBuffer (moved)
+      @param[in] _offset: file offset of data
+     */
+    void push(const std::string& _fname, const void* _header, const size_t _header_size, std::vector<char>&& _data, const off_t _offset) {
+        assert(thread_.joinable());
+        Job job;
+        job.fname = _fname;
+        if (_header!=NULL) {
+            job.header.resize(_header_size);
+            std::memcpy(job.header.data(), _header, _header_size);
+        }
+        job.data = std::move(_data);
+        job.offset = _offset;
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            queue_.push_back(std::move(job));
+            n_pending_++;
+        }
+        cv_job_.notify_one();
+    }
+
+    //! wait until all pending jobs are finished
+    void flush() {
+        std::unique_lock<std::mutex> lock(mtx_);
+        cv_done_.wait(lock, [this]{ return n_pending_==0; });
+    }
+
+    //! finish all jobs and stop the writer thread
+    void finalize() {
+        if (thread_.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(mtx_);
+                finish_flag_ = true;
+            }
+            cv_job_.notify_one();
+            thread_.join();
+        }
+        buffer_pool_.clear();
+    }
+
+    //! get accumulated waiting time due to back-pressure
+    double getWaitTime() const {
+        return wait_time_;
+    }
+
+    //! reset accumulated waiting time
+    void clearWaitTime() {
+        wait_time_ = 0.0;
+    }
+
+    ~AsyncSnapshotWriter() {
+        finalize();
+    }
+};
@@ -1,6 +1,7 @@
 #pragma once
 #include <iostream>
 #include <iomanip>
+#include <cstring>
 #include "Common/Float.h"
 
 //! Changeover function class
@@ -95,6 +96,21 @@ public:
         return r_out_;
     }
 
+    //! get 1/(r_out-r_in)
+    const Float &getNorm() const {
+        return norm_;
+    }
+
+    //! get (r_out-r_in)/(r_out+r_in)
+    const Float &getCoff() const {
+        return coff_;
+    }
+
+    //! get (1+coff)/r_out
+    const Float &getPotOff() const {
+        return pot_off_;
+    }
+
     void print(std::ostream & _fout) const{
         _fout<<" r_in="<<r_in_
              <<" r_out="<<r_out_;
@@ -142,6 +158,19 @@ public:
         fwrite(this, sizeof(Float),2,_fp);
     }
 
+    //! write class data to a memory buffer with the same layout as writeBinary
+    /*! @param[in,out] _buf: buffer pointer, shifted to the end of written data after return
+     */
+    void writeBinaryToBuffer(char*& _buf) const {
+        std::memcpy(_buf, this, 2*sizeof(Float));
+        _buf += 2*sizeof(Float);
+    }
+
+    //! get the data size in bytes of writeBinary
+    static size_t getBinarySize() {
+        return 2*sizeof(Float);
+    }
+
     //! read class data to file with binary format
     /*! @param[in] _fp: FILE type file for reading
      */
@@ -281,6 +310,27 @@ public:
         return kdot;
     }
 
+    //! changeover function for force, second derivative to separation
+    /*!
+      @param[in] _dr: particle separation
+      \f$ x = \frac{dr - r_{in}{r_{out} - r_{in}} \f$ \n 
+      \f$ W_2(x) = - (420 x^2 - 1680 x^3 + 2100 x^4 - 840 x^5) \f$ 
+      \return \f$ W_2(x) (dx/dr)^2 \f$
+     */
+    inline Float calcAcc2W(const Float& _dr) const {
+#ifdef CHANGEOVER_DEBUG
+        assert(r_in_>0.0);
+        assert(r_out_>r_in_);
+#endif
+        Float x = (_dr - r_in_)*norm_;
+        Float k2 = 0.0;
+        if(x > 0.0 && x < 1.0) {
+            Float x2 = x*x;
+            k2 = -(((-840.0*x + 2100.0)*x - 1680.0)*x + 420.0)*x2*norm_*norm_;
+        }
+        return k2;
+    }
+
 #else
     // changeover function start from potential
 
@@ -360,6 +410,29 @@ public:
         return kdot;
     }
 
+    //! changeover function for force, second derivative to separation
+    /*!
+      @param[in] _dr: particle separation
+      \f$ R_a = \frac{r_{in}}{r_{out} - r_{in}} \f$ \n 
+      \f$ x = \frac{dr - r_{in}{r_{out} - r_{in}} \f$ \n 
+      \f$ W_2(x) = \frac{280 x^2 (x-1)^2 [3 (R_a + x)(x-1) + x (x-1) + 3 x (R_a + x)]}{2 R_a + 1} \f$ 
+      \return \f$ W_2(x) (dx/dr)^2 \f$
+     */
+    inline Float calcAcc2W(const Float& _dr) const {
+#ifdef CHANGEOVER_DEBUG
+        assert(r_in_>0.0);
+        assert(r_out_>r_in_);
+#endif
+        Float x = (_dr - r_in_)*norm_;
+        Float k2 = 0.0;
+        if(x > 0.0 && x < 1.0) {
+            Float ra_x = r_in_*norm_ + x;
+            Float x_1 = x - 1;
+            k2 = coff_*280.0*x*x*x_1*x_1*(3.0*ra_x*x_1 + x*x_1 + 3.0*x*ra_x)*norm_*norm_;
+        }
+        return k2;
+    }
+
 #endif
 
     //! calculate changeover function Pot by selecting maximum rout
@@ -379,6 +452,12 @@ public:
         if (_ch1.getRout()> _ch2.getRout()) return _ch1.calcAcc1W(_dr, _drdot);
         else return _ch2.calcAcc1W(_dr, _drdot);
     }
+
+    //! calculate changeover function Acc2 by selecting maximum rout
+    static Float calcAcc2WTwo(const ChangeOver& _ch1, const ChangeOver& _ch2, const Float& _dr) {
+        if (_ch1.getRout()> _ch2.getRout()) return _ch1.calcAcc2W(_dr);
+        else return _ch2.calcAcc2W(_dr);
+    }
     
 };
 
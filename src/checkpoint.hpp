@@ -0,0 +1,85 @@
+#pragma once
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+//! header of one checkpoint file
+/*! A checkpoint is the state of PeTar at the end of one tree step (after the hard drift, no interrupted cluster exists).
+    Each MPI rank writes its own file [prefix].chk.r[rank]: the header, FileHeader, Status, KickDriftStep, domain boundaries,
+    the local real particles in the memory layout of FPSoft and the particle lists used by the next step.
+    Thus the checkpoint can only be read by the same executable (checked by the data sizes) with the same number of MPI ranks.
+ */
+class CheckpointHeader{
+public:
+    char magic[8];          ///> file identifier "PETARCHK"
+    PS::S32 version;        ///> format version
+    PS::S32 n_proc;         ///> number of MPI ranks
+    PS::S32 rank;           ///> MPI rank of the file
+    PS::S32 size_ptcl;      ///> sizeof(FPSoft)
+    PS::S32 size_status;    ///> sizeof(Status)
+    PS::S32 size_file_header; ///> sizeof(FileHeader)
+    PS::S64 n_ptcl;         ///> number of local real particles
+    PS::S64 n_mass_modify;  ///> size of mass_modify_list
+    PS::S64 n_remove;       ///> size of remove_list
+    PS::S64 n_remove_id;    ///> size of remove_id_record
+    PS::S64 n_loop;         ///> tree step counter
+    PS::F64 time_kick;      ///> time of kicks (half tree step ahead of the system time in the KDK mode)
+    PS::F64 mean_mass_inv;  ///> inverse of the averaged mass (Ptcl::mean_mass_inv) of the run
+    PS::S32 n_bse_rand;     ///> number of BSE random state data (0 if not used)
+    PS::S32 bse_rand[35];   ///> BSE random state of this rank: idum, idum2, iy, ir[32]
+
+    static const PS::S32 VERSION = 1;
+
+    CheckpointHeader(): version(VERSION), n_proc(0), rank(0), size_ptcl(0), size_status(0), size_file_header(0),
+                        n_ptcl(0), n_mass_modify(0), n_remove(0), n_remove_id(0), n_loop(0), time_kick(0.0), mean_mass_inv(0.0), n_bse_rand(0) {
+        std::memcpy(magic, "PETARCHK", 8);
+        for (int i=0; i<35; i++) bse_rand[i] = 0;
+    }
+
+    //! check whether the file is written by the same executable and MPI ranks
+    /*!
+      @param[in] _n_proc: current number of MPI ranks
+      @param[in] _rank: current MPI rank
+      @param[in] _size_ptcl: sizeof(FPSoft)
+      @param[in] _size_status: sizeof(Status)
+      @param[in] _size_file_header: sizeof(FileHeader)
+      \return true if consistent, else print the error message
+     */
+    bool check(const PS::S32 _n_proc, const PS::S32 _rank, const PS::S32 _size_ptcl, const PS::S32 _size_status, const PS::S32 _size_file_header) const {
+        if (std::memcmp(magic, "PETARCHK", 8)!=0) {
+            std::cerr<<"Error: not a PeTar checkpoint file!\n";
+            return false;
+        }
+        if (version!=VERSION) {
+            std::cerr<<"Error: checkpoint version "<<version<<" is not supported (current: "<<VERSION<<")!\n";
+            return false;
+        }
+        if (n_proc!=_n_proc||rank!=_rank) {
+            std::cerr<<"Error: checkpoint is written by rank "<<rank<<" of "<<n_proc<<" MPI processes, current: "<<_rank<<" of "<<_n_proc<<"!\n";
+            return false;
+        }
+        if (size_ptcl!=_size_ptcl||size_status!=_size_status||size_file_header!=_size_file_header) {
+            std::cerr<<"Error: checkpoint data sizes (particle "<<size_ptcl<<", status "<<size_status<<", file header "<<size_file_header
+                     <<") differ from the current executable ("<<_size_ptcl<<", "<<_size_status<<", "<<_size_file_header<<"), use the same compiling options!\n";
+            return false;
+        }
+        return true;
+    }
+
+    //! write an array in binary format
+    template <class T>
+    static void writeArray(FILE* _fout, const T* _data, const PS::S64 _n) {
+        if (_n>0) fwrite(_data, sizeof(T), _n, _fout);
+    }
+
+    //! read an array in binary format, abort if the data are not enough
+    template <class T>
+    static void readArray(FILE* _fin, T* _data, const PS::S64 _n) {
+        if (_n<=0) return;
+        size_t rcount = fread(_data, sizeof(T), _n, _fin);
+        if ((PS::S64)rcount<_n) {
+            std::cerr<<"Error: Checkpoint reading fails! requiring data number is "<<_n<<", only obtain "<<rcount<<".\n";
+            abort();
+        }
+    }
+};
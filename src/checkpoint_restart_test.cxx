@@ -0,0 +1,127 @@
+#include <map>
+#include "petar.hpp"
+
+//! build argv from strings
+std::vector<char*> getArgv(std::vector<std::string>& _args) {
+    std::vector<char*> argv;
+    for (auto& a: _args) argv.push_back(&a[0]);
+    argv.push_back(NULL);
+    return argv;
+}
+
+//! maximum difference of two values relative to their scale
+PS::F64 getRelativeDiff(const PS::F64 _a, const PS::F64 _b) {
+    return std::abs(_a-_b)/std::max(1.0, std::max(std::abs(_a), std::abs(_b)));
+}
+
+//! compare local real particles and status of a restarted run with the uninterrupted one
+/*! \return the maximum relative difference
+ */
+PS::F64 compareRun(PeTar& _ref, PeTar& _restart) {
+    PS::F64 diff_max = 0.0;
+    if (_ref.stat.time!=_restart.stat.time || _ref.stat.n_real_loc!=_restart.stat.n_real_loc || _ref.stat.n_real_glb!=_restart.stat.n_real_glb) {
+        std::cerr<<"Status differs: time "<<_ref.stat.time<<" "<<_restart.stat.time
+                 <<" n_real_loc "<<_ref.stat.n_real_loc<<" "<<_restart.stat.n_real_loc
+                 <<" n_real_glb "<<_ref.stat.n_real_glb<<" "<<_restart.stat.n_real_glb<<std::endl;
+        return std::numeric_limits<PS::F64>::max();
+    }
+
+    std::map<PS::S64, PS::S64> index_ref;
+    for (PS::S64 i=0; i<_ref.stat.n_real_loc; i++) index_ref[_ref.system_soft[i].id] = i;
+    for (PS::S64 i=0; i<_restart.stat.n_real_loc; i++) {
+        auto& pr = _restart.system_soft[i];
+        auto it = index_ref.find(pr.id);
+        if (it==index_ref.end()) {
+            std::cerr<<"Particle id "<<pr.id<<" is not found in the uninterrupted run"<<std::endl;
+            return std::numeric_limits<PS::F64>::max();
+        }
+        auto& p = _ref.system_soft[it->second];
+        diff_max = std::max(diff_max, getRelativeDiff(p.mass, pr.mass));
+        for (int k=0; k<3; k++) {
+            diff_max = std::max(diff_max, getRelativeDiff(p.pos[k], pr.pos[k]));
+            diff_max = std::max(diff_max, getRelativeDiff(p.vel[k], pr.vel[k]));
+        }
+    }
+
+    auto& e = _ref.stat.energy;
+    auto& er = _restart.stat.energy;
+    diff_max = std::max(diff_max, getRelativeDiff(e.ekin, er.ekin));
+    diff_max = std::max(diff_max, getRelativeDiff(e.epot, er.epot));
+    diff_max = std::max(diff_max, getRelativeDiff(e.etot_ref, er.etot_ref));
+    diff_max = std::max(diff_max, getRelativeDiff(e.Lt, er.Lt));
+#ifdef HARD_CHECK_ENERGY
+    diff_max = std::max(diff_max, getRelativeDiff(e.de_change_cum, er.de_change_cum));
+    diff_max = std::max(diff_max, getRelativeDiff(e.error_hard_cum, er.error_hard_cum));
+#endif
+
+    return PS::Comm::getMaxValue(diff_max);
+}
+
+int main(int argc, char *argv[]) {
+
+    PeTar::initialFDPS(argc,argv);
+
+    const PS::F64 time_break = 0.125;
+    const PS::F64 time_end = 0.25;
+    const std::string fname_snp = "checkpoint_restart_test";
+    const std::string fname_chk = fname_snp + ".chk.r" + std::to_string(PS::Comm::getRank());
+    std::remove(fname_chk.c_str());
+
+    std::vector<std::string> args_base = {"petar.checkpoint.restart.test", "-n", "512", "-t", "0.25", "-s", "0.0078125", "-o", "0.25", "-w", "0", "-f", fname_snp};
+
+    // uninterrupted run, write checkpoints at all possible steps before time_break
+    std::vector<std::string> args_ref = args_base;
+    args_ref.push_back("--checkpoint-walltime");
+    args_ref.push_back("1e-30");
+    args_ref.push_back("__Plummer");
+    auto argv_ref = getArgv(args_ref);
+
+    PeTar* petar_ref = new PeTar;
+    if (petar_ref->readParameters(args_ref.size(), argv_ref.data())<0) return 1;
+    petar_ref->generatePlummer();
+    petar_ref->initialParameters();
+    petar_ref->initialStep();
+    while (petar_ref->integrateToTime(time_break)>0);
+    petar_ref->input_parameters.checkpoint_walltime.value = 0.0;
+    while (petar_ref->integrateToTime(time_end)>0);
+
+    // restart from the last checkpoint before time_break
+    std::vector<std::string> args_restart = args_base;
+    args_restart.push_back("--checkpoint-restart");
+    args_restart.push_back("__Plummer");
+    auto argv_restart = getArgv(args_restart);
+
+    PeTar* petar_restart = new PeTar;
+    if (petar_restart->readParameters(args_restart.size(), argv_restart.data())<0) return 1;
+    petar_restart->readCheckpoint();
+    PS::F64 time_restart = petar_restart->stat.time;
+    petar_restart->initialParameters();
+    petar_restart->initialStep();
+    while (petar_restart->integrateToTime(time_break)>0);
+    while (petar_restart->integrateToTime(time_end)>0);
+
+    PS::F64 diff_max = compareRun(*petar_ref, *petar_restart);
+
+    int ret = 0;
+    if (PS::Comm::getRank()==0) {
+        std::cout<<std::setprecision(WRITE_PRECISION)
+                 <<"Checkpoint restart test: restart time "<<time_restart<<" end time "<<petar_restart->stat.time
+                 <<" maximum relative difference of particles and energies "<<diff_max<<std::endl;
+    }
+    if (time_restart<=0.0 || time_restart>time_break) {
+        std::cerr<<"Error: no checkpoint is written before time "<<time_break<<std::endl;
+        ret = 1;
+    }
+    if (diff_max>1e-10) {
+        std::cerr<<"Error: the restarted run differs from the uninterrupted one!"<<std::endl;
+        ret = 1;
+    }
+
+    std::remove(fname_chk.c_str());
+    delete petar_ref;
+    delete petar_restart;
+
+    PeTar::finalizeFDPS();
+
+    return ret;
+}
@@ -0,0 +1,103 @@
+#include <iostream>
+#include <cstdio>
+#include <cassert>
+#include <vector>
+#include <array>
+#include <particle_simulator.hpp>
+#include "kickdriftstep.hpp"
+#include "checkpoint.hpp"
+
+//! record the kick and drift steps of the continue mode of KDK, with an ending step every _n_end steps
+void recordSteps(KickDriftStep& _dt_manager, std::vector<PS::F64>& _steps, const int _n_step, const int _n_end) {
+    for (int i=0; i<_n_step; i++) {
+        PS::F64 dt_kick;
+        if (_dt_manager.isNextStart()) dt_kick = _dt_manager.getDtStartContinue();
+        else {
+            _dt_manager.nextContinue();
+            if (_dt_manager.isNextEndPossible()&&i%_n_end==0) {
+                dt_kick = _dt_manager.getDtEndContinue();
+                _steps.push_back(dt_kick);
+                dt_kick = _dt_manager.getDtStartContinue();
+            }
+            else dt_kick = _dt_manager.getDtKickContinue();
+        }
+        _steps.push_back(dt_kick);
+        _steps.push_back(_dt_manager.getDtDriftContinue());
+    }
+}
+
+int main(int argc, char** argv) {
+    const char* fname = "checkpoint.test.dat";
+    const PS::F64 ds = 1.0/64.0;
+    const int n_step = 37;
+    const int n_end = 8;
+
+    // checkpoint in the middle of the sequence
+    KickDriftStep dt_first;
+    dt_first.setKDKMode();
+    dt_first.setStep(ds);
+    std::vector<PS::F64> steps;
+    recordSteps(dt_first, steps, n_step, n_end);
+
+    CheckpointHeader header;
+    header.n_proc = 1;
+    header.rank = 0;
+    header.size_ptcl = 96;
+    header.size_status = 256;
+    header.size_file_header = 24;
+    header.n_ptcl = 3;
+    header.n_loop = n_step;
+    header.time_kick = n_step*ds + 0.5*ds;
+    header.mean_mass_inv = 1.0/3.0;
+    PS::F64 data[3] = {1.0, 2.0, 3.0};
+
+    FILE* fout = fopen(fname, "w");
+    assert(fout!=NULL);
+    CheckpointHeader::writeArray(fout, &header, 1);
+    dt_first.writeBinary(fout);
+    CheckpointHeader::writeArray(fout, data, header.n_ptcl);
+    fclose(fout);
+
+    // restart
+    FILE* fin = fopen(fname, "r");
+    assert(fin!=NULL);
+    CheckpointHeader header_read;
+    CheckpointHeader::readArray(fin, &header_read, 1);
+    KickDriftStep dt_restart;
+    dt_restart.readBinary(fin);
+    PS::F64 data_read[3];
+    CheckpointHeader::readArray(fin, data_read, header_read.n_ptcl);
+    fclose(fin);
+    std::remove(fname);
+
+    assert(header_read.check(1, 0, 96, 256, 24));
+    assert(!header_read.check(2, 0, 96, 256, 24));
+    assert(!header_read.check(1, 0, 104, 256, 24));
+    assert(header_read.n_loop==header.n_loop);
+    assert(header_read.time_kick==header.time_kick);
+    assert(header_read.mean_mass_inv==header.mean_mass_inv);
+    for (int i=0; i<3; i++) assert(data_read[i]==data[i]);
+
+    recordSteps(dt_restart, steps, n_step, n_end);
+
+    // the restarted sequence should be identical to the one continued from an in-memory copy
+    std::vector<PS::F64> steps_cmp;
+    KickDriftStep dt_cmp;
+    dt_cmp.setKDKMode();
+    dt_cmp.setStep(ds);
+    recordSteps(dt_cmp, steps_cmp, n_step, n_end);
+    KickDriftStep dt_cmp2 = dt_cmp;
+    recordSteps(dt_cmp2, steps_cmp, n_step, n_end);
+
+    assert(steps.size()==steps_cmp.size());
+    for (size_t i=0; i<steps.size(); i++) {
+        if (steps[i]!=steps_cmp[i]) {
+            std::cerr<<"Step "<<i<<" differs: restart "<<steps[i]<<" continuous "<<steps_cmp[i]<<std::endl;
+            return 1;
+        }
+    }
+
+    std::cout<<"Checkpoint test: "<<steps.size()<<" kick/drift steps after restart match the continuous sequence"<<std::endl;
+
+    return 0;
+}
@@ -4,6 +4,7 @@
 #include<map>
 #include"ptcl.hpp"
 #include"Common/binary_tree.h"
+#include"cluster_union_find.hpp"
 
 //extern const PS::F64 SAFTY_OFFSET_FOR_SEARCH;
 
@@ -185,6 +186,7 @@ private:
     std::unordered_map<PS::S32, PS::S32> id_to_adr_pcluster_;
     // 1st: adr of self 2nd: adr of ngb
     PS::ReallocatableArray< std::pair<PS::S32, PS::S32> > adr_ngb_multi_cluster_;
+    ClusterUnionFind cluster_union_find_; // local cluster labels of ptcl_cluster_[0]
     PS::ReallocatableArray<PS::S32> * adr_sys_one_cluster_;
     PS::ReallocatableArray<PtclCluster> * ptcl_cluster_;
     PS::ReallocatableArray<PS::S32> id_cluster_send_;
@@ -230,29 +232,6 @@ private:
         }
     }
 
-    void searchClusterImpl(PtclCluster * target,
-                           PtclCluster * p_first,
-                           PtclCluster *& p_top,
-                           PS::S32 & n_ptcl_in_cluster,
-                           PS::ReallocatableArray< std::pair<PS::S32, PS::S32> > & adr_ngb_array,
-                           bool & fg_isolated){
-        if(target->adr_sys_ < 0) fg_isolated = false;
-        target->flag_searched_ = true;
-        target->next_ = NULL;
-        n_ptcl_in_cluster++;
-        PS::S32 target_adr = target->adr_ngb_head_;
-        const PS::S32 n_ngb = target->n_ngb_;
-        for(PS::S32 i=0; i<n_ngb; i++){
-            PS::S32 adr_ngb = adr_ngb_array[target_adr+i].second;
-            if( (p_first+adr_ngb)->flag_searched_ == false){
-                p_top->next_ = p_first+adr_ngb;
-                p_top = p_first+adr_ngb;
-                searchClusterImpl(p_first+adr_ngb, p_first, p_top, n_ptcl_in_cluster,
-                                  adr_ngb_array, fg_isolated);
-            }
-        }
-    }
-
     void setNgbAdrHead(PS::ReallocatableArray< std::pair<PS::S32, PS::S32> > id_ngb_multi_cluster[]){
         const PS::S32 size_ngb = id_ngb_multi_cluster[0].size();
         PS::S32 n_cnt = 0;
@@ -330,6 +309,50 @@ private:
     };
 
 public:
+    //! find the receiving rank of clusters shared by multiple ranks
+    /*! Entries with the same id_ belong to the same cluster held by different ranks (rank_). 
+        The rank having the largest n_ptcl_stored_ receives all particles of the cluster; if equal, the smaller rank is chosen.
+        The entries are sorted by id_ and rank_ via an index array, thus the cost is O(n log(n)) instead of comparing all pairs.
+      @param[out] _rank_recv: receiving rank of each entry (size of _n)
+      @param[in] _cluster: cluster entries
+      @param[in] _n: number of entries
+      @param[in,out] _index: buffer for sorting
+     */
+    static void findClusterReceiveRank(PS::S32* _rank_recv,
+                                       const Cluster* _cluster,
+                                       const PS::S32 _n,
+                                       PS::ReallocatableArray<PS::S32> & _index) {
+        _index.resizeNoInitialize(_n);
+        for (PS::S32 i=0; i<_n; i++) _index[i] = i;
+        std::sort(_index.getPointer(), _index.getPointer(_n), 
+                  [&](const PS::S32 a, const PS::S32 b) {
+                      return (_cluster[a].id_ < _cluster[b].id_) || (_cluster[a].id_ == _cluster[b].id_ && _cluster[a].rank_ < _cluster[b].rank_);
+                  });
+        PS::S32 k=0;
+        while (k<_n) {
+            const PS::S32 id_cluster = _cluster[_index[k]].id_;
+            PS::S32 rank_max = _cluster[_index[k]].rank_;
+            PS::S32 n_ptcl_max = _cluster[_index[k]].n_ptcl_stored_;
+            PS::S32 k_end = k+1;
+            // entries are sorted by rank, only larger number changes the receiving rank
+            while (k_end<_n && _cluster[_index[k_end]].id_==id_cluster) {
+                const Cluster& ck = _cluster[_index[k_end]];
+                if (ck.n_ptcl_stored_ > n_ptcl_max) {
+                    rank_max = ck.rank_;
+                    n_ptcl_max = ck.n_ptcl_stored_;
+                }
+                k_end++;
+            }
+            for (PS::S32 j=k; j<k_end; j++) _rank_recv[_index[j]] = rank_max;
+            k = k_end;
+        }
+    }
+
+    //! get the home rank of one cluster id for the cluster matching
+    static PS::S32 getClusterHomeRank(const PS::S32 _id_cluster, const PS::S32 _n_proc) {
+        return ((_id_cluster % _n_proc) + _n_proc) % _n_proc;
+    }
+
     void initialize(){
         const PS::S32 n_thread = PS::Comm::getNumberOfThread();
         adr_sys_one_cluster_  = new PS::ReallocatableArray<PS::S32>[n_thread];
@@ -432,6 +455,10 @@ public:
         const PS::S32 n_thread = PS::Comm::getNumberOfThread();
         if(ptcl_outer==NULL) ptcl_outer = new PS::ReallocatableArray<PtclOuter>[n_thread];
         if(id_ngb_multi_cluster==NULL) id_ngb_multi_cluster = new PS::ReallocatableArray< std::pair<PS::S32, PS::S32> >[n_thread];
+#ifdef SAVE_NEIGHBOR_LIST_IN_FORCE_KERNEL
+        static PS::ReallocatableArray<Tepj> * nb_pack = NULL;
+        if(nb_pack==NULL) nb_pack = new PS::ReallocatableArray<Tepj>[n_thread];
+#endif
         const PS::S32 my_rank = PS::Comm::getRank();
         //        const PS::S32 n_proc_tot = PS::Comm::getNumberOfProc();
         const PS::S32 n_loc = sys.getNumberOfParticleLocal();
@@ -486,6 +513,20 @@ public:
                         sys[i].n_ngb--;
                     }
                     else sys[i].n_ngb = tree.getNeighborListOneParticle(sys[i], nbl) - 1;
+#elif defined(SAVE_NEIGHBOR_LIST_IN_FORCE_KERNEL)
+                    // use neighbor id list saved by the search kernel instead of walking the tree again
+                    PS::S32 n_ngb_force_i = sys[i].n_ngb;
+                    const PS::S64* id_ngb_list = NeighborListCSR::getIdList(sys[i].ngb_list_thread, sys[i].ngb_list_offset);
+                    nb_pack[ith].resizeNoInitialize(n_ngb_force_i);
+                    for (PS::S32 k=0; k<n_ngb_force_i; k++) {
+                        Tepj* epj_k = tree.getEpjFromId(id_ngb_list[k]);
+#ifdef CLUSTER_DEBUG
+                        assert(epj_k!=NULL);
+#endif
+                        nb_pack[ith][k] = *epj_k;
+                    }
+                    nbl = nb_pack[ith].getPointer();
+                    sys[i].n_ngb--;
 #else
 #ifdef CLUSTER_DEBUG
                     PS::S32 n_ngb_force_i = sys[i].n_ngb;
@@ -590,9 +631,15 @@ public:
 #endif        
         adr_ngb_multi_cluster_.resizeNoInitialize(id_ngb_multi_cluster[0].size());
         for(PS::S32 i=0; i<id_ngb_multi_cluster[0].size(); i++){
-            const PS::S32 adr_self = id_to_adr_pcluster_[id_ngb_multi_cluster[0][i].first];
-            const PS::S32 adr_ngb  = id_to_adr_pcluster_[id_ngb_multi_cluster[0][i].second];
-            adr_ngb_multi_cluster_[i] = std::pair<PS::S32, PS::S32>(adr_self, adr_ngb);
+            // both particles of a neighbor pair should be in ptcl_cluster_, operator[] would insert a wrong address 0
+            auto it_self = id_to_adr_pcluster_.find(id_ngb_multi_cluster[0][i].first);
+            auto it_ngb  = id_to_adr_pcluster_.find(id_ngb_multi_cluster[0][i].second);
+            if (it_self==id_to_adr_pcluster_.end() || it_ngb==id_to_adr_pcluster_.end()) {
+                std::cerr<<"Error: neighbor pair ("<<id_ngb_multi_cluster[0][i].first<<", "<<id_ngb_multi_cluster[0][i].second
+                         <<") is not found in the cluster particle list, the neighbor numbers are inconsistent!"<<std::endl;
+                abort();
+            }
+            adr_ngb_multi_cluster_[i] = std::pair<PS::S32, PS::S32>(it_self->second, it_ngb->second);
         }
     }
 
@@ -610,55 +657,58 @@ public:
     }
 
 
+    //! label local clusters by parallel union-find over neighbor pairs
+    /*! Isolated clusters (all members are local) are stored in adr_sys_multi_cluster_isolated_ in the order of their first members in ptcl_cluster_[0].
+        Members of one cluster are in the increasing order of addresses,
+        or in the order of thread scheduling if CLUSTER_MEMBER_UNSORTED is defined.
+        Members of clusters connected to other ranks are stored in mediator_sorted_id_cluster_.
+     */
     void searchClusterLocal(){
         const PS::S32 my_rank = PS::Comm::getRank();
         const PS::S32 n_loc = ptcl_cluster_[0].size();
+        const PtclCluster* ptcl_cluster = ptcl_cluster_[0].getPointer();
 
-        adr_sys_multi_cluster_isolated_.clearSize();
-        for(PS::S32 i=0; i<mediator_sorted_id_cluster_.size(); i++){
-            mediator_sorted_id_cluster_[i].clear();
-        }
-        mediator_sorted_id_cluster_.clearSize();
-        static PS::ReallocatableArray<Cluster> cluster_isolated;
-        for(PS::S32 i=0; i<cluster_isolated.size(); i++) cluster_isolated[i].clear();
-        cluster_isolated.clearSize();
-        n_ptcl_in_multi_cluster_isolated_.clearSize();
-        n_ptcl_in_multi_cluster_isolated_offset_.clearSize();
-        n_ptcl_in_multi_cluster_isolated_offset_.push_back(0);
-
-        for(PS::S32 i=0; i<n_loc; i++){
-            bool flag_isolated = true;
-            if(ptcl_cluster_[0][i].flag_searched_ == false){
-                PS::S32 n_ptcl_in_cluster = 0;
-                PtclCluster * p_top = ptcl_cluster_[0].getPointer(i);
-                searchClusterImpl(ptcl_cluster_[0].getPointer(i), ptcl_cluster_[0].getPointer(),
-                                  p_top, n_ptcl_in_cluster,
-                                  adr_ngb_multi_cluster_, flag_isolated);
-                if(flag_isolated){
-                    PtclCluster * p_tmp = ptcl_cluster_[0].getPointer(i);
-                    PS::S32 id_cluster = p_tmp->id_;
-                    PS::S32 adr_sys_multi_cluster_isolated_head = adr_sys_multi_cluster_isolated_.size();
-                    while(p_tmp != NULL){
-                        if(p_tmp->id_ < id_cluster) id_cluster = p_tmp->id_;
-                        adr_sys_multi_cluster_isolated_.push_back(p_tmp->adr_sys_);
-                        p_tmp = p_tmp->next_;
-                    }
-                    cluster_isolated.push_back( Cluster(id_cluster, n_ptcl_in_cluster, n_ptcl_in_cluster, adr_sys_multi_cluster_isolated_head, my_rank) );
-                    n_ptcl_in_multi_cluster_isolated_.push_back(n_ptcl_in_cluster);
-                    n_ptcl_in_multi_cluster_isolated_offset_.push_back(n_ptcl_in_cluster+n_ptcl_in_multi_cluster_isolated_offset_.back());
-                }
-                else{
-                    PtclCluster * p_tmp = ptcl_cluster_[0].getPointer(i);
-                    PS::S32 id_cluster = p_tmp->id_;
-                    while(p_tmp != NULL){
-                        if(p_tmp->id_ < id_cluster) id_cluster = p_tmp->id_;
-                        PS::S32 adr_pcluster = p_tmp-ptcl_cluster_[0].getPointer();
-                        mediator_sorted_id_cluster_.push_back(Mediator(p_tmp->id_, p_tmp->adr_sys_, adr_pcluster, -1, PS::Comm::getRank()) ); // temporarily send_rank_ is my_rank
-                        p_tmp = p_tmp->next_;
-                    }
-                }
+#ifdef CLUSTER_MEMBER_UNSORTED
+        const bool sort_member_flag = false;
+#else
+        const bool sort_member_flag = true;
+#endif
+        cluster_union_find_.calc(n_loc, adr_ngb_multi_cluster_.getPointer(), adr_ngb_multi_cluster_.size(),
+                                 [&](const PS::S32 i)->bool{ return ptcl_cluster[i].adr_sys_ < 0; },
+                                 sort_member_flag);
+
+        const PS::S32 n_cluster = cluster_union_find_.getNumberOfClusterIsolated();
+        const PS::S32 n_isolated = cluster_union_find_.adr_isolated.size();
+        const PS::S32 n_mediator = cluster_union_find_.adr_open.size();
+        n_ptcl_in_multi_cluster_isolated_.resizeNoInitialize(n_cluster);
+        n_ptcl_in_multi_cluster_isolated_offset_.resizeNoInitialize(n_cluster+1);
+        adr_sys_multi_cluster_isolated_.resizeNoInitialize(n_isolated);
+        mediator_sorted_id_cluster_.resizeNoInitialize(n_mediator);
+        const PS::S32* offset = cluster_union_find_.n_isolated_offset.getPointer();
+        const PS::S32* adr_isolated = cluster_union_find_.adr_isolated.getPointer();
+        const PS::S32* adr_open = cluster_union_find_.adr_open.getPointer();
+        PS::S32* n_ptcl_in_cluster = n_ptcl_in_multi_cluster_isolated_.getPointer();
+        PS::S32* n_ptcl_in_cluster_offset = n_ptcl_in_multi_cluster_isolated_offset_.getPointer();
+        PS::S32* adr_sys_isolated = adr_sys_multi_cluster_isolated_.getPointer();
+        Mediator* mediator = mediator_sorted_id_cluster_.getPointer();
+#pragma omp parallel
+        {
+#pragma omp for nowait
+            for(PS::S32 i=0; i<n_cluster; i++){
+                n_ptcl_in_cluster[i] = offset[i+1] - offset[i];
+                n_ptcl_in_cluster_offset[i] = offset[i];
+            }
+#pragma omp for nowait
+            for(PS::S32 i=0; i<n_isolated; i++){
+                adr_sys_isolated[i] = ptcl_cluster[adr_isolated[i]].adr_sys_;
+            }
+#pragma omp for nowait
+            for(PS::S32 i=0; i<n_mediator; i++){
+                const PS::S32 adr_pcluster = adr_open[i];
+                mediator[i] = Mediator(ptcl_cluster[adr_pcluster].id_, ptcl_cluster[adr_pcluster].adr_sys_, adr_pcluster, -1, my_rank); // temporarily send_rank_ is my_rank
             }
         }
+        n_ptcl_in_multi_cluster_isolated_offset_[n_cluster] = n_isolated;
     }
 
     template<class Tsys>
@@ -674,9 +724,29 @@ public:
         std::cerr<<"PASS: checkMediator (2nd)"<<std::endl;
     }
 
+    //! set id_cluster_ to the minimum id of the local cluster
+    /*! Use the labels from searchClusterLocal. The minimum id of each cluster is reduced to its root first
+     */
     void setIdClusterLocal(){
-        for(PS::S32 i=0; i<ptcl_cluster_[0].size(); i++){
-            ptcl_cluster_[0][i].setIdClusterImpl(ptcl_cluster_[0], adr_ngb_multi_cluster_);
+        const PS::S32 n_loc = ptcl_cluster_[0].size();
+        const PS::S32* root = cluster_union_find_.root.getPointer();
+        PtclCluster* ptcl_cluster = ptcl_cluster_[0].getPointer();
+#pragma omp parallel
+        {
+            // id_cluster_ of roots are used for the reduction, initially equal to id_
+#pragma omp for
+            for(PS::S32 i=0; i<n_loc; i++){
+                PS::S32* id_root = &ptcl_cluster[root[i]].id_cluster_;
+                const PS::S32 id_i = ptcl_cluster[i].id_;
+                PS::S32 id_old = __atomic_load_n(id_root, __ATOMIC_RELAXED);
+                while (id_i < id_old) {
+                    if (__atomic_compare_exchange_n(id_root, &id_old, id_i, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) break;
+                }
+            }
+#pragma omp for
+            for(PS::S32 i=0; i<n_loc; i++){
+                if (root[i]!=i) ptcl_cluster[i].id_cluster_ = ptcl_cluster[root[i]].id_cluster_;
+            }
         }
     }
 
@@ -930,6 +1000,58 @@ public:
         std::sort(mediator_sorted_id_cluster_.getPointer(0), mediator_sorted_id_cluster_.getPointer(mediator_sorted_id_cluster_.size()), OPLessIDCluster());
     }
 
+    //! point-to-point exchange with known counts, only ranks with non-zero counts communicate
+    /*! @param[in] _send: send buffer sorted by rank
+        @param[in] _n_send: send number for each rank (size of n_proc)
+        @param[in] _n_send_disp: send offset for each rank (size of n_proc+1)
+        @param[out] _recv: receive buffer, resized to _n_recv_disp[n_proc]
+        @param[in] _n_recv: receive number for each rank (size of n_proc)
+        @param[in] _n_recv_disp: receive offset for each rank (size of n_proc+1)
+        @param[in] _tag: MPI tag
+     */
+    template<class T>
+    void sendRecvSparse(const PS::ReallocatableArray<T> & _send,
+                        const PS::ReallocatableArray<PS::S32> & _n_send,
+                        const PS::ReallocatableArray<PS::S32> & _n_send_disp,
+                        PS::ReallocatableArray<T> & _recv,
+                        const PS::ReallocatableArray<PS::S32> & _n_recv,
+                        const PS::ReallocatableArray<PS::S32> & _n_recv_disp,
+                        const PS::S32 _tag) {
+        const PS::S32 n_proc = PS::Comm::getNumberOfProc();
+        static PS::ReallocatableArray<MPI_Request> req;
+        static PS::ReallocatableArray<MPI_Status> stat;
+        req.resizeNoInitialize(2*n_proc);
+        stat.resizeNoInitialize(2*n_proc);
+        _recv.resizeNoInitialize(_n_recv_disp[n_proc]);
+        PS::S32 n_req = 0;
+        for (PS::S32 i=0; i<n_proc; i++) {
+            if (_n_recv[i]>0) {
+                MPI_Irecv(_recv.getPointer(_n_recv_disp[i]), _n_recv[i], PS::GetDataType<T>(),
+                          i, _tag, MPI_COMM_WORLD, req.getPointer(n_req++));
+            }
+        }
+        for (PS::S32 i=0; i<n_proc; i++) {
+            if (_n_send[i]>0) {
+                MPI_Isend(_send.getPointer(_n_send_disp[i]), _n_send[i], PS::GetDataType<T>(),
+                          i, _tag, MPI_COMM_WORLD, req.getPointer(n_req++));
+            }
+        }
+        MPI_Waitall(n_req, req.getPointer(), stat.getPointer());
+    }
+
+    //! exchange send numbers with all ranks and get receive numbers and offsets
+    void exchangeCount(const PS::ReallocatableArray<PS::S32> & _n_send,
+                       PS::ReallocatableArray<PS::S32> & _n_recv,
+                       PS::ReallocatableArray<PS::S32> & _n_recv_disp) {
+        const PS::S32 n_proc = PS::Comm::getNumberOfProc();
+        _n_recv.resizeNoInitialize(n_proc);
+        _n_recv_disp.resizeNoInitialize(n_proc+1);
+        MPI_Alltoall(_n_send.getPointer(), 1, PS::GetDataType<PS::S32>(),
+                     _n_recv.getPointer(), 1, PS::GetDataType<PS::S32>(), MPI_COMM_WORLD);
+        _n_recv_disp[0] = 0;
+        for (PS::S32 i=0; i<n_proc; i++) _n_recv_disp[i+1] = _n_recv_disp[i] + _n_recv[i];
+    }
+
     template<class Tsys>
     void sendAndRecvCluster(const Tsys & sys){
         PS::S32 my_rank = PS::Comm::getRank();
@@ -950,68 +1072,43 @@ public:
         }
         //std::cerr<<"sendAndRecvCluster 0: "<<my_rank<<std::endl;
 
-        static PS::ReallocatableArray<PS::S32> n_cluster_recv;
-        static PS::ReallocatableArray<PS::S32> n_cluster_recv_disp;
-        n_cluster_recv.resizeNoInitialize(n_proc);
-        n_cluster_recv_disp.resizeNoInitialize(n_proc+1);
-        PS::S32 n_cluster_tot_loc = cluster_loc.size();
-        PS::Comm::allGather(&n_cluster_tot_loc, 1, n_cluster_recv.getPointer());
-        n_cluster_recv_disp[0] = 0;
-        for(PS::S32 i=0; i<n_proc; i++){
-            n_cluster_recv_disp[i+1] = n_cluster_recv[i] + n_cluster_recv_disp[i];
-        }
-
-        static PS::ReallocatableArray<Cluster> cluster_recv;
-        cluster_recv.resizeNoInitialize(n_cluster_recv_disp[n_proc]);
-        if(n_cluster_tot_loc > 0){
-            PS::Comm::allGatherV(cluster_loc.getPointer(), n_cluster_tot_loc,
-                                 cluster_recv.getPointer(),
-                                 n_cluster_recv.getPointer(), n_cluster_recv_disp.getPointer());
+        // exchange cluster info
+        //////////////////////////
+        // Each cluster id has a home rank (getClusterHomeRank). 
+        // All ranks holding one cluster send its info to the home rank, where the receiving rank is determined and sent back.
+        // Thus only the ranks sharing clusters (via home ranks) communicate instead of gathering all clusters on all ranks.
+        const PS::S32 n_cluster_tot_loc = cluster_loc.size();
+        static PS::ReallocatableArray<PS::S32> n_home_send, n_home_send_disp, n_home_recv, n_home_recv_disp;
+        static PS::ReallocatableArray<PS::S32> adr_home_send; // adr in cluster_home_send for each cluster_loc
+        static PS::ReallocatableArray<Cluster> cluster_home_send, cluster_home_recv;
+        n_home_send.resizeNoInitialize(n_proc);
+        n_home_send_disp.resizeNoInitialize(n_proc+1);
+        for(PS::S32 i=0; i<n_proc; i++) n_home_send[i] = 0;
+        for(PS::S32 i=0; i<n_cluster_tot_loc; i++) n_home_send[getClusterHomeRank(cluster_loc[i].id_, n_proc)]++;
+        n_home_send_disp[0] = 0;
+        for(PS::S32 i=0; i<n_proc; i++) {
+            n_home_send_disp[i+1] = n_home_send_disp[i] + n_home_send[i];
+            n_home_send[i] = 0;
         }
-        else{
-            Cluster tmp;
-            PS::Comm::allGatherV(&tmp, n_cluster_tot_loc,
-                                 cluster_recv.getPointer(),
-                                 n_cluster_recv.getPointer(), n_cluster_recv_disp.getPointer());
+        cluster_home_send.resizeNoInitialize(n_cluster_tot_loc);
+        adr_home_send.resizeNoInitialize(n_cluster_tot_loc);
+        for(PS::S32 i=0; i<n_cluster_tot_loc; i++) {
+            const PS::S32 rank_home = getClusterHomeRank(cluster_loc[i].id_, n_proc);
+            const PS::S32 adr = n_home_send_disp[rank_home] + n_home_send[rank_home]++;
+            cluster_home_send[adr] = cluster_loc[i];
+            adr_home_send[i] = adr;
         }
+        exchangeCount(n_home_send, n_home_recv, n_home_recv_disp);
+        sendRecvSparse(cluster_home_send, n_home_send, n_home_send_disp, cluster_home_recv, n_home_recv, n_home_recv_disp, 2031);
 
-        //std::cerr<<"sendAndRecvCluster 1: "<<my_rank<<std::endl;
-
-        // exchange cluster info
-        //////////////////////////
+        // find receiving rank in home rank and send back
+        static PS::ReallocatableArray<PS::S32> rank_recv_home, rank_recv_loc, index_sort;
+        rank_recv_home.resizeNoInitialize(cluster_home_recv.size());
+        findClusterReceiveRank(rank_recv_home.getPointer(), cluster_home_recv.getPointer(), cluster_home_recv.size(), index_sort);
+        sendRecvSparse(rank_recv_home, n_home_recv, n_home_recv_disp, rank_recv_loc, n_home_send, n_home_send_disp, 2032);
 
-        for(PS::S32 i0=0; i0<n_cluster_tot_loc; i0++){
-            const PS::S32 id_cluster = cluster_loc[i0].id_;
-            const PS::S32 n_ptcl_in_cluster = cluster_loc[i0].n_ptcl_stored_;
-            PS::S32 rank_send_tmp = my_rank;
-            PS::S32 n_ptcl_max = n_ptcl_in_cluster;
-            for(PS::S32 i1=0; i1<n_proc; i1++){
-                if(i1 == my_rank) continue;
-                /*
-                  if(my_rank == 0){
-                  std::cout<<"i1="<<i1<<std::endl;
-                  std::cout<<"n_cluster_recv_disp[i1]="<<n_cluster_recv_disp[i1]
-                  <<" n_cluster_recv_disp[i1+1]="<<n_cluster_recv_disp[i1+1]<<std::endl;
-                  }
-                */
-                for(PS::S32 i2=n_cluster_recv_disp[i1]; i2<n_cluster_recv_disp[i1+1]; i2++){
-                    if(id_cluster == cluster_recv[i2].id_){
-                        /*
-                          if(my_rank == 0){
-                          std::cout<<"cluster_recv[i2].id_="<<cluster_recv[i2].id_<<std::endl;
-                          std::cout<<"n_ptcl_in_cluster="<<n_ptcl_in_cluster<<std::endl;
-                          std::cout<<"cluster_recv[i2].n_ptcl_stored_="<<cluster_recv[i2].n_ptcl_stored_<<std::endl;
-                          }
-                        */
-                        if( (n_ptcl_max < cluster_recv[i2].n_ptcl_stored_) ||
-                            (n_ptcl_max == cluster_recv[i2].n_ptcl_stored_ && rank_send_tmp > i1) ){
-                            rank_send_tmp = i1;
-                            n_ptcl_max = cluster_recv[i2].n_ptcl_stored_;
-                        }
-                    }
-                }
-            }
-            cluster_loc[i0].rank_ = rank_send_tmp;
+        for(PS::S32 i=0; i<n_cluster_tot_loc; i++){
+            cluster_loc[i].rank_ = rank_recv_loc[adr_home_send[i]];
         }
         std::sort(cluster_loc.getPointer(), cluster_loc.getPointer(cluster_loc.size()), OPLessRank());
         //std::cerr<<"sendAndRecvCluster 2: "<<my_rank<<std::endl;
@@ -1065,6 +1162,18 @@ public:
         }
 
         //std::cerr<<"sendAndRecvCluster 3: "<<my_rank<<std::endl;
+
+        // remove ranks without sending particles
+        PS::S32 n_rank_send = 0;
+        for(PS::S32 i=0; i<rank_send_ptcl_.size(); i++){
+            if(n_ptcl_send_[i]>0) {
+                rank_send_ptcl_[n_rank_send] = rank_send_ptcl_[i];
+                n_ptcl_send_[n_rank_send] = n_ptcl_send_[i];
+                n_rank_send++;
+            }
+        }
+        rank_send_ptcl_.resizeNoInitialize(n_rank_send);
+        n_ptcl_send_.resizeNoInitialize(n_rank_send);
 	
         //static PS::ReallocatableArray<PS::S32> n_ptcl_disp_send;
         n_ptcl_disp_send_.resizeNoInitialize(rank_send_ptcl_.size()+1);
@@ -1073,6 +1182,24 @@ public:
             n_ptcl_disp_send_[i+1] = n_ptcl_disp_send_[i] + n_ptcl_send_[i];
         }
 
+        // get receiving particle number from the ranks sending particles
+        static PS::ReallocatableArray<PS::S32> n_ptcl_send_rank, n_ptcl_recv_rank, n_ptcl_recv_rank_disp;
+        n_ptcl_send_rank.resizeNoInitialize(n_proc);
+        for(PS::S32 i=0; i<n_proc; i++) n_ptcl_send_rank[i] = 0;
+        for(PS::S32 i=0; i<rank_send_ptcl_.size(); i++) n_ptcl_send_rank[rank_send_ptcl_[i]] = n_ptcl_send_[i];
+        exchangeCount(n_ptcl_send_rank, n_ptcl_recv_rank, n_ptcl_recv_rank_disp);
+        rank_recv_ptcl_.clearSize();
+        n_ptcl_recv_.clearSize();
+        for(PS::S32 i0=0; i0<n_proc; i0++){
+            if(n_ptcl_recv_rank[i0]>0) {
+#ifdef CLUSTER_DEBUG
+                assert(i0!=my_rank);
+#endif
+                rank_recv_ptcl_.push_back(i0);
+                n_ptcl_recv_.push_back(n_ptcl_recv_rank[i0]);
+            }
+        }
+
 #ifndef FDPS_COMM
         static PS::ReallocatableArray<MPI_Request> req_send;
         static PS::ReallocatableArray<MPI_Status> stat_send;
@@ -1092,28 +1219,6 @@ public:
 	
         ////////////
         // make and recv particles
-        rank_recv_ptcl_.clearSize();
-        n_ptcl_recv_.clearSize();
-        for(PS::S32 i0=0; i0<n_proc; i0++){
-            if(i0 == my_rank) continue;
-            bool flag_recv = false;
-            n_ptcl_recv_.push_back(0);
-            rank_recv_ptcl_.push_back(i0);
-            for(PS::S32 i1=n_cluster_recv_disp[i0]; i1<n_cluster_recv_disp[i0+1]; i1++){
-                PS::S32 id_cluster = cluster_recv[i1].id_;
-                for(PS::S32 i2=0; i2<cluster_loc.size(); i2++){
-                    if(id_cluster == cluster_loc[i2].id_ && cluster_loc[i2].rank_ == my_rank){
-                        n_ptcl_recv_.back() += cluster_recv[i1].n_ptcl_stored_;
-                        flag_recv = true;
-                    }
-                }
-            }
-            if(!flag_recv){
-                n_ptcl_recv_.resizeNoInitialize(n_ptcl_recv_.size()-1);
-                rank_recv_ptcl_.resizeNoInitialize(rank_recv_ptcl_.size()-1);
-            }
-        }
-
         //static PS::ReallocatableArray<PS::S32> n_ptcl_disp_recv_;
         n_ptcl_disp_recv_.resizeNoInitialize(n_ptcl_recv_.size()+1);
         n_ptcl_disp_recv_[0] = 0;
@@ -0,0 +1,160 @@
+#include <iostream>
+#include <cstdio>
+#include <iomanip>
+#include <cstdlib>
+#include <cassert>
+#include <vector>
+#include <getopt.h>
+#include <particle_simulator.hpp>
+#include "soft_ptcl.hpp"
+#include "cluster_list.hpp"
+#include "static_variables.hpp"
+
+//! original matching: compare each local cluster with the clusters of all other ranks
+void findClusterReceiveRankAllGather(PS::S32* _rank_recv,
+                                     const std::vector<std::vector<Cluster>>& _cluster_rank,
+                                     const PS::S32 _my_rank) {
+    const PS::S32 n_proc = _cluster_rank.size();
+    const std::vector<Cluster>& cluster_loc = _cluster_rank[_my_rank];
+    for (std::size_t i0=0; i0<cluster_loc.size(); i0++) {
+        const PS::S32 id_cluster = cluster_loc[i0].id_;
+        PS::S32 rank_send_tmp = _my_rank;
+        PS::S32 n_ptcl_max = cluster_loc[i0].n_ptcl_stored_;
+        for (PS::S32 i1=0; i1<n_proc; i1++) {
+            if (i1==_my_rank) continue;
+            for (std::size_t i2=0; i2<_cluster_rank[i1].size(); i2++) {
+                const Cluster& c = _cluster_rank[i1][i2];
+                if (id_cluster == c.id_) {
+                    if ( (n_ptcl_max < c.n_ptcl_stored_) || (n_ptcl_max == c.n_ptcl_stored_ && rank_send_tmp > i1)) {
+                        rank_send_tmp = i1;
+                        n_ptcl_max = c.n_ptcl_stored_;
+                    }
+                }
+            }
+        }
+        _rank_recv[i0] = rank_send_tmp;
+    }
+}
+
+int main(int argc, char **argv){
+    PS::S32 n_cluster_loc = 200; // number of connected clusters per rank
+    PS::S32 n_share_max = 4;     // maximum number of ranks sharing one cluster
+    PS::S32 n_proc_max = 1024;   // maximum number of faked ranks
+    PS::S32 n_sample = 4;        // number of ranks checked with the original matching
+
+    int copt;
+    while ((copt = getopt(argc, argv, "n:s:p:c:h")) != -1)
+        switch (copt) {
+        case 'n':
+            n_cluster_loc = atoi(optarg);
+            break;
+        case 's':
+            n_share_max = atoi(optarg);
+            assert(n_share_max>=2);
+            break;
+        case 'p':
+            n_proc_max = atoi(optarg);
+            break;
+        case 'c':
+            n_sample = atoi(optarg);
+            break;
+        case 'h':
+            std::cout<<"Benchmark of matching connected clusters between MPI ranks (ranks are faked in one process)\n"
+                     <<"Options: \n"
+                     <<"  -n: number of connected clusters per rank ("<<n_cluster_loc<<")\n"
+                     <<"  -s: maximum number of ranks sharing one cluster ("<<n_share_max<<")\n"
+                     <<"  -p: maximum number of ranks, start from 16 and multiply by 4 ("<<n_proc_max<<")\n"
+                     <<"  -c: number of ranks checked by the original all-gather matching ("<<n_sample<<")\n";
+            return 0;
+        default:
+            break;
+        }
+
+    std::cout<<std::setw(10)<<"n_proc"
+             <<std::setw(12)<<"n_entry"
+             <<std::setw(14)<<"t_allgather"
+             <<std::setw(14)<<"t_home_mean"
+             <<std::setw(14)<<"t_home_max"
+             <<std::setw(12)<<"speedup"
+             <<std::endl;
+
+    srand(1234);
+    for (PS::S32 n_proc=16; n_proc<=n_proc_max; n_proc*=4) {
+        // fake cluster lists, one cluster is shared by neighbor ranks
+        std::vector<std::vector<Cluster>> cluster_rank(n_proc);
+        const PS::S32 n_cluster_glb = n_proc*n_cluster_loc*2/(n_share_max+2);
+        for (PS::S32 k=0; k<n_cluster_glb; k++) {
+            const PS::S32 id_cluster = k*7+1;
+            const PS::S32 n_share = std::min(2 + rand()%(n_share_max-1), n_proc);
+            const PS::S32 rank_first = rand()%n_proc;
+            for (PS::S32 j=0; j<n_share; j++) {
+                const PS::S32 rank = (rank_first+j)%n_proc;
+                cluster_rank[rank].push_back(Cluster(id_cluster, 0, rand()%10, 0, rank));
+            }
+        }
+        PS::S64 n_entry = 0;
+        for (PS::S32 i=0; i<n_proc; i++) n_entry += cluster_rank[i].size();
+
+        // original matching on sample ranks
+        const PS::S32 n_check = std::min(n_sample, n_proc);
+        std::vector<std::vector<PS::S32>> rank_recv_ref(n_check);
+        PS::F64 t_allgather = PS::GetWtime();
+        for (PS::S32 i=0; i<n_check; i++) {
+            rank_recv_ref[i].resize(cluster_rank[i].size());
+            findClusterReceiveRankAllGather(rank_recv_ref[i].data(), cluster_rank, i);
+        }
+        t_allgather = (PS::GetWtime() - t_allgather)/n_check;
+
+        // home rank matching: send cluster entries to home ranks
+        std::vector<std::vector<Cluster>> cluster_home(n_proc);
+        std::vector<std::vector<std::pair<PS::S32,PS::S32>>> adr_home(n_proc); // rank, local index
+        for (PS::S32 i=0; i<n_proc; i++) {
+            for (std::size_t j=0; j<cluster_rank[i].size(); j++) {
+                const PS::S32 rank_home = SearchCluster::getClusterHomeRank(cluster_rank[i][j].id_, n_proc);
+                cluster_home[rank_home].push_back(cluster_rank[i][j]);
+                adr_home[rank_home].push_back(std::make_pair(i, (PS::S32)j));
+            }
+        }
+        std::vector<std::vector<PS::S32>> rank_recv(n_proc);
+        for (PS::S32 i=0; i<n_proc; i++) rank_recv[i].resize(cluster_rank[i].size());
+
+        PS::ReallocatableArray<PS::S32> index_sort;
+        PS::ReallocatableArray<PS::S32> rank_recv_home;
+        PS::F64 t_home_sum = 0.0, t_home_max = 0.0;
+        for (PS::S32 h=0; h<n_proc; h++) {
+            const PS::S32 n = cluster_home[h].size();
+            PS::F64 t0 = PS::GetWtime();
+            rank_recv_home.resizeNoInitialize(n);
+            SearchCluster::findClusterReceiveRank(rank_recv_home.getPointer(), cluster_home[h].data(), n, index_sort);
+            PS::F64 dt = PS::GetWtime() - t0;
+            t_home_sum += dt;
+            t_home_max = std::max(t_home_max, dt);
+            for (PS::S32 k=0; k<n; k++)
+                rank_recv[adr_home[h][k].first][adr_home[h][k].second] = rank_recv_home[k];
+        }
+
+        // check consistence
+        for (PS::S32 i=0; i<n_check; i++) {
+            for (std::size_t j=0; j<cluster_rank[i].size(); j++) {
+                if (rank_recv_ref[i][j]!=rank_recv[i][j]) {
+                    std::cerr<<"Error: receiving rank mismatch! rank "<<i<<" cluster id "<<cluster_rank[i][j].id_
+                             <<" all-gather: "<<rank_recv_ref[i][j]<<" home rank: "<<rank_recv[i][j]<<std::endl;
+                    abort();
+                }
+            }
+        }
+
+        PS::F64 t_home_mean = t_home_sum/n_proc;
+        std::cout<<std::setw(10)<<n_proc
+                 <<std::setw(12)<<n_entry
+                 <<std::setw(14)<<t_allgather
+                 <<std::setw(14)<<t_home_mean
+                 <<std::setw(14)<<t_home_max
+                 <<std::setw(12)<<t_allgather/std::max(t_home_max,1e-12)
+                 <<std::endl;
+    }
+
+    std::cout<<"Cluster matching test passed"<<std::endl;
+
+    return 0;
+}
@@ -0,0 +1,209 @@
+#pragma once
+#include <algorithm>
+
+//! OpenMP concurrent union-find labeling of clusters from neighbor pairs
+/*! Elements (e.g. particles in SearchCluster::ptcl_cluster_) are indexed by [0, n) and linked by neighbor pairs.
+    Roots are linked by atomic compare-and-swap from the larger index to the smaller one,
+    and the root finding compresses paths by path halving.
+    Thus the root of a cluster is always its minimum element index, independent of the number of threads and the linking order.
+
+    After labeling, a cluster is open if it contains at least one open element (e.g. a particle from other ranks), otherwise isolated.
+    The clusters are compacted by parallel prefix sums:
+    isolated clusters are ordered by their roots with members stored contiguously,
+    and elements of open clusters are stored in the increasing order.
+    The member order inside one isolated cluster depends on thread scheduling unless the sorting option is used.
+ */
+class ClusterUnionFind{
+public:
+    static const PS::S32 BLOCK_SIZE = 2048; ///> index block size of prefix sums
+
+    PS::ReallocatableArray<PS::S32> root;              ///> root (minimum element index) of the cluster of each element
+    PS::ReallocatableArray<PS::S32> adr_isolated;      ///> element indices of isolated clusters, grouped by cluster
+    PS::ReallocatableArray<PS::S32> n_isolated_offset; ///> offset of each isolated cluster in adr_isolated, size of cluster number + 1
+    PS::ReallocatableArray<PS::S32> adr_open;          ///> element indices of open clusters in the increasing order
+
+private:
+    PS::ReallocatableArray<PS::S32> flag_open_;     // for roots: 1 if the cluster is open
+    PS::ReallocatableArray<PS::S32> n_member_;      // for roots: number of members of the cluster
+    PS::ReallocatableArray<PS::S32> adr_cluster_;   // for roots of isolated clusters: index of the cluster
+    PS::ReallocatableArray<PS::S32> n_filled_;      // for isolated clusters: number of members filled in adr_isolated
+    PS::ReallocatableArray<PS::S32> n_block_sum_;   // prefix sum of blocks
+
+public:
+    //! find root with path halving
+    /*! Can be called concurrently with unite(), the parent of one element only moves to its ancestors
+      @param[in,out] _parent: parent of each element
+      @param[in] _i: element index
+      \return root index
+     */
+    static PS::S32 findRoot(PS::S32* _parent, PS::S32 _i) {
+        PS::S32 p = __atomic_load_n(&_parent[_i], __ATOMIC_RELAXED);
+        while (p!=_i) {
+            const PS::S32 gp = __atomic_load_n(&_parent[p], __ATOMIC_RELAXED);
+            if (gp!=p) {
+                // fail if another thread already updated the parent, which is then also an ancestor
+                PS::S32 p_expect = p;
+                __atomic_compare_exchange_n(&_parent[_i], &p_expect, gp, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+            }
+            _i = gp;
+            p = __atomic_load_n(&_parent[_i], __ATOMIC_RELAXED);
+        }
+        return _i;
+    }
+
+    //! merge the clusters of two elements
+    /*! The root with the larger index is linked to the other one if it is still a root, otherwise retry
+      @param[in,out] _parent: parent of each element
+      @param[in] _i: first element index
+      @param[in] _j: second element index
+     */
+    static void unite(PS::S32* _parent, PS::S32 _i, PS::S32 _j) {
+        while (true) {
+            _i = findRoot(_parent, _i);
+            _j = findRoot(_parent, _j);
+            if (_i==_j) return;
+            if (_i<_j) std::swap(_i, _j);
+            PS::S32 i_expect = _i;
+            if (__atomic_compare_exchange_n(&_parent[_i], &i_expect, _j, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) return;
+        }
+    }
+
+    //! parallel exclusive prefix sum over index range
+    /*! The range is divided into blocks of BLOCK_SIZE, the block sums are scanned serially
+      @param[in] _n: size of index range
+      @param[in] _count: function (const PS::S32 i) returning the count of index i
+      @param[in] _fill: function (const PS::S32 i, const PS::S32 offset) receiving the exclusive prefix sum of index i
+      \return total count
+     */
+    template <class Tcount, class Tfill>
+    PS::S32 scanExclusive(const PS::S32 _n, Tcount _count, Tfill _fill) {
+        const PS::S32 n_block = (_n+BLOCK_SIZE-1)/BLOCK_SIZE;
+        n_block_sum_.resizeNoInitialize(n_block+1);
+        PS::S32* block_sum = n_block_sum_.getPointer();
+#pragma omp parallel
+        {
+#pragma omp for schedule(static)
+            for (PS::S32 k=0; k<n_block; k++) {
+                PS::S32 sum = 0;
+                const PS::S32 i_end = std::min((k+1)*BLOCK_SIZE, _n);
+                for (PS::S32 i=k*BLOCK_SIZE; i<i_end; i++) sum += _count(i);
+                block_sum[k+1] = sum;
+            }
+#pragma omp single
+            {
+                block_sum[0] = 0;
+                for (PS::S32 k=0; k<n_block; k++) block_sum[k+1] += block_sum[k];
+            }
+#pragma omp for schedule(static)
+            for (PS::S32 k=0; k<n_block; k++) {
+                PS::S32 offset = block_sum[k];
+                const PS::S32 i_end = std::min((k+1)*BLOCK_SIZE, _n);
+                for (PS::S32 i=k*BLOCK_SIZE; i<i_end; i++) {
+                    _fill(i, offset);
+                    offset += _count(i);
+                }
+            }
+        }
+        return block_sum[n_block];
+    }
+
+    //! label clusters and compact them into isolated and open lists
+    /*!
+      @param[in] _n: number of elements
+      @param[in] _pair: neighbor pairs of element indices
+      @param[in] _n_pair: number of pairs
+      @param[in] _is_open: function (const PS::S32 i) returning true if element i is open
+      @param[in] _sort_member: if true, sort members of each isolated cluster in the increasing order for a deterministic result
+     */
+    template <class Tfunc>
+    void calc(const PS::S32 _n, const std::pair<PS::S32, PS::S32>* _pair, const PS::S32 _n_pair, Tfunc _is_open, const bool _sort_member) {
+        root.resizeNoInitialize(_n);
+        flag_open_.resizeNoInitialize(_n);
+        n_member_.resizeNoInitialize(_n);
+        adr_cluster_.resizeNoInitialize(_n);
+        PS::S32* parent = root.getPointer();
+        PS::S32* flag_open = flag_open_.getPointer();
+        PS::S32* n_member = n_member_.getPointer();
+
+#pragma omp parallel
+        {
+#pragma omp for schedule(static)
+            for (PS::S32 i=0; i<_n; i++) {
+                parent[i] = i;
+                flag_open[i] = 0;
+                n_member[i] = 0;
+            }
+            // pairs of one element are contiguous, static schedule keeps locality
+#pragma omp for schedule(static)
+            for (PS::S32 k=0; k<_n_pair; k++) unite(parent, _pair[k].first, _pair[k].second);
+            // all links are done, now every element points to its root
+#pragma omp for schedule(static)
+            for (PS::S32 i=0; i<_n; i++) {
+                const PS::S32 ri = findRoot(parent, i);
+                __atomic_store_n(&parent[i], ri, __ATOMIC_RELAXED);
+#pragma omp atomic
+                n_member[ri]++;
+                if (_is_open(i)) {
+#pragma omp atomic write
+                    flag_open[ri] = 1;
+                }
+            }
+        }
+
+        // index of isolated clusters ordered by roots
+        PS::S32* adr_cluster = adr_cluster_.getPointer();
+        const PS::S32 n_cluster = scanExclusive(_n,
+                                                [&](const PS::S32 i)->PS::S32{ return (parent[i]==i && !flag_open[i]) ? 1 : 0; },
+                                                [&](const PS::S32 i, const PS::S32 offset){ adr_cluster[i] = offset; });
+
+        // open elements in the increasing order
+        adr_open.resizeNoInitialize(_n);
+        PS::S32* adr_open_ptr = adr_open.getPointer();
+        const PS::S32 n_open = scanExclusive(_n,
+                                             [&](const PS::S32 i)->PS::S32{ return flag_open[parent[i]]; },
+                                             [&](const PS::S32 i, const PS::S32 offset){ if (flag_open[parent[i]]) adr_open_ptr[offset] = i; });
+        adr_open.resizeNoInitialize(n_open);
+
+        // offsets of isolated clusters, use n_filled_ to save the roots of clusters first
+        n_filled_.resizeNoInitialize(n_cluster);
+        PS::S32* n_filled = n_filled_.getPointer();
+#pragma omp parallel for schedule(static)
+        for (PS::S32 i=0; i<_n; i++) {
+            if (parent[i]==i && !flag_open[i]) n_filled[adr_cluster[i]] = i;
+        }
+        n_isolated_offset.resizeNoInitialize(n_cluster+1);
+        PS::S32* offset_ptr = n_isolated_offset.getPointer();
+        const PS::S32 n_isolated = scanExclusive(n_cluster,
+                                                 [&](const PS::S32 k)->PS::S32{ return n_member[n_filled[k]]; },
+                                                 [&](const PS::S32 k, const PS::S32 offset){ offset_ptr[k] = offset; });
+        offset_ptr[n_cluster] = n_isolated;
+
+        // fill members of isolated clusters
+        adr_isolated.resizeNoInitialize(n_isolated);
+        PS::S32* adr_isolated_ptr = adr_isolated.getPointer();
+#pragma omp parallel
+        {
+#pragma omp for schedule(static)
+            for (PS::S32 k=0; k<n_cluster; k++) n_filled[k] = 0;
+#pragma omp for schedule(static)
+            for (PS::S32 i=0; i<_n; i++) {
+                const PS::S32 ri = parent[i];
+                if (flag_open[ri]) continue;
+                const PS::S32 k = adr_cluster[ri];
+                PS::S32 n_k;
+#pragma omp atomic capture
+                n_k = n_filled[k]++;
+                adr_isolated_ptr[offset_ptr[k] + n_k] = i;
+            }
+            if (_sort_member) {
+#pragma omp for schedule(dynamic, 64)
+                for (PS::S32 k=0; k<n_cluster; k++) std::sort(adr_isolated_ptr+offset_ptr[k], adr_isolated_ptr+offset_ptr[k+1]);
+            }
+        }
+    }
+
+    //! get number of isolated clusters
+    PS::S32 getNumberOfClusterIsolated() const {
+        return n_isolated_offset.size()-1;
+    }
+};
@@ -0,0 +1,198 @@
+#include <iostream>
+#include <cstdio>
+#include <iomanip>
+#include <cstdlib>
+#include <cassert>
+#include <vector>
+#include <algorithm>
+#include <getopt.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include <particle_simulator.hpp>
+#include "cluster_union_find.hpp"
+
+//! uniform random number in [0,1)
+PS::F64 getRandom() {
+    return (PS::F64)rand()/((PS::F64)RAND_MAX+1.0);
+}
+
+//! serial depth-first search as the original SearchCluster::searchClusterLocal
+/*! Clusters are found in the order of their first elements, the members of clusters are sorted here for comparison
+ */
+void searchClusterDFS(std::vector<PS::S32>& _adr_isolated,
+                      std::vector<PS::S32>& _n_isolated_offset,
+                      std::vector<PS::S32>& _adr_open,
+                      std::vector<PS::S32>& _root,
+                      const PS::S32 _n,
+                      const std::vector<std::pair<PS::S32, PS::S32>>& _pair,
+                      const std::vector<PS::S32>& _adr_ngb_head,
+                      const std::vector<PS::S32>& _n_ngb,
+                      const std::vector<bool>& _is_open) {
+    std::vector<bool> flag_searched(_n, false);
+    std::vector<PS::S32> stack;
+    std::vector<PS::S32> member;
+    _adr_isolated.clear();
+    _adr_open.clear();
+    _n_isolated_offset.assign(1, 0);
+    _root.assign(_n, -1);
+    for (PS::S32 i=0; i<_n; i++) {
+        if (flag_searched[i]) continue;
+        bool flag_isolated = true;
+        member.clear();
+        stack.push_back(i);
+        flag_searched[i] = true;
+        while (!stack.empty()) {
+            const PS::S32 j = stack.back();
+            stack.pop_back();
+            member.push_back(j);
+            if (_is_open[j]) flag_isolated = false;
+            for (PS::S32 k=0; k<_n_ngb[j]; k++) {
+                const PS::S32 adr_ngb = _pair[_adr_ngb_head[j]+k].second;
+                if (!flag_searched[adr_ngb]) {
+                    flag_searched[adr_ngb] = true;
+                    stack.push_back(adr_ngb);
+                }
+            }
+        }
+        std::sort(member.begin(), member.end());
+        for (auto j: member) _root[j] = i;
+        if (flag_isolated) {
+            _adr_isolated.insert(_adr_isolated.end(), member.begin(), member.end());
+            _n_isolated_offset.push_back(_adr_isolated.size());
+        }
+        else _adr_open.insert(_adr_open.end(), member.begin(), member.end());
+    }
+    std::sort(_adr_open.begin(), _adr_open.end());
+}
+
+//! compare one array with the reference
+template <class Tarray>
+void checkArray(const Tarray& _array, const std::vector<PS::S32>& _ref, const char* _name, const PS::S32 _n_thread) {
+    if ((std::size_t)_array.size()!=_ref.size()) {
+        std::cerr<<"Error: size of "<<_name<<" differs! n_thread="<<_n_thread<<" union-find: "<<_array.size()<<" reference: "<<_ref.size()<<std::endl;
+        abort();
+    }
+    for (std::size_t i=0; i<_ref.size(); i++) {
+        if (_array[i]!=_ref[i]) {
+            std::cerr<<"Error: "<<_name<<"["<<i<<"] differs! n_thread="<<_n_thread<<" union-find: "<<_array[i]<<" reference: "<<_ref[i]<<std::endl;
+            abort();
+        }
+    }
+}
+
+int main(int argc, char **argv){
+    PS::S32 n_ptcl = 1000000;  // number of elements
+    PS::F64 frac_open = 0.05;  // fraction of open elements, at the end like particles from other ranks
+    PS::F64 n_ngb_mean = 1.5;  // mean number of neighbors per element
+    PS::S32 n_loop = 10;       // number of repeats for timing
+
+    int copt;
+    while ((copt = getopt(argc, argv, "n:o:g:l:h")) != -1)
+        switch (copt) {
+        case 'n':
+            n_ptcl = atoi(optarg);
+            break;
+        case 'o':
+            frac_open = atof(optarg);
+            break;
+        case 'g':
+            n_ngb_mean = atof(optarg);
+            break;
+        case 'l':
+            n_loop = atoi(optarg);
+            break;
+        case 'h':
+            std::cout<<"Check that ClusterUnionFind gives the same clusters as the serial depth-first search for all numbers of OpenMP threads and measure the speedup\n"
+                     <<"Elements are randomly linked to nearby indices, and a few to far indices to form large clusters\n"
+                     <<"Options: \n"
+                     <<"  -n: number of elements ("<<n_ptcl<<")\n"
+                     <<"  -o: fraction of open elements ("<<frac_open<<")\n"
+                     <<"  -g: mean number of neighbors per element ("<<n_ngb_mean<<")\n"
+                     <<"  -l: number of repeats for timing ("<<n_loop<<")\n";
+            return 0;
+        default:
+            break;
+        }
+
+    // random symmetric links, sorted by the first element as SearchCluster::adr_ngb_multi_cluster_
+    srand(1234);
+    std::vector<std::pair<PS::S32, PS::S32>> link;
+    const PS::S64 n_link = (PS::S64)(0.5*n_ngb_mean*n_ptcl);
+    for (PS::S64 k=0; k<n_link; k++) {
+        const PS::S32 i = (PS::S32)(getRandom()*n_ptcl);
+        PS::S32 j;
+        if (getRandom()<0.01) j = (PS::S32)(getRandom()*n_ptcl);
+        else j = i + 1 + (PS::S32)(getRandom()*100);
+        if (j>=n_ptcl || j==i) continue;
+        link.push_back(std::pair<PS::S32, PS::S32>(i, j));
+        link.push_back(std::pair<PS::S32, PS::S32>(j, i));
+    }
+    std::sort(link.begin(), link.end());
+    link.erase(std::unique(link.begin(), link.end()), link.end());
+    std::vector<PS::S32> adr_ngb_head(n_ptcl, 0), n_ngb(n_ptcl, 0);
+    for (std::size_t k=0; k<link.size(); k++) {
+        const PS::S32 i = link[k].first;
+        if (n_ngb[i]==0) adr_ngb_head[i] = k;
+        n_ngb[i]++;
+    }
+    std::vector<bool> is_open(n_ptcl, false);
+    for (PS::S32 i=(PS::S32)((1.0-frac_open)*n_ptcl); i<n_ptcl; i++) is_open[i] = true;
+
+    std::vector<PS::S32> adr_isolated_ref, n_isolated_offset_ref, adr_open_ref, root_ref;
+    PS::F64 t0 = PS::GetWtime();
+    for (PS::S32 k=0; k<n_loop; k++)
+        searchClusterDFS(adr_isolated_ref, n_isolated_offset_ref, adr_open_ref, root_ref, n_ptcl, link, adr_ngb_head, n_ngb, is_open);
+    const PS::F64 time_dfs = (PS::GetWtime() - t0)/n_loop;
+    const PS::S32 n_cluster_ref = n_isolated_offset_ref.size()-1;
+    std::cout<<"Elements: "<<n_ptcl<<"  Pairs: "<<link.size()
+             <<"  Isolated clusters: "<<n_cluster_ref<<"  Isolated members: "<<adr_isolated_ref.size()
+             <<"  Open members: "<<adr_open_ref.size()
+             <<"  Serial DFS time: "<<time_dfs<<std::endl;
+
+#ifdef _OPENMP
+    const PS::S32 n_thread_max = omp_get_max_threads();
+#else
+    const PS::S32 n_thread_max = 1;
+#endif
+    std::cout<<std::setw(10)<<"n_thread"
+             <<std::setw(14)<<"time_sorted"
+             <<std::setw(14)<<"time_unsorted"
+             <<std::setw(14)<<"speedup_DFS"
+             <<std::endl;
+
+    ClusterUnionFind union_find;
+    auto is_open_func = [&](const PS::S32 i)->bool{ return is_open[i]; };
+    for (PS::S32 n_thread=1; n_thread<=n_thread_max; n_thread++) {
+#ifdef _OPENMP
+        omp_set_num_threads(n_thread);
+#endif
+        // unsorted members: same cluster sets, compare after sorting members
+        t0 = PS::GetWtime();
+        for (PS::S32 k=0; k<n_loop; k++) union_find.calc(n_ptcl, link.data(), link.size(), is_open_func, false);
+        const PS::F64 time_unsorted = (PS::GetWtime() - t0)/n_loop;
+        for (PS::S32 k=0; k<union_find.getNumberOfClusterIsolated(); k++)
+            std::sort(union_find.adr_isolated.getPointer(union_find.n_isolated_offset[k]), union_find.adr_isolated.getPointer(union_find.n_isolated_offset[k+1]));
+        checkArray(union_find.n_isolated_offset, n_isolated_offset_ref, "n_isolated_offset (unsorted)", n_thread);
+        checkArray(union_find.adr_isolated, adr_isolated_ref, "adr_isolated (unsorted)", n_thread);
+
+        // sorted members: identical to the reference
+        t0 = PS::GetWtime();
+        for (PS::S32 k=0; k<n_loop; k++) union_find.calc(n_ptcl, link.data(), link.size(), is_open_func, true);
+        const PS::F64 time_sorted = (PS::GetWtime() - t0)/n_loop;
+        checkArray(union_find.root, root_ref, "root", n_thread);
+        checkArray(union_find.n_isolated_offset, n_isolated_offset_ref, "n_isolated_offset", n_thread);
+        checkArray(union_find.adr_isolated, adr_isolated_ref, "adr_isolated", n_thread);
+        checkArray(union_find.adr_open, adr_open_ref, "adr_open", n_thread);
+
+        std::cout<<std::setw(10)<<n_thread
+                 <<std::setw(14)<<time_sorted
+                 <<std::setw(14)<<time_unsorted
+                 <<std::setw(14)<<time_dfs/time_sorted
+                 <<std::endl;
+    }
+
+    std::cout<<"Cluster union-find test passed"<<std::endl;
+
+    return 0;
+}
@@ -151,3 +151,176 @@ inline void DomainDecision(PS::DomainInfo & dinfo,
 	delete [] pos_domain_tmp;
     }
 }
+
+//! Multisection of sample positions into domains with equal numbers of samples
+/*! The samples are sorted along x and divided into n_domain[0] slabs, then each slab is sorted along y and divided into n_domain[1] columns,
+    and each column is divided along z into n_domain[2] domains. The domain index is (ix*n_domain[1]+iy)*n_domain[2]+iz, same as PS::DomainInfo.
+    The number of samples should be no less than the number of domains.
+  @param[out] _pos_domain: domain boundaries, array size of n_domain[0]*n_domain[1]*n_domain[2]
+  @param[in,out] _pos_sample: sample positions, sorted in the function
+  @param[in] _n_sample: number of samples
+  @param[in] _n_domain: number of domains in x, y, z
+  @param[in] _pos_root_domain: boundary of the root domain
+ */
+inline void CalculateDomainMultiSection(PS::F64ort* _pos_domain,
+                                        PS::F64vec* _pos_sample,
+                                        const PS::S32 _n_sample,
+                                        const PS::S32 _n_domain[3],
+                                        const PS::F64ort& _pos_root_domain) {
+    assert(_n_sample>=_n_domain[0]*_n_domain[1]*_n_domain[2]);
+    // sample index range of each domain at the current level
+    const PS::S32 n_domain_tot = _n_domain[0]*_n_domain[1]*_n_domain[2];
+    PS::S32* istart = new PS::S32[n_domain_tot];
+    PS::S32* iend   = new PS::S32[n_domain_tot];
+    PS::S32 n_group = 1; // number of groups at the current level
+    istart[0] = 0;
+    iend[0] = _n_sample-1;
+    for (PS::S32 i=0; i<n_domain_tot; i++) _pos_domain[i] = _pos_root_domain;
+
+    for (PS::S32 cid=0; cid<3; cid++) {
+        const PS::S32 nd = _n_domain[cid];
+        // number of final domains in one sub-group of this level
+        PS::S32 n_sub = 1;
+        for (PS::S32 k=cid+1; k<3; k++) n_sub *= _n_domain[k];
+        // process groups backward so that the new ranges do not overwrite unprocessed ones
+        for (PS::S32 g=n_group-1; g>=0; g--) {
+            const PS::S32 i0 = istart[g];
+            const PS::S32 n_g = iend[g] - i0 + 1;
+            PS::F64vec* pos_g = _pos_sample + i0;
+            std::sort(pos_g, pos_g+n_g, 
+                      [cid](const PS::F64vec & l, const PS::F64vec & r)->bool{return l[cid] < r[cid];});
+            for (PS::S32 k=0; k<nd; k++) {
+                const PS::S32 j0 = ((PS::S64)k     * (PS::S64)n_g) / (PS::S64)nd;
+                const PS::S32 j1 = ((PS::S64)(k+1) * (PS::S64)n_g) / (PS::S64)nd - 1;
+                PS::F64 x0, x1;
+                CalculateBoundaryOfDomain(n_g, pos_g, cid, j0, j1, _pos_root_domain, x0, x1);
+                // apply to all final domains in the new group
+                const PS::S32 g_new = g*nd + k;
+                for (PS::S32 i=g_new*n_sub; i<(g_new+1)*n_sub; i++) {
+                    _pos_domain[i].low_[cid]  = x0;
+                    _pos_domain[i].high_[cid] = x1;
+                }
+                istart[g_new] = i0 + j0;
+                iend[g_new]   = i0 + j1;
+            }
+        }
+        n_group *= nd;
+    }
+
+    delete [] istart;
+    delete [] iend;
+}
+
+//! Sample particles with probability proportional to weights
+/*! Systematic sampling along the cumulative weight, a particle with weight larger than the sampling interval may be sampled several times.
+  @param[out] _pos_sample: sample positions, new samples are appended
+  @param[in] _sys: particle array (pos is used)
+  @param[in] _n: number of particles
+  @param[in] _n_sample: number of samples
+  @param[in] _weight: function (const PS::S64 i) returning the weight of particle i
+ */
+template<class Tsys, class Tweight>
+inline void SampleParticleByWeight(PS::ReallocatableArray<PS::F64vec>& _pos_sample,
+                                   const Tsys& _sys,
+                                   const PS::S64 _n,
+                                   const PS::S32 _n_sample,
+                                   Tweight _weight) {
+    if (_n==0 || _n_sample<=0) return;
+    PS::F64 weight_sum = 0.0;
+    for (PS::S64 i=0; i<_n; i++) weight_sum += _weight(i);
+    if (weight_sum<=0.0) return;
+    const PS::F64 dw = weight_sum/_n_sample;
+    PS::F64 w_next = 0.5*dw; // cumulative weight of the next sample
+    PS::F64 w_cum = 0.0;
+    PS::S32 n_sampled = 0;
+    for (PS::S64 i=0; i<_n && n_sampled<_n_sample; i++) {
+        w_cum += _weight(i);
+        while (w_next<w_cum && n_sampled<_n_sample) {
+            _pos_sample.push_back(_sys[i].pos);
+            w_next += dw;
+            n_sampled++;
+        }
+    }
+    // roundoff
+    for (; n_sampled<_n_sample; n_sampled++) _pos_sample.push_back(_sys[_n-1].pos);
+}
+
+#ifdef DOMAIN_HARD_COST
+//! Domain decomposition with particles sampled by the measured cost
+/*! The weight of a particle is its hard cost (cost_hard) plus the remaining measured cost of the rank (soft force, cluster searching, hard integration not attributed to particles) evenly divided by the local particle number.
+    Each rank samples n_smp_ave*n_proc*(local weight)/(global weight) particles by SampleParticleByWeight, 
+    so that every sample represents the same cost and the multisection with equal sample numbers balances the cost.
+    The new boundaries are smoothed with the old ones by _coef_ema, same as PS::DomainInfo.
+  @param[in,out] _dinfo: domain information
+  @param[in] _sys: particle system with cost_hard
+  @param[in] _cost_rank: measured cost per step of this rank
+  @param[in] _n_smp_ave: average number of samples per rank
+  @param[in] _coef_ema: smoothing coefficient of new boundaries, 1.0: no smoothing
+ */
+template<class Tsys>
+inline void DecomposeDomainByCost(PS::DomainInfo& _dinfo,
+                                  const Tsys& _sys,
+                                  const PS::F64 _cost_rank,
+                                  const PS::S32 _n_smp_ave,
+                                  const PS::F64 _coef_ema) {
+    const PS::S32 n_proc = PS::Comm::getNumberOfProc();
+    const PS::S32 my_rank = PS::Comm::getRank();
+    const PS::S64 n_loc = _sys.getNumberOfParticleLocal();
+
+    PS::F64 cost_hard_sum = 0.0;
+    for (PS::S64 i=0; i<n_loc; i++) cost_hard_sum += _sys[i].cost_hard;
+    const PS::F64 cost_uniform = n_loc>0 ? std::max(0.0, _cost_rank - cost_hard_sum)/n_loc : 0.0;
+    PS::F64 weight_loc = cost_uniform*n_loc + cost_hard_sum;
+    PS::F64 weight_glb = PS::Comm::getSum(weight_loc);
+    // no measured cost: sample by particle number
+    const bool unit_weight_flag = !(weight_glb>0.0);
+    if (unit_weight_flag) {
+        weight_loc = n_loc;
+        weight_glb = PS::Comm::getSum(weight_loc);
+    }
+    const PS::S32 n_smp_loc = PS::S32(_n_smp_ave*n_proc*weight_loc/weight_glb + 0.5);
+
+    PS::ReallocatableArray<PS::F64vec> pos_loc;
+    if (unit_weight_flag) 
+        SampleParticleByWeight(pos_loc, _sys, n_loc, n_smp_loc, [](const PS::S64 i)->PS::F64{ return 1.0; });
+    else 
+        SampleParticleByWeight(pos_loc, _sys, n_loc, n_smp_loc, [&](const PS::S64 i)->PS::F64{ return cost_uniform + _sys[i].cost_hard; });
+
+    // gather samples
+    PS::S32 n_smp_loc_real = pos_loc.size();
+    PS::S32* n_recv = new PS::S32[n_proc];
+    PS::S32* n_recv_disp = new PS::S32[n_proc+1];
+    PS::Comm::allGather(&n_smp_loc_real, 1, n_recv);
+    n_recv_disp[0] = 0;
+    for (PS::S32 i=0; i<n_proc; i++) n_recv_disp[i+1] = n_recv_disp[i] + n_recv[i];
+    const PS::S32 n_smp_glb = n_recv_disp[n_proc];
+
+    const PS::S32 n_domain[3] = {_dinfo.getNDomain(0), _dinfo.getNDomain(1), _dinfo.getNDomain(2)};
+    if (n_smp_glb<n_proc) {
+        // too few samples, keep the current domains
+        delete [] n_recv;
+        delete [] n_recv_disp;
+        return;
+    }
+    PS::F64vec* pos_glb = new PS::F64vec[n_smp_glb];
+    PS::Comm::allGatherV(pos_loc.getPointer(), n_smp_loc_real, pos_glb, n_recv, n_recv_disp);
+
+    PS::F64ort* pos_domain = new PS::F64ort[n_proc];
+    if (my_rank==0) CalculateDomainMultiSection(pos_domain, pos_glb, n_smp_glb, n_domain, _dinfo.getPosRootDomain());
+    PS::Comm::broadcast(pos_domain, n_proc);
+
+    for (PS::S32 i=0; i<n_proc; i++) {
+        if (_coef_ema<1.0) {
+            const PS::F64ort pos_old = _dinfo.getPosDomain(i);
+            pos_domain[i].low_  = _coef_ema*pos_domain[i].low_  + (1.0-_coef_ema)*pos_old.low_;
+            pos_domain[i].high_ = _coef_ema*pos_domain[i].high_ + (1.0-_coef_ema)*pos_old.high_;
+        }
+        _dinfo.setPosDomain(i, pos_domain[i]);
+    }
+
+    delete [] n_recv;
+    delete [] n_recv_disp;
+    delete [] pos_glb;
+    delete [] pos_domain;
+}
+#endif
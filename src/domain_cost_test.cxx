@@ -0,0 +1,199 @@
+#include <iostream>
+#include <cstdio>
+#include <iomanip>
+#include <cstdlib>
+#include <cassert>
+#include <cmath>
+#include <algorithm>
+#include <getopt.h>
+#include <particle_simulator.hpp>
+#include "particle_distribution_generator.hpp"
+#include "domain.hpp"
+
+//! particle with the cost model of the benchmark
+struct PtclDomainTest{
+    PS::F64vec pos;
+    PS::F64 cost;
+};
+
+//! uniform random number in [0,1)
+PS::F64 getRandom() {
+    return (PS::F64)rand()/((PS::F64)RAND_MAX+1.0);
+}
+
+//! divide n_proc into three factors as close as possible, in decreasing order
+void getNumberOfDomain(PS::S32 _n_domain[3], const PS::S32 _n_proc) {
+    PS::S32 n_rest = _n_proc;
+    for (PS::S32 k=0; k<2; k++) {
+        PS::S32 nd = (PS::S32)(std::pow((PS::F64)n_rest, 1.0/(3-k)) + 1e-6);
+        while (n_rest%nd!=0) nd--;
+        _n_domain[k] = nd;
+        n_rest /= nd;
+    }
+    _n_domain[2] = n_rest;
+    std::sort(_n_domain, _n_domain+3, std::greater<PS::S32>());
+}
+
+//! decompose by samples and return the imbalance of cost and particle number (max/mean-1)
+template<class Tweight>
+void calcImbalance(PS::F64& _imb_cost, PS::F64& _imb_n,
+                   const PtclDomainTest* _ptcl, const PS::S64 _n, const PS::S32 _n_proc, const PS::S32 _n_smp_ave, Tweight _weight) {
+    PS::S32 n_domain[3];
+    getNumberOfDomain(n_domain, _n_proc);
+    PS::ReallocatableArray<PS::F64vec> pos_sample;
+    SampleParticleByWeight(pos_sample, _ptcl, _n, _n_smp_ave*_n_proc, _weight);
+    PS::F64ort pos_root(PS::F64vec(-PS::LARGE_FLOAT), PS::F64vec(PS::LARGE_FLOAT));
+    PS::ReallocatableArray<PS::F64ort> pos_domain;
+    pos_domain.resizeNoInitialize(_n_proc);
+    CalculateDomainMultiSection(pos_domain.getPointer(), pos_sample.getPointer(), pos_sample.size(), n_domain, pos_root);
+
+    PS::ReallocatableArray<PS::F64> cost_domain;
+    PS::ReallocatableArray<PS::S64> n_domain_ptcl;
+    cost_domain.resizeNoInitialize(_n_proc);
+    n_domain_ptcl.resizeNoInitialize(_n_proc);
+    for (PS::S32 j=0; j<_n_proc; j++) {
+        cost_domain[j] = 0.0;
+        n_domain_ptcl[j] = 0;
+    }
+    PS::F64 cost_sum = 0.0;
+    for (PS::S64 i=0; i<_n; i++) {
+        PS::S32 n_found = 0;
+        for (PS::S32 j=0; j<_n_proc; j++) {
+            const PS::F64ort& dj = pos_domain[j];
+            if (_ptcl[i].pos.x>=dj.low_.x && _ptcl[i].pos.x<dj.high_.x &&
+                _ptcl[i].pos.y>=dj.low_.y && _ptcl[i].pos.y<dj.high_.y &&
+                _ptcl[i].pos.z>=dj.low_.z && _ptcl[i].pos.z<dj.high_.z) {
+                cost_domain[j] += _ptcl[i].cost;
+                n_domain_ptcl[j]++;
+                n_found++;
+            }
+        }
+        if (n_found!=1) {
+            std::cerr<<"Error: particle "<<i<<" is found in "<<n_found<<" domains! pos: "<<_ptcl[i].pos<<std::endl;
+            abort();
+        }
+        cost_sum += _ptcl[i].cost;
+    }
+    PS::F64 cost_max = 0.0;
+    PS::S64 n_max = 0;
+    for (PS::S32 j=0; j<_n_proc; j++) {
+        cost_max = std::max(cost_max, cost_domain[j]);
+        n_max = std::max(n_max, n_domain_ptcl[j]);
+    }
+    _imb_cost = cost_max/(cost_sum/_n_proc) - 1.0;
+    _imb_n = (PS::F64)n_max/((PS::F64)_n/_n_proc) - 1.0;
+}
+
+int main(int argc, char **argv){
+    PS::S64 n_single = 100000; // number of single stars
+    PS::S64 n_bin = 10000;     // number of primordial binaries
+    PS::S32 n_proc_max = 64;   // maximum number of domains
+    PS::S32 n_smp_ave = 100;   // average number of samples per domain
+    PS::F64 cost_bin = 50.0;   // hard cost of one binary member in the unit of the soft cost of one particle
+    PS::F64 cost_nb = 5.0;     // hard cost of one single star at the center in the unit of the soft cost of one particle
+
+    int copt;
+    while ((copt = getopt(argc, argv, "n:b:p:s:c:e:h")) != -1)
+        switch (copt) {
+        case 'n':
+            n_single = atol(optarg);
+            break;
+        case 'b':
+            n_bin = atol(optarg);
+            break;
+        case 'p':
+            n_proc_max = atoi(optarg);
+            break;
+        case 's':
+            n_smp_ave = atoi(optarg);
+            break;
+        case 'c':
+            cost_bin = atof(optarg);
+            break;
+        case 'e':
+            cost_nb = atof(optarg);
+            break;
+        case 'h':
+            std::cout<<"Benchmark of the cost imbalance of domains in a Plummer model with primordial binaries:\n"
+                     <<"uniform particle sampling (PS::DomainInfo) vs. sampling weighted by the hard cost (DOMAIN_HARD_COST)\n"
+                     <<"Cost model per particle: soft cost 1; hard cost of singles: c_nb*rho(r)/rho(0); hard cost of binary members: c_bin*(1+rho(r)/rho(0))\n"
+                     <<"Options: \n"
+                     <<"  -n: number of single stars ("<<n_single<<")\n"
+                     <<"  -b: number of primordial binaries ("<<n_bin<<")\n"
+                     <<"  -p: maximum number of domains, multiplied by 2 from 8 ("<<n_proc_max<<")\n"
+                     <<"  -s: average number of samples per domain ("<<n_smp_ave<<")\n"
+                     <<"  -c: c_bin, hard cost of one binary member ("<<cost_bin<<")\n"
+                     <<"  -e: c_nb, hard cost of one single star at the center ("<<cost_nb<<")\n";
+            return 0;
+        default:
+            break;
+        }
+
+    // Plummer model of singles and binary c.m., same as PeTar::generatePlummer (Henon units)
+    const PS::S64 n_cm = n_single + n_bin;
+    PS::F64 * mass;
+    PS::F64vec * pos;
+    PS::F64vec * vel;
+    ParticleDistributionGenerator::makePlummerModel(1.0, n_cm, n_cm, mass, pos, vel, -0.25);
+    const PS::F64 r_scale = 3.0*M_PI/16.0;
+
+    // the first n_bin c.m. are binaries (makePlummerModel gives random order), members separated by a = 1e-4 with random orientation
+    srand(1234);
+    const PS::S64 n_ptcl = n_single + 2*n_bin;
+    PS::ReallocatableArray<PtclDomainTest> ptcl;
+    ptcl.resizeNoInitialize(n_ptcl);
+    PS::S64 n = 0;
+    for (PS::S64 i=0; i<n_cm; i++) {
+        const PS::F64 r2 = pos[i]*pos[i]/(r_scale*r_scale);
+        const PS::F64 rho = std::pow(1.0 + r2, -2.5); // density normalized by the central one
+        if (i<n_bin) {
+            const PS::F64 cth = 2.0*getRandom()-1.0;
+            const PS::F64 sth = std::sqrt(1.0-cth*cth);
+            const PS::F64 phi = 2.0*M_PI*getRandom();
+            const PS::F64vec dr = PS::F64vec(sth*std::cos(phi), sth*std::sin(phi), cth)*0.5e-4;
+            ptcl[n].pos = pos[i] + dr;
+            ptcl[n].cost = 1.0 + cost_bin*(1.0 + rho);
+            n++;
+            ptcl[n].pos = pos[i] - dr;
+            ptcl[n].cost = 1.0 + cost_bin*(1.0 + rho);
+            n++;
+        }
+        else {
+            ptcl[n].pos = pos[i];
+            ptcl[n].cost = 1.0 + cost_nb*rho;
+            n++;
+        }
+    }
+    assert(n==n_ptcl);
+    delete [] mass;
+    delete [] pos;
+    delete [] vel;
+
+    // shuffle to mimic the particle order after exchange
+    for (PS::S64 i=n_ptcl-1; i>0; i--) std::swap(ptcl[i], ptcl[(PS::S64)(getRandom()*(i+1))]);
+
+    std::cout<<"Imbalance of domains: max/mean-1\n"
+             <<std::setw(10)<<"n_domain"
+             <<std::setw(16)<<"cost_uniform"
+             <<std::setw(16)<<"cost_weighted"
+             <<std::setw(16)<<"n_uniform"
+             <<std::setw(16)<<"n_weighted"
+             <<std::endl;
+    for (PS::S32 n_proc=8; n_proc<=n_proc_max; n_proc*=2) {
+        PS::F64 imb_cost_uni, imb_n_uni, imb_cost_wgt, imb_n_wgt;
+        calcImbalance(imb_cost_uni, imb_n_uni, ptcl.getPointer(), n_ptcl, n_proc, n_smp_ave,
+                      [](const PS::S64 i)->PS::F64{ return 1.0; });
+        calcImbalance(imb_cost_wgt, imb_n_wgt, ptcl.getPointer(), n_ptcl, n_proc, n_smp_ave,
+                      [&](const PS::S64 i)->PS::F64{ return ptcl[i].cost; });
+        std::cout<<std::setw(10)<<n_proc
+                 <<std::setw(16)<<imb_cost_uni
+                 <<std::setw(16)<<imb_cost_wgt
+                 <<std::setw(16)<<imb_n_uni
+                 <<std::setw(16)<<imb_n_wgt
+                 <<std::endl;
+    }
+
+    std::cout<<"Domain cost test passed"<<std::endl;
+
+    return 0;
+}
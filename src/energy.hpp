@@ -1,4 +1,6 @@
 #pragma once
+#include "reduction_buffer.hpp"
+#include "parallel_sum.hpp"
 
 //! class for collecting and calculating the energy and angular momemtum of the system
 class EnergyAndMomemtum{
@@ -193,7 +195,7 @@ public:
     }
 
     //! calculate the system kinetic and potential energy of particles
-    /*! 
+    /*! The summation is OpenMP parallelized by ParallelSum, the result does not depend on the number of threads
       @param[in] _particles: particle array
       @param[in] _n_particle: number of particles
       @param[in] _init_flag: if true, set etot, etot_sd and L reference
@@ -204,11 +206,9 @@ public:
               const PS::S32 _n_particle, 
               const bool _init_flag=false, const PS::F64vec* _pos_offset=NULL, const PS::F64vec* _vel_offset=NULL) {
         assert(Ptcl::group_data_mode == GroupDataMode::artificial);
-        ekin = epot = 0.0;
-        L = PS::F64vec(0.0);
-//#pragma omp declare reduction(+:PS::F64vec:omp_out += omp_in) initializer (omp_priv=PS::F64vec(0.0))
-//#pragma omp parallel for reduction(+:epot,ekin,L) 
-        for(PS::S32 i=0; i<_n_particle; i++){
+        // sum: ekin, epot, L
+        PS::F64 sum[5];
+        ParallelSum::calc(sum, 5, _n_particle, [&](const PS::S64 i, PS::F64* _sum) {
             PS::F64 mi = _particles[i].mass;
             auto pi_artificial = _particles[i].group_data.artificial;
             if(pi_artificial.isMember()) mi = pi_artificial.getMassBackup();
@@ -224,13 +224,19 @@ public:
             if (_vel_offset!=NULL) vi += *_vel_offset;
 
 #ifdef EXTERNAL_POT_IN_PTCL
-            epot += 0.5 * mi * (_particles[i].pot_tot + _particles[i].pot_ext);
+            _sum[1] += 0.5 * mi * (_particles[i].pot_tot + _particles[i].pot_ext);
 #else
-            epot += 0.5 * mi * _particles[i].pot_tot;
+            _sum[1] += 0.5 * mi * _particles[i].pot_tot;
 #endif
-            ekin += 0.5 * mi * vi * vi;
-            L += pi ^ (mi*vi);
-        }
+            _sum[0] += 0.5 * mi * vi * vi;
+            PS::F64vec Li = pi ^ (mi*vi);
+            _sum[2] += Li.x;
+            _sum[3] += Li.y;
+            _sum[4] += Li.z;
+        });
+        ekin = sum[0];
+        epot = sum[1];
+        L = PS::F64vec(sum[2], sum[3], sum[4]);
         Lt = std::sqrt(L*L);
         if (_init_flag) {
             etot_ref = ekin + epot;
@@ -242,7 +248,7 @@ public:
     }
 
     //! calculate the system kinetic and potential energy of particles
-    /*! Using particle index array to select particles
+    /*! Using particle index array to select particles. The summation is OpenMP parallelized by ParallelSum
       @param[in] _particles: particle array
       @param[in] _particle_index: index array to select particles
       @param[in] _n_particle: number of particles
@@ -253,22 +259,26 @@ public:
               const PS::S32* _particle_index,
               const PS::S32 _n_particle, 
               const bool _init_flag=false) {
-        ekin = epot = 0.0;
-        L = PS::F64vec(0.0);
-//#pragma omp declare reduction(+:PS::F64vec:omp_out += omp_in) initializer (omp_priv=PS::F64vec(0.0))
-//#pragma omp parallel for reduction(+:epot,ekin,L) 
-        for(PS::S32 k=0; k<_n_particle; k++){
+        // sum: ekin, epot, L
+        PS::F64 sum[5];
+        ParallelSum::calc(sum, 5, _n_particle, [&](const PS::S64 k, PS::F64* _sum) {
             PS::S32 i = _particle_index[k];
             PS::F64 mi = _particles[i].mass;
             PS::F64vec vi = _particles[i].vel;
 #ifdef EXTERNAL_POT_IN_PTCL
-            epot += 0.5 * mi * (_particles[i].pot_tot + _particles[i].pot_ext);
+            _sum[1] += 0.5 * mi * (_particles[i].pot_tot + _particles[i].pot_ext);
 #else
-            epot += 0.5 * mi * _particles[i].pot_tot;
+            _sum[1] += 0.5 * mi * _particles[i].pot_tot;
 #endif
-            ekin += 0.5 * mi * vi * vi;
-            L += _particles[i].pos ^ (mi*vi);
-        }
+            _sum[0] += 0.5 * mi * vi * vi;
+            PS::F64vec Li = _particles[i].pos ^ (mi*vi);
+            _sum[2] += Li.x;
+            _sum[3] += Li.y;
+            _sum[4] += Li.z;
+        });
+        ekin = sum[0];
+        epot = sum[1];
+        L = PS::F64vec(sum[2], sum[3], sum[4]);
         Lt   = std::sqrt(L*L);
         if (_init_flag) {
             etot_ref = ekin + epot;
@@ -297,6 +307,38 @@ public:
         }
     }
 
+    //! add local kinetic, potential energy and angular momemtum to a batch of global summations
+    /*! 
+      @param[in,out] _buf: summation buffer
+      \return the index of the first value in _buf
+     */
+    PS::S32 addToSum(ReductionSumBuffer& _buf) const {
+        PS::S32 index = _buf.add(ekin);
+        _buf.add(epot);
+        _buf.add(L);
+        return index;
+    }
+
+    //! get summation of kinetic, potential energy and angular momemtum from a finished batch of global summations
+    /*!
+      @param[in] _buf: summation buffer
+      @param[in] _index: index returned by addToSum
+      @param[in] _init_flag: if true, set etot, etot_sd and L reference
+     */
+    void getSumFromBuffer(const ReductionSumBuffer& _buf, const PS::S32 _index, const bool _init_flag=false) {
+        ekin = _buf.getF64(_index);
+        epot = _buf.getF64(_index+1);
+        L    = _buf.getF64vec(_index+2);
+        Lt  = std::sqrt(L*L);
+        if (_init_flag) {
+            etot_ref = ekin + epot;
+#ifdef HARD_CHECK_ENERGY
+            etot_sd_ref = etot_ref;
+#endif
+            L_ref = L;
+        }
+    }
+
     //! save current energy error
     void saveEnergyError() {
         error_cum_pre = getEnergyError();
@@ -4,6 +4,7 @@
 #include "soft_ptcl.hpp"
 #include "io.hpp"
 #include "status.hpp"
+#include "snapshot_columnar.hpp"
 
 typedef PS::ParticleSystem<FPSoft> SystemSoft;
 
@@ -97,6 +98,7 @@ int main(int argc, char *argv[]){
     bool read_one_file_flag=false; // If true: the input file is not a list but the filename of one snapshot
     bool write_ascii_header_flag=false; // If true: only output ascii header
     bool add_record_cm_flag=false; // If true; substract center to header
+    bool columnar_flag=false; // If true: transfer to the columnar format
     std::string fname_list("data.snap.lst"); // The filename of a file containing the list of snapshot data pathes
 
     static int long_flag=-1;
@@ -112,7 +114,7 @@ int main(int argc, char *argv[]){
     optind = 0; // reset getopt
     bool print_flag = true;
 
-    while ((copt = getopt_long(argc, argv, "brgcfHh", long_options, &option_index)) != -1) 
+    while ((copt = getopt_long(argc, argv, "brgcfCHh", long_options, &option_index)) != -1) 
         switch (copt) {
         case 0:
             switch (long_flag) {
@@ -151,6 +153,11 @@ int main(int argc, char *argv[]){
             if(print_flag) std::cout<<"Read one file instead of a filelist\n";
             opt_used ++;
             break;
+        case 'C':
+            columnar_flag = true;
+            if(print_flag) std::cout<<"Transfer to columnar format\n";
+            opt_used ++;
+            break;
         case 'H':
             write_ascii_header_flag = true;
             if(print_flag) std::cout<<"Write only header data of snapshot in ASCII format\n";
@@ -176,6 +183,7 @@ int main(int argc, char *argv[]){
 #else
                 std::cout<<"External potential column not exists\n";
 #endif
+                std::cout<<"BINARY snapshots written with the option '--write-mpiio 1' of petar have the same layout and are supported\n";
                 std::cout<<"Important: Ensure that the stellar evolution method and external mode used in the snapshots and this tool are consistent.\n"
                          <<"           If the replace option (-r) is used and the methods are not consistent, the data cannot be recovered!"<<std::endl;
                 std::cout<<"Options: "<<std::endl
@@ -187,6 +195,8 @@ int main(int argc, char *argv[]){
                          <<"   -c  Substract particle c.m. position and velocity into header\n"
                          <<"        This is used to transfer data before Dec 18, 2020 (GitHub) to new version when external-mode=galpy\n"
                          <<"   -f  Read one snapshot instead of a list, the filelist should be replaced by the filename of the snapshot\n"
+                         <<"   -C  Transfer snapshot data to the columnar BINARY format (suffix '.C'). The input format is BINARY if '-b' is used, otherwise ASCII\n"
+                         <<"        Columnar snapshots are detected automatically as input and transferred to BINARY (suffix '.B'), or ASCII (suffix '.A') if '-b' is used\n"
                          <<"   -H  Write only header data of snapshots in ascii format with suffix '.H'. This option suppress '-r' so that data are not replaced"<<std::endl
                          <<"   -h(--help)   print help"<<std::endl;
             }
@@ -214,7 +224,34 @@ int main(int argc, char *argv[]){
     FileHeaderNoOffset file_header_no_offset;
     Status status;
 
+    ColumnSnapshotReader column_reader;
+
     auto transferOneFile = [&] (const std::string& filename) {
+        // columnar snapshot to Binary or ASCII
+        if (ColumnSnapshotReader::isColumnarFile(filename.c_str())) {
+            column_reader.open(filename.c_str());
+            column_reader.getFileHeader(file_header);
+            data.setNumberOfParticleLocal(file_header.n_body);
+            column_reader.readParticles(&data[0], 0, file_header.n_body);
+            column_reader.close();
+            if (b_to_a_flag) {
+                if (replace_flag) data.writeParticleAscii(filename.c_str(), file_header);
+                else              data.writeParticleAscii((filename+".A").c_str(), file_header);
+            }
+            else {
+                if (replace_flag) data.writeParticleBinary(filename.c_str(), file_header);
+                else              data.writeParticleBinary((filename+".B").c_str(), file_header);
+            }
+            return;
+        }
+        // Binary or ASCII to columnar snapshot
+        if (columnar_flag) {
+            if (b_to_a_flag) data.readParticleBinary(filename.c_str(), file_header);
+            else             data.readParticleAscii(filename.c_str(), file_header);
+            std::string fname_out = replace_flag ? filename : filename+".C";
+            ColumnSnapshot::write(fname_out.c_str(), file_header, &data[0], data.getNumberOfParticleLocal(), 0, false);
+            return;
+        }
         // Binary to ASCII
         if (b_to_a_flag) {
             if (add_record_cm_flag) {
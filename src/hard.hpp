@@ -19,6 +19,10 @@
 #include"search_group_candidate.hpp"
 #include"artificial_particles.hpp"
 #include"stability.hpp"
+#include"reduction_buffer.hpp"
+#ifdef STELLAR_EVOLUTION
+#include"stellar_evolution_batch.hpp"
+#endif
 
 typedef H4::ParticleH4<PtclHard> PtclH4;
 
@@ -153,6 +157,39 @@ struct HardEnergy{
         return *this;
     }
 
+    //! add all values to a batch of global summations
+    /*! \return the index of the first value in _buf */
+    PS::S32 addToSum(ReductionSumBuffer& _buf) const {
+        PS::S32 index = _buf.add(de);
+        _buf.add(de_change_cum);
+        _buf.add(de_change_binary_interrupt);
+        _buf.add(de_change_modify_single);
+        _buf.add(de_sd);
+        _buf.add(de_sd_change_cum);
+        _buf.add(de_sd_change_binary_interrupt);
+        _buf.add(de_sd_change_modify_single);
+        _buf.add(ekin_sd_correction);
+        _buf.add(epot_sd_correction);
+        return index;
+    }
+
+    //! set all values from a finished batch of global summations
+    /*! @param[in] _buf: summation buffer
+        @param[in] _index: index returned by addToSum
+     */
+    void getSumFromBuffer(const ReductionSumBuffer& _buf, const PS::S32 _index) {
+        de = _buf.getF64(_index);
+        de_change_cum = _buf.getF64(_index+1);
+        de_change_binary_interrupt = _buf.getF64(_index+2);
+        de_change_modify_single = _buf.getF64(_index+3);
+        de_sd = _buf.getF64(_index+4);
+        de_sd_change_cum = _buf.getF64(_index+5);
+        de_sd_change_binary_interrupt = _buf.getF64(_index+6);
+        de_sd_change_modify_single = _buf.getF64(_index+7);
+        ekin_sd_correction = _buf.getF64(_index+8);
+        epot_sd_correction = _buf.getF64(_index+9);
+    }
+
 };
 
 //! hard integrator 
@@ -359,11 +396,15 @@ public:
             if (_ptcl_artificial!=NULL) {
                 Tsoft* api=&(_ptcl_artificial[adr_first_ptcl[0]]);
                 auto* apcm = ap_manager.getCMParticles(api);
-                auto* aptt = ap_manager.getTidalTensorParticles(api);
 
                 tidal_tensor.resizeNoInitialize(1);
                 auto& tt = tidal_tensor[0];
+#ifdef TIDAL_TENSOR_TREE
+                tt.setFromCoeff(apcm->tt_coeff, apcm->pos);
+#else
+                auto* aptt = ap_manager.getTidalTensorParticles(api);
                 tt.fit(aptt, *apcm, ap_manager.r_tidal_tensor);
+#endif
                 sym_int.perturber.soft_pert=&tt;
                 // set tt group id to the total number of particles
                 sym_int.perturber.soft_pert->group_id = n_members;
@@ -452,13 +493,18 @@ public:
 #ifdef SOFT_PERT
                     auto* api = &(_ptcl_artificial[adr_first_ptcl[i]]);
                     auto* apcm = ap_manager.getCMParticles(api);
-                    auto* aptt = ap_manager.getTidalTensorParticles(api);
 
                     // correct pos for t.t. cm
                     apcm->pos -= h4_int.particles.cm.pos;
 
+#ifdef TIDAL_TENSOR_TREE
+                    // tidal tensor from the tree force kernel
+                    tidal_tensor[i].setFromCoeff(apcm->tt_coeff, apcm->pos);
+#else
                     // fit tidal tensor
+                    auto* aptt = ap_manager.getTidalTensorParticles(api);
                     tidal_tensor[i].fit(aptt, *apcm, ap_manager.r_tidal_tensor);
+#endif
 
                     // set tidal_tensor pointer
                     groupi.perturber.soft_pert = &tidal_tensor[i];
@@ -1209,6 +1255,20 @@ private:
     PS::ReallocatableArray<HardIntegrator*> interrupt_list_; ///> interrupt integrator list
     PS::F64 interrupt_dt_; ///> time end record for interrupt clusters;
 
+    PS::ReallocatableArray<std::pair<PS::F64,PS::S32>> cluster_cost_sort_; ///> estimated cost and index of clusters, sorted in decreasing order of cost
+    PS::F64 cost_h4_step_per_ptcl_;  ///> averaged Hermite steps per particle of finished clusters in the last drift
+    PS::F64 cost_ar_step_per_group_; ///> averaged AR substeps per group of finished clusters in the last drift
+
+#ifdef STELLAR_EVOLUTION
+    StellarEvolutionBatch se_batch_; ///> batch of single stars evolved in evolveStarForOneClusterOMP
+#endif
+
+#ifdef OMP_PROFILE
+    PS::ReallocatableArray<PS::F64> omp_time_busy_; ///> accumulated integration time of each thread in driveForMultiClusterOMP
+    PS::ReallocatableArray<PS::F64> omp_time_idle_; ///> accumulated waiting time of each thread at the end of driveForMultiClusterOMP
+    PS::ReallocatableArray<PS::S64> omp_n_ptcl_;    ///> accumulated number of integrated particles of each thread
+#endif
+
     struct OPLessIDCluster{
         template<class T> bool operator() (const T & left, const T & right) const {
             return left.id_cluster < right.id_cluster;
@@ -1321,6 +1381,40 @@ private:
         return _bin.id;
     }
 
+#ifdef TIDAL_TENSOR_TREE
+    //! correct tidal tensor coefficients of a c.m. particle from the linear cutoff to the changeover soft force
+    /*! The same correction as calcAccPotShortWithLinearCutoff for the acceleration
+      @param[in,out] _pi: c.m. particle for correction
+      @param[in] _pos_j: j particle position
+      @param[in] _mass_j: j particle mass
+      @param[in] _chj: j particle changeover
+     */
+    template <class Tpi>
+    static void calcTidalTensorCoeffShortWithLinearCutoff(Tpi& _pi,
+                                                          const PS::F64vec& _pos_j,
+                                                          const PS::F64 _mass_j,
+                                                          const ChangeOver& _chj) {
+        if (_mass_j==0.0) return;
+        const PS::F64 G = ForceSoft::grav_const;
+        const PS::F64 eps_sq = EPISoft::eps * EPISoft::eps;
+        const PS::F64 r_out2 = EPISoft::r_out * EPISoft::r_out;
+
+        const PS::F64vec dr = _pi.pos - _pos_j;
+        const PS::F64 dr2_eps = dr * dr + eps_sq;
+        const PS::F64 dr_eps = sqrt(dr2_eps);
+        // k = 1 - W
+        const PS::F64 k   = 1.0 - ChangeOver::calcAcc0WTwo(_pi.changeover, _chj, dr_eps);
+        const PS::F64 dk  = - ChangeOver::calcAcc1WTwo(_pi.changeover, _chj, dr_eps, 1.0);
+        const PS::F64 d2k = - ChangeOver::calcAcc2WTwo(_pi.changeover, _chj, dr_eps);
+
+        PS::F64 coeff[TidalTensor::N_COEFF];
+        for (PS::S32 i=0; i<TidalTensor::N_COEFF; i++) coeff[i] = 0.0;
+        TidalTensor::addCoeffPointMassWithChangeOver(coeff, dr, _mass_j, dr2_eps, k, dk, d2k);
+        TidalTensor::addCoeffPointMassWithLinearCutoff(coeff, dr, -_mass_j, dr2_eps, r_out2);
+        for (PS::S32 i=0; i<TidalTensor::N_COEFF; i++) _pi.tt_coeff[i] += G*coeff[i];
+    }
+#endif
+
     //! correct force and potential for soft force with changeover function
     /*!
       @param[in,out] _pi: particle for correction
@@ -1682,7 +1776,16 @@ private:
                 calcAcorrShortWithLinearCutoff(_psoft, ptcl_nb[k]);
             else
 #endif
+            {
                 calcAccPotShortWithLinearCutoff(_psoft, ptcl_nb[k]);
+#ifdef TIDAL_TENSOR_TREE
+                if (_psoft.group_data.artificial.isCM()) {
+                    ChangeOver chj;
+                    chj.setR(ptcl_nb[k].r_in, ptcl_nb[k].r_out);
+                    calcTidalTensorCoeffShortWithLinearCutoff(_psoft, ptcl_nb[k].pos, ptcl_nb[k].mass, chj);
+                }
+#endif
+            }
         }
 //#ifdef STELLAR_EVOLUTION
 //        // correct soft potential energy of one particle change due to mass change
@@ -1735,7 +1838,13 @@ private:
                             calcAcorrShortWithLinearCutoff(pj[k], porb_kj[kk]);
                         else
 #endif
+                        {
                             calcAccPotShortWithLinearCutoff(pj[k], porb_kj[kk]);
+#ifdef TIDAL_TENSOR_TREE
+                            // no tidal tensor particles, pj is the c.m. particle
+                            calcTidalTensorCoeffShortWithLinearCutoff(pj[k], porb_kj[kk].pos, porb_kj[kk].mass, porb_kj[kk].changeover);
+#endif
+                        }
                     }
                 }
 
@@ -1748,7 +1857,12 @@ private:
                     }
                     else
 #endif
+                    {
                         calcAccPotShortWithLinearCutoff(pj[k], _ptcl_local[kj]);
+#ifdef TIDAL_TENSOR_TREE
+                        calcTidalTensorCoeffShortWithLinearCutoff(pj[k], _ptcl_local[kj].pos, _ptcl_local[kj].mass, _ptcl_local[kj].changeover);
+#endif
+                    }
                 }
             };
 
@@ -1812,6 +1926,8 @@ public:
         hard_int_ = NULL;
         n_hard_int_max_ = 0;
         n_hard_int_use_ = 0;
+        cost_h4_step_per_ptcl_ = 1.0;
+        cost_ar_step_per_group_ = 0.0;
 
 #ifdef PROFILE
         ARC_substep_sum = 0;
@@ -2052,26 +2168,6 @@ public:
             PS::F64vec dr = pi.vel * _dt;
             pi.pos += dr;
 
-#ifdef STELLAR_EVOLUTION
-            PS::F64 mbk = pi.mass;
-
-            PS::F64vec vbk = pi.vel; //back up velocity in case of change
-            assert(!std::isinf(vbk.x));
-            assert(!std::isnan(vbk.x));
-            int modify_flag = manager->ar_manager.interaction.modifyOneParticle(pi, time_origin_, time_origin_ + _dt);
-            if (modify_flag) {
-                auto& v = pi.vel;
-                Float de_kin = 0.5*(pi.mass*(v[0]*v[0]+v[1]*v[1]+v[2]*v[2]) - mbk*(vbk[0]*vbk[0]+vbk[1]*vbk[1]+vbk[2]*vbk[2]));
-                energy.de_sd_change_cum += de_kin;
-                energy.de_sd_change_modify_single += de_kin;
-                energy.de_change_cum += de_kin;
-                energy.de_change_modify_single += de_kin;
-            }
-            // shift time interrupt in order to get consistent time for stellar evolution in the next drift
-            //pi.time_record    -= _dt;
-            //pi.time_interrupt -= _dt;
-#endif
-
             //// to avoid issue in cluster search with velocity
             //auto& pi_cm = pi.group_data.cm;
             //pi_cm.mass = pi_cm.vel.x = pi_cm.vel.y = pi_cm.vel.z = 0.0;
@@ -2099,6 +2195,39 @@ public:
         time_origin_ += _dt;
     }
 
+#ifdef STELLAR_EVOLUTION
+    //! evolve isolated single stars to the current time in one batch
+    /*! Called after driveForOneClusterOMP of the same tree step.
+      Stars with time_interrupt within the step are collected and evolved in parallel by StellarEvolutionBatch,
+      the kinetic energy change is added to the energy corrections and r_search is updated for stars with velocity kicks.
+      @param[in] _dt: tree time step
+      \return number of evolved stars
+     */
+    PS::S32 evolveStarForOneClusterOMP(const PS::F64 _dt) {
+#ifdef BSE_BASE
+        auto& interaction = manager->ar_manager.interaction;
+        if (interaction.stellar_evolution_option==0) return 0;
+
+        se_batch_.collect(ptcl_hard_.getPointer(), ptcl_hard_.size(), time_origin_);
+        se_batch_.evolve(ptcl_hard_.getPointer(), interaction, time_origin_, interaction.fout_sse);
+        const PS::S32 n_batch = se_batch_.adr.size();
+        for (PS::S32 k=0; k<n_batch; k++) {
+            if (se_batch_.modify_flag[k]==2) ptcl_hard_[se_batch_.adr[k]].Ptcl::calcRSearch(_dt);
+        }
+
+        const PS::F64 de_kin = se_batch_.de_kin;
+        energy.de_sd_change_cum += de_kin;
+        energy.de_sd_change_modify_single += de_kin;
+        energy.de_change_cum += de_kin;
+        energy.de_change_modify_single += de_kin;
+
+        return n_batch;
+#else
+        return 0;
+#endif
+    }
+#endif
+
     //! write back hard particles to global system, check mass modification and update time of write back
     /*! 
       @param[in,out] _sys: particle system
@@ -2260,8 +2389,72 @@ public:
     }
 
 
+    //! estimate the integration cost of clusters and sort them in decreasing order of cost
+    /*! The cost is estimated by the averaged Hermite steps per particle and AR substeps per group of the last drift:
+        cost = n_ptcl * (n_ptcl * <H4 steps per particle> + n_group * <AR substeps per group>).
+        One Hermite step of one particle and one AR substep both loop all members in the cluster, thus n_ptcl is multiplied.
+        The result is stored in cluster_cost_sort_ for the longest-processing-time-first scheduling.
+     */
+    void estimateAndSortClusterCost() {
+        const PS::S32 n_cluster = n_ptcl_in_cluster_.size();
+        cluster_cost_sort_.resizeNoInitialize(n_cluster);
+        for (PS::S32 i=0; i<n_cluster; i++) {
+            const PS::F64 n_ptcl = n_ptcl_in_cluster_[i];
+            const PS::F64 n_group = n_group_in_cluster_.size()>i ? n_group_in_cluster_[i] : 0;
+            cluster_cost_sort_[i].first = n_ptcl * (n_ptcl * cost_h4_step_per_ptcl_ + n_group * cost_ar_step_per_group_);
+            cluster_cost_sort_[i].second = i;
+        }
+        std::sort(cluster_cost_sort_.getPointer(), cluster_cost_sort_.getPointer()+n_cluster, 
+                  [](const std::pair<PS::F64,PS::S32> &a, const std::pair<PS::F64,PS::S32> &b){ return a.first>b.first;});
+    }
+
+    //! get estimated cost of the cluster with the k-th largest cost, estimateAndSortClusterCost should be called first
+    PS::F64 getSortedClusterCost(const PS::S32 k) const {
+        return cluster_cost_sort_[k].first;
+    }
+
+#ifdef OMP_PROFILE
+    //! print the OpenMP load balance of driveForMultiClusterOMP
+    /*! For each thread, print the integration time, the idle time waiting for other threads and the number of integrated particles
+      @param[in] _fout: output stream
+      @param[in] _n_loop: number of steps for averaging
+      @param[in] _width: print width of columns
+     */
+    void printOMPProfile(std::ostream & _fout, const PS::S64 _n_loop=1, const PS::S32 _width=13) const {
+        const PS::S32 num_thread = omp_time_busy_.size();
+        _fout<<std::setw(_width)<<"Thread"
+             <<std::setw(_width)<<"Busy"
+             <<std::setw(_width)<<"Idle"
+             <<std::setw(_width)<<"N_ptcl"
+             <<std::endl;
+        PS::F64 idle_max = 0.0, idle_sum = 0.0;
+        for (PS::S32 i=0; i<num_thread; i++) {
+            _fout<<std::setw(_width)<<i
+                 <<std::setw(_width)<<omp_time_busy_[i]/_n_loop
+                 <<std::setw(_width)<<omp_time_idle_[i]/_n_loop
+                 <<std::setw(_width)<<(PS::F64)omp_n_ptcl_[i]/_n_loop
+                 <<std::endl;
+            idle_max = std::max(idle_max, omp_time_idle_[i]);
+            idle_sum += omp_time_idle_[i];
+        }
+        if (num_thread>0) 
+            _fout<<"Idle time per step, max: "<<idle_max/_n_loop<<" mean: "<<idle_sum/(num_thread*_n_loop)<<std::endl;
+    }
+
+    //! clear the OpenMP load balance profile
+    void clearOMPProfile() {
+        for (PS::S32 i=0; i<omp_time_busy_.size(); i++) {
+            omp_time_busy_[i] = omp_time_idle_[i] = 0.0;
+            omp_n_ptcl_[i] = 0;
+        }
+    }
+#endif
+
     //! Hard integration for clusters
     /*! Integrate (drift) all clusters with OpenMP
+      Clusters are integrated in decreasing order of estimated cost (longest processing time first) with dynamic scheduling, 
+      so that large clusters do not start at the end of the loop and leave other threads idle.
+      With DOMAIN_HARD_COST, the measured time of each cluster divided by the member number is saved in cost_hard of local members in _ptcl_soft.
       If interrupt integration exist, record in the interrupt_list_;
        @param[in] _dt: integration ending time (initial time is fixed to 0)
        @param[in] _ptcl_soft: global particle array which contains the artificial particles for constructing tidal tensors.
@@ -2273,17 +2466,12 @@ public:
 
         const PS::S32 n_cluster = n_ptcl_in_cluster_.size();
         //PS::ReallocatableArray<PtclH4> extra_ptcl[num_thread];
-        //// For test
-        //PS::ReallocatableArray<std::pair<PS::S32,PS::S32>> n_sort_list;
-        //n_sort_list.resizeNoInitialize(n_cluster);
-        //for(PS::S32 i=0; i<n_cluster; i++) {
-        //    n_sort_list[i].first = n_ptcl_in_cluster_[i];
-        //    n_sort_list[i].second= i;
-        //}
-        //std::sort(n_sort_list.getPointer(),n_sort_list.getPointer()+n_cluster,[](const std::pair<PS::S32,PS::S32> &a, const std::pair<PS::S32,PS::S32> &b){return a.first<b.first;});
         const PS::S32 num_thread = PS::Comm::getNumberOfThread();
         assert(n_hard_int_max_>num_thread);
 
+        // sort clusters by estimated cost, the most expensive ones are integrated first
+        estimateAndSortClusterCost();
+
 #ifndef ONLY_SOFT
         HardIntegrator* hard_int_thread[num_thread];
         // set new hard_int front pointer 
@@ -2293,6 +2481,16 @@ public:
         }
 #endif
 
+        // step counts of finished clusters for updating the cost model
+        PS::S64 cost_n_ptcl_thread[num_thread];
+        PS::S64 cost_n_group_thread[num_thread];
+        PS::S64 cost_h4_step_thread[num_thread];
+        PS::S64 cost_ar_step_thread[num_thread];
+        for (PS::S32 i=0; i<num_thread; i++) {
+            cost_n_ptcl_thread[i] = cost_n_group_thread[i] = 0;
+            cost_h4_step_thread[i] = cost_ar_step_thread[i] = 0;
+        }
+
 #ifdef OMP_PROFILE        
         PS::F64 time_thread[num_thread];
         PS::S64 num_cluster[num_thread];
@@ -2300,15 +2498,19 @@ public:
           time_thread[i] = 0;
           num_cluster[i] = 0;
         }
+        PS::F64 time_loop = -PS::GetWtime();
 #endif
 
 #pragma omp parallel for schedule(dynamic)
-        for(PS::S32 i=0; i<n_cluster; i++){
+        for(PS::S32 k=0; k<n_cluster; k++){
             const PS::S32 ith = PS::Comm::getThreadNum();
 #ifdef OMP_PROFILE
             time_thread[ith] -= PS::GetWtime();
 #endif
-            //const PS::S32 i   = n_sort_list[k].second;
+#ifdef DOMAIN_HARD_COST
+            const PS::F64 time_cluster_start = PS::GetWtime();
+#endif
+            const PS::S32 i   = cluster_cost_sort_[k].second;
             const PS::S32 adr_head = n_ptcl_in_cluster_disp_[i];
             const PS::S32 n_ptcl = n_ptcl_in_cluster_[i];
 
@@ -2359,7 +2561,12 @@ public:
                 ARC_substep_sum    += hard_int_thread[ith]->ARC_substep_sum;
                 ARC_tsyn_step_sum  += hard_int_thread[ith]->ARC_tsyn_step_sum;
                 H4_step_sum        += hard_int_thread[ith]->H4_step_sum;
+
+                cost_h4_step_thread[ith] += hard_int_thread[ith]->H4_step_sum;
+                cost_ar_step_thread[ith] += hard_int_thread[ith]->ARC_substep_sum;
 #endif
+                cost_n_ptcl_thread[ith]  += n_ptcl;
+                cost_n_group_thread[ith] += n_group;
 #ifdef HARD_COUNT_NO_NEIGHBOR
                 n_neighbor_zero    += hard_int_thread[ith]->n_neighbor_zero;
 #endif
@@ -2370,13 +2577,21 @@ public:
                 hard_int_thread[ith]->clear();
             }
 
+#ifdef DOMAIN_HARD_COST
+            // attribute the measured cluster time to local members for the domain sampling weight
+            const PS::F64 cost_member = (PS::GetWtime() - time_cluster_start)/n_ptcl;
+            for (PS::S32 j=adr_head; j<adr_head+n_ptcl; j++) {
+                const PS::S32 adr = ptcl_hard_[j].adr_org;
+                if (adr>=0) _ptcl_soft[adr].cost_hard = cost_member;
+            }
+#endif
 #ifdef OMP_PROFILE
             time_thread[ith] += PS::GetWtime();
 #endif
 
 #ifdef HARD_DEBUG_PROFILE
             PS::F64 tend = PS::GetWtime();
-            std::cerr<<"HT: "<<i<<" "<<ith<<" "<<n_cluster<<" "<<n_ptcl<<" "<<tend-tstart<<std::endl;
+            std::cerr<<"HT: "<<i<<" "<<ith<<" "<<n_cluster<<" "<<n_ptcl<<" "<<cluster_cost_sort_[k].first<<" "<<tend-tstart<<std::endl;
 #endif
 
 #else
@@ -2397,6 +2612,35 @@ public:
 
         }
 
+#ifdef OMP_PROFILE
+        time_loop += PS::GetWtime();
+        if (omp_time_busy_.size()!=num_thread) {
+            omp_time_busy_.resizeNoInitialize(num_thread);
+            omp_time_idle_.resizeNoInitialize(num_thread);
+            omp_n_ptcl_.resizeNoInitialize(num_thread);
+            for (PS::S32 i=0; i<num_thread; i++) {
+                omp_time_busy_[i] = omp_time_idle_[i] = 0.0;
+                omp_n_ptcl_[i] = 0;
+            }
+        }
+        for (PS::S32 i=0; i<num_thread; i++) {
+            omp_time_busy_[i] += time_thread[i];
+            omp_time_idle_[i] += std::max(0.0, time_loop - time_thread[i]);
+            omp_n_ptcl_[i] += num_cluster[i];
+        }
+#endif
+
+        // update cost model for the next drift
+        PS::S64 cost_n_ptcl=0, cost_n_group=0, cost_h4_step=0, cost_ar_step=0;
+        for (PS::S32 i=0; i<num_thread; i++) {
+            cost_n_ptcl  += cost_n_ptcl_thread[i];
+            cost_n_group += cost_n_group_thread[i];
+            cost_h4_step += cost_h4_step_thread[i];
+            cost_ar_step += cost_ar_step_thread[i];
+        }
+        if (cost_n_ptcl>0&&cost_h4_step>0) cost_h4_step_per_ptcl_ = PS::F64(cost_h4_step)/PS::F64(cost_n_ptcl);
+        if (cost_n_group>0) cost_ar_step_per_group_ = PS::F64(cost_ar_step)/PS::F64(cost_n_group);
+
         // regist interrupted hard integrator
         assert(interrupt_list_.size()==0);
         for (auto iptr = hard_int_; iptr<hard_int_front_ptr; iptr++) 
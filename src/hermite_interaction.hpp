@@ -2,6 +2,9 @@
 
 #include "Common/Float.h"
 #include "changeover.hpp"
+#ifndef INTEGRATED_CUTOFF_FUNCTION
+#include "hermite_simd.hpp"
+#endif
 
 //! hermite interaction class 
 class HermiteInteraction{
@@ -94,6 +97,22 @@ public:
         return dr2;
     }
 
+#ifndef INTEGRATED_CUTOFF_FUNCTION
+    //! calculate acceleration and jerk of single i from a neighbor list in structure-of-arrays (SIMD kernel)
+    /*! Equivalent to calcAccJerkPairSingleSingle summed over all neighbors in _nb, up to round-off
+      @param[out]: _fi: acceleration for i particle
+      @param[in]: _pi: particle i
+      @param[in]: _nb: neighbor list copy
+      \return the minimum distance square of i and neighbors
+     */
+    template<class Tpi>
+    inline Float calcAccJerkSingleNeighborSoA(H4::ForceH4& _fi,
+                                              const Tpi& _pi,
+                                              const HermiteNeighborSoA& _nb) {
+        return _nb.calcAccJerkPot(_fi, _pi, eps_sq, gravitational_constant);
+    }
+#endif
+
     //! calculate acceleration and jerk of one pair single and resolved group
     /*! 
       @param[out]: _fi: acceleration for i particle
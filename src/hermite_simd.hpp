@@ -0,0 +1,312 @@
+#pragma once
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#include "Common/Float.h"
+#include "changeover.hpp"
+
+#if defined(__AVX512F__) && defined(__AVX512DQ__)
+#define HERMITE_SIMD_AVX512
+#elif defined(__AVX2__)
+#define HERMITE_SIMD_AVX2
+#endif
+
+//! double precision SIMD wrappers for the Hermite neighbor kernel
+namespace HermiteSIMD {
+#if defined(HERMITE_SIMD_AVX512)
+    typedef __m512d VecD;
+    const int VEC_WIDTH = 8;
+    inline VecD set1(const double _a) { return _mm512_set1_pd(_a); }
+    inline VecD loadVec(const double* _p) { return _mm512_loadu_pd(_p); }
+    inline VecD add(const VecD _a, const VecD _b) { return _mm512_add_pd(_a, _b); }
+    inline VecD sub(const VecD _a, const VecD _b) { return _mm512_sub_pd(_a, _b); }
+    inline VecD mul(const VecD _a, const VecD _b) { return _mm512_mul_pd(_a, _b); }
+    inline VecD div(const VecD _a, const VecD _b) { return _mm512_div_pd(_a, _b); }
+    inline VecD sqrt(const VecD _a) { return _mm512_sqrt_pd(_a); }
+    inline VecD min(const VecD _a, const VecD _b) { return _mm512_min_pd(_a, _b); }
+    inline VecD max(const VecD _a, const VecD _b) { return _mm512_max_pd(_a, _b); }
+    //! (_a > _b) ? _x : _y
+    inline VecD selectGT(const VecD _a, const VecD _b, const VecD _x, const VecD _y) { return _mm512_mask_blend_pd(_mm512_cmp_pd_mask(_a, _b, _CMP_GT_OQ), _y, _x); }
+    //! (_a >= _b) ? _x : _y
+    inline VecD selectGE(const VecD _a, const VecD _b, const VecD _x, const VecD _y) { return _mm512_mask_blend_pd(_mm512_cmp_pd_mask(_a, _b, _CMP_GE_OQ), _y, _x); }
+    inline double reduceAdd(const VecD _a) { return _mm512_reduce_add_pd(_a); }
+    inline double reduceMin(const VecD _a) { return _mm512_reduce_min_pd(_a); }
+#elif defined(HERMITE_SIMD_AVX2)
+    typedef __m256d VecD;
+    const int VEC_WIDTH = 4;
+    inline VecD set1(const double _a) { return _mm256_set1_pd(_a); }
+    inline VecD loadVec(const double* _p) { return _mm256_loadu_pd(_p); }
+    inline VecD add(const VecD _a, const VecD _b) { return _mm256_add_pd(_a, _b); }
+    inline VecD sub(const VecD _a, const VecD _b) { return _mm256_sub_pd(_a, _b); }
+    inline VecD mul(const VecD _a, const VecD _b) { return _mm256_mul_pd(_a, _b); }
+    inline VecD div(const VecD _a, const VecD _b) { return _mm256_div_pd(_a, _b); }
+    inline VecD sqrt(const VecD _a) { return _mm256_sqrt_pd(_a); }
+    inline VecD min(const VecD _a, const VecD _b) { return _mm256_min_pd(_a, _b); }
+    inline VecD max(const VecD _a, const VecD _b) { return _mm256_max_pd(_a, _b); }
+    //! (_a > _b) ? _x : _y
+    inline VecD selectGT(const VecD _a, const VecD _b, const VecD _x, const VecD _y) { return _mm256_blendv_pd(_y, _x, _mm256_cmp_pd(_a, _b, _CMP_GT_OQ)); }
+    //! (_a >= _b) ? _x : _y
+    inline VecD selectGE(const VecD _a, const VecD _b, const VecD _x, const VecD _y) { return _mm256_blendv_pd(_y, _x, _mm256_cmp_pd(_a, _b, _CMP_GE_OQ)); }
+    inline double reduceAdd(const VecD _a) {
+        __m128d lo = _mm256_castpd256_pd128(_a);
+        __m128d hi = _mm256_extractf128_pd(_a, 1);
+        lo = _mm_add_pd(lo, hi);
+        return _mm_cvtsd_f64(_mm_add_sd(lo, _mm_unpackhi_pd(lo, lo)));
+    }
+    inline double reduceMin(const VecD _a) {
+        __m128d lo = _mm256_castpd256_pd128(_a);
+        __m128d hi = _mm256_extractf128_pd(_a, 1);
+        lo = _mm_min_pd(lo, hi);
+        return _mm_cvtsd_f64(_mm_min_sd(lo, _mm_unpackhi_pd(lo, lo)));
+    }
+#endif
+}
+
+//! Structure-of-arrays copy of a Hermite neighbor list for the vectorized acc/jerk/pot kernel with changeover
+/*! The kernel is equivalent to HermiteInteraction::calcAccJerkPairSingleSingle summed over the list
+    (the changeover of the pair uses the one with larger r_out, without INTEGRATED_CUTOFF_FUNCTION).
+    The branches of the changeover functions are replaced by clamping and blending, so that all lanes follow the same path.
+    The list is padded to a multiple of 8 with massless particles far away, thus no remainder loop is needed.
+    AVX-512 (8 doubles) or AVX2 (4 doubles) is used depending on the compiler flags, otherwise a scalar loop over the arrays.
+ */
+class HermiteNeighborSoA{
+private:
+    enum {X=0, Y, Z, VX, VY, VZ, MASS, R_IN, R_OUT, NORM, COFF, POT_OFF, N_FIELD};
+    enum {PAD_WIDTH = 8};
+
+    PS::ReallocatableArray<Float> buf_; // field f of particle j is buf_[f*n_pad_ + j]
+    int n_;     // number of neighbors
+    int n_pad_; // padded size
+
+    Float* field(const int _f) { return buf_.getPointer(_f*n_pad_); }
+    const Float* field(const int _f) const { return buf_.getPointer(_f*n_pad_); }
+
+    //! set one particle
+    template <class Tptcl>
+    void setParticle(const int _j, const Tptcl& _p) {
+        Float* b = buf_.getPointer();
+        b[X*n_pad_+_j] = _p.pos[0];
+        b[Y*n_pad_+_j] = _p.pos[1];
+        b[Z*n_pad_+_j] = _p.pos[2];
+        b[VX*n_pad_+_j] = _p.vel[0];
+        b[VY*n_pad_+_j] = _p.vel[1];
+        b[VZ*n_pad_+_j] = _p.vel[2];
+        b[MASS*n_pad_+_j] = _p.mass;
+        b[R_IN*n_pad_+_j] = _p.changeover.getRin();
+        b[R_OUT*n_pad_+_j] = _p.changeover.getRout();
+        b[NORM*n_pad_+_j] = _p.changeover.getNorm();
+        b[COFF*n_pad_+_j] = _p.changeover.getCoff();
+        b[POT_OFF*n_pad_+_j] = _p.changeover.getPotOff();
+    }
+
+    //! resize and fill padding particles
+    void resize(const int _n) {
+        n_ = _n;
+        n_pad_ = ((_n+PAD_WIDTH-1)/PAD_WIDTH)*PAD_WIDTH;
+        buf_.resizeNoInitialize(N_FIELD*n_pad_);
+        Float* b = buf_.getPointer();
+        for (int j=_n; j<n_pad_; j++) {
+            b[X*n_pad_+j] = b[Y*n_pad_+j] = b[Z*n_pad_+j] = 1e100;
+            b[VX*n_pad_+j] = b[VY*n_pad_+j] = b[VZ*n_pad_+j] = 0.0;
+            b[MASS*n_pad_+j] = 0.0;
+            b[R_IN*n_pad_+j] = 0.5;
+            b[R_OUT*n_pad_+j] = 1.0;
+            b[NORM*n_pad_+j] = 2.0;
+            b[COFF*n_pad_+j] = 1.0/3.0;
+            b[POT_OFF*n_pad_+j] = 4.0/3.0;
+        }
+    }
+
+public:
+    HermiteNeighborSoA(): buf_(), n_(0), n_pad_(0) {}
+
+    //! copy neighbors from a particle array with an index list
+    /*!
+      @param[in] _ptcl: particle array
+      @param[in] _index: index of neighbors in _ptcl
+      @param[in] _n: number of neighbors
+     */
+    template <class Tptcl>
+    void load(const Tptcl* _ptcl, const int* _index, const int _n) {
+        resize(_n);
+        for (int j=0; j<_n; j++) setParticle(j, _ptcl[_index[j]]);
+    }
+
+    //! copy neighbors from an address list
+    /*!
+      @param[in] _adr: particle addresses
+      @param[in] _n: number of neighbors
+     */
+    template <class Tptcl>
+    void load(Tptcl* const* _adr, const int _n) {
+        resize(_n);
+        for (int j=0; j<_n; j++) setParticle(j, *_adr[j]);
+    }
+
+    //! get number of neighbors
+    int size() const {
+        return n_;
+    }
+
+    //! accumulate acceleration, jerk and potential of particle i from all neighbors
+    /*!
+      @param[in,out] _fi: force of i particle (acc0, acc1, pot are accumulated)
+      @param[in] _pi: particle i (pos, vel, changeover)
+      @param[in] _eps_sq: softening parameter
+      @param[in] _G: gravitational constant
+      \return the minimum distance square of i and neighbors (without softening)
+     */
+    template <class Tforce, class Tpi>
+    Float calcAccJerkPot(Tforce& _fi, const Tpi& _pi, const Float _eps_sq, const Float _G) const {
+        const Float* px = field(X);
+        const Float* py = field(Y);
+        const Float* pz = field(Z);
+        const Float* vx = field(VX);
+        const Float* vy = field(VY);
+        const Float* vz = field(VZ);
+        const Float* mass = field(MASS);
+        const Float* r_in = field(R_IN);
+        const Float* r_out = field(R_OUT);
+        const Float* norm = field(NORM);
+        const Float* coff = field(COFF);
+        const Float* pot_off = field(POT_OFF);
+        const ChangeOver& chi = _pi.changeover;
+
+        Float r2_min = std::numeric_limits<Float>::max();
+        Float acc0[3] = {0.0, 0.0, 0.0};
+        Float acc1[3] = {0.0, 0.0, 0.0};
+        Float pot = 0.0;
+
+#if defined(HERMITE_SIMD_AVX512) || defined(HERMITE_SIMD_AVX2)
+        static_assert(sizeof(Float)==sizeof(double), "SIMD Hermite kernel requires double precision Float");
+        using namespace HermiteSIMD;
+        const VecD xi = set1(_pi.pos[0]), yi = set1(_pi.pos[1]), zi = set1(_pi.pos[2]);
+        const VecD vxi = set1(_pi.vel[0]), vyi = set1(_pi.vel[1]), vzi = set1(_pi.vel[2]);
+        const VecD r_in_i = set1(chi.getRin()), r_out_i = set1(chi.getRout()), norm_i = set1(chi.getNorm());
+        const VecD coff_i = set1(chi.getCoff()), pot_off_i = set1(chi.getPotOff());
+        const VecD eps_sq = set1(_eps_sq), gc = set1(_G);
+        const VecD zero = set1(0.0), one = set1(1.0), three = set1(3.0);
+        const VecD c4 = set1(4.0), c5 = set1(5.0), c10 = set1(10.0), c14 = set1(14.0), c20 = set1(20.0), c28 = set1(28.0), c35 = set1(35.0), c280 = set1(280.0);
+
+        VecD ax = zero, ay = zero, az = zero, jx = zero, jy = zero, jz = zero, vpot = zero;
+        VecD vr2_min = set1(std::numeric_limits<double>::max());
+        for (int j=0; j<n_pad_; j+=VEC_WIDTH) {
+            const VecD dx = sub(loadVec(px+j), xi);
+            const VecD dy = sub(loadVec(py+j), yi);
+            const VecD dz = sub(loadVec(pz+j), zi);
+            const VecD dvx = sub(loadVec(vx+j), vxi);
+            const VecD dvy = sub(loadVec(vy+j), vyi);
+            const VecD dvz = sub(loadVec(vz+j), vzi);
+            const VecD dr2 = add(add(mul(dx,dx), mul(dy,dy)), mul(dz,dz));
+            vr2_min = min(vr2_min, dr2);
+            const VecD drdv = add(add(mul(dx,dvx), mul(dy,dvy)), mul(dz,dvz));
+            const VecD r = sqrt(add(dr2, eps_sq));
+            const VecD rinv = div(one, r);
+            const VecD drdot = mul(drdv, rinv);
+
+            // changeover with larger r_out
+            const VecD r_out_j = loadVec(r_out+j);
+            const VecD rin = selectGT(r_out_i, r_out_j, r_in_i, loadVec(r_in+j));
+            const VecD nm = selectGT(r_out_i, r_out_j, norm_i, loadVec(norm+j));
+            const VecD cf = selectGT(r_out_i, r_out_j, coff_i, loadVec(coff+j));
+            const VecD po = selectGT(r_out_i, r_out_j, pot_off_i, loadVec(pot_off+j));
+
+            const VecD xr = mul(sub(r, rin), nm);
+            const VecD x = max(min(xr, one), zero);
+            const VecD x2 = mul(x,x);
+            const VecD x3 = mul(x2,x);
+            const VecD x4 = mul(x2,x2);
+            const VecD x5 = mul(x2,x3);
+            // potential: 1 - coff*x^5*(5x^3 - 20x^2 + 28x - 14) inside, pot_off*r outside
+            const VecD kp_in = sub(one, mul(mul(cf, x5), sub(add(sub(mul(c5,x3), mul(c20,x2)), mul(c28,x)), c14)));
+            const VecD kp = selectGE(xr, one, mul(po, r), kp_in);
+            // force: (x-1)^4 (1 + 4x + 10x^2 + 20x^3 + 35 coff x^4)
+            const VecD x_1 = sub(x, one);
+            const VecD x_2 = mul(x_1,x_1);
+            const VecD x_3 = mul(x_2,x_1);
+            const VecD x_4 = mul(x_2,x_2);
+            const VecD k = mul(x_4, add(add(add(add(one, mul(c4,x)), mul(c10,x2)), mul(c20,x3)), mul(mul(c35,cf),x4)));
+            // force derivative: coff*280 x^3 (r_in*norm + x)(x-1)^3 dx/dt, zero at the clamped boundaries
+            const VecD xdot = mul(nm, drdot);
+            const VecD kdot = mul(mul(mul(mul(mul(cf, c280), x3), add(mul(rin, nm), x)), x_3), xdot);
+
+            const VecD rinv2 = mul(rinv, rinv);
+            const VecD gmor = mul(mul(gc, loadVec(mass+j)), rinv);
+            const VecD gmor3 = mul(gmor, rinv2);
+            const VecD gmor3k = mul(gmor3, k);
+            const VecD gmor3kd = mul(gmor3, kdot);
+            const VecD a0x = mul(gmor3k, dx);
+            const VecD a0y = mul(gmor3k, dy);
+            const VecD a0z = mul(gmor3k, dz);
+            const VecD c3 = mul(mul(three, drdv), rinv2);
+            ax = add(ax, a0x);
+            ay = add(ay, a0y);
+            az = add(az, a0z);
+            jx = add(jx, add(sub(mul(gmor3k, dvx), mul(c3, a0x)), mul(gmor3kd, dx)));
+            jy = add(jy, add(sub(mul(gmor3k, dvy), mul(c3, a0y)), mul(gmor3kd, dy)));
+            jz = add(jz, add(sub(mul(gmor3k, dvz), mul(c3, a0z)), mul(gmor3kd, dz)));
+            vpot = sub(vpot, mul(gmor, kp));
+        }
+        acc0[0] = reduceAdd(ax);
+        acc0[1] = reduceAdd(ay);
+        acc0[2] = reduceAdd(az);
+        acc1[0] = reduceAdd(jx);
+        acc1[1] = reduceAdd(jy);
+        acc1[2] = reduceAdd(jz);
+        pot = reduceAdd(vpot);
+        if (n_>0) r2_min = reduceMin(vr2_min);
+#else
+        for (int j=0; j<n_; j++) {
+            const Float dr[3] = {px[j]-_pi.pos[0], py[j]-_pi.pos[1], pz[j]-_pi.pos[2]};
+            const Float dv[3] = {vx[j]-_pi.vel[0], vy[j]-_pi.vel[1], vz[j]-_pi.vel[2]};
+            const Float dr2 = dr[0]*dr[0] + dr[1]*dr[1] + dr[2]*dr[2];
+            r2_min = std::min(r2_min, dr2);
+            const Float drdv = dr[0]*dv[0] + dr[1]*dv[1] + dr[2]*dv[2];
+            const Float r = std::sqrt(dr2 + _eps_sq);
+            const Float rinv = 1.0/r;
+            const Float drdot = drdv*rinv;
+
+            const bool use_i = chi.getRout() > r_out[j];
+            const Float rin = use_i ? chi.getRin() : r_in[j];
+            const Float nm = use_i ? chi.getNorm() : norm[j];
+            const Float cf = use_i ? chi.getCoff() : coff[j];
+            const Float po = use_i ? chi.getPotOff() : pot_off[j];
+
+            const Float xr = (r - rin)*nm;
+            const Float x = std::max(std::min(xr, Float(1.0)), Float(0.0));
+            const Float x2 = x*x;
+            const Float x3 = x2*x;
+            const Float x4 = x2*x2;
+            const Float x5 = x2*x3;
+            const Float kp = (xr >= 1.0) ? po*r : 1.0 - cf*x5*(5.0*x3 - 20.0*x2 + 28.0*x - 14.0);
+            const Float x_1 = x - 1.0;
+            const Float x_2 = x_1*x_1;
+            const Float x_3 = x_2*x_1;
+            const Float x_4 = x_2*x_2;
+            const Float k = x_4*(1.0 + 4.0*x + 10.0*x2 + 20.0*x3 + 35.0*cf*x4);
+            const Float kdot = cf*280.0*x3*(rin*nm + x)*x_3*(nm*drdot);
+
+            const Float rinv2 = rinv*rinv;
+            const Float gmor = _G*mass[j]*rinv;
+            const Float gmor3 = gmor*rinv2;
+            const Float gmor3k = gmor3*k;
+            const Float gmor3kd = gmor3*kdot;
+            for (int d=0; d<3; d++) {
+                const Float a0 = gmor3k*dr[d];
+                acc0[d] += a0;
+                acc1[d] += gmor3k*dv[d] - 3.0*drdv*rinv2*a0 + gmor3kd*dr[d];
+            }
+            pot -= gmor*kp;
+        }
+#endif
+        for (int d=0; d<3; d++) {
+            _fi.acc0[d] += acc0[d];
+            _fi.acc1[d] += acc1[d];
+        }
+        _fi.pot += pot;
+        return r2_min;
+    }
+};
@@ -0,0 +1,177 @@
+#include <iostream>
+#include <cstdio>
+#include <iomanip>
+#include <cstdlib>
+#include <cassert>
+#include <cmath>
+#include <getopt.h>
+#define ASSERT assert
+#include <particle_simulator.hpp>
+#include "Hermite/hermite_integrator.h"
+#include "hermite_interaction.hpp"
+
+//! simple particle type for the Hermite kernel test
+struct PtclHermiteTest{
+    Float pos[3];
+    Float vel[3];
+    Float mass;
+    PS::S64 id;
+    ChangeOver changeover;
+};
+
+//! uniform random number in [0,1)
+Float getRandom() {
+    return (Float)rand()/((Float)RAND_MAX+1.0);
+}
+
+//! relative difference of two 3D vectors
+Float calcRelDiff(const Float* _a, const Float* _b) {
+    Float da2 = 0.0, a2 = 0.0;
+    for (int k=0; k<3; k++) {
+        da2 += (_a[k]-_b[k])*(_a[k]-_b[k]);
+        a2 += _a[k]*_a[k];
+    }
+    return a2>0.0 ? std::sqrt(da2/a2) : std::sqrt(da2);
+}
+
+int main(int argc, char **argv){
+    int n_ptcl = 1024;  // number of particles
+    int n_nb = 64;      // number of neighbors of each particle
+    int n_loop = 100;   // number of repeats for timing
+    Float r_out = 0.01; // changeover outer radius
+    Float r_sys = 0.02; // system radius
+
+    int copt;
+    while ((copt = getopt(argc, argv, "n:b:l:r:s:h")) != -1)
+        switch (copt) {
+        case 'n':
+            n_ptcl = atoi(optarg);
+            break;
+        case 'b':
+            n_nb = atoi(optarg);
+            break;
+        case 'l':
+            n_loop = atoi(optarg);
+            break;
+        case 'r':
+            r_out = atof(optarg);
+            break;
+        case 's':
+            r_sys = atof(optarg);
+            break;
+        case 'h':
+            std::cout<<"Benchmark of the Hermite acc/jerk/pot kernel with changeover: scalar pair function vs. structure-of-arrays SIMD kernel\n"
+                     <<"Options: \n"
+                     <<"  -n: number of particles ("<<n_ptcl<<")\n"
+                     <<"  -b: number of neighbors of each particle ("<<n_nb<<")\n"
+                     <<"  -l: number of repeats for timing ("<<n_loop<<")\n"
+                     <<"  -r: changeover outer radius, r_in = 0.1 r_out ("<<r_out<<")\n"
+                     <<"  -s: system radius ("<<r_sys<<")\n";
+            return 0;
+        default:
+            break;
+        }
+    assert(n_nb<n_ptcl);
+
+    HermiteInteraction interaction;
+    interaction.eps_sq = 0.0;
+    interaction.gravitational_constant = 1.0;
+
+    // uniform sphere with different changeover radii by mass
+    srand(1234);
+    PS::ReallocatableArray<PtclHermiteTest> ptcl;
+    ptcl.resizeNoInitialize(n_ptcl);
+    const Float m_mean = 1.0/n_ptcl;
+    for (int i=0; i<n_ptcl; i++) {
+        Float r2;
+        do {
+            for (int k=0; k<3; k++) ptcl[i].pos[k] = r_sys*(2.0*getRandom()-1.0);
+            r2 = ptcl[i].pos[0]*ptcl[i].pos[0] + ptcl[i].pos[1]*ptcl[i].pos[1] + ptcl[i].pos[2]*ptcl[i].pos[2];
+        } while (r2>r_sys*r_sys);
+        for (int k=0; k<3; k++) ptcl[i].vel[k] = 2.0*getRandom()-1.0;
+        ptcl[i].mass = m_mean*std::pow(10.0, 2.0*getRandom());
+        ptcl[i].id = i+1;
+        ptcl[i].changeover.setR(ptcl[i].mass/m_mean, 0.1*r_out, r_out);
+    }
+
+    // neighbor lists: n_nb random particles except i
+    PS::ReallocatableArray<int> nb_list;
+    nb_list.resizeNoInitialize(n_ptcl*n_nb);
+    for (int i=0; i<n_ptcl; i++) {
+        for (int k=0; k<n_nb; k++) {
+            int j;
+            do { j = rand()%n_ptcl; } while (j==i);
+            nb_list[i*n_nb+k] = j;
+        }
+    }
+
+    PS::ReallocatableArray<H4::ForceH4> force_scalar, force_simd;
+    PS::ReallocatableArray<Float> r2_scalar, r2_simd;
+    force_scalar.resizeNoInitialize(n_ptcl);
+    force_simd.resizeNoInitialize(n_ptcl);
+    r2_scalar.resizeNoInitialize(n_ptcl);
+    r2_simd.resizeNoInitialize(n_ptcl);
+    HermiteNeighborSoA nb_soa;
+
+    PS::F64 t_scalar = 0.0, t_simd = 0.0, t_load = 0.0;
+    for (int l=0; l<n_loop; l++) {
+        PS::F64 t0 = PS::GetWtime();
+        for (int i=0; i<n_ptcl; i++) {
+            auto& fi = force_scalar[i];
+            for (int k=0; k<3; k++) fi.acc0[k] = fi.acc1[k] = 0.0;
+            fi.pot = 0.0;
+            Float r2_min = NUMERIC_FLOAT_MAX;
+            for (int k=0; k<n_nb; k++) {
+                Float r2 = interaction.calcAccJerkPairSingleSingle(fi, ptcl[i], ptcl[nb_list[i*n_nb+k]]);
+                r2_min = std::min(r2_min, r2);
+            }
+            r2_scalar[i] = r2_min;
+        }
+        PS::F64 t1 = PS::GetWtime();
+        for (int i=0; i<n_ptcl; i++) {
+            PS::F64 tl0 = PS::GetWtime();
+            nb_soa.load(ptcl.getPointer(), nb_list.getPointer(i*n_nb), n_nb);
+            t_load += PS::GetWtime() - tl0;
+            auto& fi = force_simd[i];
+            for (int k=0; k<3; k++) fi.acc0[k] = fi.acc1[k] = 0.0;
+            fi.pot = 0.0;
+            r2_simd[i] = interaction.calcAccJerkSingleNeighborSoA(fi, ptcl[i], nb_soa);
+        }
+        PS::F64 t2 = PS::GetWtime();
+        t_scalar += t1-t0;
+        t_simd += t2-t1;
+    }
+
+    // compare
+    Float dacc_max = 0.0, djerk_max = 0.0, dpot_max = 0.0;
+    const Float diff_crit = 1e-10;
+    for (int i=0; i<n_ptcl; i++) {
+        Float dacc = calcRelDiff(force_scalar[i].acc0, force_simd[i].acc0);
+        Float djerk = calcRelDiff(force_scalar[i].acc1, force_simd[i].acc1);
+        Float dpot = std::abs((force_scalar[i].pot-force_simd[i].pot)/force_scalar[i].pot);
+        dacc_max = std::max(dacc_max, dacc);
+        djerk_max = std::max(djerk_max, djerk);
+        dpot_max = std::max(dpot_max, dpot);
+        Float dr2 = std::abs((r2_scalar[i]-r2_simd[i])/r2_scalar[i]);
+        if (dacc>diff_crit || djerk>diff_crit || dpot>diff_crit || dr2>diff_crit) {
+            std::cerr<<"Error: difference too large! i="<<i
+                     <<" dacc="<<dacc<<" djerk="<<djerk<<" dpot="<<dpot
+                     <<" r2_min scalar="<<r2_scalar[i]<<" simd="<<r2_simd[i]<<std::endl;
+            abort();
+        }
+    }
+
+#if defined(HERMITE_SIMD_AVX512)
+    std::cout<<"Use AVX512"<<std::endl;
+#elif defined(HERMITE_SIMD_AVX2)
+    std::cout<<"Use AVX2"<<std::endl;
+#else
+    std::cout<<"No SIMD (scalar loop over arrays)"<<std::endl;
+#endif
+    std::cout<<"Relative diff max: acc: "<<dacc_max<<" jerk: "<<djerk_max<<" pot: "<<dpot_max<<std::endl;
+    std::cout<<"Time: scalar="<<t_scalar<<" soa="<<t_simd<<" (load="<<t_load<<") ratio="<<t_scalar/t_simd
+             <<" ratio_kernel="<<t_scalar/(t_simd-t_load)<<std::endl;
+    std::cout<<"Hermite SIMD kernel test passed"<<std::endl;
+
+    return 0;
+}
@@ -168,6 +168,35 @@ public:
         return coff_one_step_[coff_one_step_.size()-1][mode_];
     }
 
+    //! write step state in binary format
+    void writeBinary(FILE* _fout) const {
+        fwrite(&ds_, sizeof(double), 1, _fout);
+        int idat[5] = {mode_, count_one_step_, count_continue_, next_is_start_flag_, next_is_kick_flag_};
+        fwrite(idat, sizeof(int), 5, _fout);
+    }
+
+    //! read step state in binary format
+    /*! The coefficient tables are regenerated from the step size
+     */
+    void readBinary(FILE* _fin) {
+        double ds;
+        int idat[5];
+        size_t rcount = fread(&ds, sizeof(double), 1, _fin);
+        rcount += fread(idat, sizeof(int), 5, _fin);
+        if (rcount<6) {
+            std::cerr<<"Error: Data reading fails! requiring data number is 6, only obtain "<<rcount<<".\n";
+            abort();
+        }
+        count_one_step_ = 0;
+        next_is_start_flag_ = true;
+        setStep(ds);
+        mode_ = idat[0];
+        count_one_step_ = idat[1];
+        count_continue_ = idat[2];
+        next_is_start_flag_ = idat[3];
+        next_is_kick_flag_ = idat[4];
+    }
+
     //! get whether next is start 
     bool isNextStart() const {
         return next_is_start_flag_;
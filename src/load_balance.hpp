@@ -0,0 +1,130 @@
+#pragma once
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+
+//! Trigger and weight of domain decomposition based on the measured cost per MPI rank
+/*! The local wallclock time of the soft force, hard integration and cluster searching is accumulated between two decompositions.
+    Waiting time in collective communications is not included.
+    Every N_STEP_CHECK tree steps, the cost per step is gathered from all ranks.
+    If the imbalance, max/mean-1 of the total cost, exceeds the threshold, or N_STEP_MAX steps passed since the last decomposition,
+    a new decomposition is done with the local cost as the sampling weight in decomposeDomainAll.
+ */
+class DomainLoadBalancer{
+public:
+    static const PS::S32 N_STEP_CHECK = 4; ///> steps between two imbalance checks
+    static const PS::S32 N_STEP_MAX = 64;  ///> maximum steps between two decompositions
+    static const PS::S32 N_COST = 4;       ///> number of cost types: soft, hard, search, total
+
+    PS::F64 imbalance_threshold; ///> decompose if max/mean-1 of the total cost per rank exceeds this value
+    PS::F64 coef_ema;            ///> smoothing coefficient of new domain boundaries (same as PS::DomainInfo)
+
+    // local cost since the last decomposition, accumulated by cost -= PS::GetWtime(); ... cost += PS::GetWtime();
+    PS::F64 cost_soft;   ///> soft force kernel time
+    PS::F64 cost_hard;   ///> hard integration time
+    PS::F64 cost_search; ///> cluster searching and group creation time
+    PS::S32 n_step;      ///> tree steps since the last decomposition
+
+    // statistics of the cost per step over ranks from the last check
+    PS::F64 cost_min[N_COST];
+    PS::F64 cost_max[N_COST];
+    PS::F64 cost_mean[N_COST];
+    PS::F64 imbalance;     ///> max/mean-1 of the total cost
+
+    // statistics since the last profile clear
+    PS::S64 n_check;       ///> number of checks
+    PS::S64 n_decompose;   ///> number of decompositions
+    PS::F64 imbalance_sum; ///> summed imbalance of checks
+    PS::F64 imbalance_max; ///> maximum imbalance of checks
+
+    DomainLoadBalancer(): imbalance_threshold(0.1), coef_ema(1.0), cost_soft(0.0), cost_hard(0.0), cost_search(0.0), n_step(0), imbalance(0.0),
+                          n_check(0), n_decompose(0), imbalance_sum(0.0), imbalance_max(0.0) {
+        for (PS::S32 k=0; k<N_COST; k++) cost_min[k] = cost_max[k] = cost_mean[k] = 0.0;
+    }
+
+    //! local total cost since the last decomposition
+    PS::F64 getCost() const {
+        return cost_soft + cost_hard + cost_search;
+    }
+
+    //! sampling weight for decomposeDomainAll
+    /*! \return local total cost per step, 1.0 if no cost is measured */
+    PS::F64 getWeight() const {
+        PS::F64 cost = getCost();
+        if (n_step==0 || cost<=0.0) return 1.0;
+        return cost/n_step;
+    }
+
+    //! gather the cost per step from all ranks and calculate the imbalance
+    /*! Collective, should be called by all ranks */
+    void calcImbalance() {
+        PS::F64 cost_loc[N_COST];
+        const PS::F64 n_step_inv = n_step>0 ? 1.0/n_step : 0.0;
+        cost_loc[0] = cost_soft*n_step_inv;
+        cost_loc[1] = cost_hard*n_step_inv;
+        cost_loc[2] = cost_search*n_step_inv;
+        cost_loc[3] = getCost()*n_step_inv;
+#ifdef PARTICLE_SIMULATOR_MPI_PARALLEL
+        const PS::S32 n_proc = PS::Comm::getNumberOfProc();
+        MPI_Allreduce(cost_loc, cost_max,  N_COST, PS::GetDataType<PS::F64>(), MPI_MAX, MPI_COMM_WORLD);
+        MPI_Allreduce(cost_loc, cost_min,  N_COST, PS::GetDataType<PS::F64>(), MPI_MIN, MPI_COMM_WORLD);
+        MPI_Allreduce(cost_loc, cost_mean, N_COST, PS::GetDataType<PS::F64>(), MPI_SUM, MPI_COMM_WORLD);
+        for (PS::S32 k=0; k<N_COST; k++) cost_mean[k] /= n_proc;
+#else
+        for (PS::S32 k=0; k<N_COST; k++) cost_min[k] = cost_max[k] = cost_mean[k] = cost_loc[k];
+#endif
+        imbalance = cost_mean[3]>0.0 ? cost_max[3]/cost_mean[3] - 1.0 : 0.0;
+        n_check++;
+        imbalance_sum += imbalance;
+        imbalance_max = std::max(imbalance_max, imbalance);
+    }
+
+    //! count one tree step and check whether a new decomposition is needed
+    /*! Collective every N_STEP_CHECK steps, should be called by all ranks at each step
+      \return true if decomposition is needed
+     */
+    bool checkDecompose() {
+        n_step++;
+        if (n_step%N_STEP_CHECK!=0) return false;
+        calcImbalance();
+        return (imbalance>imbalance_threshold || n_step>=N_STEP_MAX);
+    }
+
+    //! reset the cost after a decomposition
+    void reset() {
+        cost_soft = cost_hard = cost_search = 0.0;
+        n_step = 0;
+        n_decompose++;
+    }
+
+    //! print the imbalance statistics
+    void print(std::ostream & _fout, const PS::S32 _width=13) const {
+        _fout<<"Imbalance threshold: "<<imbalance_threshold
+             <<"  Checks: "<<n_check
+             <<"  Decompositions: "<<n_decompose
+             <<"  Imbalance (max/mean-1) last: "<<imbalance
+             <<" mean: "<<(n_check>0 ? imbalance_sum/n_check : 0.0)
+             <<" max: "<<imbalance_max
+             <<std::endl;
+        _fout<<"Cost per step of ranks from the last check:\n"
+             <<std::setw(_width)<<" "
+             <<std::setw(_width)<<"Soft"
+             <<std::setw(_width)<<"Hard"
+             <<std::setw(_width)<<"Search"
+             <<std::setw(_width)<<"Total"
+             <<std::endl;
+        const char* name[3] = {"Min", "Mean", "Max"};
+        const PS::F64* cost[3] = {cost_min, cost_mean, cost_max};
+        for (PS::S32 i=0; i<3; i++) {
+            _fout<<std::setw(_width)<<name[i];
+            for (PS::S32 k=0; k<N_COST; k++) _fout<<std::setw(_width)<<cost[i][k];
+            _fout<<std::endl;
+        }
+    }
+
+    //! clear the statistics for profile
+    void clearProfile() {
+        n_check = n_decompose = 0;
+        imbalance_sum = imbalance_max = 0.0;
+    }
+};
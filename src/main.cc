@@ -18,7 +18,8 @@ int main(int argc, char *argv[]){
 
     auto& inp = petar.input_parameters;
 
-    if (inp.fname_inp.value=="__Plummer") petar.generatePlummer();
+    if (inp.checkpoint_restart_flag) petar.readCheckpoint();
+    else if (inp.fname_inp.value=="__Plummer") petar.generatePlummer();
     //else if (inp.fname_inp.value!="__KeplerDisk") petar.generateKeplerDisk();
     else petar.readDataFromFile();
 
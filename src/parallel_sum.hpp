@@ -0,0 +1,98 @@
+#pragma once
+#include <algorithm>
+
+//! Deterministic OpenMP summation over an index range
+/*! The index range is divided into blocks of BLOCK_SIZE, independent of the number of threads.
+    Each block is summed serially by one thread into its own row of a partial-sum array,
+    then the rows are added in the block order by the calling thread.
+    Thus the result is bitwise identical for any number of OpenMP threads and any scheduling.
+ */
+class ParallelSum{
+public:
+    static const PS::S64 BLOCK_SIZE = 2048;
+
+    //! accumulated profile of all summations
+    /*! The parallel speedup is estimated by the busy time summed over threads divided by the wallclock time
+     */
+    struct Profile{
+        PS::F64 time_wall; ///> wallclock time
+        PS::F64 time_busy; ///> busy time summed over threads
+        PS::S64 n_call;    ///> number of summations
+        PS::S32 n_thread;  ///> number of threads of the last summation
+
+        Profile(): time_wall(0.0), time_busy(0.0), n_call(0), n_thread(0) {}
+
+        void clear() {
+            time_wall = time_busy = 0.0;
+            n_call = 0;
+        }
+
+        //! print the wallclock time per step and the speedup
+        void print(std::ostream & _fout, const PS::S64 _n_loop=1) const {
+            _fout<<"Threads: "<<n_thread
+                 <<"  Calls: "<<(PS::F64)n_call/_n_loop
+                 <<"  Wallclock: "<<time_wall/_n_loop
+                 <<"  Thread busy: "<<time_busy/_n_loop
+                 <<"  Speedup: "<<(time_wall>0.0 ? time_busy/time_wall : 0.0)
+                 <<std::endl;
+        }
+    };
+
+    static Profile& getProfile() {
+        static Profile profile;
+        return profile;
+    }
+
+    //! sum _n_sum values over index [0, _n)
+    /*!
+      @param[out] _sum: summation results, size of _n_sum
+      @param[in] _n_sum: number of values to sum
+      @param[in] _n: size of index range
+      @param[in] _func: function (const PS::S64 i, PS::F64* sum) adding the values of index i to sum
+     */
+    template <class Tfunc>
+    static void calc(PS::F64* _sum, const PS::S32 _n_sum, const PS::S64 _n, Tfunc _func) {
+        static thread_local PS::ReallocatableArray<PS::F64> block_sum;
+        const PS::S64 n_block = (_n+BLOCK_SIZE-1)/BLOCK_SIZE;
+        block_sum.resizeNoInitialize(n_block*_n_sum);
+        // the thread_local array is only visible to the calling thread, use its pointer inside the parallel region
+        PS::F64* block_sum_ptr = block_sum.getPointer();
+#ifdef PROFILE
+        PS::F64 time_busy = 0.0;
+        const PS::F64 t0 = PS::GetWtime();
+#pragma omp parallel reduction(+:time_busy)
+#else
+#pragma omp parallel
+#endif
+        {
+#ifdef PROFILE
+            const PS::F64 tb = PS::GetWtime();
+#endif
+#pragma omp for schedule(static) nowait
+            for (PS::S64 k=0; k<n_block; k++) {
+                PS::F64* sum_k = &block_sum_ptr[k*_n_sum];
+                for (PS::S32 j=0; j<_n_sum; j++) sum_k[j] = 0.0;
+                const PS::S64 i_end = std::min((k+1)*BLOCK_SIZE, _n);
+                for (PS::S64 i=k*BLOCK_SIZE; i<i_end; i++) _func(i, sum_k);
+            }
+#ifdef PROFILE
+            time_busy += PS::GetWtime() - tb;
+#endif
+        }
+
+        // combine in fixed order
+        for (PS::S32 j=0; j<_n_sum; j++) _sum[j] = 0.0;
+        for (PS::S64 k=0; k<n_block; k++) {
+            const PS::F64* sum_k = &block_sum_ptr[k*_n_sum];
+            for (PS::S32 j=0; j<_n_sum; j++) _sum[j] += sum_k[j];
+        }
+
+#ifdef PROFILE
+        Profile& profile = getProfile();
+        profile.time_wall += PS::GetWtime() - t0;
+        profile.time_busy += time_busy;
+        profile.n_call++;
+        profile.n_thread = PS::Comm::getNumberOfThread();
+#endif
+    }
+};
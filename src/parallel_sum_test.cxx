@@ -0,0 +1,135 @@
+#include <iostream>
+#include <cstdio>
+#include <iomanip>
+#include <cstdlib>
+#include <cassert>
+#include <cmath>
+#include <getopt.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include <particle_simulator.hpp>
+#include "parallel_sum.hpp"
+
+//! uniform random number in [0,1)
+PS::F64 getRandom() {
+    return (PS::F64)rand()/((PS::F64)RAND_MAX+1.0);
+}
+
+//! simple particle for the energy and angular momemtum summation
+struct PtclSumTest{
+    PS::F64 mass;
+    PS::F64vec pos;
+    PS::F64vec vel;
+    PS::F64 pot;
+};
+
+//! kinetic, potential energy and angular momemtum summed by ParallelSum
+void calcSum(PS::F64* _sum, const PtclSumTest* _ptcl, const PS::S64 _n) {
+    ParallelSum::calc(_sum, 5, _n, [&](const PS::S64 i, PS::F64* _sum_i) {
+        const PtclSumTest& pi = _ptcl[i];
+        _sum_i[0] += 0.5*pi.mass*pi.vel*pi.vel;
+        _sum_i[1] += 0.5*pi.mass*pi.pot;
+        PS::F64vec Li = pi.pos ^ (pi.mass*pi.vel);
+        _sum_i[2] += Li.x;
+        _sum_i[3] += Li.y;
+        _sum_i[4] += Li.z;
+    });
+}
+
+int main(int argc, char **argv){
+    PS::S64 n_ptcl = 1000000; // number of particles
+    PS::S32 n_loop = 20;      // number of repeats for timing
+
+    int copt;
+    while ((copt = getopt(argc, argv, "n:l:h")) != -1)
+        switch (copt) {
+        case 'n':
+            n_ptcl = atol(optarg);
+            break;
+        case 'l':
+            n_loop = atoi(optarg);
+            break;
+        case 'h':
+            std::cout<<"Check that ParallelSum gives identical results for all numbers of OpenMP threads and measure the speedup\n"
+                     <<"Options: \n"
+                     <<"  -n: number of particles ("<<n_ptcl<<")\n"
+                     <<"  -l: number of repeats for timing ("<<n_loop<<")\n";
+            return 0;
+        default:
+            break;
+        }
+
+    // random particles with a wide range of magnitudes to amplify roundoff differences
+    srand(1234);
+    PS::ReallocatableArray<PtclSumTest> ptcl;
+    ptcl.resizeNoInitialize(n_ptcl);
+    for (PS::S64 i=0; i<n_ptcl; i++) {
+        ptcl[i].mass = std::pow(10.0, 3.0*getRandom())/n_ptcl;
+        ptcl[i].pos = PS::F64vec(getRandom()-0.5, getRandom()-0.5, getRandom()-0.5)*std::pow(10.0, 4.0*getRandom());
+        ptcl[i].vel = PS::F64vec(getRandom()-0.5, getRandom()-0.5, getRandom()-0.5);
+        ptcl[i].pot = -std::pow(10.0, 4.0*getRandom());
+    }
+
+    // serial reference with one long summation
+    PS::F64 sum_serial[5] = {0.0, 0.0, 0.0, 0.0, 0.0};
+    for (PS::S64 i=0; i<n_ptcl; i++) {
+        sum_serial[0] += 0.5*ptcl[i].mass*ptcl[i].vel*ptcl[i].vel;
+        sum_serial[1] += 0.5*ptcl[i].mass*ptcl[i].pot;
+        PS::F64vec Li = ptcl[i].pos ^ (ptcl[i].mass*ptcl[i].vel);
+        sum_serial[2] += Li.x;
+        sum_serial[3] += Li.y;
+        sum_serial[4] += Li.z;
+    }
+
+#ifdef _OPENMP
+    const PS::S32 n_thread_max = omp_get_max_threads();
+#else
+    const PS::S32 n_thread_max = 1;
+#endif
+    std::cout<<std::setw(10)<<"n_thread"
+             <<std::setw(14)<<"time"
+             <<std::setw(12)<<"speedup"
+             <<std::endl;
+
+    PS::F64 sum_ref[5];
+    PS::F64 time_one = 0.0;
+    for (PS::S32 n_thread=1; n_thread<=n_thread_max; n_thread++) {
+#ifdef _OPENMP
+        omp_set_num_threads(n_thread);
+#endif
+        PS::F64 sum[5];
+        PS::F64 t0 = PS::GetWtime();
+        for (PS::S32 k=0; k<n_loop; k++) calcSum(sum, ptcl.getPointer(), n_ptcl);
+        PS::F64 time = (PS::GetWtime() - t0)/n_loop;
+
+        if (n_thread==1) {
+            for (PS::S32 j=0; j<5; j++) {
+                sum_ref[j] = sum[j];
+                // only the summation order differs from the serial reference
+                if (std::abs(sum[j]-sum_serial[j])>1e-10*std::abs(sum_serial[j])) {
+                    std::cerr<<"Error: sum "<<j<<" differs from the serial reference! parallel: "<<sum[j]<<" serial: "<<sum_serial[j]<<std::endl;
+                    abort();
+                }
+            }
+            time_one = time;
+        }
+        else {
+            for (PS::S32 j=0; j<5; j++) {
+                if (sum[j]!=sum_ref[j]) {
+                    std::cerr<<std::setprecision(17)<<"Error: sum "<<j<<" depends on the number of threads! n_thread="<<n_thread
+                             <<" sum: "<<sum[j]<<" one thread: "<<sum_ref[j]<<std::endl;
+                    abort();
+                }
+            }
+        }
+        std::cout<<std::setw(10)<<n_thread
+                 <<std::setw(14)<<time
+                 <<std::setw(12)<<time_one/time
+                 <<std::endl;
+    }
+
+    std::cout<<"Parallel sum test passed"<<std::endl;
+
+    return 0;
+}
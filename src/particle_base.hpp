@@ -1,4 +1,5 @@
 #pragma once
+#include <cstring>
 #ifdef BSE_BASE
 #include "bse_interface.h"
 #endif
@@ -180,6 +181,19 @@ public:
     }
 
 
+    //! write class data to a memory buffer with the same layout as writeBinary
+    /*! @param[in,out] _buf: buffer pointer, shifted to the end of written data after return
+     */
+    void writeBinaryToBuffer(char*& _buf) const{
+        std::memcpy(_buf, &(this->mass), sizeof(ParticleBase));
+        _buf += sizeof(ParticleBase);
+    }
+
+    //! get the data size in bytes of writeBinary
+    static size_t getBinarySize() {
+        return sizeof(ParticleBase);
+    }
+
     //! read class data with BINARY format
     /*! @param[in] _fin: file IO for read
      */
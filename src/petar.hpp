@@ -63,20 +63,41 @@ int MPI_Irecv(void* buffer, int count, MPI_Datatype datatype, int dest, int tag,
 #include"hard_assert.hpp"
 #include"soft_ptcl.hpp"
 #include"soft_force.hpp"
+#ifdef TIDAL_TENSOR_TREE
+#if (defined USE_GPU) || (defined USE_FUGAKU)
+#error "TIDAL_TENSOR_TREE is not supported by the GPU and Fugaku force kernels"
+#endif
+#ifndef SOFT_PERT
+#error "TIDAL_TENSOR_TREE requires SOFT_PERT"
+#endif
+#endif
 #ifdef USE_GPU
 #include"force_gpu_cuda.hpp"
 #endif
 #ifdef USE_FUGAKU
 #include "force_fugaku.hpp"
+#ifdef SAVE_NEIGHBOR_LIST_IN_FORCE_KERNEL
+#error "SAVE_NEIGHBOR_LIST_IN_FORCE_KERNEL is not supported by the Fugaku neighbor search kernel"
+#endif
 #endif
 #include"energy.hpp"
 #include"hard.hpp"
 #include"io.hpp"
+#include"async_writer.hpp"
+#include"snapshot_columnar.hpp"
 #include"status.hpp"
 #include"particle_distribution_generator.hpp"
 #include"domain.hpp"
+#include"load_balance.hpp"
 #include"cluster_list.hpp"
 #include"kickdriftstep.hpp"
+#include"checkpoint.hpp"
+#ifdef SOFT_RUNG
+#ifdef KDKDK_4TH
+#error "SOFT_RUNG is not supported by the KDKDK_4TH integrator"
+#endif
+#include"soft_rung.hpp"
+#endif
 #ifdef PROFILE
 #include"profile.hpp"
 #endif
@@ -97,6 +118,7 @@ public:
     IOParams<PS::S64> n_group_limit;
     IOParams<PS::S64> n_interrupt_limit;
     IOParams<PS::S64> n_smp_ave;
+    IOParams<PS::F64> domain_imbalance;
 #ifdef ORBIT_SAMPLING
     IOParams<PS::S64> n_split;
 #endif
@@ -131,6 +153,14 @@ public:
     IOParams<PS::F64> sd_factor;
     IOParams<PS::S64> data_format;
     IOParams<PS::S64> write_style;
+    IOParams<PS::S64> write_mpiio;
+    IOParams<PS::S64> write_async;
+    IOParams<PS::S64> write_columnar;
+    IOParams<PS::F64> checkpoint_walltime;
+#ifdef SOFT_RUNG
+    IOParams<PS::S64> soft_rung_max;
+    IOParams<PS::F64> soft_rung_eta;
+#endif
 #ifdef STELLAR_EVOLUTION
     IOParams<PS::S64> stellar_evolution_option;
 #endif
@@ -147,6 +177,7 @@ public:
     bool print_flag; 
     bool update_changeover_flag;
     bool update_rsearch_flag;
+    bool checkpoint_restart_flag;
 
     IOParamsPeTar(): input_par_store(), 
                      ratio_r_cut      (input_par_store, 0.1,  "r-ratio", "r_in / r_out"),
@@ -159,6 +190,7 @@ public:
 #endif
                      n_interrupt_limit(input_par_store, 128,  "number-interrupt-limit", "Interrupted hard integrator limit"),
                      n_smp_ave        (input_par_store, 100,  "number-sample-average", "Average target number of sample particles per process"),
+                     domain_imbalance (input_par_store, 0.1,  "domain-imbalance", "Domain decomposition is done when the imbalance of the measured soft+hard+cluster-search time per MPI rank, max/mean-1, exceeds this value (checked every 4 steps, at least every 64 steps); the time is the sampling weight of ranks"),
 #ifdef ORBIT_SAMPLING
                      n_split          (input_par_store, 4,    "number-split", "Number of binary sample points for tree perturbation force"),
 #endif
@@ -193,6 +225,14 @@ public:
                      sd_factor    (input_par_store, 1e-4, "slowdown-factor", "Slowdown perturbation criterion"),
                      data_format  (input_par_store, 1,    "i", "Data read(r)/write(w) format BINARY(B)/ASCII(A): r-B/w-A (3), r-A/w-B (2), rw-A (1), rw-B (0)"),
                      write_style  (input_par_store, 1,    "w", "File Writing style: 0, no output; 1. write snapshots, status and profile separately; 2. write snapshot and status in one line per step (no MPI support); 3. write only status and profile"),
+                     write_mpiio  (input_par_store, 0,    "write-mpiio", "Write BINARY snapshots by: 0. gathering to rank 0 (FDPS); 1. collective MPI-IO, each rank writes its packed particle data at the offset of the particle number prefix sum (same file layout)"),
+                     write_columnar(input_par_store, 0,   "write-columnar", "Write snapshots in the columnar BINARY format (self-describing field table, each column is 64-byte aligned for memory mapping, read by petar.format.transfer and ColumnSnapshotReader): 0. off; 1. on (suppress -i for writing)"),
+                     write_async  (input_par_store, 0,    "write-async", "Write BINARY snapshots by a background thread on each rank: 0. off; >0: maximum number of pending snapshots (2: double buffering); the integration waits if the limit is reached"),
+                     checkpoint_walltime(input_par_store, 0.0, "checkpoint-walltime", "Wall-clock time interval in seconds to write the checkpoint of the full integration state, [data filename prefix].chk.r[MPI rank], at the end of a tree step without interrupted clusters (the previous checkpoint is replaced): 0. off"),
+#ifdef SOFT_RUNG
+                     soft_rung_max(input_par_store, 3,    "soft-rung-max", "Maximum rung of block soft steps for single particles, the soft step is tree step * 2^rung and is limited by the output interval: 0. off (all particles use the tree step)"),
+                     soft_rung_eta(input_par_store, 0.05, "soft-rung-eta", "Block soft step coefficient: step = eta * |acc| / |d acc/dt|"),
+#endif
 #ifdef STELLAR_EVOLUTION
 #ifdef BSE_BASE
                      stellar_evolution_option  (input_par_store, 1, "stellar-evolution", "stellar evolution of stars in Hermite+SDAR: 0: off; >=1: using SSE/BSE based codes; ==2: switch on dynamical tide and hyperbolic gravitational wave radiation"),
@@ -211,7 +251,7 @@ public:
                      fname_snp(input_par_store, "data", "f", "The prefix of filenames for output data: [prefix].**"),
                      fname_par(input_par_store, "input.par", "p", "Input parameter file (this option should be used first before any other options)"),
                      fname_inp(input_par_store, "__NONE__", "snap-filename", "Input data file", NULL, false),
-                     print_flag(false), update_changeover_flag(false), update_rsearch_flag(false) {}
+                     print_flag(false), update_changeover_flag(false), update_rsearch_flag(false), checkpoint_restart_flag(false) {}
 
     
     //! reading parameters from GNU option API
@@ -257,6 +297,16 @@ public:
 #ifdef ADJUST_GROUP_PRINT
             {adjust_group_write_option.key,   required_argument, &petar_flag, 24},
 #endif            
+            {write_mpiio.key,          required_argument, &petar_flag, 25},
+            {write_async.key,          required_argument, &petar_flag, 26},
+            {write_columnar.key,       required_argument, &petar_flag, 27},
+#ifdef SOFT_RUNG
+            {soft_rung_max.key,        required_argument, &petar_flag, 28},
+            {soft_rung_eta.key,        required_argument, &petar_flag, 29},
+#endif
+            {domain_imbalance.key,     required_argument, &petar_flag, 31},
+            {checkpoint_walltime.key,  required_argument, &petar_flag, 32},
+            {"checkpoint-restart",     no_argument,       &petar_flag, 33},
             {"help",                  no_argument, 0, 'h'},        
             {0,0,0,0}
         };
@@ -421,6 +471,55 @@ public:
                     opt_used += 2;
                     break;
 #endif
+                case 25:
+                    write_mpiio.value = atoi(optarg);
+                    if(print_flag) write_mpiio.print(std::cout);
+                    opt_used += 2;
+                    assert(write_mpiio.value==0||write_mpiio.value==1);
+                    break;
+                case 26:
+                    write_async.value = atoi(optarg);
+                    if(print_flag) write_async.print(std::cout);
+                    opt_used += 2;
+                    assert(write_async.value>=0);
+                    break;
+                case 27:
+                    write_columnar.value = atoi(optarg);
+                    if(print_flag) write_columnar.print(std::cout);
+                    opt_used += 2;
+                    assert(write_columnar.value==0||write_columnar.value==1);
+                    break;
+#ifdef SOFT_RUNG
+                case 28:
+                    soft_rung_max.value = atoi(optarg);
+                    if(print_flag) soft_rung_max.print(std::cout);
+                    opt_used += 2;
+                    assert(soft_rung_max.value>=0);
+                    break;
+                case 29:
+                    soft_rung_eta.value = atof(optarg);
+                    if(print_flag) soft_rung_eta.print(std::cout);
+                    opt_used += 2;
+                    assert(soft_rung_eta.value>0.0);
+                    break;
+#endif
+                case 31:
+                    domain_imbalance.value = atof(optarg);
+                    if(print_flag) domain_imbalance.print(std::cout);
+                    opt_used += 2;
+                    assert(domain_imbalance.value>=0.0);
+                    break;
+                case 32:
+                    checkpoint_walltime.value = atof(optarg);
+                    if(print_flag) checkpoint_walltime.print(std::cout);
+                    opt_used += 2;
+                    assert(checkpoint_walltime.value>=0.0);
+                    break;
+                case 33:
+                    checkpoint_restart_flag = true;
+                    if(print_flag) std::cout<<"Restart from checkpoint files\n";
+                    opt_used ++;
+                    break;
                 default:
                     break;
                 }
@@ -543,6 +642,7 @@ public:
                     input_par_store.printHelp(std::cout, 2, 10, 23);
                     std::cout<<"        --disable-print-info:  "<<"Do not print information"<<std::endl;
                     std::cout<<"        --disable-write-info:  "<<"Do not write information"<<std::endl;
+                    std::cout<<"        --checkpoint-restart:  "<<"Restart from the checkpoint files [data filename prefix].chk.r[MPI rank] instead of the data file; use the same executable, MPI process number and input parameter file (-p) of the run writing the checkpoint"<<std::endl;
                     std::cout<<"  -h(--help):               print help"<<std::endl;
                     std::cout<<"*** PS: r_in : transit function inner boundary radius\n"
                              <<"        r_out: transit function outer boundary radius\n"
@@ -597,6 +697,8 @@ public:
         assert(n_interrupt_limit.value>0);
         assert(n_leaf_limit.value>0);
         assert(n_smp_ave.value>0.0);
+        assert(domain_imbalance.value>=0.0);
+        assert(checkpoint_walltime.value>=0.0);
         assert(theta.value>=0.0);
         assert(eta.value>0.0);
         return true;
@@ -642,6 +744,15 @@ public:
     Status stat;
     std::ofstream fstatus;
     PS::F64 time_kick;
+    struct StatusSum{ // batched global summations of status
+        ReductionSumBuffer buf;
+        PS::S32 index_energy; // index of energy and angular momemtum in buf
+        PS::S32 index_hard;   // index of hard energy change in buf
+        PS::S32 index_cm;     // index of center of system in buf
+        bool initial_flag;    // whether it is the initial status
+
+        StatusSum(): buf(), index_energy(-1), index_hard(-1), index_cm(-1), initial_flag(false) {}
+    } status_sum;
 
     // escaper
     Escaper escaper;
@@ -650,13 +761,17 @@ public:
     // file system
     FileHeader file_header;
     SystemSoft system_soft;
+    PS::ReallocatableArray<char> snapshot_buffer; // packed particle data for parallel writing
+    AsyncSnapshotWriter async_writer; // background thread for writing snapshots
+    CheckpointHeader checkpoint_header; // header of the checkpoint read for restarting
+    PS::F64 checkpoint_wtime_ref; // wall-clock time of the last checkpoint
 
     // particle index map
     std::map<PS::S64, PS::S32> id_adr_map;
 
     // domain
-    PS::S64 n_loop; // count for domain decomposition
-    PS::F64 domain_decompose_weight;
+    PS::S64 n_loop; // count of tree steps
+    DomainLoadBalancer load_balancer; // measured cost for domain decomposition
     PS::DomainInfo dinfo;
     PS::F64ort * pos_domain;
 #ifdef FDPS_COMM
@@ -665,6 +780,9 @@ public:
 
     // tree time step manager
     KickDriftStep dt_manager;
+#ifdef SOFT_RUNG
+    SoftRungManager soft_rung_manager; // block-rung soft steps of single particles
+#endif
 
     // tree
     TreeNB tree_nb;
@@ -699,6 +817,7 @@ public:
     bool read_data_flag;
     bool initial_parameters_flag;
     bool initial_step_flag;
+    bool read_checkpoint_flag;
 
     // MPI 
     PS::S32 my_rank;
@@ -720,11 +839,14 @@ public:
         // profile
         dn_loop(0), profile(), n_count(), n_count_sum(), tree_soft_profile(), fprofile(), 
 #endif
-        stat(), fstatus(), time_kick(0.0),
+        stat(), fstatus(), time_kick(0.0), status_sum(),
         escaper(), fesc(),
-        file_header(), system_soft(), id_adr_map(),
-        n_loop(0), domain_decompose_weight(1.0), dinfo(), pos_domain(NULL), 
+        file_header(), system_soft(), snapshot_buffer(), async_writer(), checkpoint_header(), checkpoint_wtime_ref(0.0), id_adr_map(),
+        n_loop(0), load_balancer(), dinfo(), pos_domain(NULL), 
         dt_manager(),
+#ifdef SOFT_RUNG
+        soft_rung_manager(),
+#endif
         tree_nb(), tree_soft(), 
 #ifdef GALPY
         galpy_manager(),
@@ -736,7 +858,7 @@ public:
         n_interrupt_glb(0),
         mass_modify_list(), remove_list(), remove_id_record(),
         search_cluster(),
-        read_parameters_flag(false), read_data_flag(false), initial_parameters_flag(false), initial_step_flag(false) {
+        read_parameters_flag(false), read_data_flag(false), initial_parameters_flag(false), initial_step_flag(false), read_checkpoint_flag(false) {
         assert(initial_fdps_flag);
         my_rank = PS::Comm::getRank();
         n_proc = PS::Comm::getNumberOfProc();
@@ -762,6 +884,9 @@ public:
         tree_nb.clearNumberOfInteraction();
         tree_nb.clearTimeProfile();
 #endif
+#ifdef SAVE_NEIGHBOR_LIST_IN_FORCE_KERNEL
+        NeighborListCSR::clear();
+#endif
 #ifdef USE_SIMD
         tree_nb.calcForceAllAndWriteBack(SearchNeighborEpEpSimd(), system_soft, dinfo);
 #elif USE_FUGAKU
@@ -785,11 +910,13 @@ public:
         profile.search_cluster.start();
 #endif
         // >2.1 search clusters ----------------------------------------
+        load_balancer.cost_search -= PS::GetWtime();
         search_cluster.searchNeighborOMP<SystemSoft, TreeNB, EPJSoft>
             (system_soft, tree_nb, pos_domain, 1.0, input_parameters.search_peri_factor.value);
 
         search_cluster.searchClusterLocal();
         search_cluster.setIdClusterLocal();
+        load_balancer.cost_search += PS::GetWtime();
 
         // >2.2 Send/receive connect cluster
 #ifdef PARTICLE_SIMULATOR_MPI_PARALLEL        
@@ -815,6 +942,7 @@ public:
 
         // >2.3 Find ARC groups and create artificial particles
         // Set local ptcl_hard for isolated  clusters
+        load_balancer.cost_search -= PS::GetWtime();
         system_hard_isolated.setPtclForIsolatedMultiClusterOMP(system_soft, search_cluster.adr_sys_multi_cluster_isolated_, search_cluster.n_ptcl_in_multi_cluster_isolated_);
 
 //#ifdef CLUSTER_DEBUG
@@ -823,6 +951,7 @@ public:
 
         // Find groups and add artificial particles to global particle system
         system_hard_isolated.findGroupsAndCreateArtificialParticlesOMP<SystemSoft, FPSoft>(system_soft, _dt_tree);
+        load_balancer.cost_search += PS::GetWtime();
 
 //#ifdef CLUSTER_DEBUG
 //        not correct check, isolated clusters are not reset above
@@ -873,8 +1002,8 @@ public:
         profile.tree_soft.start();
 
         tree_soft.clearNumberOfInteraction();
-        tree_soft.clearTimeProfile();
 #endif
+        tree_soft.clearTimeProfile();
 
 #ifdef USE_GPU
         const PS::S32 n_walk_limit = 200;
@@ -930,6 +1059,8 @@ public:
                                            system_soft,
                                            dinfo);
 #endif // end else
+        // force kernel time for load balance
+        load_balancer.cost_soft += tree_soft.getTimeProfile().calc_force;
 
 #ifdef PROFILE
         n_count.ep_ep_interact     += tree_soft.getNumberOfInteractionEPEPLocal();
@@ -938,7 +1069,6 @@ public:
         n_count_sum.ep_sp_interact += tree_soft.getNumberOfInteractionEPSPGlobal(); 
 
         tree_soft_profile += tree_soft.getTimeProfile();
-        domain_decompose_weight = tree_soft_profile.calc_force;
 
         //profile.tree_soft.barrier();
         //PS::Comm::barrier();
@@ -1035,29 +1165,44 @@ public:
         galpy_manager.updatePotential(stat.time, input_parameters.print_flag);
 
         PS::S64 n_loc_all = system_soft.getNumberOfParticleLocal();
-#pragma omp parallel for
-        for (int i=0; i<n_loc_all; i++) {
-            auto& pi = system_soft[i];
-            double acc[3], pot;
+        // evaluate in batches with structure-of-arrays positions
+#pragma omp parallel for schedule(static)
+        for (PS::S64 i0=0; i0<n_loc_all; i0+=GALPY_BATCH_SIZE) {
+            const int nb = std::min((PS::S64)GALPY_BATCH_SIZE, n_loc_all-i0);
+            double pos_g[3][GALPY_BATCH_SIZE], pos_l[3][GALPY_BATCH_SIZE];
+            double acc[3][GALPY_BATCH_SIZE], pot[GALPY_BATCH_SIZE];
+            for (int j=0; j<nb; j++) {
+                auto& pi = system_soft[i0+j];
+                for (int k=0; k<3; k++) {
 #ifdef RECORD_CM_IN_HEADER
-            PS::F64vec pos_correct=pi.pos + stat.pcm.pos;
-            galpy_manager.calcAccPot(acc, pot, stat.time, &pos_correct[0], &pi.pos[0]);
+                    pos_g[k][j] = pi.pos[k] + stat.pcm.pos[k];
+                    pos_l[k][j] = pi.pos[k];
 #else
-            PS::F64vec pos_center=pi.pos - stat.pcm.pos;
-            galpy_manager.calcAccPot(acc, pot, stat.time, &pi.pos[0], &pos_center[0]);
-#endif
-            assert(!std::isinf(acc[0]));
-            assert(!std::isnan(acc[0]));
-            assert(!std::isinf(pot));
-            assert(!std::isnan(pot));
-            pi.acc[0] += acc[0]; 
-            pi.acc[1] += acc[1]; 
-            pi.acc[2] += acc[2]; 
-            pi.pot_tot += pot;
-            pi.pot_soft += pot;
+                    pos_g[k][j] = pi.pos[k];
+                    pos_l[k][j] = pi.pos[k] - stat.pcm.pos[k];
+#endif
+                }
+            }
+            double* acc_ptr[3] = {acc[0], acc[1], acc[2]};
+            const double* pos_g_ptr[3] = {pos_g[0], pos_g[1], pos_g[2]};
+            const double* pos_l_ptr[3] = {pos_l[0], pos_l[1], pos_l[2]};
+            galpy_manager.calcAccPotBatch(acc_ptr, pot, stat.time, nb, pos_g_ptr, pos_l_ptr);
+
+            for (int j=0; j<nb; j++) {
+                auto& pi = system_soft[i0+j];
+                assert(!std::isinf(acc[0][j]));
+                assert(!std::isnan(acc[0][j]));
+                assert(!std::isinf(pot[j]));
+                assert(!std::isnan(pot[j]));
+                pi.acc[0] += acc[0][j]; 
+                pi.acc[1] += acc[1][j]; 
+                pi.acc[2] += acc[2][j]; 
+                pi.pot_tot += pot[j];
+                pi.pot_soft += pot[j];
 #ifdef EXTERNAL_POT_IN_PTCL
-            pi.pot_ext = pot;
+                pi.pot_ext = pot[j];
 #endif
+            }
         }
 #endif //GALPY
         
@@ -1114,8 +1259,8 @@ public:
 #ifdef PROFILE
         profile.tree_soft.start();
         tree_soft.clearNumberOfInteraction();
-        tree_soft.clearTimeProfile();
 #endif
+        tree_soft.clearTimeProfile();
         // correction calculation
         //tree_soft.setParticaleLocalTree(system_soft, false);
         
@@ -1127,6 +1272,7 @@ public:
 #endif
                                            system_soft,
                                            dinfo);
+        load_balancer.cost_soft += tree_soft.getTimeProfile().calc_force;
 
 #ifdef PROFILE
         n_count.ep_ep_interact     += tree_soft.getNumberOfInteractionEPEPLocal();
@@ -1135,7 +1281,6 @@ public:
         n_count_sum.ep_sp_interact += tree_soft.getNumberOfInteractionEPSPGlobal(); 
 
         tree_soft_profile += tree_soft.getTimeProfile();
-        domain_decompose_weight += tree_soft_profile.calc_force;
 
         profile.tree_soft.barrier();
         PS::Comm::barrier();
@@ -1335,6 +1480,15 @@ public:
 
         /// Member mass are recovered
         // single and reset particle type to single (due to binary disruption)
+#ifdef SOFT_RUNG
+        if (input_parameters.soft_rung_max.value>0) {
+            // In the KDK mode, the start flag is set after the ending kick, and the starting kick is half of the tree step
+            const bool end_flag = dt_manager.isNextStart();
+            const bool start_flag = !end_flag && _dt_kick!=dt_manager.getStep();
+            soft_rung_manager.kick(system_soft, stat.n_real_loc, search_cluster.getAdrSysOneCluster(), stat.time, dt_manager.getStep(), !start_flag, !end_flag);
+        }
+        else
+#endif
         kickOne(system_soft, _dt_kick, search_cluster.getAdrSysOneCluster());
         // isolated
         kickClusterAndRecoverGroupMemberMass(system_soft, system_hard_isolated.getPtcl(), _dt_kick);
@@ -1401,15 +1555,35 @@ public:
         //system_hard_connected.setTimeOrigin(stat.time);
         ////// set time
 
+#ifdef DOMAIN_HARD_COST
+        // reset the hard cost, members of clusters are updated in driveForMultiClusterOMP
+#pragma omp parallel for
+        for (PS::S32 i=0; i<stat.n_real_loc; i++) system_soft[i].cost_hard = 0.0;
+#endif
+
 #ifdef PROFILE
         profile.hard_single.start();
 #endif
         ////// integrater one cluster
+        load_balancer.cost_hard -= PS::GetWtime();
         system_hard_one_cluster.initializeForOneCluster(search_cluster.getAdrSysOneCluster().size());
         system_hard_one_cluster.setPtclForOneClusterOMP(system_soft, search_cluster.getAdrSysOneCluster());
         system_hard_one_cluster.driveForOneClusterOMP(_dt_drift);
+#ifdef STELLAR_EVOLUTION
+#ifdef PROFILE
+        profile.hard_sse.start();
+#endif
+        // evolve single stars with interrupt time in this step in one batch
+        PS::S32 n_sse_single = system_hard_one_cluster.evolveStarForOneClusterOMP(_dt_drift);
+#ifdef PROFILE
+        n_count.hard_sse += n_sse_single;
+        n_count_sum.hard_sse += PS::Comm::getSum(n_sse_single);
+        profile.hard_sse.end();
+#endif
+#endif
         //system_hard_one_cluster.writeBackPtclForOneClusterOMP(system_soft, search_cluster.getAdrSysOneCluster());
         system_hard_one_cluster.writeBackPtclForOneClusterOMP(system_soft, mass_modify_list);
+        load_balancer.cost_hard += PS::GetWtime();
         ////// integrater one cluster
 #ifdef PROFILE
         profile.hard_single.barrier();
@@ -1425,10 +1599,12 @@ public:
         // reset slowdown energy correction
         system_hard_isolated.energy.resetEnergyCorrection();
         // integrate multi cluster A
+        load_balancer.cost_hard -= PS::GetWtime();
         system_hard_isolated.driveForMultiClusterOMP(_dt_drift, &(system_soft[0]));
         //system_hard_isolated.writeBackPtclForMultiCluster(system_soft, search_cluster.adr_sys_multi_cluster_isolated_,remove_list);
         PS::S32 n_interrupt_isolated = system_hard_isolated.getNumberOfInterruptClusters();
         if(n_interrupt_isolated==0) system_hard_isolated.writeBackPtclForMultiCluster(system_soft, mass_modify_list);
+        load_balancer.cost_hard += PS::GetWtime();
         // integrate multi cluster A
 
 #ifdef PROFILE
@@ -1456,7 +1632,9 @@ public:
         // reset slowdown energy correction
         system_hard_connected.energy.resetEnergyCorrection();
         // integrate multi cluster B
+        load_balancer.cost_hard -= PS::GetWtime();
         system_hard_connected.driveForMultiClusterOMP(_dt_drift, &(system_soft[0]));
+        load_balancer.cost_hard += PS::GetWtime();
         PS::S32 n_interrupt_connected = system_hard_connected.getNumberOfInterruptClusters();
 
 #ifdef PROFILE
@@ -1507,7 +1685,9 @@ public:
         // isolated clusters
         PS::S32 n_interrupt_isolated = 0;
         if (system_hard_isolated.getNumberOfInterruptClusters()>0) {
+            load_balancer.cost_hard -= PS::GetWtime();
             system_hard_isolated.finishIntegrateInterruptClustersOMP();
+            load_balancer.cost_hard += PS::GetWtime();
             n_interrupt_isolated = system_hard_isolated.getNumberOfInterruptClusters();
             if(n_interrupt_isolated==0) system_hard_isolated.writeBackPtclForMultiCluster(system_soft, mass_modify_list);
         }
@@ -1536,7 +1716,9 @@ public:
         // connected clusters
         PS::S32 n_interrupt_connected = 0;
         if (system_hard_connected.getNumberOfInterruptClusters()>0) {
+            load_balancer.cost_hard -= PS::GetWtime();
             system_hard_connected.finishIntegrateInterruptClustersOMP();
+            load_balancer.cost_hard += PS::GetWtime();
             n_interrupt_connected = system_hard_connected.getNumberOfInterruptClusters();
         }
 
@@ -1706,8 +1888,9 @@ public:
     }
 
     //! domain decomposition
-    /*!
-      @param[in] _enforce: do domain decompose without check n_loop (false)
+    /*! Decompose when the measured cost imbalance of ranks exceeds the threshold, see DomainLoadBalancer.
+        The measured cost per step is the sampling weight of this rank.
+      @param[in] _enforce: do domain decompose without checking the imbalance (false)
      */
     void domainDecompose(const bool _enforce=false) {
 #ifdef PROFILE
@@ -1715,9 +1898,16 @@ public:
         profile.domain.start();
 #endif
         // Domain decomposition, parrticle exchange and force calculation
-        if(n_loop % 16 == 0 || _enforce) {
-            dinfo.decomposeDomainAll(system_soft,domain_decompose_weight);
-            //std::cout<<"rank: "<<my_rank<<" weight: "<<domain_decompose_weight<<std::endl;
+        if(load_balancer.checkDecompose() || _enforce) {
+#ifdef DOMAIN_HARD_COST
+            // sample particles weighted by the measured cost, the hard cost is attributed to cluster members
+            const PS::F64 cost_rank = load_balancer.n_step>0 ? load_balancer.getCost()/load_balancer.n_step : 0.0;
+            DecomposeDomainByCost(dinfo, system_soft, cost_rank, input_parameters.n_smp_ave.value, _enforce ? 1.0 : load_balancer.coef_ema);
+#else
+            dinfo.decomposeDomainAll(system_soft,load_balancer.getWeight());
+#endif
+            //std::cout<<"rank: "<<my_rank<<" weight: "<<load_balancer.getWeight()<<std::endl;
+            load_balancer.reset();
         }
 #ifdef PROFILE
         profile.domain.barrier();
@@ -1754,90 +1944,106 @@ public:
         return dt_mod_flag;
     }
 
-    //! update system status
-    void updateStatus(const bool _initial_flag) {
+    //! start updating system status
+    /*! Calculate the local energy, angular momemtum and center of system, and issue one non-blocking global summation for all of them (including hard energy changes).
+        finishUpdateStatus should be called before the status is used.
+      @param[in] _initial_flag: if true, set the energy and angular momemtum references
+     */
+    void startUpdateStatus(const bool _initial_flag) {
 #ifdef PROFILE
         profile.status.start();
 #endif
+        status_sum.buf.clear();
+        status_sum.initial_flag = _initial_flag;
+        status_sum.index_hard = status_sum.index_cm = -1;
 //        stat.shiftToOriginFrame(&system_soft[0], stat.n_real_loc);
         if (_initial_flag) {
             // calculate initial energy
             stat.energy.clear();
-#ifdef RECORD_CM_IN_HEADER
-            stat.energy.calc(&system_soft[0], stat.n_real_loc, true, &(stat.pcm.pos), &(stat.pcm.vel));
-#else
-            stat.energy.calc(&system_soft[0], stat.n_real_loc, true);
-#endif
-#ifdef PARTICLE_SIMULATOR_MPI_PARALLEL
-            stat.energy.getSumMultiNodes(true);
-#endif
-#ifdef HARD_CHECK_ENERGY
-            stat.energy.ekin_sd = stat.energy.ekin;
-            stat.energy.epot_sd = stat.energy.epot;
-#endif
-#ifndef RECORD_CM_IN_HEADER
-            stat.calcCenterOfMass(&system_soft[0], stat.n_real_loc);
-#endif
-            //Ptcl::vel_cm = stat.pcm.vel;
-
         }
-        else {
 #ifdef HARD_CHECK_ENERGY
+        else {
             // reset sd energy reference to no slowdown case
             PS::F64 energy_old = stat.energy.ekin + stat.energy.epot;
             stat.energy.etot_sd_ref -= stat.energy.ekin_sd + stat.energy.epot_sd - energy_old;
+        }
 #endif
 #ifdef RECORD_CM_IN_HEADER
-            stat.energy.calc(&system_soft[0], stat.n_real_loc,false, &(stat.pcm.pos), &(stat.pcm.vel));
+        stat.energy.calc(&system_soft[0], stat.n_real_loc, _initial_flag, &(stat.pcm.pos), &(stat.pcm.vel));
 #else
-            stat.energy.calc(&system_soft[0], stat.n_real_loc);
-#endif
-#ifdef PARTICLE_SIMULATOR_MPI_PARALLEL
-            stat.energy.getSumMultiNodes();
+        stat.energy.calc(&system_soft[0], stat.n_real_loc, _initial_flag);
 #endif
+        status_sum.index_energy = stat.energy.addToSum(status_sum.buf);
 
 #ifdef HARD_CHECK_ENERGY
+        if (!_initial_flag) {
             HardEnergy energy_local = system_hard_one_cluster.energy;
             energy_local += system_hard_isolated.energy;
 #ifdef PARTICLE_SIMULATOR_MPI_PARALLEL
             energy_local += system_hard_connected.energy;
 #endif
+            status_sum.index_hard = energy_local.addToSum(status_sum.buf);
+
+            system_hard_one_cluster.energy.clear();
+            system_hard_isolated.energy.clear();
+#ifdef PARTICLE_SIMULATOR_MPI_PARALLEL
+            system_hard_connected.energy.clear();
+#endif
+        }
+#endif
+#ifndef RECORD_CM_IN_HEADER
+        status_sum.index_cm = stat.addCenterOfMassToSum(status_sum.buf, &system_soft[0], stat.n_real_loc);
+#endif
+        status_sum.buf.start();
+#ifdef PROFILE
+        profile.status.end();
+#endif
+    }
+
+    //! finish updating system status
+    /*! Wait for the global summation issued by startUpdateStatus and update the status. No effect if no update is pending.
+     */
+    void finishUpdateStatus() {
+        if (!status_sum.buf.isPending()) return;
+#ifdef PROFILE
+        profile.status.start();
+#endif
+        status_sum.buf.wait();
+        stat.energy.getSumFromBuffer(status_sum.buf, status_sum.index_energy, status_sum.initial_flag);
+#ifdef HARD_CHECK_ENERGY
+        if (status_sum.initial_flag) {
+            stat.energy.ekin_sd = stat.energy.ekin;
+            stat.energy.epot_sd = stat.energy.epot;
+        }
+        else {
+            HardEnergy energy_glb;
+            energy_glb.getSumFromBuffer(status_sum.buf, status_sum.index_hard);
             // hard energy error
-            stat.energy.error_hard_cum += PS::Comm::getSum(energy_local.de);
-            stat.energy.error_hard_sd_cum += PS::Comm::getSum(energy_local.de_sd);
+            stat.energy.error_hard_cum += energy_glb.de;
+            stat.energy.error_hard_sd_cum += energy_glb.de_sd;
             // energy correction due to slowdown 
-            PS::F64 ekin_sd_correction = PS::Comm::getSum(energy_local.ekin_sd_correction);
+            PS::F64 ekin_sd_correction = energy_glb.ekin_sd_correction;
             stat.energy.ekin_sd = stat.energy.ekin + ekin_sd_correction;
-            PS::F64 epot_sd_correction = PS::Comm::getSum(energy_local.epot_sd_correction);
+            PS::F64 epot_sd_correction = energy_glb.epot_sd_correction;
             stat.energy.epot_sd = stat.energy.epot + epot_sd_correction;
             PS::F64 etot_sd_correction = ekin_sd_correction + epot_sd_correction;
-            PS::F64 de_change_cum = PS::Comm::getSum(energy_local.de_change_cum);
-            PS::F64 de_change_binary_interrupt = PS::Comm::getSum(energy_local.de_change_binary_interrupt);
-            PS::F64 de_change_modify_single = PS::Comm::getSum(energy_local.de_change_modify_single);
+            PS::F64 de_change_cum = energy_glb.de_change_cum;
             stat.energy.etot_ref += de_change_cum;
             stat.energy.de_change_cum += de_change_cum;
-            stat.energy.de_change_binary_interrupt += de_change_binary_interrupt;
-            stat.energy.de_change_modify_single += de_change_modify_single;
+            stat.energy.de_change_binary_interrupt += energy_glb.de_change_binary_interrupt;
+            stat.energy.de_change_modify_single += energy_glb.de_change_modify_single;
             // for total energy reference, first add the cumulative change due to slowdown change in the integration (referring to no slowdown case), then add slowdown energy correction from current time
-            PS::F64 de_sd_change_cum  = PS::Comm::getSum(energy_local.de_sd_change_cum) + etot_sd_correction;
-            PS::F64 de_sd_change_binary_interrupt = PS::Comm::getSum(energy_local.de_sd_change_binary_interrupt);
-            PS::F64 de_sd_change_modify_single = PS::Comm::getSum(energy_local.de_sd_change_modify_single);
+            PS::F64 de_sd_change_cum  = energy_glb.de_sd_change_cum + etot_sd_correction;
             stat.energy.etot_sd_ref += de_sd_change_cum; 
             stat.energy.de_sd_change_cum += de_sd_change_cum;
-            stat.energy.de_sd_change_binary_interrupt += de_sd_change_binary_interrupt;
-            stat.energy.de_sd_change_modify_single += de_sd_change_modify_single;
-
-            system_hard_one_cluster.energy.clear();
-            system_hard_isolated.energy.clear();
-#ifdef PARTICLE_SIMULATOR_MPI_PARALLEL
-            system_hard_connected.energy.clear();
-#endif
+            stat.energy.de_sd_change_binary_interrupt += energy_glb.de_sd_change_binary_interrupt;
+            stat.energy.de_sd_change_modify_single += energy_glb.de_sd_change_modify_single;
+        }
 #endif
 #ifndef RECORD_CM_IN_HEADER
-            stat.calcCenterOfMass(&system_soft[0], stat.n_real_loc);
+        stat.getCenterOfMassFromBuffer(status_sum.buf, status_sum.index_cm);
 #endif
-            //Ptcl::vel_cm = stat.pcm.vel;
-        }
+        //Ptcl::vel_cm = stat.pcm.vel;
         //stat.shiftToCenterOfMassFrame(&system_soft[0], stat.n_real_loc);
 
 #ifdef PROFILE
@@ -1847,6 +2053,233 @@ public:
 #endif
     }
 
+    //! update system status
+    /*! All global summations are done in one reduction
+      @param[in] _initial_flag: if true, set the energy and angular momemtum references
+     */
+    void updateStatus(const bool _initial_flag) {
+        startUpdateStatus(_initial_flag);
+        finishUpdateStatus();
+    }
+
+    //! write real particles in binary format in parallel
+    /*! Each rank packs its particles into one contiguous buffer (same layout as FPSoft::writeBinary).
+        With MPI, the data are written by collective MPI-IO at the offset of the prefix sum of particle numbers, and rank 0 writes the file header.
+        The file layout is the same as system_soft.writeParticleBinary, thus the existing readers can be used.
+      @param[in] _fname: snapshot filename
+     */
+    void writeParticleBinaryParallel(const char* _fname) {
+        const size_t record_size = FPSoft::getBinarySize();
+        const PS::S64 n_loc = stat.n_real_loc;
+        snapshot_buffer.resizeNoInitialize(n_loc*record_size);
+        char* buf = snapshot_buffer.getPointer();
+#pragma omp parallel for schedule(static)
+        for (PS::S64 i=0; i<n_loc; i++) {
+            char* buf_i = buf + i*record_size;
+            system_soft[i].writeBinaryToBuffer(buf_i);
+        }
+#ifdef PARTICLE_SIMULATOR_MPI_PARALLEL
+        MPI_File fh;
+        int err = MPI_File_open(MPI_COMM_WORLD, _fname, MPI_MODE_CREATE|MPI_MODE_WRONLY, MPI_INFO_NULL, &fh);
+        if (err!=MPI_SUCCESS) {
+            std::cerr<<"Error: Cannot open file "<<_fname<<" with MPI-IO!\n";
+            abort();
+        }
+        // remove old data if the file exists
+        MPI_File_set_size(fh, 0);
+
+        PS::S64 n_offset = 0;
+        MPI_Exscan(&n_loc, &n_offset, 1, MPI_LONG_LONG_INT, MPI_SUM, MPI_COMM_WORLD);
+        if (my_rank==0) {
+            n_offset = 0;
+            MPI_File_write_at(fh, 0, &file_header, sizeof(FileHeader), MPI_BYTE, MPI_STATUS_IGNORE);
+        }
+        MPI_Offset offset = sizeof(FileHeader) + n_offset*record_size;
+
+        // the count of MPI-IO is int, write large data in chunks, all ranks call the same number of collective writes
+        const PS::S64 chunk_size = 1<<30;
+        const PS::S64 data_size = n_loc*record_size;
+        PS::S64 n_chunk = (data_size+chunk_size-1)/chunk_size;
+        n_chunk = PS::Comm::getMaxValue(n_chunk);
+        for (PS::S64 k=0; k<n_chunk; k++) {
+            const PS::S64 chunk_offset = std::min(k*chunk_size, data_size);
+            const int count = std::min(chunk_size, data_size-chunk_offset);
+            MPI_File_write_at_all(fh, offset+chunk_offset, buf+chunk_offset, count, MPI_BYTE, MPI_STATUS_IGNORE);
+        }
+        MPI_File_close(&fh);
+#else
+        FILE* fout;
+        if( (fout = fopen(_fname,"w")) == NULL) {
+            std::cerr<<"Error: Cannot open file "<<_fname<<"!\n";
+            abort();
+        }
+        file_header.writeBinary(fout);
+        fwrite(buf, 1, n_loc*record_size, fout);
+        fclose(fout);
+#endif
+    }
+
+    //! write real particles in the columnar format
+    /*! With MPI, each rank writes its slices of columns by collective MPI-IO
+      @param[in] _fname: snapshot filename
+     */
+    void writeParticleColumnar(const char* _fname) {
+        const PS::S64 n_loc = stat.n_real_loc;
+        PS::S64 n_offset = 0;
+#ifdef PARTICLE_SIMULATOR_MPI_PARALLEL
+        MPI_Exscan(&n_loc, &n_offset, 1, MPI_LONG_LONG_INT, MPI_SUM, MPI_COMM_WORLD);
+        if (my_rank==0) n_offset = 0;
+        ColumnSnapshot::write(_fname, file_header, &system_soft[0], n_loc, n_offset, true);
+#else
+        ColumnSnapshot::write(_fname, file_header, &system_soft[0], n_loc, n_offset, false);
+#endif
+    }
+
+    //! write real particles in binary format by the background writer thread
+    /*! The particles are packed into a staging buffer (same layout as FPSoft::writeBinary), then the writer thread of each rank writes the buffer at the offset of the prefix sum of particle numbers.
+        Rank 0 creates the file with the full size and writes the file header, the file layout is the same as system_soft.writeParticleBinary.
+        If the number of pending snapshots reaches the limit of write_async, the packing waits until one snapshot is finished.
+      @param[in] _fname: snapshot filename
+     */
+    void writeParticleBinaryAsync(const std::string& _fname) {
+        const size_t record_size = FPSoft::getBinarySize();
+        const PS::S64 n_loc = stat.n_real_loc;
+        async_writer.initialize(input_parameters.write_async.value);
+        std::vector<char> buf = async_writer.getBuffer(n_loc*record_size);
+        char* buf_ptr = buf.data();
+#pragma omp parallel for schedule(static)
+        for (PS::S64 i=0; i<n_loc; i++) {
+            char* buf_i = buf_ptr + i*record_size;
+            system_soft[i].writeBinaryToBuffer(buf_i);
+        }
+
+        PS::S64 n_offset = 0;
+#ifdef PARTICLE_SIMULATOR_MPI_PARALLEL
+        MPI_Exscan(&n_loc, &n_offset, 1, MPI_LONG_LONG_INT, MPI_SUM, MPI_COMM_WORLD);
+#endif
+        if (my_rank==0) {
+            n_offset = 0;
+            // create the file with the full size, the existing data is removed
+            int fd = open(_fname.c_str(), O_CREAT|O_WRONLY|O_TRUNC, 0644);
+            if (fd<0 || ftruncate(fd, sizeof(FileHeader) + stat.n_real_glb*record_size)!=0) {
+                std::cerr<<"Error: Cannot create file "<<_fname<<"!\n";
+                abort();
+            }
+            close(fd);
+        }
+#ifdef PARTICLE_SIMULATOR_MPI_PARALLEL
+        // ensure the file exists before other ranks write
+        PS::Comm::barrier();
+#endif
+        const off_t offset = sizeof(FileHeader) + n_offset*record_size;
+        if (my_rank==0) async_writer.push(_fname, &file_header, sizeof(FileHeader), std::move(buf), offset);
+        else            async_writer.push(_fname, NULL, 0, std::move(buf), offset);
+    }
+
+    //! write the checkpoint of the integration state
+    /*! The checkpoint is written at the end of a tree step (after the hard drift) without interrupted clusters.
+        Each rank writes its own file [prefix].chk.r[rank] (see CheckpointHeader) to [prefix].chk.r[rank].tmp first,
+        the previous checkpoint is replaced after all ranks finish, thus a failure during the writing keeps the previous one.
+        The hard particles and groups are not written, since the next tree step removes the artificial particles and creates groups from the real particles,
+        the remaining state of SystemHard is the time origin and the hard energy changes not yet summed in the status.
+        The changeover update lists of SystemHard are not written, thus isCheckpointStep skips steps with changeover updates.
+        Pending asynchronous snapshots and buffered output files are flushed first, since the restart does not rewrite outputs before the checkpoint time.
+     */
+    void writeCheckpoint() {
+        assert(n_interrupt_glb==0);
+
+        // finish pending snapshots and flush output files, so that outputs before the checkpoint are complete when it is committed
+        async_writer.flush();
+        if (fstatus.is_open()) fstatus.flush();
+        if (fesc.is_open()) fesc.flush();
+#ifdef PROFILE
+        if (fprofile.is_open()) fprofile.flush();
+#endif
+#ifdef BSE_BASE
+        auto& interaction = hard_manager.ar_manager.interaction;
+        if (interaction.fout_sse.is_open()) interaction.fout_sse.flush();
+        if (interaction.fout_bse.is_open()) interaction.fout_bse.flush();
+#endif
+#ifdef ADJUST_GROUP_PRINT
+        if (hard_manager.h4_manager.fgroup.is_open()) hard_manager.h4_manager.fgroup.flush();
+#endif
+
+        std::string fname = input_parameters.fname_snp.value + ".chk.r" + std::to_string(my_rank);
+        std::string fname_tmp = fname + ".tmp";
+        FILE* fout;
+        if( (fout = fopen(fname_tmp.c_str(),"w")) == NULL) {
+            std::cerr<<"Error: Cannot open file "<<fname_tmp<<"!\n";
+            abort();
+        }
+
+        CheckpointHeader header;
+        header.n_proc = n_proc;
+        header.rank = my_rank;
+        header.size_ptcl = sizeof(FPSoft);
+        header.size_status = sizeof(Status);
+        header.size_file_header = sizeof(FileHeader);
+        header.n_ptcl = stat.n_real_loc;
+        header.n_mass_modify = mass_modify_list.size();
+        header.n_remove = remove_list.size();
+        header.n_remove_id = remove_id_record.size();
+        header.n_loop = n_loop;
+        header.time_kick = time_kick;
+        header.mean_mass_inv = Ptcl::mean_mass_inv;
+#ifdef BSE_BASE
+        if (input_parameters.stellar_evolution_option.value>0) {
+            header.n_bse_rand = 35;
+            hard_manager.ar_manager.interaction.bse_manager.getRandConstant(header.bse_rand);
+        }
+#endif
+        CheckpointHeader::writeArray(fout, &header, 1);
+        file_header.writeBinary(fout);
+        CheckpointHeader::writeArray(fout, &stat, 1);
+        dt_manager.writeBinary(fout);
+        for (PS::S32 i=0; i<n_proc; i++) {
+            PS::F64ort pos = dinfo.getPosDomain(i);
+            CheckpointHeader::writeArray(fout, &pos, 1);
+        }
+#ifdef HARD_CHECK_ENERGY
+        CheckpointHeader::writeArray(fout, &system_hard_one_cluster.energy, 1);
+        CheckpointHeader::writeArray(fout, &system_hard_isolated.energy, 1);
+#ifdef PARTICLE_SIMULATOR_MPI_PARALLEL
+        CheckpointHeader::writeArray(fout, &system_hard_connected.energy, 1);
+#endif
+#endif
+        CheckpointHeader::writeArray(fout, &system_soft[0], header.n_ptcl);
+        CheckpointHeader::writeArray(fout, mass_modify_list.getPointer(), header.n_mass_modify);
+        CheckpointHeader::writeArray(fout, remove_list.getPointer(), header.n_remove);
+        CheckpointHeader::writeArray(fout, remove_id_record.getPointer(), header.n_remove_id);
+        fclose(fout);
+
+        PS::Comm::barrier();
+        if (rename(fname_tmp.c_str(), fname.c_str())!=0) {
+            std::cerr<<"Error: Cannot rename file "<<fname_tmp<<" to "<<fname<<"!\n";
+            abort();
+        }
+        if (input_parameters.print_flag) 
+            std::cout<<"Write checkpoint: "<<input_parameters.fname_snp.value<<".chk.r*  Time = "<<stat.time<<"  N_loop = "<<n_loop<<std::endl;
+    }
+
+    //! check whether a checkpoint should be written at the end of the current tree step
+    /*! All ranks use the wall-clock decision of rank 0.
+        The checkpoint is delayed when clusters updated their changeovers in the last drift,
+        because the changeover update lists of SystemHard used by the force correction in the next step are not saved.
+     */
+    bool isCheckpointStep() {
+        int flag = (PS::GetWtime() - checkpoint_wtime_ref >= input_parameters.checkpoint_walltime.value);
+        PS::Comm::broadcast(&flag, 1, 0);
+        if (!flag) return false;
+
+        PS::S32 n_changeover_modify_local = system_hard_isolated.getNClusterChangeOverUpdate();
+#ifdef PARTICLE_SIMULATOR_MPI_PARALLEL        
+        n_changeover_modify_local += system_hard_connected.getNClusterChangeOverUpdate();
+        return PS::Comm::getSum(n_changeover_modify_local)==0;
+#else
+        return n_changeover_modify_local==0;
+#endif
+    }
+
     //! output data
     void output() {
 #ifdef PROFILE
@@ -1856,19 +2289,8 @@ public:
         int write_style = input_parameters.write_style.value;
         std::cout<<std::setprecision(PRINT_PRECISION);
 
-        // print status
-        if(print_flag) {
-            std::cout<<std::endl;
-            stat.print(std::cout);
-        }
-        // write status, output to separate snapshots
+        // output to separate snapshots, the data do not depend on the status summation started by startUpdateStatus, thus write them first to overlap with the communication
         if(write_style==1) {
-            // status output
-            if(my_rank==0) {
-                stat.printColumn(fstatus, WRITE_WIDTH);
-                fstatus<<std::endl;
-            }
-
             // data output
             file_header.n_body = stat.n_real_glb;
             file_header.time = stat.time;
@@ -1883,12 +2305,37 @@ public:
             assert(system_soft.getNumberOfParticleLocal()== stat.n_all_loc);
 #endif
             system_soft.setNumberOfParticleLocal(stat.n_real_loc);
-            if (input_parameters.data_format.value==1||input_parameters.data_format.value==3)
+            if (input_parameters.write_columnar.value==1) 
+                writeParticleColumnar(fname.c_str());
+            else if (input_parameters.data_format.value==1||input_parameters.data_format.value==3)
                 system_soft.writeParticleAscii(fname.c_str(), file_header);
-            else if(input_parameters.data_format.value==0||input_parameters.data_format.value==2)
-                system_soft.writeParticleBinary(fname.c_str(), file_header);
+            else if(input_parameters.data_format.value==0||input_parameters.data_format.value==2) {
+                if (input_parameters.write_async.value>0)
+                    writeParticleBinaryAsync(fname);
+                else if (input_parameters.write_mpiio.value==1) 
+                    writeParticleBinaryParallel(fname.c_str());
+                else
+                    system_soft.writeParticleBinary(fname.c_str(), file_header);
+            }
             system_soft.setNumberOfParticleLocal(stat.n_all_loc);
         }
+
+        // status is needed from here
+        finishUpdateStatus();
+
+        // print status
+        if(print_flag) {
+            std::cout<<std::endl;
+            stat.print(std::cout);
+        }
+        // write status
+        if(write_style==1) {
+            // status output
+            if(my_rank==0) {
+                stat.printColumn(fstatus, WRITE_WIDTH);
+                fstatus<<std::endl;
+            }
+        }
         // write all information in to fstatus
         else if(write_style==2&&my_rank==0) {
             // write snapshot with one line
@@ -1911,6 +2358,8 @@ public:
 
 #ifdef GALPY
         // for External potential
+        // synchronize the delayed MWPotentialEvolve parameters on all ranks before writing
+        if (write_style>0&&galpy_manager.set_parfile!="") galpy_manager.updatePotentialEvolveToTime(stat.time, false);
         if (write_style>0&&my_rank==0) {
             std::string fname = galpy_manager.set_parfile;
             if (fname!="") {
@@ -2066,12 +2515,24 @@ public:
         profile.clear();
         tree_soft_profile.clear();
         tree_nb_profile.clear();
+        ParallelSum::getProfile().clear();
+        load_balancer.clearProfile();
+#ifdef OMP_PROFILE
+        system_hard_isolated.clearOMPProfile();
+#ifdef PARTICLE_SIMULATOR_MPI_PARALLEL
+        system_hard_connected.clearOMPProfile();
+#endif
+#endif
 #if defined(USE_GPU) && defined(GPU_PROFILE)
         gpu_profile.clear();
         gpu_counter.clear();
 #endif
         n_count.clear();
         n_count_sum.clear();
+        async_writer.clearWaitTime();
+#ifdef SOFT_RUNG
+        soft_rung_manager.clearCount();
+#endif
         dn_loop=0;
     }
 
@@ -2096,6 +2557,9 @@ public:
             profile.dump(std::cout,dn_loop);
             std::cout<<std::endl;
 
+            if (input_parameters.write_async.value>0)
+                std::cout<<"**** Waiting time per step of output for pending asynchronous snapshots (local): "<<async_writer.getWaitTime()/dn_loop<<std::endl;
+
             std::cout<<"**** FDPS tree soft force time profile (local):\n";
             tree_soft_profile.dumpName(std::cout);
             std::cout<<std::endl;
@@ -2118,6 +2582,21 @@ public:
             std::cout<<std::endl;
 #endif
 
+#ifdef OMP_PROFILE
+            std::cout<<"**** OpenMP thread load of isolated clusters (local):\n";
+            system_hard_isolated.printOMPProfile(std::cout, dn_loop);
+#ifdef PARTICLE_SIMULATOR_MPI_PARALLEL
+            std::cout<<"**** OpenMP thread load of connected clusters (local):\n";
+            system_hard_connected.printOMPProfile(std::cout, dn_loop);
+#endif
+#endif
+
+            std::cout<<"**** Domain decomposition load balance (global):\n";
+            load_balancer.print(std::cout);
+
+            std::cout<<"**** OpenMP summation of energy and center of system (local):\n";
+            ParallelSum::getProfile().print(std::cout, dn_loop);
+
             std::cout<<"**** Number per step (global):\n";
             n_count_sum.dumpName(std::cout);
             std::cout<<std::endl;
@@ -2126,6 +2605,11 @@ public:
                 
             std::cout<<"**** Number of members in clusters (global):\n";
             n_count_sum.printHist(std::cout,dn_loop);
+
+#ifdef SOFT_RUNG
+            if (input_parameters.soft_rung_max.value>0) 
+                std::cout<<"**** Fraction of active single particles in block soft steps (local): "<<soft_rung_manager.getActiveFraction()<<std::endl;
+#endif
         }
 
         if(input_parameters.write_style.value>0) {
@@ -2702,7 +3186,8 @@ public:
         // domain decomposition
         system_soft.setAverageTargetNumberOfSampleParticlePerProcess(input_parameters.n_smp_ave.value);
         const PS::F32 coef_ema = 0.2;
-        domain_decompose_weight=1.0;
+        load_balancer.imbalance_threshold = input_parameters.domain_imbalance.value;
+        load_balancer.coef_ema = coef_ema;
         dinfo.initialize(coef_ema);
 
         if(pos_domain==NULL) {
@@ -2719,6 +3204,9 @@ public:
 
         // initial search cluster
         search_cluster.initialize();
+#ifdef SAVE_NEIGHBOR_LIST_IN_FORCE_KERNEL
+        NeighborListCSR::initialize();
+#endif
 
         return read_flag;
     }
@@ -2734,7 +3222,23 @@ public:
         PS::S32 data_format = input_parameters.data_format.value;
         auto* data_filename = input_parameters.fname_inp.value.c_str();
                 
-        if(data_format==1||data_format==2||data_format==4)
+        // columnar snapshot is detected automatically and read by rank 0
+        int columnar_flag = 0;
+        if (my_rank==0) columnar_flag = ColumnSnapshotReader::isColumnarFile(data_filename);
+        PS::Comm::broadcast(&columnar_flag, 1, 0);
+        if (columnar_flag) {
+            PS::S64 n_read = 0;
+            if (my_rank==0) {
+                ColumnSnapshotReader reader;
+                reader.open(data_filename);
+                reader.getFileHeader(file_header);
+                n_read = reader.getNumberOfParticles();
+                system_soft.setNumberOfParticleLocal(n_read);
+                reader.readParticles(&system_soft[0], 0, n_read);
+            }
+            else system_soft.setNumberOfParticleLocal(0);
+        }
+        else if(data_format==1||data_format==2||data_format==4)
             system_soft.readParticleAscii(data_filename, file_header);
         else
             system_soft.readParticleBinary(data_filename, file_header);
@@ -2770,6 +3274,64 @@ public:
         read_data_flag = true;
     }
 
+    //! read the checkpoint for restarting instead of readDataFromFile
+    /*! The particles, status, file header, tree step state and domain boundaries are restored here,
+        the kick time, averaged mass and BSE random state of the header are applied in initialStep, after initialParameters sets the parameters.
+     */
+    void readCheckpoint() {
+        assert(read_parameters_flag);
+        std::string fname = input_parameters.fname_snp.value + ".chk.r" + std::to_string(my_rank);
+        FILE* fin;
+        if( (fin = fopen(fname.c_str(),"r")) == NULL) {
+            std::cerr<<"Error: Cannot open file "<<fname<<"!\n";
+            abort();
+        }
+
+        CheckpointHeader::readArray(fin, &checkpoint_header, 1);
+        if (!checkpoint_header.check(n_proc, my_rank, sizeof(FPSoft), sizeof(Status), sizeof(FileHeader))) abort();
+        file_header.readBinary(fin);
+        CheckpointHeader::readArray(fin, &stat, 1);
+        dt_manager.readBinary(fin);
+        for (PS::S32 i=0; i<n_proc; i++) {
+            PS::F64ort pos;
+            CheckpointHeader::readArray(fin, &pos, 1);
+            dinfo.setPosDomain(i, pos);
+        }
+#ifdef HARD_CHECK_ENERGY
+        CheckpointHeader::readArray(fin, &system_hard_one_cluster.energy, 1);
+        CheckpointHeader::readArray(fin, &system_hard_isolated.energy, 1);
+#ifdef PARTICLE_SIMULATOR_MPI_PARALLEL
+        CheckpointHeader::readArray(fin, &system_hard_connected.energy, 1);
+#endif
+#endif
+        system_soft.setNumberOfParticleLocal(checkpoint_header.n_ptcl);
+        CheckpointHeader::readArray(fin, &system_soft[0], checkpoint_header.n_ptcl);
+        mass_modify_list.resizeNoInitialize(checkpoint_header.n_mass_modify);
+        CheckpointHeader::readArray(fin, mass_modify_list.getPointer(), checkpoint_header.n_mass_modify);
+        remove_list.resizeNoInitialize(checkpoint_header.n_remove);
+        CheckpointHeader::readArray(fin, remove_list.getPointer(), checkpoint_header.n_remove);
+        remove_id_record.resizeNoInitialize(checkpoint_header.n_remove_id);
+        CheckpointHeader::readArray(fin, remove_id_record.getPointer(), checkpoint_header.n_remove_id);
+        fclose(fin);
+
+        // artificial particles are not saved
+        stat.n_all_loc = stat.n_real_loc;
+        stat.n_all_glb = stat.n_real_glb;
+        n_loop = checkpoint_header.n_loop;
+        input_parameters.n_glb.value = stat.n_real_glb;
+
+        if(input_parameters.print_flag) {
+            std::cout<<std::setprecision(WRITE_PRECISION);
+            std::cout<<"----- Reading checkpoint: "<<input_parameters.fname_snp.value<<".chk.r* -----"<<std::endl
+                     <<"Number of particles = "<<stat.n_real_glb<<std::endl
+                     <<"Time = "<<stat.time<<std::endl
+                     <<"N_loop = "<<n_loop<<std::endl;
+        }
+
+        read_data_flag = true;
+        read_checkpoint_flag = true;
+    }
+
     //! reading data from particle array
     /*!
       @param[in] _n_partcle: number of particles
@@ -3151,6 +3713,8 @@ public:
 
         PS::F64 mass_average_glb = mass_cm_glb/(PS::F64)n_glb;
         mass_average = mass_average_glb;
+        // keep the averaged mass of the run writing the checkpoint, it determines the changeover radii of particles
+        if (read_checkpoint_flag) mass_average = 1.0/checkpoint_header.mean_mass_inv;
 
         // flag to check whether r_ous is already defined
         bool r_out_flag = (r_out>0);
@@ -3243,7 +3807,10 @@ public:
         id_offset = id_offset==-1 ? stat.n_real_glb+1 : id_offset;
 
         // initial particles paramters
-        if (!restart_flag) {
+        if (read_checkpoint_flag) {
+            // changeover, r_search and group data of particles are restored from the checkpoint
+        }
+        else if (!restart_flag) {
 #pragma omp parallel for
             for (PS::S32 i=0; i<stat.n_real_loc; i++) {
                 // ID safety check 
@@ -3315,6 +3882,10 @@ public:
         hard_manager.energy_error_max = PS::LARGE_FLOAT;
 #endif
         hard_manager.n_step_per_orbit = input_parameters.n_step_per_orbit.value;
+#ifdef SOFT_RUNG
+        soft_rung_manager.rung_max = input_parameters.soft_rung_max.value;
+        soft_rung_manager.eta = input_parameters.soft_rung_eta.value;
+#endif
         hard_manager.ap_manager.r_tidal_tensor = r_bin;
         hard_manager.ap_manager.id_offset = id_offset;
 #ifdef ORBIT_SAMPLING
@@ -3420,8 +3991,8 @@ public:
 #endif
         }
 
-        // initial tree step manager
-        dt_manager.setKDKMode();
+        // initial tree step manager, the state of the checkpoint is kept
+        if (!read_checkpoint_flag) dt_manager.setKDKMode();
 
         if (print_flag) std::cout<<"-----  Finish parameter initialization -----"<<std::endl;
 
@@ -3435,6 +4006,24 @@ public:
 
         assert(checkTimeConsistence());
 
+        checkpoint_wtime_ref = PS::GetWtime();
+
+        // continue from the checkpoint, the groups are created in the next tree step
+        if (read_checkpoint_flag) {
+            time_kick = checkpoint_header.time_kick;
+            Ptcl::mean_mass_inv = checkpoint_header.mean_mass_inv;
+#ifdef BSE_BASE
+            if (checkpoint_header.n_bse_rand>0&&input_parameters.stellar_evolution_option.value>0) 
+                hard_manager.ar_manager.interaction.bse_manager.setRandConstant(checkpoint_header.bse_rand);
+#endif
+            Ptcl::group_data_mode = stat.n_real_glb==1 ? GroupDataMode::artificial : GroupDataMode::cm;
+#ifdef PROFILE
+            clearProfile();
+#endif
+            initial_step_flag = true;
+            return;
+        }
+
         // one particle case
         if (stat.n_real_glb==1) {
             Ptcl::group_data_mode = GroupDataMode::artificial;
@@ -3462,8 +4051,13 @@ public:
             return;
         }
 
-        // domain decomposition
-        domainDecompose();
+#ifdef SOFT_RUNG
+        // all particles start from the closed base tree step
+        soft_rung_manager.initial(system_soft, stat.n_real_loc);
+#endif
+
+        // domain decomposition, no cost is measured yet
+        domainDecompose(true);
 
         // exchange particles
         exchangeParticle();
@@ -3604,7 +4198,8 @@ public:
                 // output information
                 if(output_flag) {
 
-                    updateStatus(false);
+                    // the status summation overlaps with the snapshot output
+                    startUpdateStatus(false);
                     output();
 #ifdef PROFILE
                     // profile
@@ -3684,6 +4279,25 @@ public:
     }
 
     
+#ifdef SOFT_RUNG
+    //! check whether all block soft steps should be synchronized in the current tree step
+    /*! The same conditions as the ending step in integrateToTime: output, changeover update and interruption, or the starting step
+      @param[in] _time_break: breaking time of the integration
+     */
+    bool isSoftRungSyncStep(const PS::F64 _time_break) {
+        if (dt_manager.isNextStart()) return true;
+        if (fmod(stat.time, input_parameters.dt_snap.value) == 0.0) return true;
+        if (stat.time>=_time_break) return true;
+        PS::S32 n_changeover_modify_local = system_hard_isolated.getNClusterChangeOverUpdate();
+#ifdef PARTICLE_SIMULATOR_MPI_PARALLEL        
+        n_changeover_modify_local += system_hard_connected.getNClusterChangeOverUpdate();
+        return PS::Comm::getSum(n_changeover_modify_local)>0;
+#else
+        return n_changeover_modify_local>0;
+#endif
+    }
+#endif
+
     //! integrate the system
     /*! @param[in] _time_break: additional breaking time to interrupt the integration, in default (0.0) the system integrate to time_end 
       \return interrupted cluster number
@@ -3741,10 +4355,22 @@ public:
             /// gether clusters information to search_cluster, using tree_nb and velocity criterion (particles status/mass_bk)
             searchCluster();
 
+#ifdef SOFT_RUNG
+            // close block soft steps of particles entering clusters before they are copied to the hard systems
+            if (input_parameters.soft_rung_max.value>0) 
+                soft_rung_manager.synchronizeClusterMember(system_soft, stat.n_real_loc, search_cluster.getAdrSysOneCluster(), stat.time, dt_tree);
+#endif
+
             // >3. find group and create artificial particles
             /// find group and create artificial particles, using search_cluster, save to system_hard and system_soft (particle status/mass_bk updated)
             createGroup(dt_tree);
 
+#ifdef SOFT_RUNG
+            // select active particles of block soft steps
+            if (input_parameters.soft_rung_max.value>0) 
+                soft_rung_manager.setActive(system_soft, system_soft.getNumberOfParticleLocal(), search_cluster.getAdrSysOneCluster(), stat.time, dt_tree, isSoftRungSyncStep(time_break));
+#endif
+
             // >4 tree soft force
             /// calculate tree force with linear cutoff, save to system_soft.acc
             treeSoftForce() ;
@@ -3757,6 +4383,12 @@ public:
             /// substract tidal tensor measure point force
             treeForceCorrectChangeover();
 
+#ifdef SOFT_RUNG
+            // recover forces of inactive particles and determine new rungs
+            if (input_parameters.soft_rung_max.value>0) 
+                soft_rung_manager.restoreAndUpdateRung(system_soft, stat.time, dt_tree, dt_output);
+#endif
+
 
 #ifdef KDKDK_4TH
             // only do correction at middle step
@@ -3837,8 +4469,8 @@ public:
 
             // output information
             if(output_flag) {
-                // update status
-                updateStatus(false);
+                // update status, the global summation overlaps with the snapshot output
+                startUpdateStatus(false);
                 output();
 
 #ifdef PROFILE
@@ -3935,6 +4567,11 @@ public:
                 return n_interrupt_glb;
             }
 
+            // write checkpoint if the wall-clock time interval is reached
+            if (input_parameters.checkpoint_walltime.value>0.0 && isCheckpointStep()) {
+                writeCheckpoint();
+                checkpoint_wtime_ref = PS::GetWtime();
+            }
         }
 
         return 0;
@@ -3942,6 +4579,9 @@ public:
 
     void clear() {
 
+        // finish pending snapshots
+        async_writer.finalize();
+
         if (fstatus.is_open()) fstatus.close();
         if (fesc.is_open()) fesc.close();
 #ifdef PROFILE
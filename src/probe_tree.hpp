@@ -0,0 +1,219 @@
+#pragma once
+
+//! Barnes-Hut octree for calculating gravity and potential at probe points
+/*! FDPS trees only calculate forces on particles of the system, thus this light-weight monopole tree is used for external probe points (e.g. AMUSE bridge).
+    The tree is built from local particles with the same opening angle theta and leaf size limit as the soft tree.
+    The probe points are walked in parallel by OpenMP.
+ */
+class ProbeTree{
+private:
+    //! tree node
+    struct Node{
+        PS::F64vec center; // box center
+        PS::F64 half_size; // half box size
+        PS::F64vec pos_cm; // center of mass position
+        PS::F64 mass;      // total mass
+        PS::S32 adr_ptcl;  // first particle address in the sorted index
+        PS::S32 n_ptcl;    // number of particles
+        PS::S32 adr_child; // first child node address, -1 for leaf
+        PS::S32 n_child;   // number of children
+    };
+
+    PS::ReallocatableArray<Node> node_;
+    PS::ReallocatableArray<PS::S32> index_; // sorted particle index
+    PS::ReallocatableArray<PS::S32> index_tmp_; // buffer for sorting
+    PS::ReallocatableArray<PS::F64vec> pos_; // particle positions
+    PS::ReallocatableArray<PS::F64> mass_;   // particle masses
+    PS::F64 theta2_;
+    PS::S32 n_leaf_limit_;
+
+    //! get octant of a position in a node
+    static PS::S32 getOctant(const PS::F64vec& _pos, const PS::F64vec& _center) {
+        return (_pos.x>=_center.x ? 1 : 0) | (_pos.y>=_center.y ? 2 : 0) | (_pos.z>=_center.z ? 4 : 0);
+    }
+
+    //! split a node into children recursively
+    void splitNode(const PS::S32 _adr_node, const PS::S32 _level) {
+        const PS::S32 adr_ptcl = node_[_adr_node].adr_ptcl;
+        const PS::S32 n_ptcl = node_[_adr_node].n_ptcl;
+        // avoid infinite split of identical positions
+        if (n_ptcl<=n_leaf_limit_ || _level>=60) return;
+
+        const PS::F64vec center = node_[_adr_node].center;
+        const PS::F64 half_size = node_[_adr_node].half_size;
+
+        // counting sort by octant
+        PS::S32 n_oct[8] = {0,0,0,0,0,0,0,0};
+        for (PS::S32 i=adr_ptcl; i<adr_ptcl+n_ptcl; i++) n_oct[getOctant(pos_[index_[i]], center)]++;
+        PS::S32 offset[9];
+        offset[0] = adr_ptcl;
+        for (PS::S32 k=0; k<8; k++) offset[k+1] = offset[k] + n_oct[k];
+        PS::S32 fill[8];
+        for (PS::S32 k=0; k<8; k++) fill[k] = offset[k];
+        for (PS::S32 i=adr_ptcl; i<adr_ptcl+n_ptcl; i++) index_tmp_[fill[getOctant(pos_[index_[i]], center)]++] = index_[i];
+        for (PS::S32 i=adr_ptcl; i<adr_ptcl+n_ptcl; i++) index_[i] = index_tmp_[i];
+
+        // create non-empty children continuously
+        const PS::S32 adr_child = node_.size();
+        PS::S32 n_child = 0;
+        for (PS::S32 k=0; k<8; k++) {
+            if (n_oct[k]==0) continue;
+            Node child;
+            const PS::F64 quarter = 0.5*half_size;
+            child.center = PS::F64vec(center.x + ((k&1) ? quarter : -quarter),
+                                      center.y + ((k&2) ? quarter : -quarter),
+                                      center.z + ((k&4) ? quarter : -quarter));
+            child.half_size = quarter;
+            child.adr_ptcl = offset[k];
+            child.n_ptcl = n_oct[k];
+            child.adr_child = -1;
+            child.n_child = 0;
+            child.mass = 0.0;
+            child.pos_cm = PS::F64vec(0.0);
+            for (PS::S32 i=offset[k]; i<offset[k+1]; i++) {
+                child.mass += mass_[index_[i]];
+                child.pos_cm += mass_[index_[i]]*pos_[index_[i]];
+            }
+            if (child.mass>0.0) child.pos_cm /= child.mass;
+            else child.pos_cm = child.center;
+            node_.push_back(child);
+            n_child++;
+        }
+        node_[_adr_node].adr_child = adr_child;
+        node_[_adr_node].n_child = n_child;
+
+        for (PS::S32 k=0; k<n_child; k++) splitNode(adr_child+k, _level+1);
+    }
+
+public:
+
+    ProbeTree(): node_(), index_(), index_tmp_(), pos_(), mass_(), theta2_(0.0), n_leaf_limit_(8) {}
+
+    //! build tree from particles
+    /*!
+      @param[in] _ptcl: particle array (require pos and mass)
+      @param[in] _n: number of particles
+      @param[in] _theta: opening angle
+      @param[in] _n_leaf_limit: maximum particle number in a leaf
+     */
+    template <class Tptcl>
+    void build(const Tptcl* _ptcl, const PS::S32 _n, const PS::F64 _theta, const PS::S32 _n_leaf_limit) {
+        assert(_n_leaf_limit>0);
+        theta2_ = _theta*_theta;
+        n_leaf_limit_ = _n_leaf_limit;
+        node_.resizeNoInitialize(0);
+        index_.resizeNoInitialize(_n);
+        index_tmp_.resizeNoInitialize(_n);
+        pos_.resizeNoInitialize(_n);
+        mass_.resizeNoInitialize(_n);
+        if (_n==0) return;
+
+        Node root;
+        root.mass = 0.0;
+        root.pos_cm = PS::F64vec(0.0);
+        PS::F64vec pos_min = _ptcl[0].pos, pos_max = _ptcl[0].pos;
+        for (PS::S32 i=0; i<_n; i++) {
+            index_[i] = i;
+            pos_[i] = _ptcl[i].pos;
+            mass_[i] = _ptcl[i].mass;
+            root.mass += mass_[i];
+            root.pos_cm += mass_[i]*pos_[i];
+            pos_min.x = std::min(pos_min.x, pos_[i].x);
+            pos_min.y = std::min(pos_min.y, pos_[i].y);
+            pos_min.z = std::min(pos_min.z, pos_[i].z);
+            pos_max.x = std::max(pos_max.x, pos_[i].x);
+            pos_max.y = std::max(pos_max.y, pos_[i].y);
+            pos_max.z = std::max(pos_max.z, pos_[i].z);
+        }
+        root.center = 0.5*(pos_min+pos_max);
+        PS::F64vec dpos = pos_max - pos_min;
+        // enlarge slightly to keep all particles inside
+        root.half_size = 0.5*std::max(dpos.x, std::max(dpos.y, dpos.z))*1.0001 + 1e-300;
+        if (root.mass>0.0) root.pos_cm /= root.mass;
+        else root.pos_cm = root.center;
+        root.adr_ptcl = 0;
+        root.n_ptcl = _n;
+        root.adr_child = -1;
+        root.n_child = 0;
+        node_.push_back(root);
+
+        splitNode(0, 0);
+    }
+
+    //! calculate acceleration and potential at probe points
+    /*! The results are added to _acc and _pot.
+        A node is used as a monopole if (box size)^2 < theta^2 * distance^2 and the probe point is outside the box, otherwise it is opened.
+      @param[in,out] _acc: acceleration x,y,z of probe points (size of 3*_n), set NULL to skip
+      @param[in,out] _pot: potential of probe points (size of _n), set NULL to skip
+      @param[in] _x: x of probe points
+      @param[in] _y: y of probe points
+      @param[in] _z: z of probe points
+      @param[in] _n: number of probe points
+      @param[in] _G: gravitational constant
+     */
+    void calcAccPot(PS::F64* _acc, PS::F64* _pot, const PS::F64* _x, const PS::F64* _y, const PS::F64* _z, const PS::S32 _n, const PS::F64 _G) const {
+        if (node_.size()==0) return;
+#pragma omp parallel for schedule(dynamic, 64)
+        for (PS::S32 i=0; i<_n; i++) {
+            const PS::F64vec pos_i(_x[i], _y[i], _z[i]);
+            PS::F64vec acc_i(0.0);
+            PS::F64 pot_i = 0.0;
+
+            // depth-first walk with a node stack
+            PS::S32 stack[512];
+            PS::S32 n_stack = 0;
+            stack[n_stack++] = 0;
+            while (n_stack>0) {
+                const Node& node = node_[stack[--n_stack]];
+                const PS::F64vec dr_cm = pos_i - node.pos_cm;
+                const PS::F64 r2 = dr_cm*dr_cm;
+                const PS::F64vec dc = pos_i - node.center;
+                const bool outside = (std::abs(dc.x)>node.half_size || std::abs(dc.y)>node.half_size || std::abs(dc.z)>node.half_size);
+                const PS::F64 size = 2.0*node.half_size;
+                if (node.adr_child<0) {
+                    // leaf: direct sum
+                    for (PS::S32 k=node.adr_ptcl; k<node.adr_ptcl+node.n_ptcl; k++) {
+                        const PS::S32 j = index_[k];
+                        const PS::F64vec dr = pos_i - pos_[j];
+                        const PS::F64 dr2 = dr*dr;
+                        if (dr2==0.0||mass_[j]==0.0) continue;
+                        const PS::F64 r_inv = 1.0/std::sqrt(dr2);
+                        const PS::F64 mr_inv = mass_[j]*r_inv;
+                        acc_i -= mr_inv*r_inv*r_inv*dr;
+                        pot_i -= mr_inv;
+                    }
+                }
+                else if (outside && size*size < theta2_*r2) {
+                    // monopole
+                    const PS::F64 r_inv = 1.0/std::sqrt(r2);
+                    const PS::F64 mr_inv = node.mass*r_inv;
+                    acc_i -= mr_inv*r_inv*r_inv*dr_cm;
+                    pot_i -= mr_inv;
+                }
+                else {
+                    assert(n_stack+node.n_child<=512);
+                    for (PS::S32 k=0; k<node.n_child; k++) stack[n_stack++] = node.adr_child+k;
+                }
+            }
+            if (_acc!=NULL) {
+                _acc[3*i  ] += _G*acc_i.x;
+                _acc[3*i+1] += _G*acc_i.y;
+                _acc[3*i+2] += _G*acc_i.z;
+            }
+            if (_pot!=NULL) _pot[i] += _G*pot_i;
+        }
+    }
+
+    //! get number of particles in tree
+    PS::S32 getNumberOfParticles() const {
+        return index_.size();
+    }
+
+    void clear() {
+        node_.clear();
+        index_.clear();
+        index_tmp_.clear();
+        pos_.clear();
+        mass_.clear();
+    }
+};
@@ -317,6 +317,7 @@ public:
 	Tprofile hard_isolated;
 	Tprofile hard_connected;
     Tprofile hard_interrupt;
+    Tprofile hard_sse;
 	Tprofile tree_nb;
     Tprofile tree_soft;
     Tprofile force_correct;
@@ -335,6 +336,7 @@ public:
                   hard_isolated (Tprofile("PP_cluster ")),
                   hard_connected(Tprofile("PP_cross   ")),
                   hard_interrupt(Tprofile("PP_intrpt* ")),
+                  hard_sse      (Tprofile("PP_SSE*    ")),
                   tree_nb       (Tprofile("Tree_NB    ")),
                   tree_soft     (Tprofile("Tree_Force ")),
                   force_correct (Tprofile("Force_corr ")),
@@ -346,7 +348,7 @@ public:
                   output        (Tprofile("Output     ")),
                   status        (Tprofile("Status     ")),
                   other         (Tprofile("Other      ")),
-                  n_profile(16) {}
+                  n_profile(17) {}
 
 	void print(std::ostream & fout, const PS::F64 time_sys, const PS::S64 n_loop=1){
         fout<<"Time: "<<time_sys<<std::endl;
@@ -421,6 +423,7 @@ public:
     NumCounter hard_isolated;
     NumCounter hard_connected;
     NumCounter hard_interrupt;
+    NumCounter hard_sse;
     NumCounter cluster_isolated;
     NumCounter cluster_connected;
     NumCounter ARC_substep_sum;
@@ -439,6 +442,7 @@ public:
                  hard_isolated    (NumCounter("PP_cluster ")),
                  hard_connected   (NumCounter("PP_cross   ")),
                  hard_interrupt   (NumCounter("PP_intrpt* ")),
+                 hard_sse         (NumCounter("PP_SSE*    ")),
                  cluster_isolated (NumCounter("Cluster    ")),
                  cluster_connected(NumCounter("Cross      ")),
                  ARC_substep_sum  (NumCounter("AR_step_sum")),
@@ -450,7 +454,7 @@ public:
                  ep_ep_interact   (NumCounter("Ep-Ep_sum  ")),
                  ep_sp_interact   (NumCounter("Ep-Sp_sum  ")),
                  //ARC_step_group   (NumCounter("ARC step per group")),
-                 n_counter(14) {}
+                 n_counter(15) {}
 
     void clusterCount(const PS::S32 n, const PS::S32 ntimes=1) {
         if (n_cluster.count(n)) n_cluster[n] += ntimes;
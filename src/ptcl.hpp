@@ -162,6 +162,21 @@ public:
         changeover.writeBinary(_fout);
     }
 
+    //! write class data to a memory buffer with the same layout as writeBinary
+    /*! @param[in,out] _buf: buffer pointer, shifted to the end of written data after return
+     */
+    void writeBinaryToBuffer(char*& _buf) const{
+        ParticleBase::writeBinaryToBuffer(_buf);
+        std::memcpy(_buf, &(this->r_search), 4*sizeof(PS::F64));
+        _buf += 4*sizeof(PS::F64);
+        changeover.writeBinaryToBuffer(_buf);
+    }
+
+    //! get the data size in bytes of writeBinary
+    static size_t getBinarySize() {
+        return ParticleBase::getBinarySize() + 4*sizeof(PS::F64) + ChangeOver::getBinarySize();
+    }
+
     //! read class data with ASCII format
     /*! @param[in] _fin: file IO for read
      */
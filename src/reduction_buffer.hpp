@@ -0,0 +1,83 @@
+#pragma once
+
+//! Batch of global summations packed into one buffer
+/*! Local values are added by add(), which returns the index of the value in the buffer.
+    start() issues one non-blocking MPI_Iallreduce (MPI_SUM) for the whole buffer, so that the work between start() and wait(),
+    e.g. snapshot serialization, overlaps with the communication.
+    After wait(), the global sums are obtained by getF64/getF64vec with the indices.
+    Without MPI, the local values are the global ones.
+ */
+class ReductionSumBuffer{
+private:
+    PS::ReallocatableArray<PS::F64> send_; // local values
+    PS::ReallocatableArray<PS::F64> recv_; // global sums
+#ifdef PARTICLE_SIMULATOR_MPI_PARALLEL
+    MPI_Request request_;
+#endif
+    bool pending_flag_; // reduction started and not yet finished
+
+public:
+    ReductionSumBuffer(): send_(), recv_(), pending_flag_(false) {}
+
+    //! clear buffer for new values
+    void clear() {
+        assert(!pending_flag_);
+        send_.clearSize();
+    }
+
+    //! add one local value
+    /*! \return index of the value */
+    PS::S32 add(const PS::F64 _v) {
+        assert(!pending_flag_);
+        send_.push_back(_v);
+        return send_.size()-1;
+    }
+
+    //! add one local vector
+    /*! \return index of the x component, y and z follow */
+    PS::S32 add(const PS::F64vec& _v) {
+        PS::S32 index = add(_v.x);
+        add(_v.y);
+        add(_v.z);
+        return index;
+    }
+
+    //! start global summation
+    void start() {
+        assert(!pending_flag_);
+        const PS::S32 n = send_.size();
+        recv_.resizeNoInitialize(n);
+#ifdef PARTICLE_SIMULATOR_MPI_PARALLEL
+        MPI_Iallreduce(send_.getPointer(), recv_.getPointer(), n, PS::GetDataType<PS::F64>(), MPI_SUM, MPI_COMM_WORLD, &request_);
+#else
+        for (PS::S32 i=0; i<n; i++) recv_[i] = send_[i];
+#endif
+        pending_flag_ = true;
+    }
+
+    //! wait for the global summation to finish, no effect if not started
+    void wait() {
+        if (!pending_flag_) return;
+#ifdef PARTICLE_SIMULATOR_MPI_PARALLEL
+        MPI_Wait(&request_, MPI_STATUS_IGNORE);
+#endif
+        pending_flag_ = false;
+    }
+
+    //! check whether the summation is started and not yet finished
+    bool isPending() const {
+        return pending_flag_;
+    }
+
+    //! get global sum of one value
+    PS::F64 getF64(const PS::S32 _index) const {
+        assert(!pending_flag_);
+        return recv_[_index];
+    }
+
+    //! get global sum of one vector
+    PS::F64vec getF64vec(const PS::S32 _index) const {
+        assert(!pending_flag_);
+        return PS::F64vec(recv_[_index], recv_[_index+1], recv_[_index+2]);
+    }
+};
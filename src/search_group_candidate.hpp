@@ -1,10 +1,16 @@
 #pragma once
+#include<algorithm>
 #include<particle_simulator.hpp>
 
 #ifndef ARRAY_ALLOW_LIMIT
 #define ARRAY_ALLOW_LIMIT 1000000000
 #endif
 
+// minimum cluster size to use the cell-list partner search
+#ifndef SEARCH_GROUP_CELL_LIST_THRESHOLD
+#define SEARCH_GROUP_CELL_LIST_THRESHOLD 200
+#endif
+
 template<class Tptcl>
 class SearchGroupCandidate{
 private:
@@ -15,7 +21,13 @@ private:
     PS::ReallocatableArray<PS::S32> group_list_disp_;
     PS::ReallocatableArray<PS::S32> group_list_n_;
 
-    //! Search partner to create group
+    // cell list buffers
+    PS::ReallocatableArray<PS::S32> cell_disp_;  // first particle address of each cell in cell_index_ (size of n_cell+1)
+    PS::ReallocatableArray<PS::S32> cell_index_; // particle indices sorted by cell
+    PS::ReallocatableArray<PS::S32> cell_id_;    // hash bucket of each particle
+    PS::ReallocatableArray<PS::S64> cell_coord_; // integer cell coordinates (x,y,z) of each particle
+
+    //! Search partner to create group by checking all pairs
     /* If r.v >0, Use bin factor sqrt(r^2 - (r*v/|v|)^2) to check, otherwise use distance to check. The mass ratio is also considered.
        The perturber acceleration from non-partner member is stored in mass_bk for the later stablility check
        @param[out] _part_list: partner index in _ptcl for each particle
@@ -24,11 +36,11 @@ private:
        @param[in,out] _ptcl: particle data, mass_bk is updated
        @param[in] _n: number of particles
     */
-    void searchPartner(PS::ReallocatableArray<PS::S32> & _part_list,
-                       PS::ReallocatableArray<PS::S32> & _part_list_disp,
-                       PS::ReallocatableArray<PS::S32> & _part_list_n,
-                       Tptcl *_ptcl,
-                       const PS::S32 _n) {
+    void searchPartnerDirect(PS::ReallocatableArray<PS::S32> & _part_list,
+                             PS::ReallocatableArray<PS::S32> & _part_list_disp,
+                             PS::ReallocatableArray<PS::S32> & _part_list_n,
+                             Tptcl *_ptcl,
+                             const PS::S32 _n) {
 
         _part_list.clearSize();
         _part_list_disp.reserve(_n);
@@ -105,6 +117,141 @@ private:
         }
     }
 
+    //! get hash bucket of a cell
+    static PS::S32 getCellBucket(const PS::S64 _ix, const PS::S64 _iy, const PS::S64 _iz, const PS::U64 _mask) {
+        const PS::U64 h = ((PS::U64)_ix*73856093ULL) ^ ((PS::U64)_iy*19349663ULL) ^ ((PS::U64)_iz*83492791ULL);
+        return (PS::S32)(h&_mask);
+    }
+
+    //! Search partner to create group by using a cell list
+    /* The criterion is the same as searchPartnerDirect: r < min(r_group_candidate_i, r_group_candidate_j).
+       The cell size is the maximum r_group_candidate, thus only the 27 neighbor cells are checked.
+       Cells are mapped to 2n-4n hash buckets, so the memory does not depend on the spatial extent of the cluster.
+       Particles in other cells sharing the same bucket are skipped by comparing the cell coordinates.
+       Two passes are used: first count partners of each particle, then fill _part_list after the offsets are known.
+       The partner indices of each particle are sorted in increasing order, so that the result is identical to searchPartnerDirect.
+       @param[out] _part_list: partner index in _ptcl for each particle
+       @param[out] _part_list_disp: offset to separate partner index for different particles
+       @param[out] _part_list_n: number of partners for each particle
+       @param[in] _ptcl: particle data
+       @param[in] _n: number of particles
+    */
+    void searchPartnerCellList(PS::ReallocatableArray<PS::S32> & _part_list,
+                               PS::ReallocatableArray<PS::S32> & _part_list_disp,
+                               PS::ReallocatableArray<PS::S32> & _part_list_n,
+                               Tptcl *_ptcl,
+                               const PS::S32 _n) {
+#ifdef HARD_DEBUG
+        assert(_n<ARRAY_ALLOW_LIMIT);
+#endif        
+        _part_list.clearSize();
+        _part_list_disp.resizeNoInitialize(_n);
+        _part_list_n.resizeNoInitialize(_n);
+        if (_n==0) return;
+
+        // lower bound of positions and maximum searching radius
+        PS::F64vec pos_min = _ptcl[0].pos;
+        PS::F64 r_max = 0.0;
+        for (PS::S32 i=0; i<_n; i++) {
+            const PS::F64vec& pos = _ptcl[i].pos;
+            pos_min.x = std::min(pos_min.x, pos.x);
+            pos_min.y = std::min(pos_min.y, pos.y);
+            pos_min.z = std::min(pos_min.z, pos.z);
+            r_max = std::max(r_max, _ptcl[i].getRGroupCandidate());
+        }
+        if (r_max<=0.0) {
+            for (PS::S32 i=0; i<_n; i++) {
+                _part_list_n[i] = 0;
+                _part_list_disp[i] = 0;
+            }
+            return;
+        }
+
+        // hashed cell mesh with cell size r_max, the bucket number is a power of two in [2n, 4n)
+        const PS::F64 cell_size_inv = 1.0/r_max;
+        PS::S32 n_bucket = 1;
+        while (n_bucket<2*_n) n_bucket <<= 1;
+        const PS::U64 bucket_mask = n_bucket-1;
+        cell_disp_.resizeNoInitialize(n_bucket+1);
+        cell_index_.resizeNoInitialize(_n);
+        cell_id_.resizeNoInitialize(_n);
+        cell_coord_.resizeNoInitialize(3*_n);
+        for (PS::S32 c=0; c<=n_bucket; c++) cell_disp_[c] = 0;
+        for (PS::S32 i=0; i<_n; i++) {
+            PS::S64* ic = &cell_coord_[3*i];
+            for (PS::S32 k=0; k<3; k++) ic[k] = (PS::S64)std::min((_ptcl[i].pos[k]-pos_min[k])*cell_size_inv, 1e15);
+            cell_id_[i] = getCellBucket(ic[0], ic[1], ic[2], bucket_mask);
+            cell_disp_[cell_id_[i]+1]++;
+        }
+        for (PS::S32 c=0; c<n_bucket; c++) cell_disp_[c+1] += cell_disp_[c];
+        // cell_disp_[c] is used as the filling cursor, after filling it becomes the offset of bucket c+1
+        for (PS::S32 i=0; i<_n; i++) cell_index_[cell_disp_[cell_id_[i]]++] = i;
+        for (PS::S32 c=n_bucket; c>0; c--) cell_disp_[c] = cell_disp_[c-1];
+        cell_disp_[0] = 0;
+
+        // two passes: count (ipass=0) and fill (ipass=1)
+        for (PS::S32 ipass=0; ipass<2; ipass++) {
+            if (ipass==1) {
+                PS::S32 offset = 0;
+                for (PS::S32 i=0; i<_n; i++) {
+                    _part_list_disp[i] = offset;
+                    offset += _part_list_n[i];
+                }
+                _part_list.resizeNoInitialize(offset);
+            }
+            for (PS::S32 i=0; i<_n; i++) {
+                const PS::S64* ic = &cell_coord_[3*i];
+                const PS::F64 r_i = _ptcl[i].getRGroupCandidate();
+                PS::S32 n_part = 0;
+                PS::S32* part_i = ipass==1 ? &_part_list[_part_list_disp[i]] : NULL;
+                for (PS::S64 jz=ic[2]-1; jz<=ic[2]+1; jz++) {
+                    for (PS::S64 jy=ic[1]-1; jy<=ic[1]+1; jy++) {
+                        for (PS::S64 jx=ic[0]-1; jx<=ic[0]+1; jx++) {
+                            const PS::S32 cj = getCellBucket(jx, jy, jz, bucket_mask);
+                            for (PS::S32 k=cell_disp_[cj]; k<cell_disp_[cj+1]; k++) {
+                                const PS::S32 j = cell_index_[k];
+                                // skip other cells sharing the same bucket
+                                const PS::S64* jc = &cell_coord_[3*j];
+                                if (i==j || jc[0]!=jx || jc[1]!=jy || jc[2]!=jz) continue;
+                                PS::F64vec dr = _ptcl[i].pos-_ptcl[j].pos;
+                                PS::F64 r2 = dr*dr;
+                                PS::F64 rin_min = std::min(r_i, _ptcl[j].getRGroupCandidate());
+                                if (r2<rin_min*rin_min) {
+                                    if (ipass==1) part_i[n_part] = j;
+                                    n_part++;
+                                }
+                            }
+                        }
+                    }
+                }
+                if (ipass==0) _part_list_n[i] = n_part;
+                else {
+#ifdef HARD_DEBUG
+                    assert(n_part==_part_list_n[i]);
+#endif
+                    std::sort(part_i, part_i+n_part);
+                }
+            }
+        }
+    }
+
+    //! Search partner to create group
+    /* Use cell list if _n >= SEARCH_GROUP_CELL_LIST_THRESHOLD, otherwise check all pairs
+       @param[out] _part_list: partner index in _ptcl for each particle
+       @param[out] _part_list_disp: offset to separate partner index for different particles
+       @param[out] _part_list_n: number of partners for each particle
+       @param[in,out] _ptcl: particle data
+       @param[in] _n: number of particles
+    */
+    void searchPartner(PS::ReallocatableArray<PS::S32> & _part_list,
+                       PS::ReallocatableArray<PS::S32> & _part_list_disp,
+                       PS::ReallocatableArray<PS::S32> & _part_list_n,
+                       Tptcl *_ptcl,
+                       const PS::S32 _n) {
+        if (_n>=n_cell_list_threshold) searchPartnerCellList(_part_list, _part_list_disp, _part_list_n, _ptcl, _n);
+        else searchPartnerDirect(_part_list, _part_list_disp, _part_list_n, _ptcl, _n);
+    }
+
     void mergeGroup(PS::ReallocatableArray<PS::S32> & group_list,
                       PS::ReallocatableArray<PS::S32> & group_list_disp,
                       PS::ReallocatableArray<PS::S32> & group_list_n,
@@ -221,6 +368,10 @@ private:
 
 public:
 
+    PS::S32 n_cell_list_threshold; ///> minimum cluster size to use the cell-list partner search
+
+    SearchGroupCandidate(): group_list_(), group_list_disp_(), group_list_n_(), cell_disp_(), cell_index_(), cell_id_(), cell_coord_(), n_cell_list_threshold(SEARCH_GROUP_CELL_LIST_THRESHOLD) {}
+
     void searchAndMerge(Tptcl *_ptcl_in_cluster, const PS::S32 _n_ptcl) {
         PS::ReallocatableArray<PS::S32> part_list;      ///partner list
         PS::ReallocatableArray<PS::S32> part_list_disp;      ///partner list
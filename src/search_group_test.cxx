@@ -0,0 +1,151 @@
+#include <iostream>
+#include <cstdio>
+#include <iomanip>
+#include <cstdlib>
+#include <cassert>
+#include <cmath>
+#include <getopt.h>
+#include <particle_simulator.hpp>
+#include "search_group_candidate.hpp"
+
+//! simple particle type for group candidate search
+struct PtclGroupTest{
+    PS::F64vec pos;
+    PS::F64 r_group;
+
+    PS::F64 getRGroupCandidate() const {
+        return r_group;
+    }
+};
+
+//! uniform random number in [0,1)
+PS::F64 getRandom() {
+    return (PS::F64)rand()/((PS::F64)RAND_MAX+1.0);
+}
+
+//! generate a Plummer-like cluster with a fraction of close pairs
+/*!
+  @param[out] _ptcl: particle array
+  @param[in] _n: number of particles
+  @param[in] _r_group: group candidate radius
+  @param[in] _f_pair: fraction of particles in close pairs
+ */
+void generateCluster(PS::ReallocatableArray<PtclGroupTest>& _ptcl, const PS::S32 _n, const PS::F64 _r_group, const PS::F64 _f_pair) {
+    _ptcl.resizeNoInitialize(_n);
+    for (PS::S32 i=0; i<_n; i++) {
+        if (i>0 && getRandom()<_f_pair) {
+            // companion close to the previous particle
+            const PS::F64 dr = 0.5*_r_group*getRandom();
+            _ptcl[i].pos = _ptcl[i-1].pos + PS::F64vec(dr, 0.3*dr, -0.2*dr);
+        }
+        else {
+            const PS::F64 r = 1.0/std::sqrt(std::pow(std::max(getRandom(),1e-6), -2.0/3.0) - 1.0);
+            const PS::F64 cth = 2.0*getRandom()-1.0;
+            const PS::F64 sth = std::sqrt(1.0-cth*cth);
+            const PS::F64 phi = 2.0*M_PI*getRandom();
+            _ptcl[i].pos = PS::F64vec(r*sth*std::cos(phi), r*sth*std::sin(phi), r*cth);
+        }
+        // mimic different search radii of particles
+        _ptcl[i].r_group = _r_group*(0.5+getRandom());
+    }
+}
+
+int main(int argc, char **argv){
+    PS::S32 n_min = 50;     // minimum cluster size
+    PS::S32 n_max = 3200;   // maximum cluster size
+    PS::F64 r_group = 0.01; // group candidate radius
+    PS::F64 f_pair = 0.2;   // fraction of close pairs
+    PS::S32 n_loop = 20;    // number of repeats for timing
+
+    int copt;
+    while ((copt = getopt(argc, argv, "n:m:r:f:l:h")) != -1)
+        switch (copt) {
+        case 'n':
+            n_min = atoi(optarg);
+            break;
+        case 'm':
+            n_max = atoi(optarg);
+            break;
+        case 'r':
+            r_group = atof(optarg);
+            break;
+        case 'f':
+            f_pair = atof(optarg);
+            break;
+        case 'l':
+            n_loop = atoi(optarg);
+            break;
+        case 'h':
+            std::cout<<"Benchmark of the group candidate search: all-pair check vs. cell list\n"
+                     <<"Options: \n"
+                     <<"  -n: minimum cluster size, multiplied by 2 until the maximum ("<<n_min<<")\n"
+                     <<"  -m: maximum cluster size ("<<n_max<<")\n"
+                     <<"  -r: group candidate radius in the unit of Plummer radius ("<<r_group<<")\n"
+                     <<"  -f: fraction of particles in close pairs ("<<f_pair<<")\n"
+                     <<"  -l: number of repeats for timing ("<<n_loop<<")\n";
+            return 0;
+        default:
+            break;
+        }
+
+    std::cout<<std::setw(10)<<"n_ptcl"
+             <<std::setw(10)<<"n_group"
+             <<std::setw(14)<<"t_direct"
+             <<std::setw(14)<<"t_cell"
+             <<std::setw(12)<<"speedup"
+             <<std::endl;
+
+    srand(1234);
+    PS::ReallocatableArray<PtclGroupTest> ptcl;
+    for (PS::S32 n=n_min; n<=n_max; n*=2) {
+        generateCluster(ptcl, n, r_group, f_pair);
+
+        PS::F64 t_direct = 0.0, t_cell = 0.0;
+        for (PS::S32 k=0; k<n_loop; k++) {
+            SearchGroupCandidate<PtclGroupTest> group_direct, group_cell;
+            group_direct.n_cell_list_threshold = n+1;
+            group_cell.n_cell_list_threshold = 0;
+
+            PS::F64 t0 = PS::GetWtime();
+            group_direct.searchAndMerge(ptcl.getPointer(), n);
+            PS::F64 t1 = PS::GetWtime();
+            group_cell.searchAndMerge(ptcl.getPointer(), n);
+            PS::F64 t2 = PS::GetWtime();
+            t_direct += t1-t0;
+            t_cell += t2-t1;
+
+            // check consistence
+            if (k==0) {
+                assert(group_direct.getNumberOfGroups()==group_cell.getNumberOfGroups());
+                assert(group_direct.getGroupListSize()==group_cell.getGroupListSize());
+                for (PS::S32 i=0; i<group_direct.getNumberOfGroups(); i++) {
+                    const PS::S32 n_mem = group_direct.getNumberOfGroupMembers(i);
+                    assert(n_mem==group_cell.getNumberOfGroupMembers(i));
+                    PS::S32* mem_direct = group_direct.getMemberList(i);
+                    PS::S32* mem_cell = group_cell.getMemberList(i);
+                    for (PS::S32 j=0; j<n_mem; j++) {
+                        if (mem_direct[j]!=mem_cell[j]) {
+                            std::cerr<<"Error: group member mismatch! n_ptcl="<<n<<" group "<<i<<" member "<<j
+                                     <<" direct: "<<mem_direct[j]<<" cell: "<<mem_cell[j]<<std::endl;
+                            abort();
+                        }
+                    }
+                }
+            }
+            if (k==n_loop-1) {
+                std::cout<<std::setw(10)<<n
+                         <<std::setw(10)<<group_direct.getNumberOfGroups();
+            }
+        }
+        t_direct /= n_loop;
+        t_cell /= n_loop;
+        std::cout<<std::setw(14)<<t_direct
+                 <<std::setw(14)<<t_cell
+                 <<std::setw(12)<<t_direct/std::max(t_cell,1e-12)
+                 <<std::endl;
+    }
+
+    std::cout<<"Group candidate search test passed"<<std::endl;
+
+    return 0;
+}
@@ -0,0 +1,401 @@
+#pragma once
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <cassert>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "soft_ptcl.hpp"
+#include "io.hpp"
+
+/* Columnar snapshot format
+   [ColumnSnapshotHeader][ColumnFieldInfo x n_field][padding][column 0][padding][column 1]...
+   Each column stores one scalar member of all particles continuously (8 bytes per particle), and starts at a 64-byte aligned offset.
+   The field table records the name, type, offset and size of each column, thus the file does not depend on the compile flags of FPSoft.
+ */
+
+#define COLUMN_SNAPSHOT_VERSION 1
+#define COLUMN_SNAPSHOT_ALIGN 64
+
+//! data type of columns
+enum class ColumnType: int32_t {f64=0, i64=1};
+
+//! header of columnar snapshot
+struct ColumnSnapshotHeader{
+    char magic[8];        // "PETARCOL"
+    int32_t version;      // format version
+    int32_t n_field;      // number of columns
+    int64_t n_body;       // number of particles
+    int64_t nfile;        // snapshot index
+    double time;          // time
+    double pos_offset[3]; // c.m. position offset (RECORD_CM_IN_HEADER)
+    double vel_offset[3]; // c.m. velocity offset (RECORD_CM_IN_HEADER)
+    int64_t file_size;    // total file size in bytes
+};
+
+//! one entry of the field table
+struct ColumnFieldInfo{
+    char name[32];    // column name, same as the column title of ASCII snapshots
+    int32_t type;     // ColumnType
+    int32_t reserved;
+    int64_t offset;   // file offset of the column
+    int64_t size;     // column size in bytes
+};
+
+//! member of FPSoft stored as a column
+struct ColumnFieldFPSoft{
+    std::string name;
+    ColumnType type;
+    size_t offset; // byte offset in FPSoft
+};
+
+//! Columnar snapshot functions
+class ColumnSnapshot{
+public:
+    //! align an offset to COLUMN_SNAPSHOT_ALIGN
+    static int64_t align(const int64_t _offset) {
+        return (_offset + COLUMN_SNAPSHOT_ALIGN - 1)/COLUMN_SNAPSHOT_ALIGN*COLUMN_SNAPSHOT_ALIGN;
+    }
+
+    //! get the list of FPSoft members stored in columns
+    /*! The list follows the column order of ASCII snapshots (except group_data stored as two 64-bit integers)
+     */
+    static const std::vector<ColumnFieldFPSoft>& getFieldList() {
+        static std::vector<ColumnFieldFPSoft> fields;
+        if (fields.size()>0) return fields;
+
+        static_assert(sizeof(Float)==8, "Columnar snapshot requires 8-byte Float for changeover");
+        FPSoft p;
+        const char* base = (const char*)&p;
+        auto add = [&](const char* _name, ColumnType _type, const void* _member) {
+            fields.push_back(ColumnFieldFPSoft{std::string(_name), _type, size_t((const char*)_member - base)});
+        };
+        add("mass",  ColumnType::f64, &p.mass);
+        add("pos.x", ColumnType::f64, &p.pos.x);
+        add("pos.y", ColumnType::f64, &p.pos.y);
+        add("pos.z", ColumnType::f64, &p.pos.z);
+        add("vel.x", ColumnType::f64, &p.vel.x);
+        add("vel.y", ColumnType::f64, &p.vel.y);
+        add("vel.z", ColumnType::f64, &p.vel.z);
+        add("bin_stat", ColumnType::i64, &p.binary_state);
+#ifdef STELLAR_EVOLUTION
+        add("radius",   ColumnType::f64, &p.radius);
+        add("dm",       ColumnType::f64, &p.dm);
+        add("t_record", ColumnType::f64, &p.time_record);
+        add("t_interrupt", ColumnType::f64, &p.time_interrupt);
+#ifdef BSE_BASE
+        add("s_type",  ColumnType::i64, &p.star.kw);
+        add("s_mass0", ColumnType::f64, &p.star.m0);
+        add("s_mass",  ColumnType::f64, &p.star.mt);
+        add("s_rad",   ColumnType::f64, &p.star.r);
+        add("s_mcore", ColumnType::f64, &p.star.mc);
+        add("s_rcore", ColumnType::f64, &p.star.rc);
+        add("s_spin",  ColumnType::f64, &p.star.ospin);
+        add("s_epoch", ColumnType::f64, &p.star.epoch);
+        add("s_time",  ColumnType::f64, &p.star.tphys);
+        add("s_lum",   ColumnType::f64, &p.star.lum);
+#endif
+#endif
+        add("r_search", ColumnType::f64, &p.r_search);
+        add("id",       ColumnType::i64, &p.id);
+        add("group_data1", ColumnType::i64, &p.group_data.data_int64.data1);
+        add("group_data2", ColumnType::i64, &p.group_data.data_int64.data2);
+        // r_in and r_out are the first two members of ChangeOver (see ChangeOver::writeBinary)
+        add("r_in",  ColumnType::f64, (const char*)&p.changeover);
+        add("r_out", ColumnType::f64, (const char*)&p.changeover + sizeof(Float));
+        add("acc_soft.x", ColumnType::f64, &p.acc.x);
+        add("acc_soft.y", ColumnType::f64, &p.acc.y);
+        add("acc_soft.z", ColumnType::f64, &p.acc.z);
+        add("pot_tot",  ColumnType::f64, &p.pot_tot);
+        add("pot_soft", ColumnType::f64, &p.pot_soft);
+#ifdef EXTERNAL_POT_IN_PTCL
+        add("pot_ext",  ColumnType::f64, &p.pot_ext);
+#endif
+        add("n_b", ColumnType::i64, &p.n_ngb);
+        return fields;
+    }
+
+    //! calculate the header and the field table for a given number of particles
+    static void calcLayout(ColumnSnapshotHeader& _header, std::vector<ColumnFieldInfo>& _info, const FileHeader& _file_header) {
+        const auto& fields = getFieldList();
+        const int n_field = fields.size();
+        std::memset(&_header, 0, sizeof(ColumnSnapshotHeader));
+        std::memcpy(_header.magic, "PETARCOL", 8);
+        _header.version = COLUMN_SNAPSHOT_VERSION;
+        _header.n_field = n_field;
+        _header.n_body = _file_header.n_body;
+        _header.nfile = _file_header.nfile;
+        _header.time = _file_header.time;
+#ifdef RECORD_CM_IN_HEADER
+        for (int k=0; k<3; k++) {
+            _header.pos_offset[k] = _file_header.pos_offset[k];
+            _header.vel_offset[k] = _file_header.vel_offset[k];
+        }
+#endif
+        _info.resize(n_field);
+        int64_t offset = align(sizeof(ColumnSnapshotHeader) + n_field*sizeof(ColumnFieldInfo));
+        for (int i=0; i<n_field; i++) {
+            std::memset(&_info[i], 0, sizeof(ColumnFieldInfo));
+            assert(fields[i].name.size()<sizeof(_info[i].name));
+            std::strncpy(_info[i].name, fields[i].name.c_str(), sizeof(_info[i].name)-1);
+            _info[i].type = static_cast<int32_t>(fields[i].type);
+            _info[i].offset = offset;
+            _info[i].size = _header.n_body*8;
+            offset = align(offset + _info[i].size);
+        }
+        _header.file_size = offset;
+    }
+
+    //! write one column slice of local particles into a buffer
+    static void packColumn(char* _buf, const FPSoft* _ptcl, const int64_t _n, const size_t _member_offset) {
+#pragma omp parallel for schedule(static)
+        for (int64_t i=0; i<_n; i++)
+            std::memcpy(_buf + i*8, (const char*)&_ptcl[i] + _member_offset, 8);
+    }
+
+    //! write a columnar snapshot
+    /*! Each rank writes its slice of each column at the offset of _n_offset particles.
+        If _mpi_flag is true (requiring PARTICLE_SIMULATOR_MPI_PARALLEL), the columns are written by collective MPI-IO,
+        otherwise _n_offset should be zero and _n_loc should equal n_body in _file_header.
+      @param[in] _fname: filename
+      @param[in] _file_header: snapshot header (n_body is the global number of particles)
+      @param[in] _ptcl: local particle array
+      @param[in] _n_loc: number of local particles
+      @param[in] _n_offset: prefix sum of particle numbers of previous ranks
+      @param[in] _mpi_flag: use MPI-IO
+     */
+    static void write(const char* _fname, const FileHeader& _file_header, const FPSoft* _ptcl, const int64_t _n_loc, const int64_t _n_offset, const bool _mpi_flag) {
+        ColumnSnapshotHeader header;
+        std::vector<ColumnFieldInfo> info;
+        calcLayout(header, info, _file_header);
+        const auto& fields = getFieldList();
+        const int n_field = fields.size();
+        std::vector<char> buf(_n_loc*8);
+
+#ifdef PARTICLE_SIMULATOR_MPI_PARALLEL
+        if (_mpi_flag) {
+            // MPI-IO count is int, use one 8-byte element per particle
+            if (_n_loc>(int64_t)INT32_MAX) {
+                std::cerr<<"Error: local particle number "<<_n_loc<<" exceeds the MPI-IO count limit "<<INT32_MAX<<" for columnar snapshot "<<_fname<<"!\n";
+                abort();
+            }
+            MPI_Datatype type_elem;
+            MPI_Type_contiguous(8, MPI_BYTE, &type_elem);
+            MPI_Type_commit(&type_elem);
+            MPI_File fh;
+            int err = MPI_File_open(MPI_COMM_WORLD, _fname, MPI_MODE_CREATE|MPI_MODE_WRONLY, MPI_INFO_NULL, &fh);
+            if (err!=MPI_SUCCESS) {
+                std::cerr<<"Error: Cannot open file "<<_fname<<" with MPI-IO!\n";
+                abort();
+            }
+            MPI_File_set_size(fh, header.file_size);
+            if (PS::Comm::getRank()==0) {
+                MPI_File_write_at(fh, 0, &header, sizeof(ColumnSnapshotHeader), MPI_BYTE, MPI_STATUS_IGNORE);
+                MPI_File_write_at(fh, sizeof(ColumnSnapshotHeader), info.data(), n_field*sizeof(ColumnFieldInfo), MPI_BYTE, MPI_STATUS_IGNORE);
+            }
+            for (int i=0; i<n_field; i++) {
+                packColumn(buf.data(), _ptcl, _n_loc, fields[i].offset);
+                MPI_File_write_at_all(fh, info[i].offset + _n_offset*8, buf.data(), (int)_n_loc, type_elem, MPI_STATUS_IGNORE);
+            }
+            MPI_File_close(&fh);
+            MPI_Type_free(&type_elem);
+            return;
+        }
+#endif
+        assert(!_mpi_flag);
+        assert(_n_offset==0 && _n_loc==header.n_body);
+        FILE* fout;
+        if( (fout = fopen(_fname,"w")) == NULL) {
+            std::cerr<<"Error: Cannot open file "<<_fname<<"!\n";
+            abort();
+        }
+        fwrite(&header, sizeof(ColumnSnapshotHeader), 1, fout);
+        fwrite(info.data(), sizeof(ColumnFieldInfo), n_field, fout);
+        for (int i=0; i<n_field; i++) {
+            packColumn(buf.data(), _ptcl, _n_loc, fields[i].offset);
+            fseek(fout, info[i].offset, SEEK_SET);
+            fwrite(buf.data(), 1, _n_loc*8, fout);
+        }
+        // fill the padding after the last column
+        if (ftruncate(fileno(fout), header.file_size)!=0) {
+            std::cerr<<"Error: Cannot resize file "<<_fname<<"!\n";
+            abort();
+        }
+        fclose(fout);
+    }
+};
+
+//! Reader of columnar snapshots with memory mapping
+/*! The whole file is mapped read-only, so only the pages of accessed columns are loaded from disk.
+    Example:
+        ColumnSnapshotReader reader;
+        reader.open("data.1");
+        const double* mass = reader.getColumnF64("mass");
+        const double* x = reader.getColumnF64("pos.x");
+ */
+class ColumnSnapshotReader{
+private:
+    int fd_;
+    size_t map_size_;
+    const char* map_;
+    const ColumnSnapshotHeader* header_;
+    const ColumnFieldInfo* info_;
+    std::string fname_;
+
+public:
+    ColumnSnapshotReader(): fd_(-1), map_size_(0), map_(NULL), header_(NULL), info_(NULL), fname_() {}
+
+    //! check whether a file is a columnar snapshot
+    static bool isColumnarFile(const char* _fname) {
+        FILE* fin = fopen(_fname, "r");
+        if (fin==NULL) return false;
+        char magic[8];
+        size_t rcount = fread(magic, 1, 8, fin);
+        fclose(fin);
+        return (rcount==8 && std::memcmp(magic, "PETARCOL", 8)==0);
+    }
+
+    //! open and map a columnar snapshot
+    void open(const char* _fname) {
+        close();
+        fname_ = _fname;
+        fd_ = ::open(_fname, O_RDONLY);
+        if (fd_<0) {
+            std::cerr<<"Error: Cannot open file "<<_fname<<"!\n";
+            abort();
+        }
+        struct stat st;
+        fstat(fd_, &st);
+        map_size_ = st.st_size;
+        if (map_size_<sizeof(ColumnSnapshotHeader)) {
+            std::cerr<<"Error: "<<_fname<<" is too small to be a columnar snapshot!\n";
+            abort();
+        }
+        void* ptr = mmap(NULL, map_size_, PROT_READ, MAP_SHARED, fd_, 0);
+        if (ptr==MAP_FAILED) {
+            std::cerr<<"Error: Cannot map file "<<_fname<<"!\n";
+            abort();
+        }
+        map_ = (const char*)ptr;
+        header_ = (const ColumnSnapshotHeader*)map_;
+        if (std::memcmp(header_->magic, "PETARCOL", 8)!=0) {
+            std::cerr<<"Error: "<<_fname<<" is not a columnar snapshot!\n";
+            abort();
+        }
+        if (header_->version>COLUMN_SNAPSHOT_VERSION) {
+            std::cerr<<"Error: columnar snapshot version "<<header_->version<<" of "<<_fname<<" is newer than the reader ("<<COLUMN_SNAPSHOT_VERSION<<")!\n";
+            abort();
+        }
+        if ((int64_t)map_size_<header_->file_size) {
+            std::cerr<<"Error: "<<_fname<<" is truncated, size: "<<map_size_<<" expected: "<<header_->file_size<<"!\n";
+            abort();
+        }
+        info_ = (const ColumnFieldInfo*)(map_ + sizeof(ColumnSnapshotHeader));
+    }
+
+    //! unmap and close file
+    void close() {
+        if (map_!=NULL) munmap((void*)map_, map_size_);
+        if (fd_>=0) ::close(fd_);
+        fd_ = -1;
+        map_ = NULL;
+        map_size_ = 0;
+        header_ = NULL;
+        info_ = NULL;
+    }
+
+    const ColumnSnapshotHeader& getHeader() const {
+        assert(header_!=NULL);
+        return *header_;
+    }
+
+    int64_t getNumberOfParticles() const {
+        return getHeader().n_body;
+    }
+
+    double getTime() const {
+        return getHeader().time;
+    }
+
+    int getNumberOfFields() const {
+        return getHeader().n_field;
+    }
+
+    const ColumnFieldInfo& getFieldInfo(const int _i) const {
+        assert(_i>=0&&_i<getNumberOfFields());
+        return info_[_i];
+    }
+
+    //! find the column index by name, return -1 if not found
+    int findField(const char* _name) const {
+        for (int i=0; i<getNumberOfFields(); i++)
+            if (std::strncmp(info_[i].name, _name, sizeof(info_[i].name))==0) return i;
+        return -1;
+    }
+
+    //! get pointer of a 64-bit floating column, NULL if not found
+    const double* getColumnF64(const char* _name) const {
+        int i = findField(_name);
+        if (i<0) return NULL;
+        assert(info_[i].type==static_cast<int32_t>(ColumnType::f64));
+        return (const double*)(map_ + info_[i].offset);
+    }
+
+    //! get pointer of a 64-bit integer column, NULL if not found
+    const long long int* getColumnI64(const char* _name) const {
+        int i = findField(_name);
+        if (i<0) return NULL;
+        assert(info_[i].type==static_cast<int32_t>(ColumnType::i64));
+        return (const long long int*)(map_ + info_[i].offset);
+    }
+
+    //! copy header to FileHeader
+    void getFileHeader(FileHeader& _file_header) const {
+        _file_header.nfile = getHeader().nfile;
+        _file_header.n_body = getHeader().n_body;
+        _file_header.time = getHeader().time;
+#ifdef RECORD_CM_IN_HEADER
+        for (int k=0; k<3; k++) {
+            _file_header.pos_offset[k] = getHeader().pos_offset[k];
+            _file_header.vel_offset[k] = getHeader().vel_offset[k];
+        }
+#endif
+    }
+
+    //! read particles (from _i_start to _i_start+_n) into FPSoft array
+    /*! The columns are matched by names. Members not found in the file are not modified, a warning is printed.
+      @param[out] _ptcl: particle array with size of _n
+      @param[in] _i_start: first particle index
+      @param[in] _n: number of particles
+     */
+    void readParticles(FPSoft* _ptcl, const int64_t _i_start, const int64_t _n) const {
+        assert(_i_start>=0 && _i_start+_n<=getNumberOfParticles());
+        const auto& fields = ColumnSnapshot::getFieldList();
+        for (size_t k=0; k<fields.size(); k++) {
+            int i = findField(fields[k].name.c_str());
+            if (i<0) {
+                std::cerr<<"Warning: column "<<fields[k].name<<" is not found in "<<fname_<<"!\n";
+                continue;
+            }
+            const char* col = map_ + info_[i].offset + _i_start*8;
+            const size_t offset = fields[k].offset;
+#pragma omp parallel for schedule(static)
+            for (int64_t j=0; j<_n; j++)
+                std::memcpy((char*)&_ptcl[j] + offset, col + j*8, 8);
+        }
+        // update changeover parameters from r_in and r_out
+        for (int64_t j=0; j<_n; j++) {
+            const Float r_in = _ptcl[j].changeover.getRin();
+            const Float r_out = _ptcl[j].changeover.getRout();
+            _ptcl[j].changeover.setR(1.0, r_in, r_out);
+        }
+    }
+
+    ~ColumnSnapshotReader() {
+        close();
+    }
+};
@@ -6,6 +6,66 @@
 #include"phantomquad_for_p3t_x86.hpp"
 #endif
 
+#ifdef TIDAL_TENSOR_TREE
+//! tidal tensor coefficients of EPJ with linear cutoff for c.m. artificial particles
+/*! The same force law as CalcForceEpEpWithLinearCutoff, called after the force kernel
+ */
+struct CalcTidalTensorEpEpWithLinearCutoff{
+    void operator () (const EPISoft * ep_i,
+                      const PS::S32 n_ip,
+                      const EPJSoft * ep_j,
+                      const PS::S32 n_jp,
+                      ForceSoft * force){
+        const PS::F64 eps2 = EPISoft::eps * EPISoft::eps;
+        const PS::F64 r_out2 = EPISoft::r_out*EPISoft::r_out;
+        const PS::F64 G = ForceSoft::grav_const;
+        for(PS::S32 i=0; i<n_ip; i++){
+            if (ep_i[i].tt_flag!=1) continue;
+#ifdef SOFT_RUNG
+            if (ep_i[i].type==2) continue;
+#endif
+            PS::F64 coeff[TidalTensor::N_COEFF];
+            for (PS::S32 k=0; k<TidalTensor::N_COEFF; k++) coeff[k] = 0.0;
+            const PS::F64vec xi = ep_i[i].pos;
+            for(PS::S32 j=0; j<n_jp; j++){
+                if (ep_j[j].mass==0.0) continue;
+                const PS::F64vec rij = xi - ep_j[j].pos;
+                TidalTensor::addCoeffPointMassWithLinearCutoff(coeff, rij, ep_j[j].mass, rij*rij+eps2, r_out2);
+            }
+            for (PS::S32 k=0; k<TidalTensor::N_COEFF; k++) force[i].tt_coeff[k] += G*coeff[k];
+        }
+    }
+};
+
+//! tidal tensor coefficients of SPJ for c.m. artificial particles
+/*! Only the monopole moment is used, also for the quadrupole tree
+ */
+struct CalcTidalTensorEpSpMono{
+    template<class Tsp>
+    void operator () (const EPISoft * ep_i,
+                      const PS::S32 n_ip,
+                      const Tsp * sp_j,
+                      const PS::S32 n_jp,
+                      ForceSoft * force){
+        const PS::F64 eps2 = EPISoft::eps * EPISoft::eps;
+        const PS::F64 G = ForceSoft::grav_const;
+        for(PS::S32 i=0; i<n_ip; i++){
+            if (ep_i[i].tt_flag!=1) continue;
+#ifdef SOFT_RUNG
+            if (ep_i[i].type==2) continue;
+#endif
+            PS::F64 coeff[TidalTensor::N_COEFF];
+            for (PS::S32 k=0; k<TidalTensor::N_COEFF; k++) coeff[k] = 0.0;
+            const PS::F64vec xi = ep_i[i].pos;
+            for(PS::S32 j=0; j<n_jp; j++){
+                const PS::F64vec rij = xi - sp_j[j].getPos();
+                TidalTensor::addCoeffPointMass(coeff, rij, sp_j[j].getCharge(), rij*rij+eps2);
+            }
+            for (PS::S32 k=0; k<TidalTensor::N_COEFF; k++) force[i].tt_coeff[k] += G*coeff[k];
+        }
+    }
+};
+#endif
 
 // Neighbor search function
 struct SearchNeighborEpEpNoSimd{
@@ -14,9 +74,17 @@ struct SearchNeighborEpEpNoSimd{
                       const EPJSoft * ep_j,
                       const PS::S32 n_jp,
                       ForceSoft * force){
+#ifdef SAVE_NEIGHBOR_LIST_IN_FORCE_KERNEL
+        const PS::S32 ith = PS::Comm::getThreadNum();
+        auto& id_ngb_list = NeighborListCSR::id_ngb[ith];
+#endif
         for(PS::S32 i=0; i<n_ip; i++){
             const PS::F64vec xi = ep_i[i].pos;
             PS::S32 n_ngb_i = 0;
+#ifdef SAVE_NEIGHBOR_LIST_IN_FORCE_KERNEL
+            force[i].ngb_list_thread = ith;
+            force[i].ngb_list_offset = id_ngb_list.size();
+#endif
             for(PS::S32 j=0; j<n_jp; j++){
                 const PS::F64vec rij = xi - ep_j[j].pos;
                 const PS::F64 r2 = rij * rij;
@@ -24,6 +92,9 @@ struct SearchNeighborEpEpNoSimd{
                 if(r2 < r_search*r_search){
 #ifdef SAVE_NEIGHBOR_ID_IN_FORCE_KERNEL
                     force[i].id_ngb[n_ngb_i & 0x3] = ep_j[j].id;
+#endif
+#ifdef SAVE_NEIGHBOR_LIST_IN_FORCE_KERNEL
+                    id_ngb_list.push_back(ep_j[j].id);
 #endif
                     n_ngb_i++;
                 }
@@ -45,6 +116,20 @@ struct CalcForceEpEpWithLinearCutoffNoSimd{
         const PS::F64 r_out2 = EPISoft::r_out*EPISoft::r_out;
         const PS::F64 G = ForceSoft::grav_const;
         for(PS::S32 i=0; i<n_ip; i++){
+#ifdef SOFT_RUNG
+            // inactive particles of the block-rung soft step only count neighbors, so that n_ngb is up to date for all particles
+            if (ep_i[i].type==2) {
+                const PS::F64vec xi = ep_i[i].pos;
+                PS::S32 n_ngb_i = 0;
+                for(PS::S32 j=0; j<n_jp; j++){
+                    const PS::F64vec rij = xi - ep_j[j].pos;
+                    const PS::F64 r_search = std::max(ep_i[i].r_search,ep_j[j].r_search);
+                    if(rij*rij < r_search*r_search) n_ngb_i++;
+                }
+                force[i].n_ngb = n_ngb_i;
+                continue;
+            }
+#endif
             const PS::F64vec xi = ep_i[i].pos;
             //PS::S64 id_i = ep_i[i].id;
             PS::F64vec ai = 0.0;
@@ -83,6 +168,9 @@ struct CalcForceEpEpWithLinearCutoffNoSimd{
 #endif
             force[i].n_ngb = n_ngb_i;
         }
+#ifdef TIDAL_TENSOR_TREE
+        CalcTidalTensorEpEpWithLinearCutoff()(ep_i, n_ip, ep_j, n_jp, force);
+#endif
     }
 };
 
@@ -132,6 +220,10 @@ struct CalcForceEpSpMonoNoSimd {
         const PS::F64 eps2 = EPISoft::eps * EPISoft::eps;
         const PS::F64 G = ForceSoft::grav_const;
         for(PS::S32 i=0; i<n_ip; i++){
+#ifdef SOFT_RUNG
+            // skip inactive particles of the block-rung soft step
+            if (ep_i[i].type==2) continue;
+#endif
             PS::F64vec xi = ep_i[i].pos;
             PS::F64vec ai = 0.0;
             PS::F64 poti = 0.0;
@@ -154,6 +246,9 @@ struct CalcForceEpSpMonoNoSimd {
             assert(!std::isnan(poti));
 #endif
         }
+#ifdef TIDAL_TENSOR_TREE
+        CalcTidalTensorEpSpMono()(ep_i, n_ip, sp_j, n_jp, force);
+#endif
     }
 };
 
@@ -168,6 +263,10 @@ struct CalcForceEpSpQuadNoSimd{
         const PS::F64 G = ForceSoft::grav_const;
 //        assert(n_jp==0);
         for(PS::S32 ip=0; ip<n_ip; ip++){
+#ifdef SOFT_RUNG
+            // skip inactive particles of the block-rung soft step
+            if (ep_i[ip].type==2) continue;
+#endif
             PS::F64vec xi = ep_i[ip].pos;
             PS::F64vec ai = 0.0;
             PS::F64 poti = 0.0;
@@ -196,6 +295,9 @@ struct CalcForceEpSpQuadNoSimd{
             force[ip].acc += G*ai;
             force[ip].pot += G*poti;
         }
+#ifdef TIDAL_TENSOR_TREE
+        CalcTidalTensorEpSpMono()(ep_i, n_ip, sp_j, n_jp, force);
+#endif
     }
 };
 
@@ -279,6 +381,29 @@ struct SearchNeighborEpEpSimd{
                 force[i].n_ngb += (PS::S32)(n_ngb*1.00001);
             }
         }
+#ifdef SAVE_NEIGHBOR_LIST_IN_FORCE_KERNEL
+        // save neighbor ids only for particles having neighbors (n_ngb>1, self included), 
+        // the scalar check is used to keep neighbor number consistent with the saved list
+        const PS::S32 ith = PS::Comm::getThreadNum();
+        auto& id_ngb_list = NeighborListCSR::id_ngb[ith];
+        for(PS::S32 i=0; i<n_ip; i++){
+            force[i].ngb_list_thread = ith;
+            force[i].ngb_list_offset = id_ngb_list.size();
+            if(force[i].n_ngb<=1) continue;
+            const PS::F64vec xi = ep_i[i].pos;
+            PS::S32 n_ngb_i = 0;
+            for(PS::S32 j=0; j<n_jp; j++){
+                const PS::F64vec rij = xi - ep_j[j].pos;
+                const PS::F64 r2 = rij * rij;
+                const PS::F64 r_search = std::max(ep_i[i].r_search,ep_j[j].r_search);
+                if(r2 < r_search*r_search){
+                    id_ngb_list.push_back(ep_j[j].id);
+                    n_ngb_i++;
+                }
+            }
+            force[i].n_ngb = n_ngb_i;
+        }
+#endif
     }
 };
 
@@ -401,7 +526,7 @@ struct CalcForceEpEpWithLinearCutoffSimd{
                 pg.set_epj_one(i_tmp, pos_j.x, pos_j.y, pos_j.z, m_j, ep_j[ij].r_search);
 
             }
-            pg.run_epj_for_p3t_with_linear_cutoff(n_ip, n_jp_tmp);
+            pg.run_epj_for_p3t_with_linear_cutoff(n_ip_local, n_jp_tmp);
             for(PS::S32 k=0; k<n_ip_local; k++){
                 PS::S32 i=ep_i_list[k];
                 PS::F64 p = 0;
@@ -421,6 +546,9 @@ struct CalcForceEpEpWithLinearCutoffSimd{
                 force[i].n_ngb += (PS::S32)(n_ngb*1.00001);
             }
         }
+#ifdef TIDAL_TENSOR_TREE
+        CalcTidalTensorEpEpWithLinearCutoff()(ep_i, n_ip, ep_j, n_jp, force);
+#endif
     }
 };
 
@@ -467,7 +595,7 @@ struct CalcForceEpSpMonoSimd{
                 const PS::F64vec pos_j = sp_j[i].getPos();
                 pg.set_epj_one(i_tmp, pos_j.x, pos_j.y, pos_j.z, m_j, 0.0);
             }
-            pg.run_epj(n_ip, n_jp_tmp);
+            pg.run_epj(n_ip_local, n_jp_tmp);
             for(PS::S32 k=0; k<n_ip_local; k++){
                 PS::S32 i=ep_i_list[k];
                 PS::F64 p = 0;
@@ -485,6 +613,9 @@ struct CalcForceEpSpMonoSimd{
 #endif
             }
         }
+#ifdef TIDAL_TENSOR_TREE
+        CalcTidalTensorEpSpMono()(ep_i, n_ip, sp_j, n_jp, force);
+#endif
     }
 };
 
@@ -532,7 +663,7 @@ struct CalcForceEpSpQuadSimd{
                 pg.set_spj_one(i, pos_j.x, pos_j.y, pos_j.z, m_j,
                                q.xx, q.yy, q.zz, q.xy, q.yz, q.xz);
             }
-            pg.run_spj(n_ip, n_jp_tmp);
+            pg.run_spj(n_ip_local, n_jp_tmp);
             for(PS::S32 k=0; k<n_ip_local; k++){
                 PS::S32 i=ep_i_list[k];
                 PS::F64 p = 0;
@@ -550,6 +681,9 @@ struct CalcForceEpSpQuadSimd{
                 force[i].pot += G*p;
             }
         }
+#ifdef TIDAL_TENSOR_TREE
+        CalcTidalTensorEpSpMono()(ep_i, n_ip, sp_j, n_jp, force);
+#endif
     }
 };
 #endif
@@ -1,5 +1,49 @@
 #pragma once
 #include"ptcl.hpp"
+#ifdef TIDAL_TENSOR_TREE
+#include"tidal_tensor.hpp"
+#endif
+
+#ifdef SAVE_NEIGHBOR_LIST_IN_FORCE_KERNEL
+//! compact neighbor list buffer filled by the neighbor search kernel
+/*! Each OpenMP thread appends the neighbor ids of its i-particles to its own array,
+    thus the neighbors of one i-particle are contiguous (CSR layout).
+    The i-particle saves the thread index and the offset in ForceSoft.
+    The buffer is valid until the next call of clear().
+ */
+class NeighborListCSR{
+public:
+    static PS::ReallocatableArray<PS::S64>* id_ngb; ///> neighbor id buffer for each thread
+    static PS::S32 n_thread; ///> number of threads
+
+    //! allocate buffers for all threads
+    static void initialize() {
+        if (id_ngb!=NULL) return;
+        n_thread = PS::Comm::getNumberOfThread();
+        id_ngb = new PS::ReallocatableArray<PS::S64>[n_thread];
+    }
+
+    //! clear buffers before a new neighbor search
+    static void clear() {
+        for (PS::S32 i=0; i<n_thread; i++) id_ngb[i].clearSize();
+    }
+
+    //! get neighbor id list of one i-particle
+    /*! @param[in] _ith: thread index saved in i-particle
+        @param[in] _offset: offset saved in i-particle
+     */
+    static const PS::S64* getIdList(const PS::S32 _ith, const PS::S32 _offset) {
+        return id_ngb[_ith].getPointer(_offset);
+    }
+
+    //! total number of saved neighbor ids
+    static PS::S64 getSize() {
+        PS::S64 n = 0;
+        for (PS::S32 i=0; i<n_thread; i++) n += id_ngb[i].size();
+        return n;
+    }
+};
+#endif
 
 class ForceSoft{
 public:
@@ -10,15 +54,29 @@ public:
 #endif
 #ifdef SAVE_NEIGHBOR_ID_IN_FORCE_KERNEL
     PS::S64 id_ngb[4]; /// five neighbor id
+#endif
+#ifdef SAVE_NEIGHBOR_LIST_IN_FORCE_KERNEL
+    PS::S32 ngb_list_thread; ///> thread index of neighbor list in NeighborListCSR
+    PS::S32 ngb_list_offset; ///> offset of neighbor list in NeighborListCSR
 #endif
     PS::S64 n_ngb; ///> neighbor number+1
+#ifdef TIDAL_TENSOR_TREE
+    PS::F64 tt_coeff[TidalTensor::N_COEFF]; ///> tidal tensor coefficients at c.m. particles (tt_flag), c.m. force not included
+#endif
     static PS::F64 grav_const; ///> gravitational constant
     void clear(){
         acc = 0.0;
         pot = 0.0;
         n_ngb = 0;
+#ifdef TIDAL_TENSOR_TREE
+        for (int k=0; k<TidalTensor::N_COEFF; k++) tt_coeff[k] = 0.0;
+#endif
 #ifdef SAVE_NEIGHBOR_ID_IN_FORCE_KERNEL
         id_ngb[0] = id_ngb[1] = id_ngb[2] = id_ngb[3] = 0;
+#endif
+#ifdef SAVE_NEIGHBOR_LIST_IN_FORCE_KERNEL
+        ngb_list_thread = -1;
+        ngb_list_offset = 0;
 #endif
     }
 };
@@ -36,13 +94,37 @@ public:
 #endif
 #ifdef SAVE_NEIGHBOR_ID_IN_FORCE_KERNEL
     PS::S64 id_ngb[4];
+#endif
+#ifdef SAVE_NEIGHBOR_LIST_IN_FORCE_KERNEL
+    PS::S32 ngb_list_thread;
+    PS::S32 ngb_list_offset;
 #endif
     PS::S64 n_ngb;
     PS::S32 rank_org;
     PS::S32 adr;
+#ifdef SOFT_RUNG
+    PS::S32 rung;         // soft step level, step = dt_tree * 2^rung
+    PS::S32 rung_active;  // 1: soft force is updated in the current tree step; 0: inactive
+    PS::F64 time_rung;    // time of the last kick at the rung step boundary
+    PS::F64 dt_rung_open; // pending opening half kick step, 0: closed
+#endif
+#ifdef DOMAIN_HARD_COST
+    PS::F64 cost_hard;    // measured hard integration time per step attributed to this particle (cluster time / member number), weight of domain sampling
+#endif
+#ifdef TIDAL_TENSOR_TREE
+    PS::F64 tt_coeff[TidalTensor::N_COEFF]; // tidal tensor coefficients from the tree force, only used by c.m. artificial particles
+#endif
 //    static PS::F64 r_out;
 
-    FPSoft() {}
+#ifdef SOFT_RUNG
+    FPSoft(): rung(0), rung_active(1), time_rung(0.0), dt_rung_open(0.0) {
+#else
+    FPSoft() {
+#endif
+#ifdef DOMAIN_HARD_COST
+        cost_hard = 0.0;
+#endif
+    }
 
     //! Get position (required for \ref ARC::chain)
     /*! \return position vector (PS::F64[3])
@@ -79,6 +161,15 @@ public:
         pot_ext = 0;
 #endif
         n_ngb = 0;
+#ifdef SOFT_RUNG
+        rung = 0;
+        rung_active = 1;
+        time_rung = 0.0;
+        dt_rung_open = 0.0;
+#endif
+#ifdef DOMAIN_HARD_COST
+        cost_hard = 0.0;
+#endif
     }
 
     void copyFromForce(const ForceSoft & force){
@@ -90,8 +181,15 @@ public:
 #endif
 #ifdef SAVE_NEIGHBOR_ID_IN_FORCE_KERNEL
         for (int k=0; k<4; k++) id_ngb[k] = force.id_ngb[k];
+#endif
+#ifdef SAVE_NEIGHBOR_LIST_IN_FORCE_KERNEL
+        ngb_list_thread = force.ngb_list_thread;
+        ngb_list_offset = force.ngb_list_offset;
 #endif
         n_ngb = force.n_ngb;
+#ifdef TIDAL_TENSOR_TREE
+        for (int k=0; k<TidalTensor::N_COEFF; k++) tt_coeff[k] = force.tt_coeff[k];
+#endif
     }
 
     PS::F64 getRSearch() const {
@@ -120,6 +218,29 @@ public:
 #endif
     }
 
+    //! write class data to a memory buffer with the same layout as writeBinary
+    /*! @param[in,out] _buf: buffer pointer, shifted to the end of written data after return
+     */
+    void writeBinaryToBuffer(char*& _buf) const{
+        Ptcl::writeBinaryToBuffer(_buf);
+#ifdef EXTERNAL_POT_IN_PTCL
+        const size_t size = 7*sizeof(PS::F64);
+#else
+        const size_t size = 6*sizeof(PS::F64);
+#endif
+        std::memcpy(_buf, &(this->acc), size);
+        _buf += size;
+    }
+
+    //! get the data size in bytes of writeBinary
+    static size_t getBinarySize() {
+#ifdef EXTERNAL_POT_IN_PTCL
+        return Ptcl::getBinarySize() + 7*sizeof(PS::F64);
+#else
+        return Ptcl::getBinarySize() + 6*sizeof(PS::F64);
+#endif
+    }
+
     void readAscii(FILE* fp) {
         Ptcl::readAscii(fp);
         PS::S64 rcount=fscanf(fp, "%lf %lf %lf %lf %lf ",
@@ -274,9 +395,12 @@ public:
     PS::F64vec pos;
     PS::F64 r_search;
     PS::S32 rank_org;
-    PS::S32 type; // 0: orbital artificial particles; 1: others
+    PS::S32 type; // 0: orbital artificial particles; 1: others; 2: inactive particles in the block-rung soft step (SOFT_RUNG)
 #ifdef KDKDK_4TH
     PS::F64vec acc;
+#endif
+#ifdef TIDAL_TENSOR_TREE
+    PS::S32 tt_flag; // 1: c.m. artificial particles, tidal tensor coefficients are calculated; 0: others
 #endif
     static PS::F64 eps;
     static PS::F64 r_out;
@@ -286,6 +410,12 @@ public:
         pos = fp.pos;
         if (fp.group_data.artificial.isArtificial() && !fp.group_data.artificial.isCM() && fp.mass>0 ) type = 0;
         else type = 1;
+#ifdef SOFT_RUNG
+        if (!fp.rung_active) type = 2;
+#endif
+#ifdef TIDAL_TENSOR_TREE
+        tt_flag = fp.group_data.artificial.isCM() ? 1 : 0;
+#endif
 
 #ifdef KDKDK_4TH
         acc = fp.acc;
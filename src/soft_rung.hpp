@@ -0,0 +1,239 @@
+#pragma once
+#include <cmath>
+
+//! Block-rung (hierarchical) time steps for the soft force of single particles
+/*! Each single particle (not in any cluster) has a rung r and its soft step is dt_tree * 2^r.
+    The soft force of a particle is only updated at its own step boundaries (active particle),
+    thus the tree force kernels skip inactive i-particles (EPISoft::type == 2).
+    All particles are still drifted every tree step, so the j-particles are always at the current time.
+    The neighbor search is not affected by the rung: the neighbor tree pass and the neighbor count of the force kernel include inactive particles,
+    and n_ngb is not restored, thus an inactive particle approaching another particle joins a cluster in the same tree step as a rung 0 particle.
+
+    The kick-drift-kick leap frog of one particle with rung step dt_r is:
+    at the boundary time t, v += a(t) * (h_old + h_new), where h_old is the pending opening half step from the last boundary and h_new = dt_r/2.
+    The particle state (FPSoft) stores the rung, the active flag, the time of the last kick (time_rung) and the pending opening half step (dt_rung_open, 0 means closed).
+
+    Particles in clusters always use the base tree step (rung 0) to keep the cluster and changeover machinery unchanged.
+    If a particle with an open rung step must be synchronized before its boundary (entering a cluster, output, changeover update or interruption),
+    the opening kick is corrected with the stored acceleration so that the particle is equivalent to a rung 0 particle opened at t - dt_tree.
+
+    The rung is determined after the force update by eta * |a|/|da/dt|, where da/dt is estimated from the accelerations of the two last boundaries.
+    The rung can increase by at most one level per step, and the new step should be commensurate with the current time and the output interval.
+ */
+class SoftRungManager{
+private:
+    //! force backup of single particles before the tree force calculation
+    struct ForceBackup{
+        PS::S32 adr;
+        PS::F64vec acc;
+        PS::F64 pot_tot;
+        PS::F64 pot_soft;
+#ifdef EXTERNAL_POT_IN_PTCL
+        PS::F64 pot_ext;
+#endif
+    };
+
+    PS::ReallocatableArray<ForceBackup> backup_;   // backup of single particles
+    PS::ReallocatableArray<PS::S32> single_flag_;  // 1: single particle (in one cluster list); 0: cluster member
+    PS::S64 n_active_;  // accumulated number of active single particles
+    PS::S64 n_single_;  // accumulated number of single particles
+
+    //! check whether a particle reaches its step boundary
+    template <class Tptcl>
+    static bool isAtBoundary(const Tptcl& _p, const PS::F64 _time, const PS::F64 _dt_tree) {
+        return _p.dt_rung_open==0.0 || _time >= _p.time_rung + 2.0*_p.dt_rung_open - 1e-8*_dt_tree;
+    }
+
+    //! close an open rung step before the step boundary
+    /*! Correct the opening kick by the stored acceleration, so that the particle is equivalent to a rung 0 particle opened at t - dt_tree
+     */
+    template <class Tptcl>
+    static void demote(Tptcl& _p, const PS::F64 _time, const PS::F64 _dt_tree) {
+        const PS::F64 dt_half = 0.5*_dt_tree;
+        if (_p.dt_rung_open>0.0) {
+            const PS::F64 dt_last = _time - _p.time_rung;
+            _p.vel += _p.acc * (dt_last - _p.dt_rung_open - dt_half);
+            _p.dt_rung_open = dt_half;
+        }
+        _p.time_rung = _time - _dt_tree;
+        _p.rung = 0;
+    }
+
+public:
+    PS::S32 rung_max; ///> maximum rung, 0: switch off
+    PS::F64 eta;      ///> rung step coefficient
+
+    SoftRungManager(): backup_(), single_flag_(), n_active_(0), n_single_(0), rung_max(0), eta(0.05) {}
+
+    //! initialize the rung state of particles
+    template <class Tsys>
+    void initial(Tsys& _sys, const PS::S64 _n) {
+#pragma omp parallel for
+        for (PS::S64 i=0; i<_n; i++) {
+            _sys[i].rung = 0;
+            _sys[i].rung_active = 1;
+            _sys[i].time_rung = 0.0;
+            _sys[i].dt_rung_open = 0.0;
+        }
+    }
+
+    //! synchronize rung steps of particles in clusters
+    /*! Call after the cluster search and before creating groups (members are copied to the hard systems)
+      @param[in,out] _sys: particle system
+      @param[in] _n_real_loc: number of local real particles
+      @param[in] _adr_single: address list of single particles
+      @param[in] _time: current time
+      @param[in] _dt_tree: base tree step
+     */
+    template <class Tsys>
+    void synchronizeClusterMember(Tsys& _sys, const PS::S64 _n_real_loc, const PS::ReallocatableArray<PS::S32>& _adr_single, const PS::F64 _time, const PS::F64 _dt_tree) {
+        single_flag_.resizeNoInitialize(_n_real_loc);
+#pragma omp parallel for
+        for (PS::S64 i=0; i<_n_real_loc; i++) single_flag_[i] = 0;
+        const PS::S64 n_single = _adr_single.size();
+#pragma omp parallel for
+        for (PS::S64 i=0; i<n_single; i++) single_flag_[_adr_single[i]] = 1;
+#pragma omp parallel for
+        for (PS::S64 i=0; i<_n_real_loc; i++) {
+            if (!single_flag_[i] && (_sys[i].rung>0 || _sys[i].dt_rung_open>0.0)) demote(_sys[i], _time, _dt_tree);
+        }
+    }
+
+    //! set active flags for the tree force and backup forces of single particles
+    /*! Call before the tree force calculation
+      @param[in,out] _sys: particle system
+      @param[in] _n_loc_all: number of all local particles (including artificial particles)
+      @param[in] _adr_single: address list of single particles
+      @param[in] _time: current time
+      @param[in] _dt_tree: base tree step
+      @param[in] _sync_flag: if true, all particles are synchronized (start or end of the continuing steps)
+     */
+    template <class Tsys>
+    void setActive(Tsys& _sys, const PS::S64 _n_loc_all, const PS::ReallocatableArray<PS::S32>& _adr_single, const PS::F64 _time, const PS::F64 _dt_tree, const bool _sync_flag) {
+#pragma omp parallel for
+        for (PS::S64 i=0; i<_n_loc_all; i++) _sys[i].rung_active = 1;
+
+        const PS::S64 n_single = _adr_single.size();
+        backup_.resizeNoInitialize(n_single);
+        PS::S64 n_active = 0;
+#pragma omp parallel for reduction(+:n_active)
+        for (PS::S64 i=0; i<n_single; i++) {
+            const PS::S32 k = _adr_single[i];
+            auto& pk = _sys[k];
+            if (!isAtBoundary(pk, _time, _dt_tree)) {
+                if (_sync_flag) demote(pk, _time, _dt_tree);
+                else pk.rung_active = 0;
+            }
+            if (pk.rung_active) n_active++;
+            ForceBackup& bk = backup_[i];
+            bk.adr = k;
+            bk.acc = pk.acc;
+            bk.pot_tot = pk.pot_tot;
+            bk.pot_soft = pk.pot_soft;
+#ifdef EXTERNAL_POT_IN_PTCL
+            bk.pot_ext = pk.pot_ext;
+#endif
+        }
+        n_active_ += n_active;
+        n_single_ += n_single;
+    }
+
+    //! restore forces of inactive particles and update rungs of active single particles
+    /*! Call after the tree force, external force and changeover correction.
+        The neighbor number (n_ngb) of inactive particles is kept from the force kernel.
+      @param[in,out] _sys: particle system
+      @param[in] _time: current time
+      @param[in] _dt_tree: base tree step
+      @param[in] _dt_output: output time interval, the rung step should not exceed it
+     */
+    template <class Tsys>
+    void restoreAndUpdateRung(Tsys& _sys, const PS::F64 _time, const PS::F64 _dt_tree, const PS::F64 _dt_output) {
+        const PS::S64 n_single = backup_.size();
+#pragma omp parallel for
+        for (PS::S64 i=0; i<n_single; i++) {
+            const ForceBackup& bk = backup_[i];
+            auto& pk = _sys[bk.adr];
+            if (!pk.rung_active) {
+                pk.acc = bk.acc;
+                pk.pot_tot = bk.pot_tot;
+                pk.pot_soft = bk.pot_soft;
+#ifdef EXTERNAL_POT_IN_PTCL
+                pk.pot_ext = bk.pot_ext;
+#endif
+                pk.rung_active = 1;
+                continue;
+            }
+
+            // new rung from the acceleration change since the last boundary
+            PS::S32 rung_new = 0;
+            const PS::F64 dt_last = _time - pk.time_rung;
+            if (pk.dt_rung_open>0.0 && dt_last>0.0) {
+                const PS::F64vec da = pk.acc - bk.acc;
+                const PS::F64 da2 = da*da;
+                const PS::F64 a2 = pk.acc*pk.acc;
+                PS::F64 dt_est = 2.0*_dt_output;
+                if (da2>0.0) dt_est = std::min(dt_est, eta*std::sqrt(a2/da2)*dt_last);
+                rung_new = std::min(std::min(pk.rung+1, rung_max), std::max(0, (PS::S32)std::floor(std::log2(dt_est/_dt_tree))));
+            }
+            // the step should be commensurate with the current time and the output interval
+            while (rung_new>0) {
+                const PS::F64 dt_rung = _dt_tree*std::pow(2.0, rung_new);
+                if (dt_rung<=_dt_output && std::fmod(_time, dt_rung)==0.0 && std::fmod(_dt_output, dt_rung)==0.0) break;
+                rung_new--;
+            }
+            pk.rung = rung_new;
+        }
+    }
+
+    //! kick single particles and update the rung state of all local real particles
+    /*! The inactive single particles are not kicked.
+        For the continuing step, both closing and opening half kicks are applied;
+        for the starting step, only the opening half kick; for the ending step, only the closing half kick.
+      @param[in,out] _sys: particle system
+      @param[in] _n_real_loc: number of local real particles
+      @param[in] _adr_single: address list of single particles
+      @param[in] _time: current time
+      @param[in] _dt_tree: base tree step
+      @param[in] _close_flag: apply closing half kick
+      @param[in] _open_flag: apply opening half kick
+     */
+    template <class Tsys>
+    void kick(Tsys& _sys, const PS::S64 _n_real_loc, const PS::ReallocatableArray<PS::S32>& _adr_single, const PS::F64 _time, const PS::F64 _dt_tree, const bool _close_flag, const bool _open_flag) {
+        const PS::S64 n_single = _adr_single.size();
+#pragma omp parallel for
+        for (PS::S64 i=0; i<n_single; i++) {
+            const PS::S32 k = _adr_single[i];
+            auto& pk = _sys[k];
+            pk.group_data.artificial.setParticleTypeToSingle();
+            if (!isAtBoundary(pk, _time, _dt_tree)) continue;
+            const PS::F64 dt_open = _open_flag ? 0.5*_dt_tree*std::pow(2.0, pk.rung) : 0.0;
+            const PS::F64 dt_close = _close_flag ? pk.dt_rung_open : 0.0;
+            pk.vel += pk.acc * (dt_close + dt_open);
+            pk.time_rung = _time;
+            pk.dt_rung_open = dt_open;
+        }
+
+        // particles in clusters use the base tree step
+        const PS::F64 dt_open = _open_flag ? 0.5*_dt_tree : 0.0;
+        assert((PS::S64)single_flag_.size()==_n_real_loc);
+#pragma omp parallel for
+        for (PS::S64 i=0; i<_n_real_loc; i++) {
+            if (!single_flag_[i]) {
+                _sys[i].rung = 0;
+                _sys[i].time_rung = _time;
+                _sys[i].dt_rung_open = dt_open;
+            }
+        }
+    }
+
+    //! get the ratio of accumulated active single particles to all single particles
+    PS::F64 getActiveFraction() const {
+        return n_single_>0 ? (PS::F64)n_active_/(PS::F64)n_single_ : 1.0;
+    }
+
+    //! clear the accumulated counts
+    void clearCount() {
+        n_active_ = 0;
+        n_single_ = 0;
+    }
+};
@@ -0,0 +1,95 @@
+#include <iostream>
+#include <cstdio>
+#include <iomanip>
+#include <cstdlib>
+#include <cassert>
+#include <particle_simulator.hpp>
+#include "soft_ptcl.hpp"
+#include "soft_force.hpp"
+#include "soft_rung.hpp"
+#include "static_variables.hpp"
+
+#ifndef SOFT_RUNG
+#error "soft_rung_test should be compiled with -D SOFT_RUNG"
+#endif
+
+//! calculate the particle-particle soft force of all particles, the same as one tree step with a single leaf
+void calcForce(FPSoft* _ptcl, const PS::S32 _n) {
+    PS::ReallocatableArray<EPISoft> epi;
+    PS::ReallocatableArray<EPJSoft> epj;
+    PS::ReallocatableArray<ForceSoft> force;
+    epi.resizeNoInitialize(_n);
+    epj.resizeNoInitialize(_n);
+    force.resizeNoInitialize(_n);
+    for (PS::S32 i=0; i<_n; i++) {
+        epi[i].copyFromFP(_ptcl[i]);
+        epj[i].copyFromFP(_ptcl[i]);
+        force[i].clear();
+    }
+    CalcForceEpEpWithLinearCutoffNoSimd()(epi.getPointer(), _n, epj.getPointer(), _n, force.getPointer());
+    for (PS::S32 i=0; i<_n; i++) _ptcl[i].copyFromForce(force[i]);
+}
+
+int main(int argc, char **argv){
+    const PS::F64 dt_tree = 1.0/64.0;
+    const PS::F64 dt_output = 1.0/8.0;
+    EPISoft::eps = 0.0;
+    EPISoft::r_out = 0.01;
+
+    // an active particle at the origin and a rung 1 particle far away
+    const PS::S32 n = 2;
+    FPSoft ptcl[n];
+    PS::ReallocatableArray<PS::S32> adr_single;
+    for (PS::S32 i=0; i<n; i++) {
+        ptcl[i].mass = 1.0;
+        ptcl[i].id = i+1;
+        ptcl[i].vel = PS::F64vec(0.0);
+        ptcl[i].r_search = 0.1;
+        ptcl[i].group_data.artificial.setParticleTypeToSingle();
+        adr_single.push_back(i);
+    }
+    ptcl[0].pos = PS::F64vec(0.0);
+    ptcl[1].pos = PS::F64vec(10.0, 0.0, 0.0);
+
+    SoftRungManager manager;
+    manager.rung_max = 3;
+    manager.initial(ptcl, n);
+
+    // first tree step, both particles are active and isolated
+    manager.setActive(ptcl, n, adr_single, 0.0, dt_tree, true);
+    calcForce(ptcl, n);
+    manager.restoreAndUpdateRung(ptcl, 0.0, dt_tree, dt_output);
+    assert(ptcl[0].n_ngb==1 && ptcl[1].n_ngb==1);
+
+    // open a rung 1 step of particle 1 at time 0, it is inactive at the next tree step
+    ptcl[1].rung = 1;
+    ptcl[1].time_rung = 0.0;
+    ptcl[1].dt_rung_open = dt_tree;
+    const PS::F64vec acc_inactive = ptcl[1].acc;
+
+    // particle 1 drifts into the neighbor radius of particle 0
+    ptcl[1].pos = PS::F64vec(0.05, 0.0, 0.0);
+    manager.setActive(ptcl, n, adr_single, dt_tree, dt_tree, false);
+    assert(ptcl[0].rung_active==1);
+    assert(ptcl[1].rung_active==0);
+    calcForce(ptcl, n);
+    manager.restoreAndUpdateRung(ptcl, dt_tree, dt_tree, dt_output);
+
+    std::cout<<std::setprecision(14)
+             <<"active: n_ngb "<<ptcl[0].n_ngb<<" acc "<<ptcl[0].acc<<"\n"
+             <<"inactive: n_ngb "<<ptcl[1].n_ngb<<" acc "<<ptcl[1].acc<<std::endl;
+
+    // the force of the inactive particle is kept, but both particles see each other as neighbors
+    PS::F64vec dacc = ptcl[1].acc - acc_inactive;
+    assert(dacc*dacc==0.0);
+    assert(ptcl[0].acc.x>0.0);
+    if (ptcl[0].n_ngb!=2 || ptcl[1].n_ngb!=2) {
+        std::cerr<<"Error: the neighbor numbers of the active ("<<ptcl[0].n_ngb<<") and the inactive ("<<ptcl[1].n_ngb<<") particles are inconsistent!"<<std::endl;
+        abort();
+    }
+    assert(ptcl[1].rung_active==1);
+
+    std::cout<<"Soft rung test passed"<<std::endl;
+
+    return 0;
+}
@@ -10,3 +10,7 @@ PS::F64 EPISoft::eps = 0.0;
 PS::F64 EPISoft::r_out = 0.0;
 PS::F64 ForceSoft::grav_const = 1.0;
 
+#ifdef SAVE_NEIGHBOR_LIST_IN_FORCE_KERNEL
+PS::ReallocatableArray<PS::S64>* NeighborListCSR::id_ngb = NULL;
+PS::S32 NeighborListCSR::n_thread = 0;
+#endif
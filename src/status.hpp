@@ -106,118 +106,90 @@ public:
         pcm.is_center_shift_flag = false;
     }
 
-    //! calculate the center of system 
-    /*!
+    //! add local sums for the center of system to a batch of global summations
+    /*! The local summation is OpenMP parallelized by ParallelSum, the result does not depend on the number of threads
+      @param[in,out] _buf: summation buffer
       @param[in] _tsys: particle system
       @param[in] _n: number of particle
       @param[in] _mode: calculation mode, 1: center-of-the-mass; 2: number (no mass) weighted center; 3: soft potential weighted center
-     */
+      \return the index of the first value in _buf
+    */
     template <class Tsoft>
-    void calcCenterOfMass(Tsoft* _tsys, const PS::S64 _n, int _mode=3) {
-        PS::F64 mass = 0.0;
-        PS::F64vec pos_cm = PS::F64vec(0.0);
-        PS::F64vec vel_cm = PS::F64vec(0.0);
-
-        if (_mode==1) { // center of the mass
-//#pragma omp declare reduction(+:PS::F64vec:omp_out += omp_in) initializer (omp_priv=PS::F64vec(0.0))
-//#pragma omp parallel for reduction(+:mass,pos_cm,vel_cm)
-            for (int i=0; i<_n; i++) {
-                auto& pi = _tsys[i];
-                PS::F64 mi = pi.mass;
-                mass  += mi;
+    PS::S32 addCenterOfMassToSum(ReductionSumBuffer& _buf, Tsoft* _tsys, const PS::S64 _n, int _mode=3) const {
+        // sum: mass, pos_cm, vel_cm, weight (total weight except mass-weighted case)
+        PS::F64 sum[8];
+        ParallelSum::calc(sum, 8, _n, [&](const PS::S64 i, PS::F64* _sum) {
+            auto& pi = _tsys[i];
+            PS::F64 mi = pi.mass;
 #ifdef NAN_CHECK_DEBUG
-                assert(!std::isnan(pi.vel.x));
-                assert(!std::isnan(pi.vel.y));
-                assert(!std::isnan(pi.vel.z));
+            assert(!std::isnan(pi.vel.x));
+            assert(!std::isnan(pi.vel.y));
+            assert(!std::isnan(pi.vel.z));
 #endif
-                pos_cm += mi*pi.pos;
-                vel_cm += mi*pi.vel;
-            }        
-
-#ifdef PARTICLE_SIMULATOR_MPI_PARALLEL
-            pcm.mass = PS::Comm::getSum(mass);
-            pcm.pos  = PS::Comm::getSum(pos_cm);
-            pcm.vel  = PS::Comm::getSum(vel_cm);
-#else
-            pcm.mass = mass;
-            pcm.pos  = pos_cm;
-            pcm.vel  = vel_cm;
+            PS::F64 wi = 0.0;
+            if (_mode==1) wi = mi; // center of the mass
+            else if (_mode==2) wi = 1.0; // no mass weighted center
+            else if (_mode==3) { // soft potential
+                wi = pi.pot_soft;
+#ifdef EXTERNAL_POT_IN_PTCL
+                wi -= pi.pot_ext; // remove external potential
 #endif
-            if (pcm.mass>0) {
-                pcm.pos /= pcm.mass;
-                pcm.vel /= pcm.mass;
+                _sum[7] += wi;
             }
-        }
-        else if (_mode==2) { // no mass weighted center
-//#pragma omp declare reduction(+:PS::F64vec:omp_out += omp_in) initializer (omp_priv=PS::F64vec(0.0))
-//#pragma omp parallel for reduction(+:mass,pos_cm,vel_cm)
-            for (int i=0; i<_n; i++) {
-                auto& pi = _tsys[i];
-                PS::F64 mi = pi.mass;
-                mass  += mi;
-#ifdef NAN_CHECK_DEBUG
-                assert(!std::isnan(pi.vel.x));
-                assert(!std::isnan(pi.vel.y));
-                assert(!std::isnan(pi.vel.z));
-#endif
-                pos_cm += pi.pos;
-                vel_cm += pi.vel;
-            }        
+            _sum[0] += mi;
+            _sum[1] += wi*pi.pos.x;
+            _sum[2] += wi*pi.pos.y;
+            _sum[3] += wi*pi.pos.z;
+            _sum[4] += wi*pi.vel.x;
+            _sum[5] += wi*pi.vel.y;
+            _sum[6] += wi*pi.vel.z;
+        });
+        PS::F64 mass = sum[0];
+        PS::F64vec pos_cm = PS::F64vec(sum[1], sum[2], sum[3]);
+        PS::F64vec vel_cm = PS::F64vec(sum[4], sum[5], sum[6]);
+        PS::F64 weight = sum[7];
+        if (_mode==2) weight = PS::F64(_n);
 
-#ifdef PARTICLE_SIMULATOR_MPI_PARALLEL
-            pcm.mass = PS::Comm::getSum(mass);
-            pcm.pos  = PS::Comm::getSum(pos_cm);
-            pcm.vel  = PS::Comm::getSum(vel_cm);
-            PS::S64 n_glb = PS::Comm::getSum(_n);
-#else
-            pcm.mass = mass;
-            pcm.pos  = pos_cm;
-            pcm.vel  = vel_cm;
-            PS::S64 n_glb = _n;
-#endif
-            if (n_glb>0) {
-                pcm.pos /= PS::F64(n_glb);
-                pcm.vel /= PS::F64(n_glb);
-            }
-        }
-        else if (_mode==3) { // soft potential
-            PS::F64 pot_tot = 0.0;
-            for (int i=0; i<_n; i++) {
-                auto& pi = _tsys[i];
-                PS::F64 mi = pi.mass;
-                PS::F64 poti = pi.pot_soft;
-#ifdef EXTERNAL_POT_IN_PTCL
-                poti -= pi.pot_ext; // remove external potential
-#endif
-                mass  += mi;
-#ifdef NAN_CHECK_DEBUG
-                assert(!std::isnan(pi.vel.x));
-                assert(!std::isnan(pi.vel.y));
-                assert(!std::isnan(pi.vel.z));
-#endif
-                pos_cm += poti*pi.pos;
-                vel_cm += poti*pi.vel;
-                pot_tot += poti;
-            }        
+        PS::S32 index = _buf.add(mass);
+        _buf.add(pos_cm);
+        _buf.add(vel_cm);
+        _buf.add(weight);
+        return index;
+    }
 
-#ifdef PARTICLE_SIMULATOR_MPI_PARALLEL
-            pcm.mass = PS::Comm::getSum(mass);
-            pcm.pos  = PS::Comm::getSum(pos_cm);
-            pcm.vel  = PS::Comm::getSum(vel_cm);
-            PS::F64 pot_tot_glb = PS::Comm::getSum(pot_tot);
-#else
-            pcm.mass = mass;
-            pcm.pos  = pos_cm;
-            pcm.vel  = vel_cm;
-            PS::F64 pot_tot_glb = pot_tot;
-#endif
-            if (pot_tot_glb!=0) {
-                pcm.pos /= pot_tot_glb;
-                pcm.vel /= pot_tot_glb;
-            }
+    //! get the center of system from a finished batch of global summations
+    /*!
+      @param[in] _buf: summation buffer
+      @param[in] _index: index returned by addCenterOfMassToSum
+      @param[in] _mode: calculation mode, same as the one used in addCenterOfMassToSum
+    */
+    void getCenterOfMassFromBuffer(const ReductionSumBuffer& _buf, const PS::S32 _index, int _mode=3) {
+        pcm.mass = _buf.getF64(_index);
+        pcm.pos  = _buf.getF64vec(_index+1);
+        pcm.vel  = _buf.getF64vec(_index+4);
+        PS::F64 weight = _buf.getF64(_index+7);
+        if (_mode==1) weight = pcm.mass;
+        if ((_mode==1 && weight>0) || (_mode==2 && weight>0) || (_mode==3 && weight!=0)) {
+            pcm.pos /= weight;
+            pcm.vel /= weight;
         }
     }
 
+    //! calculate the center of system 
+    /*! All global sums are done in one reduction
+      @param[in] _tsys: particle system
+      @param[in] _n: number of particle
+      @param[in] _mode: calculation mode, 1: center-of-the-mass; 2: number (no mass) weighted center; 3: soft potential weighted center
+     */
+    template <class Tsoft>
+    void calcCenterOfMass(Tsoft* _tsys, const PS::S64 _n, int _mode=3) {
+        ReductionSumBuffer buf;
+        PS::S32 index = addCenterOfMassToSum(buf, _tsys, _n, _mode);
+        buf.start();
+        buf.wait();
+        getCenterOfMassFromBuffer(buf, index, _mode);
+    }
+
     //! calculate the center of system and shift particle systems to center frame
     /*!
       @param[in] _tsys: particle system
@@ -0,0 +1,105 @@
+#pragma once
+#include <sstream>
+#include <vector>
+#include "parallel_sum.hpp"
+
+//! Batched stellar evolution of single stars in one tree step
+/*! Single stars (e.g. SystemHard::ptcl_hard_ of one-particle clusters) whose time_interrupt falls within the current tree step
+    are collected into a compact index list in the increasing order, independent of the number of threads.
+    The batch is evolved in one OpenMP loop with static schedule by ARInteraction::evolveOneStar,
+    the SSE event records are written to per-thread buffers instead of the shared fout_sse in critical sections,
+    and the buffers are appended to fout_sse in the thread order after the loop.
+    Since each thread evolves a contiguous chunk of the batch, the records follow the batch order.
+    The kinetic energy changes of all stars are then summed by ParallelSum, so the energy correction does not depend on the thread scheduling.
+ */
+class StellarEvolutionBatch{
+public:
+    PS::ReallocatableArray<PS::S32> adr;         ///> indices of stars in the batch
+    PS::ReallocatableArray<PS::S32> modify_flag; ///> return of evolveOneStar of each star in the batch, 2: velocity kick
+    PS::F64 de_kin;  ///> kinetic energy change of the last batch
+    PS::S64 n_evolve_cum; ///> accumulated number of evolved stars
+
+private:
+    PS::ReallocatableArray<PS::F64> de_kin_star_;             // kinetic energy change of each star in the batch
+    std::vector<PS::ReallocatableArray<PS::S32>> adr_thread_;  // indices collected by each thread
+    std::vector<std::ostringstream> fout_thread_;              // SSE event records of each thread
+
+public:
+    StellarEvolutionBatch(): adr(), modify_flag(), de_kin(0.0), n_evolve_cum(0), de_kin_star_(), adr_thread_(), fout_thread_() {}
+
+    //! collect stars with time_interrupt <= _time_end
+    /*!
+      @param[in] _ptcl: particle array
+      @param[in] _n: number of particles
+      @param[in] _time_end: ending time of the current step
+     */
+    template <class Tptcl>
+    void collect(const Tptcl* _ptcl, const PS::S32 _n, const PS::F64 _time_end) {
+        const PS::S32 num_thread = PS::Comm::getNumberOfThread();
+        if ((PS::S32)adr_thread_.size()<num_thread) adr_thread_.resize(num_thread);
+        // static schedule: threads scan contiguous chunks in the thread order
+#pragma omp parallel num_threads(num_thread)
+        {
+            const PS::S32 ith = PS::Comm::getThreadNum();
+            auto& adr_ith = adr_thread_[ith];
+            adr_ith.clearSize();
+#pragma omp for schedule(static)
+            for (PS::S32 i=0; i<_n; i++) {
+                if (_ptcl[i].time_interrupt<=_time_end) adr_ith.push_back(i);
+            }
+        }
+        adr.clearSize();
+        for (PS::S32 i=0; i<num_thread; i++) {
+            for (PS::S32 k=0; k<adr_thread_[i].size(); k++) adr.push_back(adr_thread_[i][k]);
+        }
+    }
+
+    //! evolve stars in the batch to _time_end and sum the kinetic energy changes
+    /*!
+      @param[in,out] _ptcl: particle array used in collect
+      @param[in] _interaction: ARInteraction that evolves one star
+      @param[in] _time_end: ending time of the current step
+      @param[in,out] _fout: output of SSE events (fout_sse)
+     */
+    template <class Tptcl, class Tinteraction>
+    void evolve(Tptcl* _ptcl, Tinteraction& _interaction, const PS::F64 _time_end, std::ostream& _fout) {
+        const PS::S32 n_batch = adr.size();
+        de_kin = 0.0;
+        modify_flag.resizeNoInitialize(n_batch);
+        if (n_batch==0) return;
+        de_kin_star_.resizeNoInitialize(n_batch);
+
+        const PS::S32 num_thread = PS::Comm::getNumberOfThread();
+        if ((PS::S32)fout_thread_.size()<num_thread) fout_thread_.resize(num_thread);
+        for (PS::S32 i=0; i<num_thread; i++) {
+            fout_thread_[i].str("");
+            fout_thread_[i].clear();
+            fout_thread_[i].precision(_fout.precision());
+        }
+
+        // static schedule: threads evolve contiguous chunks, thus the buffers in the thread order follow the batch order
+#pragma omp parallel for schedule(static) num_threads(num_thread)
+        for (PS::S32 k=0; k<n_batch; k++) {
+            const PS::S32 ith = PS::Comm::getThreadNum();
+            auto& pk = _ptcl[adr[k]];
+            const PS::F64 mbk = pk.mass;
+            const PS::F64vec vbk = pk.vel; //back up velocity in case of change
+            assert(!std::isinf(vbk.x));
+            assert(!std::isnan(vbk.x));
+            modify_flag[k] = _interaction.evolveOneStar(pk, _time_end, fout_thread_[ith], false);
+            if (modify_flag[k]) {
+                const PS::F64vec& v = pk.vel;
+                de_kin_star_[k] = 0.5*(pk.mass*(v*v) - mbk*(vbk*vbk));
+            }
+            else de_kin_star_[k] = 0.0;
+        }
+
+        for (PS::S32 i=0; i<num_thread; i++) {
+            if (fout_thread_[i].tellp()>0) _fout<<fout_thread_[i].str();
+        }
+
+        const PS::F64* de_kin_star = de_kin_star_.getPointer();
+        ParallelSum::calc(&de_kin, 1, n_batch, [&](const PS::S64 k, PS::F64* sum){ sum[0] += de_kin_star[k]; });
+        n_evolve_cum += n_batch;
+    }
+};
@@ -437,7 +437,296 @@ public:
         return 8;
 #else
         return 4;
+#endif
+    }
+
+    //! number of tensor coefficients accumulated by the tree force kernels (TIDAL_TENSOR_TREE)
+    /*! symmetric T2 (6): xx xy xz yy yz zz; symmetric T3 (10): the same order as T3
+     */
+#ifdef TIDAL_TENSOR_3RD
+    static const PS::S32 N_COEFF = 16;
+#else
+    static const PS::S32 N_COEFF = 6;
+#endif
+
+    //! add tensor coefficients of a radial force kernel
+    /*! For the acceleration \f$ a = - m f(s) dr \f$ with \f$ s = \sqrt{dr^2 + \epsilon^2} \f$:
+      \f$ T2_{ab} = \partial_b a_a = - m (f \delta_{ab} + g_1 dr_a dr_b) \f$ \n
+      \f$ T3_{abc} = \frac{1}{2} \partial_b \partial_c a_a = -\frac{m}{2} [ g_1 (\delta_{ab} dr_c + \delta_{ac} dr_b + \delta_{bc} dr_a) + g_2 dr_a dr_b dr_c ] \f$ \n
+      where \f$ g_1 = f'/s \f$, \f$ g_2 = (f'' - f'/s)/s^2 \f$
+      @param[in,out] _coeff: coefficients to add (N_COEFF)
+      @param[in] _dr: position of measuring point - position of source
+      @param[in] _mass: source mass
+      @param[in] _f: f(s)
+      @param[in] _g1: g_1(s)
+      @param[in] _g2: g_2(s), only used for TIDAL_TENSOR_3RD
+     */
+    static void addCoeffRadial(PS::F64* _coeff, const PS::F64vec& _dr, const PS::F64 _mass, const PS::F64 _f, const PS::F64 _g1, const PS::F64 _g2) {
+        const PS::F64 x = _dr.x;
+        const PS::F64 y = _dr.y;
+        const PS::F64 z = _dr.z;
+        const PS::F64 mg1 = _mass*_g1;
+        _coeff[0] -= _mass*_f + mg1*x*x;
+        _coeff[1] -= mg1*x*y;
+        _coeff[2] -= mg1*x*z;
+        _coeff[3] -= _mass*_f + mg1*y*y;
+        _coeff[4] -= mg1*y*z;
+        _coeff[5] -= _mass*_f + mg1*z*z;
+#ifdef TIDAL_TENSOR_3RD
+        const PS::F64 h1 = 0.5*mg1;
+        const PS::F64 h2 = 0.5*_mass*_g2;
+        _coeff[6]  -= 3.0*h1*x + h2*x*x*x; // xxx
+        _coeff[7]  -=     h1*y + h2*x*x*y; // xxy
+        _coeff[8]  -=     h1*z + h2*x*x*z; // xxz
+        _coeff[9]  -=     h1*x + h2*x*y*y; // xyy
+        _coeff[10] -=            h2*x*y*z; // xyz
+        _coeff[11] -=     h1*x + h2*x*z*z; // xzz
+        _coeff[12] -= 3.0*h1*y + h2*y*y*y; // yyy
+        _coeff[13] -=     h1*z + h2*y*y*z; // yyz
+        _coeff[14] -=     h1*y + h2*y*z*z; // yzz
+        _coeff[15] -= 3.0*h1*z + h2*z*z*z; // zzz
+#endif
+    }
+
+    //! add tensor coefficients of a softened point mass, \f$ f = s^{-3} \f$
+    /*!
+      @param[in,out] _coeff: coefficients to add (N_COEFF)
+      @param[in] _dr: position of measuring point - position of source
+      @param[in] _mass: source mass
+      @param[in] _r2_eps: \f$ s^2 = dr^2 + \epsilon^2 \f$
+     */
+    static void addCoeffPointMass(PS::F64* _coeff, const PS::F64vec& _dr, const PS::F64 _mass, const PS::F64 _r2_eps) {
+        const PS::F64 r_inv = 1.0/sqrt(_r2_eps);
+        const PS::F64 r2_inv = r_inv*r_inv;
+        const PS::F64 r3_inv = r2_inv*r_inv;
+        const PS::F64 r5_inv = r3_inv*r2_inv;
+        addCoeffRadial(_coeff, _dr, _mass, r3_inv, -3.0*r5_inv, 15.0*r5_inv*r2_inv);
+    }
+
+    //! add tensor coefficients of a softened point mass with the linear cutoff used in the tree force
+    /*! Inside r_out, the force is \f$ - m r_{out}^{-3} dr \f$, thus only the constant diagonal T2 remains
+      @param[in,out] _coeff: coefficients to add (N_COEFF)
+      @param[in] _dr: position of measuring point - position of source
+      @param[in] _mass: source mass
+      @param[in] _r2_eps: \f$ s^2 = dr^2 + \epsilon^2 \f$
+      @param[in] _r_out2: \f$ r_{out}^2 \f$
+     */
+    static void addCoeffPointMassWithLinearCutoff(PS::F64* _coeff, const PS::F64vec& _dr, const PS::F64 _mass, const PS::F64 _r2_eps, const PS::F64 _r_out2) {
+        if (_r2_eps>_r_out2) addCoeffPointMass(_coeff, _dr, _mass, _r2_eps);
+        else {
+            const PS::F64 r_out_inv = 1.0/sqrt(_r_out2);
+            addCoeffRadial(_coeff, _dr, _mass, r_out_inv*r_out_inv*r_out_inv, 0.0, 0.0);
+        }
+    }
+
+    //! add tensor coefficients of a softened point mass weighted by a changeover function k(s), \f$ f = k s^{-3} \f$
+    /*!
+      @param[in,out] _coeff: coefficients to add (N_COEFF)
+      @param[in] _dr: position of measuring point - position of source
+      @param[in] _mass: source mass
+      @param[in] _r2_eps: \f$ s^2 = dr^2 + \epsilon^2 \f$
+      @param[in] _k: k(s)
+      @param[in] _dk: dk/ds
+      @param[in] _d2k: d^2k/ds^2, only used for TIDAL_TENSOR_3RD
+     */
+    static void addCoeffPointMassWithChangeOver(PS::F64* _coeff, const PS::F64vec& _dr, const PS::F64 _mass, const PS::F64 _r2_eps,
+                                                const PS::F64 _k, const PS::F64 _dk, const PS::F64 _d2k) {
+        const PS::F64 r_inv = 1.0/sqrt(_r2_eps);
+        const PS::F64 r2_inv = r_inv*r_inv;
+        const PS::F64 r3_inv = r2_inv*r_inv;
+        const PS::F64 f = _k*r3_inv;
+        const PS::F64 df = (_dk - 3.0*_k*r_inv)*r3_inv;
+        const PS::F64 d2f = (_d2k - 6.0*_dk*r_inv + 12.0*_k*r2_inv)*r3_inv;
+        addCoeffRadial(_coeff, _dr, _mass, f, df*r_inv, (d2f - df*r_inv)*r2_inv);
+    }
+
+    //! set tensor from the coefficients accumulated at the c.m. position
+    /*! The c.m. force is not included (T1=0), consistent with fit
+      @param[in] _coeff: coefficients (N_COEFF)
+      @param[in] _pos: c.m. position
+     */
+    void setFromCoeff(const PS::F64* _coeff, const PS::F64vec& _pos) {
+        pos = _pos;
+        T1[0] = T1[1] = T1[2] = 0.0;
+        T2[0] = _coeff[0];
+        T2[1] = T2[3] = _coeff[1];
+        T2[2] = T2[6] = _coeff[2];
+        T2[4] = _coeff[3];
+        T2[5] = T2[7] = _coeff[4];
+        T2[8] = _coeff[5];
+#ifdef TIDAL_TENSOR_3RD
+        for (PS::S32 i=0; i<10; i++) T3[i] = _coeff[i+6];
 #endif
     }
 };
 
+
+//! k-d tree index of tidal tensor c.m. positions for finding the closest tensor
+/*! The index is built once for a tensor array in a cluster (O(n log n)), then each query costs about O(log n).
+    The tree splits at the median along the direction with the largest extent, thus it is not sensitive to the 
+    strongly clustered distribution of groups in a star cluster.
+    The index keeps its own copy of the positions, when a tensor c.m. is shifted, updatePosition should be called
+    so that the bounding boxes of the nodes are enlarged to include the new position.
+    The result is identical to the linear scan (the first tensor with the minimum distance).
+ */
+class TidalTensorIndex{
+private:
+    enum {LEAF_SIZE = 8};
+
+    //! tree node, leaf if left<0
+    struct Node{
+        PS::S32 begin, end; // range in index_
+        PS::S32 left, right; // child nodes
+        PS::S32 parent; // parent node, -1 for root
+        PS::F64vec pos_min, pos_max; // bounding box of the positions
+    };
+
+    PS::ReallocatableArray<Node> node_;
+    PS::ReallocatableArray<PS::S32> index_; // tensor index sorted by tree
+    PS::ReallocatableArray<PS::S32> leaf_;  // leaf node of each tensor
+    PS::ReallocatableArray<PS::F64vec> pos_; // indexed tensor positions
+    PS::S32 n_tt_;          // number of tensors
+
+    //! comparison of tensor positions in one direction
+    struct CompPos{
+        const PS::F64vec* pos;
+        PS::S32 dim;
+        bool operator() (const PS::S32 _i, const PS::S32 _j) const {
+            return pos[_i][dim] < pos[_j][dim];
+        }
+    };
+
+    //! build a node for index_ range [_begin, _end)
+    PS::S32 buildNode(const PS::S32 _begin, const PS::S32 _end, const PS::S32 _parent) {
+        const PS::S32 inode = node_.size();
+        node_.increaseSize(1);
+        node_[inode].begin = _begin;
+        node_[inode].end = _end;
+        node_[inode].left = node_[inode].right = -1;
+        node_[inode].parent = _parent;
+
+        // bounding box
+        PS::F64vec pos_min = pos_[index_[_begin]];
+        PS::F64vec pos_max = pos_min;
+        for (PS::S32 i=_begin+1; i<_end; i++) {
+            const PS::F64vec& pos = pos_[index_[i]];
+            for (PS::S32 k=0; k<3; k++) {
+                pos_min[k] = std::min(pos_min[k], pos[k]);
+                pos_max[k] = std::max(pos_max[k], pos[k]);
+            }
+        }
+        node_[inode].pos_min = pos_min;
+        node_[inode].pos_max = pos_max;
+
+        // split along the largest extent
+        PS::S32 dim = 0;
+        for (PS::S32 k=1; k<3; k++) 
+            if (pos_max[k]-pos_min[k] > pos_max[dim]-pos_min[dim]) dim = k;
+        // leaf, or all tensors at the same position
+        if (_end-_begin<=LEAF_SIZE || pos_max[dim]<=pos_min[dim]) {
+            for (PS::S32 i=_begin; i<_end; i++) leaf_[index_[i]] = inode;
+            return inode;
+        }
+
+        const PS::S32 mid = (_begin+_end)/2;
+        CompPos comp = {pos_.getPointer(), dim};
+        std::nth_element(index_.getPointer(_begin), index_.getPointer(mid), index_.getPointer(_end), comp);
+        const PS::S32 left = buildNode(_begin, mid, inode);
+        const PS::S32 right = buildNode(mid, _end, inode);
+        // node_ may be reallocated during recursion
+        node_[inode].left = left;
+        node_[inode].right = right;
+        return inode;
+    }
+
+    //! square distance from a position to the bounding box of a node
+    PS::F64 getDistance2Box(const PS::F64vec& _pos, const Node& _nd) const {
+        PS::F64 r2 = 0.0;
+        for (PS::S32 k=0; k<3; k++) {
+            PS::F64 dx = std::max(_nd.pos_min[k]-_pos[k], _pos[k]-_nd.pos_max[k]);
+            if (dx>0.0) r2 += dx*dx;
+        }
+        return r2;
+    }
+
+    //! search the closest tensor in a node
+    void searchNode(PS::S32& _index, PS::F64& _r_min2, const PS::F64vec& _pos, const PS::S32 _inode) const {
+        const Node& nd = node_[_inode];
+        if (nd.left<0) {
+            for (PS::S32 k=nd.begin; k<nd.end; k++) {
+                const PS::S32 i = index_[k];
+                PS::F64vec dr = _pos - pos_[i];
+                PS::F64 r2 = dr*dr;
+                if (r2<_r_min2 || (r2==_r_min2 && i<_index)) {
+                    _index = i;
+                    _r_min2 = r2;
+                }
+            }
+            return;
+        }
+        const PS::F64 r2_left  = getDistance2Box(_pos, node_[nd.left]);
+        const PS::F64 r2_right = getDistance2Box(_pos, node_[nd.right]);
+        const PS::S32 near = r2_left<=r2_right ? nd.left : nd.right;
+        const PS::S32 far  = r2_left<=r2_right ? nd.right : nd.left;
+        const PS::F64 r2_far = std::max(r2_left, r2_right);
+        searchNode(_index, _r_min2, _pos, near);
+        // equal distance is also checked to select the smallest index
+        if (r2_far<=_r_min2) searchNode(_index, _r_min2, _pos, far);
+    }
+
+public:
+    TidalTensorIndex(): node_(), index_(), leaf_(), pos_(), n_tt_(0) {}
+
+    //! build tree for a tensor array
+    /*! The positions are copied, thus later changes of the tensor array are not seen by the index except via updatePosition
+      @param[in] _tt: tensor array
+      @param[in] _n_tt: number of tensors
+     */
+    void build(const TidalTensor* _tt, const PS::S32 _n_tt) {
+        n_tt_ = _n_tt;
+        node_.clearSize();
+        index_.resizeNoInitialize(_n_tt);
+        leaf_.resizeNoInitialize(_n_tt);
+        pos_.resizeNoInitialize(_n_tt);
+        for (PS::S32 i=0; i<_n_tt; i++) {
+            index_[i] = i;
+            pos_[i] = _tt[i].pos;
+        }
+        if (_n_tt>0) buildNode(0, _n_tt, -1);
+    }
+
+    //! update the position of one tensor, e.g. after TidalTensor::shiftCM
+    /*! The bounding boxes of the nodes containing the tensor are enlarged, the cost is O(log n).
+        If many tensors move far away, the search becomes slower and the index should be rebuilt.
+      @param[in] _i: tensor index
+      @param[in] _pos: new position
+     */
+    void updatePosition(const PS::S32 _i, const PS::F64vec& _pos) {
+        pos_[_i] = _pos;
+        for (PS::S32 inode=leaf_[_i]; inode>=0; inode=node_[inode].parent) {
+            Node& nd = node_[inode];
+            for (PS::S32 k=0; k<3; k++) {
+                nd.pos_min[k] = std::min(nd.pos_min[k], _pos[k]);
+                nd.pos_max[k] = std::max(nd.pos_max[k], _pos[k]);
+            }
+        }
+    }
+
+    //! find the closest tensor
+    /*!
+      @param[in] _pos: position
+      \return the tensor index, if no tensor exists, return -1
+     */
+    PS::S32 findClosest(const PS::F64vec& _pos) const {
+        if (n_tt_==0) return -1;
+        PS::S32 index = -1;
+        PS::F64 r_min2 = PS::LARGE_FLOAT;
+        searchNode(index, r_min2, _pos, 0);
+        return index;
+    }
+
+    //! get number of indexed tensors
+    PS::S32 getSize() const {
+        return n_tt_;
+    }
+};
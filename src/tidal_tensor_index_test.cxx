@@ -0,0 +1,205 @@
+#include <iostream>
+#include <cstdio>
+#include <iomanip>
+#include <cstdlib>
+#include <cassert>
+#include <cmath>
+#include <getopt.h>
+#include <particle_simulator.hpp>
+#include "soft_ptcl.hpp"
+#include "tidal_tensor.hpp"
+#include "ar_perturber.hpp"
+#include "static_variables.hpp"
+
+//! uniform random number in [0,1)
+PS::F64 getRandom() {
+    return (PS::F64)rand()/((PS::F64)RAND_MAX+1.0);
+}
+
+//! random position in a Plummer sphere
+PS::F64vec getPlummerPos() {
+    const PS::F64 r = 1.0/std::sqrt(std::pow(std::max(getRandom(),1e-6), -2.0/3.0) - 1.0);
+    const PS::F64 cth = 2.0*getRandom()-1.0;
+    const PS::F64 sth = std::sqrt(1.0-cth*cth);
+    const PS::F64 phi = 2.0*M_PI*getRandom();
+    return PS::F64vec(r*sth*std::cos(phi), r*sth*std::sin(phi), r*cth);
+}
+
+//! closest tensor by linear scan, same as ARPerturber::findCloseSoftPert
+PS::S32 findClosestLinear(const TidalTensor* _tt, const PS::S32 _n_tt, const PS::F64vec& _pos) {
+    PS::F64 r_min2=PS::LARGE_FLOAT;
+    PS::S32 r_min_index=-1;
+    for (int i=0; i<_n_tt; i++) {
+        PS::F64vec dr = _pos - _tt[i].pos;
+        PS::F64 r2 = dr*dr;
+        if (r_min2>r2) {
+            r_min_index = i;
+            r_min2 = r2;
+        }
+    }
+    return r_min_index;
+}
+
+int main(int argc, char **argv){
+    PS::S32 n_min = 100;    // minimum number of binaries
+    PS::S32 n_max = 3200;   // maximum number of binaries
+    PS::F64 r_cluster = 0.05; // cluster size in the unit of Plummer radius
+    PS::S32 n_loop = 20;    // number of repeats for timing
+
+    int copt;
+    while ((copt = getopt(argc, argv, "n:m:r:l:h")) != -1)
+        switch (copt) {
+        case 'n':
+            n_min = atoi(optarg);
+            break;
+        case 'm':
+            n_max = atoi(optarg);
+            break;
+        case 'r':
+            r_cluster = atof(optarg);
+            break;
+        case 'l':
+            n_loop = atoi(optarg);
+            break;
+        case 'h':
+            std::cout<<"Benchmark of the closest tidal tensor search: linear scan vs. k-d tree index\n"
+                     <<"Options: \n"
+                     <<"  -n: minimum number of binaries in one cluster, multiplied by 2 until the maximum ("<<n_min<<")\n"
+                     <<"  -m: maximum number of binaries ("<<n_max<<")\n"
+                     <<"  -r: cluster size in the unit of Plummer radius ("<<r_cluster<<")\n"
+                     <<"  -l: number of repeats for timing ("<<n_loop<<")\n";
+            return 0;
+        default:
+            break;
+        }
+
+    std::cout<<std::setw(10)<<"n_binary"
+             <<std::setw(14)<<"t_linear"
+             <<std::setw(14)<<"t_index"
+             <<std::setw(14)<<"t_build"
+             <<std::setw(12)<<"speedup"
+             <<std::endl;
+
+    srand(1234);
+    PS::ReallocatableArray<TidalTensor> tt;
+    PS::ReallocatableArray<PS::F64vec> query;
+    PS::ReallocatableArray<PS::S32> index_linear, index_tree;
+    TidalTensorIndex tt_index;
+    for (PS::S32 n=n_min; n<=n_max; n*=2) {
+        // one tensor at the c.m. of each binary of a cluster, a few binaries share the same c.m. (ties)
+        tt.resizeNoInitialize(n);
+        for (PS::S32 i=0; i<n; i++) {
+            tt[i].clear();
+            if (i>0 && getRandom()<0.02) tt[i].pos = tt[i-1].pos;
+            else tt[i].pos = getPlummerPos()*r_cluster;
+            tt[i].group_id = -(i+1);
+        }
+
+        // queries: binaries after drifting and at the tensor c.m. (timed), random points in the cluster and far outside
+        const PS::S32 n_query = 4*n;
+        const PS::S32 n_query_group = 2*n;
+        query.resizeNoInitialize(n_query);
+        for (PS::S32 i=0; i<n; i++) {
+            query[i] = tt[i].pos + PS::F64vec(getRandom()-0.5, getRandom()-0.5, getRandom()-0.5)*(1e-3*r_cluster);
+            query[n+i] = tt[i].pos;
+            query[2*n+i] = getPlummerPos()*r_cluster;
+            query[3*n+i] = getPlummerPos()*(100.0*r_cluster);
+        }
+        index_linear.resizeNoInitialize(n_query);
+        index_tree.resizeNoInitialize(n_query);
+
+        PS::F64 t_linear = 0.0, t_index = 0.0, t_build = 0.0;
+        for (PS::S32 k=0; k<n_loop; k++) {
+            PS::F64 t0 = PS::GetWtime();
+            for (PS::S32 i=0; i<n_query_group; i++) index_linear[i] = findClosestLinear(tt.getPointer(), n, query[i]);
+            PS::F64 t1 = PS::GetWtime();
+            tt_index.build(tt.getPointer(), n);
+            PS::F64 t2 = PS::GetWtime();
+            for (PS::S32 i=0; i<n_query_group; i++) index_tree[i] = tt_index.findClosest(query[i]);
+            PS::F64 t3 = PS::GetWtime();
+            t_linear += t1-t0;
+            t_build += t2-t1;
+            t_index += t3-t1;
+        }
+
+        // check consistence
+        for (PS::S32 i=n_query_group; i<n_query; i++) {
+            index_linear[i] = findClosestLinear(tt.getPointer(), n, query[i]);
+            index_tree[i] = tt_index.findClosest(query[i]);
+        }
+        for (PS::S32 i=0; i<n_query; i++) {
+            if (index_linear[i]!=index_tree[i]) {
+                std::cerr<<"Error: closest tensor mismatch! n_binary="<<n<<" query "<<i<<" pos "<<query[i].x<<" "<<query[i].y<<" "<<query[i].z
+                         <<" linear: "<<index_linear[i]<<" index: "<<index_tree[i]<<std::endl;
+                abort();
+            }
+        }
+
+        t_linear /= n_loop;
+        t_index /= n_loop;
+        t_build /= n_loop;
+        std::cout<<std::setw(10)<<n
+                 <<std::setw(14)<<t_linear
+                 <<std::setw(14)<<t_index
+                 <<std::setw(14)<<t_build
+                 <<std::setw(12)<<t_linear/t_index
+                 <<std::endl;
+    }
+
+    // ARPerturber::findCloseSoftPert with index vs. linear scan, matched tensors are shifted to the c.m. of groups
+    {
+        const PS::S32 n = n_min;
+        PS::ReallocatableArray<TidalTensor> tt_linear, tt_tree;
+        tt_linear.resizeNoInitialize(n);
+        tt_tree.resizeNoInitialize(n);
+        for (PS::S32 i=0; i<n; i++) {
+            tt_linear[i].clear();
+            tt_linear[i].pos = getPlummerPos()*r_cluster;
+            tt_linear[i].group_id = -(i+1);
+            tt_tree[i] = tt_linear[i];
+        }
+        tt_index.build(tt_tree.getPointer(), n);
+        int n_tt = n;
+        ARPerturber pert_linear, pert_tree;
+        H4::ParticleH4<PtclHard> cm;
+        PS::S32 n_match = 0;
+        for (PS::S32 k=0; k<4*n; k++) {
+            // a group drifts from its tensor c.m., some drift far enough to be closer to another tensor
+            const PS::S32 j = PS::S32(getRandom()*n);
+            const PS::F64 drift = (k%2==0) ? 1e-3*r_cluster : 0.3*r_cluster;
+            cm.pos = tt_linear[j].pos + PS::F64vec(getRandom()-0.5, getRandom()-0.5, getRandom()-0.5)*drift;
+            const PS::F64 gid = j+1;
+            PS::S32 i_linear = pert_linear.findCloseSoftPert(tt_linear.getPointer(), n_tt, n, cm, gid);
+            PS::S32 i_tree = pert_tree.findCloseSoftPert(tt_tree.getPointer(), tt_index, cm, gid);
+            if (i_linear!=i_tree) {
+                std::cerr<<"Error: findCloseSoftPert mismatch! query "<<k<<" group "<<gid<<" linear: "<<i_linear<<" index: "<<i_tree<<std::endl;
+                abort();
+            }
+            if (i_linear>=0) {
+                n_match++;
+                PS::F64vec dpos = tt_linear[i_linear].pos - tt_tree[i_tree].pos;
+                assert(dpos*dpos==0.0);
+                assert(tt_linear[i_linear].group_id==tt_tree[i_tree].group_id);
+            }
+            // random positions see the shifted tensors
+            PS::F64vec pos = getPlummerPos()*r_cluster;
+            PS::S32 i_closest = findClosestLinear(tt_tree.getPointer(), n, pos);
+            if (tt_index.findClosest(pos)!=i_closest) {
+                std::cerr<<"Error: closest tensor mismatch after shift! query "<<k<<" linear: "<<i_closest<<" index: "<<tt_index.findClosest(pos)<<std::endl;
+                abort();
+            }
+        }
+        std::cout<<"findCloseSoftPert: "<<n_match<<" of "<<4*n<<" queries matched a tensor"<<std::endl;
+        assert(n_match>0);
+    }
+
+    // empty and single tensor cases
+    tt_index.build(tt.getPointer(), 0);
+    assert(tt_index.findClosest(PS::F64vec(0.0))==-1);
+    tt_index.build(tt.getPointer(), 1);
+    assert(tt_index.findClosest(PS::F64vec(1e10, -1e10, 0.0))==0);
+
+    std::cout<<"Tidal tensor index test passed"<<std::endl;
+
+    return 0;
+}
@@ -64,6 +64,23 @@ void printAcc(FPSoft* ptcl, FPSoft& pcm, int n, TidalTensor& tt) {
     }
 }
 
+//! relative RMS difference of the tensor acceleration at particles
+/*! \return sqrt(sum |acc(tt)-acc|^2 / sum |acc|^2)
+ */
+PS::F64 calcAccError(FPSoft* ptcl, FPSoft& pcm, int n, TidalTensor& tt) {
+    PS::F64 da2_sum = 0.0, a2_sum = 0.0;
+    for (int i=0; i<n; i++) {
+        PS::F64vec acc;
+        acc.x = acc.y = acc.z = 0.0;
+        PS::F64vec pos = ptcl[i].pos - pcm.pos;
+        tt.eval(&acc.x, pos);
+        PS::F64vec da = acc - ptcl[i].acc;
+        da2_sum += da*da;
+        a2_sum += ptcl[i].acc*ptcl[i].acc;
+    }
+    return a2_sum>0.0 ? sqrt(da2_sum/a2_sum) : 0.0;
+}
+
 int main(int argc, char **argv){
 
 #ifdef GALPY
@@ -195,24 +212,36 @@ int main(int argc, char **argv){
         std::cout<<"I"<<i<<" "<<ptcl_check[i].pos<<std::endl;
     }
 
+    // tidal tensor coefficients from tree moments at the center
+    PS::F64 coeff_tree[TidalTensor::N_COEFF];
+    for (int k=0; k<TidalTensor::N_COEFF; k++) coeff_tree[k] = 0.0;
+
     if (Nepj>0) {
         EPISoft epi[Nepi];
         for (int i=0; i<n_tt; i++) {
             epi[i].id = i+1;
             epi[i].pos = ptcl_tt[i].pos;
             epi[i].r_search = r_scale*2;
+            epi[i].type = 1;
             ptcl_tt[i].group_data.artificial.setParticleTypeToSingle();
         }
         epi[n_tt].id = 9;
         epi[n_tt].pos = ptcl_binary_cm.pos;
         epi[n_tt].r_search  = r_scale*2;
+        epi[n_tt].type = 1;
 
         for (int i=0; i<n_check; i++) {
             int k = i+n_tt+1;
             epi[k].id = k+1;
             epi[k].pos = ptcl[i].pos;
             epi[k].r_search = r_scale*2;
+            epi[k].type = 1;
         }
+#ifdef TIDAL_TENSOR_TREE
+        // only the center calculates the tidal tensor coefficients
+        for (int i=0; i<Nepi; i++) epi[i].tt_flag = 0;
+        epi[n_tt].tt_flag = 1;
+#endif
 
         EPJSoft epj[Nepj];
         for (int i=0; i<Nepj; i++) {
@@ -223,7 +252,7 @@ int main(int argc, char **argv){
 
         // calculate force
         ForceSoft force_sp[Nepi]; //8: box; last cm
-        for (int i=0; i<Nepi; i++) force_sp[i].acc = PS::F64vec(0,0,0);
+        for (int i=0; i<Nepi; i++) force_sp[i].clear();
         CalcForceEpSpMonoNoSimd f_ep_sp;
         ForceSoft::grav_const = gravitational_constant;
         EPISoft::eps = 0.0;
@@ -235,16 +264,27 @@ int main(int argc, char **argv){
         for (int i=0; i<n_tt; i++) ptcl_tt[i].copyFromForce(force_sp[i]);
         ptcl_binary_cm.copyFromForce(force_sp[n_tt]);
         for (int i=0; i<n_check; i++) ptcl_check[i].copyFromForce(force_sp[i+n_tt+1]);
+
+        // tidal tensor coefficients at the center
+#ifdef TIDAL_TENSOR_TREE
+        // from the tree force kernel
+        for (int k=0; k<TidalTensor::N_COEFF; k++) coeff_tree[k] = ptcl_binary_cm.tt_coeff[k];
+#else
+        // the same as the tree force kernel with TIDAL_TENSOR_TREE
+        for (int j=0; j<Nepj; j++) {
+            PS::F64vec dr = ptcl_binary_cm.pos - epj[j].pos;
+            TidalTensor::addCoeffPointMass(coeff_tree, dr, gravitational_constant*epj[j].mass, dr*dr);
+        }
+#endif
     }
 
 #ifdef GALPY
     addExtAcc(ptcl_binary_cm, pos_off, galpy_manager);
     for (int i=0; i<n_tt; i++) addExtAcc(ptcl_tt[i], pos_off, galpy_manager);
-    for (int i=0; i<n_check; i++) {
-        addExtAcc(ptcl_check[i], pos_off, galpy_manager);
-        ptcl_check[i].acc -= ptcl_binary_cm.acc;
-    }
+    for (int i=0; i<n_check; i++) addExtAcc(ptcl_check[i], pos_off, galpy_manager);
 #endif
+    // the tensor force does not include the c.m. force
+    for (int i=0; i<n_check; i++) ptcl_check[i].acc -= ptcl_binary_cm.acc;
 
     // print acc at box
     std::cout<<"Original acc at tensor box:\n";
@@ -271,6 +311,35 @@ int main(int argc, char **argv){
     std::cout<<"Check acc at measuring points\n";
     printAcc(ptcl_check, ptcl_binary_cm, n_check, tt);
 
+    // compare with the tidal tensor from tree moments at the center
+    TidalTensor tt_tree;
+    tt_tree.setFromCoeff(coeff_tree, ptcl_binary_cm.pos);
+    std::cout<<"Tidal tensor from tree moments:\n";
+#ifdef GALPY
+    std::cout<<"Notice: the external potential is not included\n";
+#endif
+    tt_tree.print(std::cout,PRINT_WIDTH);
+
+    std::cout<<"Check acc at box sample points (tree moments)\n";
+    printAcc(ptcl_tt, ptcl_binary_cm, n_tt, tt_tree);
+
+    std::cout<<"Check acc at measuring points (tree moments)\n";
+    printAcc(ptcl_check, ptcl_binary_cm, n_check, tt_tree);
+
+    std::cout<<"Relative RMS acc error:\n"
+             <<std::setw(24)<<" "
+             <<std::setw(PRINT_WIDTH)<<"fit"
+             <<std::setw(PRINT_WIDTH)<<"tree"
+             <<std::endl
+             <<std::setw(24)<<"box sample points"
+             <<std::setw(PRINT_WIDTH)<<calcAccError(ptcl_tt, ptcl_binary_cm, n_tt, tt)
+             <<std::setw(PRINT_WIDTH)<<calcAccError(ptcl_tt, ptcl_binary_cm, n_tt, tt_tree)
+             <<std::endl
+             <<std::setw(24)<<"measuring points"
+             <<std::setw(PRINT_WIDTH)<<calcAccError(ptcl_check, ptcl_binary_cm, n_check, tt)
+             <<std::setw(PRINT_WIDTH)<<calcAccError(ptcl_check, ptcl_binary_cm, n_check, tt_tree)
+             <<std::endl;
+
     return 0;
 }
 
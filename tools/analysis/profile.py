@@ -49,6 +49,7 @@ class PeTarProfile(DictNpArrayMix):
         hard_isolated (1D): short-range integration of clusters with multiple particles in local MPI process (Hermite + SDAR)
         hard_connected (1D): short-range integration of clusters with multiple particles crossing multiple MPI processes (Hermite + SDAR; MPI communication)
         hard_interrupt (1D): short-range integration of interrupted clusters
+        hard_sse (1D): batched stellar evolution of single stars (part of hard_single)
         tree_neighbor (1D): particle-tree construction of n_real and neighbor searching
         tree_force    (1D): particle-tree construction of n_all and tree forace calculattion
         force_correct (1D): force correction for changeover function
@@ -64,7 +65,7 @@ class PeTarProfile(DictNpArrayMix):
     def __init__ (self, _dat=None, _offset=int(0), _append=False, **kwargs):
         """ DictNpArrayMix type initialzation, see help(DictNpArrayMix.__init__)
         """
-        keys = [["total",np.float64], ["hard_single",np.float64], ["hard_isolated",np.float64], ["hard_connected",np.float64], ["hard_interrupt",np.float64], ["tree_neighbor",np.float64], ["tree_force",np.float64], ["force_correct",np.float64], ["kick",np.float64], ["search_cluster",np.float64], ["create_group",np.float64], ["domain_decomp",np.float64], ["exchange_ptcl",np.float64], ["output",np.float64], ["status",np.float64],["other",np.float64]]
+        keys = [["total",np.float64], ["hard_single",np.float64], ["hard_isolated",np.float64], ["hard_connected",np.float64], ["hard_interrupt",np.float64], ["hard_sse",np.float64], ["tree_neighbor",np.float64], ["tree_force",np.float64], ["force_correct",np.float64], ["kick",np.float64], ["search_cluster",np.float64], ["create_group",np.float64], ["domain_decomp",np.float64], ["exchange_ptcl",np.float64], ["output",np.float64], ["status",np.float64],["other",np.float64]]
         DictNpArrayMix.__init__(self, keys, _dat, _offset, _append, **kwargs)
 
 class GPUProfile(DictNpArrayMix):
@@ -93,6 +94,7 @@ class PeTarCount(DictNpArrayMix):
         hard_isolated:  number of particles in isolated clusters
         hard_connected:  number of particles in connected clusters
         hard_interrupt: number of clusters suffering interruptions
+        hard_sse: number of single stars evolved in the stellar evolution batch
         cluster_isolated: number of clusters with multiple particles in local MPI process
         cluster_connected: number of clusters with multiple particles crosing multiple MPI processes
         AR_step_sum: total AR steps
@@ -107,7 +109,7 @@ class PeTarCount(DictNpArrayMix):
     def __init__(self, _dat=None, _offset=int(0), _append=False, **kwargs):
         """ DictNpArrayMix type initialzation, see help(DictNpArrayMix.__init__)
         """
-        keys = [["hard_single",np.int64], ["hard_isolated",np.int64], ["hard_connected",np.int64], ["hard_interrupt",np.int64], ["cluster_isolated",np.int64], ["cluster_connected",np.int64], ["AR_step_sum",np.int64], ["AR_tsyn_step_sum",np.int64], ["AR_group_number",np.int64], ["iso_group_number",np.int64], ["Hermite_step_sum",np.int64], ["n_neighbor_zero",np.int64], ["Ep_Ep_interaction",np.int64], ["Ep_Sp_interaction",np.int64]]
+        keys = [["hard_single",np.int64], ["hard_isolated",np.int64], ["hard_connected",np.int64], ["hard_interrupt",np.int64], ["hard_sse",np.int64], ["cluster_isolated",np.int64], ["cluster_connected",np.int64], ["AR_step_sum",np.int64], ["AR_tsyn_step_sum",np.int64], ["AR_group_number",np.int64], ["iso_group_number",np.int64], ["Hermite_step_sum",np.int64], ["n_neighbor_zero",np.int64], ["Ep_Ep_interaction",np.int64], ["Ep_Sp_interaction",np.int64]]
         DictNpArrayMix.__init__(self, keys, _dat, _offset, _append, **kwargs)
 
 class Profile(DictNpArrayMix):